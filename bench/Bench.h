@@ -0,0 +1,117 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace doip::bench {
+
+/**
+ * @brief Number of heap allocations and allocated bytes since program start.
+ *
+ * Counted by the replaced global operator new (see BenchMain.cpp).
+ */
+struct AllocationCounters {
+    uint64_t allocations{0};
+    uint64_t bytes{0};
+};
+
+AllocationCounters allocationCounters();
+
+/**
+ * @brief Prevent the compiler from optimizing away a value.
+ */
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Result of a single benchmark.
+ */
+struct BenchResult {
+    std::string name;
+    uint64_t iterations{0};
+    double nsPerOp{0.0};
+    double allocationsPerOp{0.0};
+    double bytesPerOp{0.0};
+};
+
+/**
+ * @brief Measurement context passed to a benchmark function.
+ *
+ * A benchmark calls run() exactly once with the operation to measure. The
+ * operation is repeated with growing iteration counts until a batch takes at
+ * least the configured minimum time; the last batch is reported.
+ */
+class Bench {
+  public:
+    Bench(std::string name, std::chrono::milliseconds minTime) : m_minTime(minTime) { m_result.name = std::move(name); }
+
+    template <typename Op>
+    void run(Op &&op) {
+        // Warm-up, so lazy initialization does not count
+        op();
+
+        uint64_t iterations = 1;
+        while (true) {
+            AllocationCounters before = allocationCounters();
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) {
+                op();
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            AllocationCounters after = allocationCounters();
+
+            if (elapsed >= m_minTime || iterations >= (uint64_t{1} << 40)) {
+                auto n = static_cast<double>(iterations);
+                m_result.iterations = iterations;
+                m_result.nsPerOp = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / n;
+                m_result.allocationsPerOp = static_cast<double>(after.allocations - before.allocations) / n;
+                m_result.bytesPerOp = static_cast<double>(after.bytes - before.bytes) / n;
+                return;
+            }
+            iterations *= elapsed * 10 < m_minTime ? 10u : 2u;
+        }
+    }
+
+    const BenchResult &result() const { return m_result; }
+
+  private:
+    std::chrono::milliseconds m_minTime;
+    BenchResult m_result;
+};
+
+using BenchFunction = void (*)(Bench &);
+
+/**
+ * @brief Register a benchmark (used by the BENCHMARK macro).
+ */
+bool registerBenchmark(const char *name, BenchFunction function);
+
+} // namespace doip::bench
+
+#define DOIP_BENCH_CONCAT_IMPL(a, b) a##b
+#define DOIP_BENCH_CONCAT(a, b) DOIP_BENCH_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Define and register a benchmark.
+ *
+ * Usage:
+ * @code
+ * BENCHMARK("ByteArray::writeU16BE") {
+ *     ByteArray data;
+ *     bench.run([&]() { ... });
+ * }
+ * @endcode
+ */
+#define BENCHMARK(name)                                                                                            \
+    static void DOIP_BENCH_CONCAT(doipBench_, __LINE__)(doip::bench::Bench & bench);                               \
+    static const bool DOIP_BENCH_CONCAT(doipBenchRegistered_, __LINE__) =                                          \
+        doip::bench::registerBenchmark(name, &DOIP_BENCH_CONCAT(doipBench_, __LINE__));                            \
+    static void DOIP_BENCH_CONCAT(doipBench_, __LINE__)(doip::bench::Bench & bench)
+
+#endif /* BENCH_H */
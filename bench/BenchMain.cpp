@@ -0,0 +1,131 @@
+#include "Bench.h"
+#include "Logger.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void *countedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+struct Registration {
+    const char *name;
+    doip::bench::BenchFunction function;
+};
+
+std::vector<Registration> &registry() {
+    static std::vector<Registration> benchmarks;
+    return benchmarks;
+}
+
+void usage(const char *program) {
+    std::printf("Usage: %s [--min-time-ms N] [filter...]\n", program);
+    std::printf("Runs all benchmarks whose name contains one of the filters (all if none given).\n");
+}
+
+} // namespace
+
+// Replaced global allocation functions, used to report allocations per operation
+void *operator new(std::size_t size) {
+    void *p = countedAlloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    void *p = countedAlloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace doip::bench {
+
+AllocationCounters allocationCounters() {
+    return {g_allocations.load(std::memory_order_relaxed), g_allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+bool registerBenchmark(const char *name, BenchFunction function) {
+    registry().push_back({name, function});
+    return true;
+}
+
+} // namespace doip::bench
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds minTime(200);
+    std::vector<const char *> filters;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            minTime = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    // Logging would dominate the measured paths
+    doip::Logger::setLevel(spdlog::level::off);
+
+    std::printf("%-56s %14s %12s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op");
+    for (const auto &benchmark : registry()) {
+        bool selected = filters.empty();
+        for (const char *filter : filters) {
+            selected = selected || std::strstr(benchmark.name, filter) != nullptr;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        doip::bench::Bench bench(benchmark.name, minTime);
+        benchmark.function(bench);
+        const auto &result = bench.result();
+        std::printf("%-56s %14llu %12.1f %12.2f %12.1f\n",
+                    result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations),
+                    result.nsPerOp,
+                    result.allocationsPerOp,
+                    result.bytesPerOp);
+    }
+    return 0;
+}
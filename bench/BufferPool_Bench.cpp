@@ -0,0 +1,92 @@
+#include "Bench.h"
+
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+// One operation mimics the buffers of a diagnostic exchange: the request is
+// built, copied out of the receive buffer and answered. With std::allocator
+// every buffer is a malloc/free pair, with PoolAllocator the buffers are
+// recycled through the thread cache of the BufferPool.
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 8 + 4; // generic header and addresses
+
+template <typename Allocator>
+using Buffer = std::vector<uint8_t, Allocator>;
+
+// The payload is copied with std::copy (memmove) like ByteArray::append(),
+// since libstdc++ copies element by element into new storage for allocators
+// other than std::allocator
+template <typename Allocator, size_t Length>
+Buffer<Allocator> buildMessage(const uint8_t *userData) {
+    Buffer<Allocator> message(HEADER_SIZE + Length);
+    std::copy(userData, userData + Length, message.begin() + HEADER_SIZE);
+    return message;
+}
+
+template <typename Allocator, size_t Length>
+void exchange(const uint8_t *userData) {
+    auto request = buildMessage<Allocator, Length>(userData);
+    Buffer<Allocator> received(request.size());
+    std::copy(request.begin(), request.end(), received.begin());
+    auto response = buildMessage<Allocator, Length>(received.data() + HEADER_SIZE);
+    doNotOptimize(response.data());
+}
+
+template <typename Allocator, size_t Length>
+void benchExchange(doip::bench::Bench &bench) {
+    std::vector<uint8_t> userData(Length, 0x22);
+    bench.run([&]() { exchange<Allocator, Length>(userData.data()); });
+}
+
+template <typename Allocator>
+void benchExchangeThreads(doip::bench::Bench &bench, int threads) {
+    constexpr int EXCHANGES_PER_THREAD = 10000;
+    std::vector<uint8_t> userData(64, 0x22);
+    bench.run([&]() {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&userData]() {
+                for (int i = 0; i < EXCHANGES_PER_THREAD; ++i) {
+                    exchange<Allocator, 64>(userData.data());
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    });
+}
+
+} // namespace
+
+BENCHMARK("exchange buffers std::allocator (64 bytes)") {
+    benchExchange<std::allocator<uint8_t>, 64>(bench);
+}
+
+BENCHMARK("exchange buffers PoolAllocator (64 bytes)") {
+    benchExchange<PoolAllocator<uint8_t>, 64>(bench);
+}
+
+BENCHMARK("exchange buffers std::allocator (4000 bytes)") {
+    benchExchange<std::allocator<uint8_t>, 4000>(bench);
+}
+
+BENCHMARK("exchange buffers PoolAllocator (4000 bytes)") {
+    benchExchange<PoolAllocator<uint8_t>, 4000>(bench);
+}
+
+BENCHMARK("exchange buffers std::allocator (4 threads x 10k)") {
+    benchExchangeThreads<std::allocator<uint8_t>>(bench, 4);
+}
+
+BENCHMARK("exchange buffers PoolAllocator (4 threads x 10k)") {
+    benchExchangeThreads<PoolAllocator<uint8_t>>(bench, 4);
+}
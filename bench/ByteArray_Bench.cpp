@@ -0,0 +1,44 @@
+#include "Bench.h"
+
+#include "ByteArray.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+BENCHMARK("ByteArray::writeU16BE (32 values)") {
+    ByteArray data;
+    data.reserve(64);
+    bench.run([&]() {
+        data.clear();
+        for (uint16_t i = 0; i < 32; ++i) {
+            data.writeU16BE(i);
+        }
+        doNotOptimize(data);
+    });
+}
+
+BENCHMARK("ByteArray::writeU32BE (32 values)") {
+    ByteArray data;
+    data.reserve(128);
+    bench.run([&]() {
+        data.clear();
+        for (uint32_t i = 0; i < 32; ++i) {
+            data.writeU32BE(i);
+        }
+        doNotOptimize(data);
+    });
+}
+
+BENCHMARK("ByteArray::readU32BE (32 values)") {
+    ByteArray data;
+    for (uint32_t i = 0; i < 32; ++i) {
+        data.writeU32BE(i * 0x01010101u);
+    }
+    bench.run([&]() {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < 32; ++i) {
+            sum += data.readU32BE(i * 4);
+        }
+        doNotOptimize(sum);
+    });
+}
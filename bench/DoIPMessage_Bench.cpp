@@ -0,0 +1,184 @@
+#include "Bench.h"
+
+#include <sstream>
+
+#include "DoIPMessage.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+namespace {
+
+ByteArray userData(size_t length) {
+    ByteArray data;
+    for (size_t i = 0; i < length; ++i) {
+        data.push_back(static_cast<uint8_t>(i));
+    }
+    return data;
+}
+
+const DoIPAddress SA(0x0E80);
+const DoIPAddress TA(0x1234);
+
+} // namespace
+
+BENCHMARK("DoIPMessage::tryParseHeader") {
+    auto msg = message::makeDiagnosticMessage(SA, TA, userData(64));
+    bench.run([&]() {
+        auto header = DoIPMessage::tryParseHeader(msg.data(), msg.size());
+        doNotOptimize(header);
+    });
+}
+
+BENCHMARK("DoIPMessage::tryParse (diagnostic, 64 bytes)") {
+    auto msg = message::makeDiagnosticMessage(SA, TA, userData(64));
+    bench.run([&]() {
+        auto parsed = DoIPMessage::tryParse(msg.data(), msg.size());
+        doNotOptimize(parsed);
+    });
+}
+
+BENCHMARK("DoIPMessage::tryParse (diagnostic, 4000 bytes)") {
+    auto msg = message::makeDiagnosticMessage(SA, TA, userData(4000));
+    bench.run([&]() {
+        auto parsed = DoIPMessage::tryParse(msg.data(), msg.size());
+        doNotOptimize(parsed);
+    });
+}
+
+BENCHMARK("message::makeVehicleIdentificationRequest") {
+    bench.run([&]() {
+        auto msg = message::makeVehicleIdentificationRequest();
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeVehicleIdentificationRequestWithEid") {
+    DoIpEid eid(0x001122334455);
+    bench.run([&]() {
+        auto msg = message::makeVehicleIdentificationRequestWithEid(eid);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeVehicleIdentificationRequestWithVin") {
+    DoIpVin vin("WVWZZZ1JZXW000001");
+    bench.run([&]() {
+        auto msg = message::makeVehicleIdentificationRequestWithVin(vin);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeVehicleIdentificationResponse") {
+    DoIpVin vin("WVWZZZ1JZXW000001");
+    DoIpEid eid(0x001122334455);
+    DoIpGid gid(0x665544332211);
+    bench.run([&]() {
+        auto msg = message::makeVehicleIdentificationResponse(vin, SA, eid, gid);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeEntityStatusRequest") {
+    bench.run([&]() {
+        auto msg = message::makeEntityStatusRequest();
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeEntityStatusResponse") {
+    bench.run([&]() {
+        auto msg = message::makeEntityStatusResponse(DoIPNodeType::Gateway, 255, 3, 4096);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticPowerModeRequest") {
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticPowerModeRequest();
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticPowerModeResponse") {
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticPowerModeResponse(DoIPPowerMode::Ready);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeNegativeAckMessage") {
+    bench.run([&]() {
+        auto msg = message::makeNegativeAckMessage(DoIPNegativeAck::InvalidPayloadLength);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticMessage (64 bytes)") {
+    auto data = userData(64);
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticMessage(SA, TA, data);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticMessage (4000 bytes)") {
+    auto data = userData(4000);
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticMessage(SA, TA, data);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticPositiveResponse") {
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticPositiveResponse(TA, SA, {});
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeDiagnosticNegativeResponse") {
+    bench.run([&]() {
+        auto msg = message::makeDiagnosticNegativeResponse(TA, SA, DoIPNegativeDiagnosticAck::TargetUnreachable, {});
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeAliveCheckRequest") {
+    bench.run([&]() {
+        auto msg = message::makeAliveCheckRequest();
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeAliveCheckResponse") {
+    bench.run([&]() {
+        auto msg = message::makeAliveCheckResponse(SA);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeRoutingActivationRequest") {
+    bench.run([&]() {
+        auto msg = message::makeRoutingActivationRequest(SA);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("message::makeRoutingActivationResponse") {
+    auto request = message::makeRoutingActivationRequest(SA);
+    bench.run([&]() {
+        auto msg = message::makeRoutingActivationResponse(request, TA);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("operator<<(DoIPMessage) (diagnostic, 64 bytes)") {
+    auto msg = message::makeDiagnosticMessage(SA, TA, userData(64));
+    std::ostringstream os;
+    bench.run([&]() {
+        os.str(std::string());
+        os << msg;
+        doNotOptimize(os);
+    });
+}
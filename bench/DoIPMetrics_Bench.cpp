@@ -0,0 +1,38 @@
+#include "Bench.h"
+
+#include "DoIPMetrics.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+BENCHMARK("DoIPMetrics::countReceived") {
+    DoIPMetrics metrics;
+    bench.run([&]() {
+        metrics.countReceived(DoIPPayloadType::DiagnosticMessage, 17);
+        doNotOptimize(metrics);
+    });
+}
+
+BENCHMARK("LatencyHistogram::observe") {
+    DoIPMetrics metrics;
+    auto latency = std::chrono::microseconds(120);
+    bench.run([&]() {
+        metrics.diagnosticHandlerLatency().observe(latency);
+        doNotOptimize(latency);
+    });
+}
+
+BENCHMARK("DoIPMetricsRegistry::snapshot (16 connections)") {
+    DoIPMetricsRegistry registry;
+    std::vector<DoIPMetrics> connections(16);
+    for (const auto &metrics : connections) {
+        registry.addConnection(&metrics);
+    }
+    bench.run([&]() {
+        auto snapshot = registry.snapshot();
+        doNotOptimize(snapshot);
+    });
+    for (const auto &metrics : connections) {
+        registry.removeConnection(&metrics);
+    }
+}
@@ -0,0 +1,37 @@
+#include "Bench.h"
+
+#include "DoIPRateLimiter.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+namespace {
+
+/**
+ * Each iteration checks one datagram of the given number of sources, round
+ * robin. With more sources than the table holds every check evicts a source.
+ */
+void benchAllowDatagram(doip::bench::Bench &bench, uint32_t sources) {
+    DoIPRateLimiter limiter(DOIP_DEFAULT_RATE_LIMIT_SOURCES, DoIPRateLimit{20.0, 40.0}, DoIPRateLimit{2.0, 5.0});
+    auto now = DoIPRateLimiter::Clock::now();
+    uint32_t address = 0;
+
+    bench.run([&]() {
+        doNotOptimize(limiter.allowDatagram(address, now));
+        address = address + 1 < sources ? address + 1 : 0;
+    });
+}
+
+} // namespace
+
+BENCHMARK("UDP rate limit check (one source)") {
+    benchAllowDatagram(bench, 1);
+}
+
+BENCHMARK("UDP rate limit check (512 sources)") {
+    benchAllowDatagram(bench, 512);
+}
+
+BENCHMARK("UDP rate limit check (1M sources, evicting)") {
+    benchAllowDatagram(bench, 1 << 20);
+}
@@ -0,0 +1,25 @@
+#include "Bench.h"
+
+#include "DoIPServer.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+BENCHMARK("Vehicle identification response (makeVehicleIdentificationResponse)") {
+    ServerConfig config;
+    config.vin = DoIpVin("TESTVIN1234567890");
+    bench.run([&]() {
+        auto msg = message::makeVehicleIdentificationResponse(config.vin, config.logicalAddress, config.eid, config.gid);
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("Vehicle identification response (DoIPServer cache)") {
+    ServerConfig config;
+    config.vin = DoIpVin("TESTVIN1234567890");
+    DoIPServer server(config);
+    bench.run([&]() {
+        auto msg = server.getVehicleIdentificationResponse();
+        doNotOptimize(msg->data());
+    });
+}
@@ -0,0 +1,76 @@
+#include "Bench.h"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "DoIPMessage.h"
+#include "DoIPUdpBatch.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+namespace {
+
+constexpr size_t BURST_SIZE = 16;
+
+int openLoopbackSocket(sockaddr_in &address) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+    return fd;
+}
+
+/**
+ * Each iteration, 16 testers send a vehicle identification request, the
+ * server answers all of them through a DoIPUdpBatch of the given capacity
+ * and the testers read their responses.
+ */
+void benchDiscoveryBurst(doip::bench::Bench &bench, size_t batchSize) {
+    sockaddr_in serverAddress;
+    int server = openLoopbackSocket(serverAddress);
+    int testers[BURST_SIZE];
+    for (int &tester : testers) {
+        sockaddr_in address;
+        tester = openLoopbackSocket(address);
+    }
+    auto request = message::makeVehicleIdentificationRequest();
+    auto response = message::makeVehicleIdentificationResponse(DoIpVin::Zero, DoIPAddress(0x0028), DoIpEid::Zero, DoIpGid::Zero);
+    DoIPUdpBatch batch(batchSize);
+    uint8_t buffer[64];
+
+    bench.run([&]() {
+        for (int tester : testers) {
+            sendto(tester, request.data(), request.size(), 0, reinterpret_cast<const sockaddr *>(&serverAddress), sizeof(serverAddress));
+        }
+        size_t handled = 0;
+        while (handled < BURST_SIZE) {
+            batch.receive(server);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch.addReply(batch.sender(i), response.data(), response.size());
+            }
+            handled += batch.flush(server);
+        }
+        for (int tester : testers) {
+            doNotOptimize(recv(tester, buffer, sizeof(buffer), 0));
+        }
+    });
+
+    for (int tester : testers) {
+        close(tester);
+    }
+    close(server);
+}
+
+} // namespace
+
+BENCHMARK("UDP discovery burst of 16 (one datagram per syscall)") {
+    benchDiscoveryBurst(bench, 1);
+}
+
+BENCHMARK("UDP discovery burst of 16 (recvmmsg/sendmmsg batch of 16)") {
+    benchDiscoveryBurst(bench, BURST_SIZE);
+}
@@ -0,0 +1,26 @@
+#include "Bench.h"
+
+#include "DoIPMessage.h"
+#include "Logger.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+// Logging is switched off while the benchmarks run, so these measure the cost
+// of a log statement whose level is disabled at runtime.
+
+BENCHMARK("LOG_DOIP_INFO disabled (streamed DoIPMessage)") {
+    auto msg = message::makeAliveCheckResponse(DoIPAddress(0x0E80));
+    bench.run([&]() {
+        LOG_DOIP_INFO("RX: {}", fmt::streamed(msg));
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("LOG_DOIP_SUCCESS disabled") {
+    int value = 42;
+    bench.run([&]() {
+        LOG_DOIP_SUCCESS("value {}", value);
+        doNotOptimize(value);
+    });
+}
@@ -0,0 +1,26 @@
+#include "Bench.h"
+
+#include "DoIPMessage.h"
+#include "ProtocolTrace.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+
+BENCHMARK("ProtocolTrace::record (stopped)") {
+    auto msg = message::makeDiagnosticPositiveResponse(DoIPAddress(0x0E80), DoIPAddress(0x1234), ByteArray{0x22, 0xF1, 0x90});
+    bench.run([&]() {
+        ProtocolTrace::instance().record(TraceDirection::Tx, TraceTransport::Tcp, 1, msg.data(), msg.size());
+        doNotOptimize(msg);
+    });
+}
+
+BENCHMARK("ProtocolTrace::record (running, 17 bytes)") {
+    auto msg = message::makeDiagnosticPositiveResponse(DoIPAddress(0x0E80), DoIPAddress(0x1234), ByteArray{0x22, 0xF1, 0x90});
+    auto &trace = ProtocolTrace::instance();
+    trace.start("/dev/null", 4 * 1024 * 1024);
+    bench.run([&]() {
+        trace.record(TraceDirection::Tx, TraceTransport::Tcp, 1, msg.data(), msg.size());
+        doNotOptimize(msg);
+    });
+    trace.stop();
+}
@@ -0,0 +1,102 @@
+#include "Bench.h"
+
+#include "RingQueue.h"
+#include "ThreadSafeQueue.h"
+
+#include <thread>
+#include <vector>
+
+using doip::bench::doNotOptimize;
+using namespace std::chrono_literals;
+
+// Each operation moves TRANSFER_ITEMS items from the producers to one consumer,
+// so ns/op divided by TRANSFER_ITEMS is the cost per item under contention.
+
+namespace {
+
+constexpr int TRANSFER_ITEMS = 1 << 16;
+constexpr size_t RING_CAPACITY = 1024;
+constexpr size_t POP_BATCH = 32;
+
+template<typename Queue, typename Consume>
+void transfer(Queue &queue, int producers, Consume &&consume) {
+    std::vector<std::thread> threads;
+    const int perProducer = TRANSFER_ITEMS / producers;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, perProducer]() {
+            for (int i = 0; i < perProducer; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+
+    int received = 0;
+    while (received < perProducer * producers) {
+        received += consume();
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void benchThreadSafeQueue(doip::bench::Bench &bench, int producers) {
+    ThreadSafeQueue<int> queue;
+    bench.run([&]() {
+        transfer(queue, producers, [&queue]() {
+            int item = 0;
+            bool ok = queue.pop(item, 10ms);
+            doNotOptimize(item);
+            return ok ? 1 : 0;
+        });
+    });
+}
+
+void benchMpmcRingQueue(doip::bench::Bench &bench, int producers) {
+    MpmcRingQueue<int> queue(RING_CAPACITY);
+    bench.run([&]() {
+        transfer(queue, producers, [&queue]() {
+            int items[POP_BATCH] = {};
+            size_t n = queue.pop_n(items, POP_BATCH, 10ms);
+            doNotOptimize(items);
+            return static_cast<int>(n);
+        });
+    });
+}
+
+} // namespace
+
+BENCHMARK("ThreadSafeQueue transfer 64k items (1 producer)") {
+    benchThreadSafeQueue(bench, 1);
+}
+
+BENCHMARK("SpscRingQueue transfer 64k items (1 producer, pop_n)") {
+    SpscRingQueue<int> queue(RING_CAPACITY);
+    bench.run([&]() {
+        transfer(queue, 1, [&queue]() {
+            int items[POP_BATCH] = {};
+            size_t n = queue.pop_n(items, POP_BATCH, 10ms);
+            doNotOptimize(items);
+            return static_cast<int>(n);
+        });
+    });
+}
+
+BENCHMARK("MpmcRingQueue transfer 64k items (1 producer, pop_n)") {
+    benchMpmcRingQueue(bench, 1);
+}
+
+BENCHMARK("ThreadSafeQueue transfer 64k items (4 producers)") {
+    benchThreadSafeQueue(bench, 4);
+}
+
+BENCHMARK("MpmcRingQueue transfer 64k items (4 producers, pop_n)") {
+    benchMpmcRingQueue(bench, 4);
+}
+
+BENCHMARK("ThreadSafeQueue transfer 64k items (16 producers)") {
+    benchThreadSafeQueue(bench, 16);
+}
+
+BENCHMARK("MpmcRingQueue transfer 64k items (16 producers, pop_n)") {
+    benchMpmcRingQueue(bench, 16);
+}
@@ -0,0 +1,214 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "uds/UdsMock.h"
+
+using namespace doip;
+using doip::bench::doNotOptimize;
+using namespace doip::uds;
+
+BENCHMARK("UdsMock::handleDiagnosticRequest (unsupported service)") {
+    UdsMock udsMock;
+    ByteArray request{0x10, 0x01};
+    bench.run([&]() {
+        auto response = udsMock.handleDiagnosticRequest(request);
+        doNotOptimize(response);
+    });
+}
+
+BENCHMARK("UdsMock::handleDiagnosticRequest (TesterPresent)") {
+    UdsMock udsMock;
+    udsMock.registerTesterPresentHandler([](uint8_t subFunction) {
+        return std::make_pair(UdsResponseCode::OK, ByteArray{subFunction});
+    });
+    ByteArray request{0x3E, 0x00};
+    bench.run([&]() {
+        auto response = udsMock.handleDiagnosticRequest(request);
+        doNotOptimize(response);
+    });
+}
+
+BENCHMARK("UdsMock::handleDiagnosticRequest (ReadDataByIdentifier)") {
+    UdsMock udsMock;
+    udsMock.registerReadDataByIdentifierHandler([](uint16_t did) {
+        ByteArray data;
+        data.writeU16BE(did);
+        data.insert(data.end(), {0x57, 0x56, 0x57, 0x5A, 0x5A, 0x5A});
+        return std::make_pair(UdsResponseCode::OK, data);
+    });
+    ByteArray request{0x22, 0xF1, 0x90};
+    bench.run([&]() {
+        auto response = udsMock.handleDiagnosticRequest(request);
+        doNotOptimize(response);
+    });
+}
+
+namespace {
+
+/**
+ * @brief Dispatch of the previous UdsMock: linear descriptor search, hash map
+ * lookup and a virtual call wrapping a std::function.
+ */
+class LinearSearchUdsDispatch {
+  public:
+    void registerService(UdsService serviceId, std::function<UdsResponse(const ByteArray &)> fn) {
+        m_handlers[static_cast<uint8_t>(serviceId)] = std::make_unique<LambdaUdsHandler>(std::move(fn));
+    }
+
+    ByteArray handleDiagnosticRequest(const ByteArray &request) const {
+        auto sid = static_cast<UdsService>(request[0]);
+        auto desc = std::find_if(UDS_SERVICE_DESCRIPTORS.begin(), UDS_SERVICE_DESCRIPTORS.end(),
+                                 [sid](const UdsServiceDescriptor &d) { return d.service == sid; });
+        if (desc == UDS_SERVICE_DESCRIPTORS.end()) {
+            return makeResponse(request, UdsResponseCode::ServiceNotSupported, {});
+        }
+        if (request.size() < desc->minReqLength || request.size() > desc->maxReqLength) {
+            return makeResponse(request, UdsResponseCode::IncorrectMessageLengthOrInvalidFormat, {});
+        }
+        auto it = m_handlers.find(request[0]);
+        if (it == m_handlers.end() || !it->second) {
+            return makeResponse(request, UdsResponseCode::ServiceNotSupported, {});
+        }
+        UdsResponse resp = it->second->handle(request);
+        size_t rspSize = resp.second.size() + 1;
+        if (rspSize < desc->minRspLength || rspSize > desc->maxRspLength) {
+            return makeResponse(request, UdsResponseCode::GeneralProgrammingFailure, {});
+        }
+        return makeResponse(request, resp.first, resp.second);
+    }
+
+  private:
+    std::unordered_map<uint8_t, IUdsServiceHandlerPtr> m_handlers;
+
+    // Same as UdsMock::makeResponse(), so only the dispatch differs
+    static ByteArray makeResponse(const ByteArray &request, UdsResponseCode responseCode, const ByteArray &extraData) {
+        if (responseCode != UdsResponseCode::OK) {
+            ByteArray negativeResponse;
+            negativeResponse.emplace_back(0x7F);
+            negativeResponse.emplace_back(request[0]);
+            negativeResponse.emplace_back(static_cast<uint8_t>(responseCode));
+            return negativeResponse;
+        }
+        ByteArray positiveResponse;
+        positiveResponse.emplace_back(static_cast<uint8_t>(request[0] + UDS_POSITIVE_RESPONSE_OFFSET));
+        positiveResponse.insert(positiveResponse.end(), extraData.begin(), extraData.end());
+        return positiveResponse;
+    }
+};
+
+const std::array<UdsService, 19> ALL_SERVICES = {
+    UdsService::DiagnosticSessionControl, UdsService::ECUReset, UdsService::SecurityAccess,
+    UdsService::CommunicationControl, UdsService::TesterPresent, UdsService::AccessTimingParameters,
+    UdsService::SecuredDataTransmission, UdsService::ControlDTCSetting, UdsService::ResponseOnEvent,
+    UdsService::LinkControl, UdsService::ReadDataByIdentifier, UdsService::ReadMemoryByAddress,
+    UdsService::ReadScalingDataByIdentifier, UdsService::ReadDataByPeriodicIdentifier,
+    UdsService::DynamicallyDefineDataIdentifier, UdsService::WriteDataByIdentifier,
+    UdsService::WriteMemoryByAddress, UdsService::ClearDiagnosticInformation, UdsService::ReadDTCInformation};
+
+// One request of minimum length per service, dispatched round robin
+std::vector<ByteArray> makeDispatchRequests() {
+    std::vector<ByteArray> requests;
+    for (auto service : ALL_SERVICES) {
+        ByteArray request{static_cast<uint8_t>(service)};
+        request.resize(UDS_SERVICE_DESCRIPTOR_TABLE[static_cast<uint8_t>(service)].minReqLength, 0x01);
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+template <typename Dispatch>
+void benchDispatch(doip::bench::Bench &bench, Dispatch &dispatch) {
+    for (auto service : ALL_SERVICES) {
+        // Positive response of minimum length
+        size_t dataSize = UDS_SERVICE_DESCRIPTOR_TABLE[static_cast<uint8_t>(service)].minRspLength - 1u;
+        dispatch.registerService(service, [dataSize](const ByteArray &request) {
+            ByteArray data;
+            data.resize(dataSize, request[1]);
+            return UdsResponse{UdsResponseCode::OK, data};
+        });
+    }
+    auto requests = makeDispatchRequests();
+    size_t next = 0;
+    bench.run([&]() {
+        auto response = dispatch.handleDiagnosticRequest(requests[next]);
+        next = next + 1 < requests.size() ? next + 1 : 0;
+        doNotOptimize(response);
+    });
+}
+
+} // namespace
+
+BENCHMARK("UDS dispatch, 19 services (linear search + hash map)") {
+    LinearSearchUdsDispatch dispatch;
+    benchDispatch(bench, dispatch);
+}
+
+BENCHMARK("UDS dispatch, 19 services (SID table)") {
+    UdsMock udsMock;
+    benchDispatch(bench, udsMock);
+}
+
+BENCHMARK("UDS service lookup, 19 services (linear search + hash map)") {
+    std::unordered_map<uint8_t, IUdsServiceHandlerPtr> handlers;
+    for (auto service : ALL_SERVICES) {
+        handlers[static_cast<uint8_t>(service)] = std::make_unique<LambdaUdsHandler>(nullptr);
+    }
+    size_t next = 0;
+    bench.run([&]() {
+        UdsService sid = ALL_SERVICES[next];
+        next = next + 1 < ALL_SERVICES.size() ? next + 1 : 0;
+        auto desc = std::find_if(UDS_SERVICE_DESCRIPTORS.begin(), UDS_SERVICE_DESCRIPTORS.end(),
+                                 [sid](const UdsServiceDescriptor &d) { return d.service == sid; });
+        auto handler = handlers.find(static_cast<uint8_t>(sid));
+        doNotOptimize(desc);
+        doNotOptimize(handler);
+    });
+}
+
+BENCHMARK("UDS service lookup, 19 services (SID table)") {
+    std::array<UdsServiceFunction, 256> handlers;
+    for (auto service : ALL_SERVICES) {
+        handlers[static_cast<uint8_t>(service)] = [](const ByteArray &request) { return UdsResponse{UdsResponseCode::OK, request}; };
+    }
+    size_t next = 0;
+    bench.run([&]() {
+        UdsService sid = ALL_SERVICES[next];
+        next = next + 1 < ALL_SERVICES.size() ? next + 1 : 0;
+        const UdsServiceDescriptor *desc = findServiceDescriptor(sid);
+        const UdsServiceFunction *handler = &handlers[static_cast<uint8_t>(sid)];
+        doNotOptimize(desc);
+        doNotOptimize(handler);
+    });
+}
+
+BENCHMARK("UDS RDBI response to DoIP message (returned ByteArray + makeDiagnosticMessage)") {
+    UdsMock udsMock;
+    udsMock.registerReadDataByIdentifierHandler([](uint16_t did) {
+        ByteArray response;
+        response.writeU16BE(did);
+        response.append(reinterpret_cast<const uint8_t *>("1HGCM82633A00001Z"), 17);
+        return std::make_pair(UdsResponseCode::OK, response);
+    });
+    ByteArray request{0x22, 0xF1, 0x90};
+    bench.run([&]() {
+        ByteArray response = udsMock.handleDiagnosticRequest(request);
+        auto message = message::makeDiagnosticMessage(DoIPAddress(0x1001), DoIPAddress(0x0E80), response);
+        doNotOptimize(message);
+    });
+}
+
+BENCHMARK("UDS RDBI response to DoIP message (in-place writer)") {
+    UdsMock udsMock;
+    udsMock.registerReadDataByIdentifierHandler([](uint16_t did, UdsResponseWriter &writer) {
+        (void)did;
+        writer.write(reinterpret_cast<const uint8_t *>("1HGCM82633A00001Z"), 17);
+        return UdsResponseCode::OK;
+    });
+    ByteArray request{0x22, 0xF1, 0x90};
+    bench.run([&]() {
+        auto message = udsMock.handleDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1001), request);
+        doNotOptimize(message);
+    });
+}
@@ -6,8 +6,8 @@
 #ifndef EXAMPLEDOIPSERVERMODEL_H
 #define EXAMPLEDOIPSERVERMODEL_H
 
+#include "DoIPDownstreamDispatcher.h"
 #include "DoIPServerModel.h"
-#include "ThreadSafeQueue.h"
 #include "uds/UdsMock.h"
 #include "uds/UdsResponseCode.h"
 
@@ -18,15 +18,15 @@ class ExampleDoIPServerModel : public DoIPServerModel {
     ExampleDoIPServerModel() {
         onOpenConnection = [this](IConnectionContext &ctx) noexcept {
             (void)ctx;
-            startWorker();
+            m_dispatcher.start();
         };
         onCloseConnection = [this](IConnectionContext &ctx, DoIPCloseReason reason) noexcept {
             (void)ctx;
-            stopWorker();
+            m_dispatcher.stop();
             LOG_DOIP_WARN("Connection closed ({})", fmt::streamed(reason));
         };
 
-        onDiagnosticMessage = [this](IConnectionContext &ctx, const DoIPMessage &msg) noexcept -> DoIPDiagnosticAck {
+        onDiagnosticMessage = [this](IConnectionContext &ctx, const DoIPMessageView &msg) noexcept -> DoIPDiagnosticAck {
             (void)ctx;
             m_log->info("Received Diagnostic message (from ExampleDoIPServerModel)", fmt::streamed(msg));
 
@@ -45,23 +45,7 @@ class ExampleDoIPServerModel : public DoIPServerModel {
             m_log->info("Diagnostic ACK/NACK sent (from ExampleDoIPServerModel)", fmt::streamed(ack));
         };
 
-        onDownstreamRequest = [this](IConnectionContext &ctx, const DoIPMessage &msg, ServerModelDownstreamResponseHandler callback) noexcept {
-            (void)ctx;
-            (void)msg;
-
-            m_log->info("Received downstream request (from ExampleDoIPServerModel)", fmt::streamed(msg));
-            m_downstreamCallback = callback;
-            if (!m_downstreamCallback) {
-                m_log->error("onDownstreamRequest: No callback function passed");
-                return DoIPDownstreamResult::Error;
-            }
-
-            // Store message in send queue
-            auto [data, size] = msg.getDiagnosticMessagePayload();
-            m_tx.push(ByteArray(data, size));
-            m_log->info("Enqueued msg");
-            return DoIPDownstreamResult::Pending;
-        };
+        onDownstreamRequest = m_dispatcher.makeHandler();
 
         m_uds.registerDefaultServices();
 
@@ -78,18 +62,17 @@ class ExampleDoIPServerModel : public DoIPServerModel {
             return std::make_pair(uds::UdsResponseCode::PositiveResponse, ByteArray{resetType}); // Positive response SID = 0x61
         });
 
-        m_uds.registerReadDataByIdentifierHandler([this](uint16_t did) {
+        m_uds.registerReadDataByIdentifierHandler([this](uint16_t did, uds::UdsResponseWriter &writer) {
             m_loguds->info("Read Data By Identifier requested, DID={:04X}", did);
             if (did == 0xF190) {
-                // Return example VIN
-                ByteArray vinPayload = {'1', 'H', 'G', 'C', 'M',
-                                        '8', '2', '6', '3', '3',
-                                        'A', '0', '0', '0', '0', '1', 'Z'};
-                ByteArray response = {static_cast<uint8_t>((did >> 8) & 0xFF), static_cast<uint8_t>(did & 0xFF)};
-                response.insert(response.end(), vinPayload.begin(), vinPayload.end());
-                return std::make_pair(uds::UdsResponseCode::PositiveResponse, response); // Positive response
+                // Return example VIN, written directly after the DID
+                static constexpr std::array<uint8_t, 17> vin = {'1', 'H', 'G', 'C', 'M',
+                                                                '8', '2', '6', '3', '3',
+                                                                'A', '0', '0', '0', '0', '1', 'Z'};
+                writer.write(vin.data(), vin.size());
+                return uds::UdsResponseCode::PositiveResponse;
             }
-            return std::make_pair(uds::UdsResponseCode::RequestOutOfRange, ByteArray{0x22}); // Positive response
+            return uds::UdsResponseCode::RequestOutOfRange;
         });
 
         m_uds.registerWriteDataByIdentifierHandler([this](uint16_t did, ByteArray value) {
@@ -110,56 +93,26 @@ class ExampleDoIPServerModel : public DoIPServerModel {
   private:
     std::shared_ptr<spdlog::logger> m_log = Logger::get("smodel");
     std::shared_ptr<spdlog::logger> m_loguds = Logger::get("uds");
-    ServerModelDownstreamResponseHandler m_downstreamCallback = nullptr;
-    ThreadSafeQueue<ByteArray> m_rx;
-    ThreadSafeQueue<ByteArray> m_tx;
     uds::UdsMock m_uds;
-    std::thread m_worker;
-    bool m_running = true;
     uint16_t m_p2_ms = 1000;
     uint16_t m_p2star_10ms = 200;
 
-
-    void startWorker() {
-        m_worker = std::thread([this] {
-            while (m_running) {
-                downstream_thread();
-            }
-        });
-        m_log->info("Started worker thread");
-    }
-    void stopWorker() {
-        m_running = false;
-        if (m_worker.joinable())
-            m_worker.join();
-        m_log->info("Stopped worker thread");
-    }
+    // Declared last, so the worker is stopped before the members it uses are destroyed
+    DoIPDownstreamDispatcher m_dispatcher{[this](const DoIPDownstreamRequest &request, const ServerModelDownstreamResponseHandler &complete) {
+        forwardDownstream(request, complete);
+    }};
 
     /**
-     * @brief Thread simulating downstream communication (e. g. CAN).
+     * @brief Downstream transport simulating an ECU behind the gateway (e. g. on CAN).
+     *
+     * A real transport would send the request on the bus here and call
+     * complete() from its receive path once the ECU answered.
      */
-    void downstream_thread() {
-        if (m_tx.size()) {
-            // simulate send. In a real environment we could send a CAN message
-            ByteArray req;
-            m_tx.pop(req);
-            m_log->info("Simulate send {}", fmt::streamed(req));
-            // simulate some latency
-            std::this_thread::sleep_for(50ms);
-            // simulate receive
-            m_rx.push(m_uds.handleDiagnosticRequest(req));
-        }
-
-        if (m_rx.size()) {
-            ByteArray rsp;
-            m_rx.pop(rsp);
-            m_log->info("Simulate receive {}", fmt::streamed(rsp));
-            if (m_downstreamCallback) {
-                m_downstreamCallback(rsp, DoIPDownstreamResult::Handled);
-                m_downstreamCallback = nullptr;
-            }
-        }
-        std::this_thread::sleep_for(10ms);
+    void forwardDownstream(const DoIPDownstreamRequest &request, const ServerModelDownstreamResponseHandler &complete) {
+        m_log->info("Simulate send {}", fmt::streamed(request.payload));
+        ByteArray rsp = m_uds.handleDiagnosticRequest(request.payload);
+        m_log->info("Simulate receive {}", fmt::streamed(rsp));
+        complete(rsp, DoIPDownstreamResult::Handled);
     }
 };
 
@@ -0,0 +1,126 @@
+/**
+ * @brief Reads the VIN (ReadDataByIdentifier 0xF190) of many DoIP entities at once
+ *
+ * All sessions are driven by a single DoIPClientEngine thread, e.g. for
+ * end-of-line or HIL rigs with many vehicles or simulated gateways.
+ */
+
+#include "DoIPClientEngine.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace doip;
+using namespace std;
+
+namespace {
+
+void printUsage(const char *progName) {
+    cout << "Usage: " << progName << " [OPTIONS] <ip> [<ip> ...]\n";
+    cout << "Options:\n";
+    cout << "  --sessions <n>     Sessions per entity, each with its own source address (default: 1)\n";
+    cout << "  --source <addr>    Source address of the first session, incremented per session (default: 0x0E80)\n";
+    cout << "  --target <addr>    Logical address of the entities (default: 0x0028)\n";
+    cout << "  --timeout <ms>     Setup and response timeout (default: 2000)\n";
+    cout << "  --help             Show this help message\n";
+}
+
+const char *resultName(DoIPClientResult result) {
+    switch (result) {
+    case DoIPClientResult::Response:
+        return "response";
+    case DoIPClientResult::NegativeAck:
+        return "NACK";
+    case DoIPClientResult::Timeout:
+        return "timeout";
+    case DoIPClientResult::SessionClosed:
+        return "session closed";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    vector<string> servers;
+    unsigned int sessionsPerServer = 1;
+    DoIPAddress sourceBase = DoIPAddress(0x0E80);
+    DoIPAddress target = DoIPAddress(0x0028);
+    chrono::milliseconds timeout = DOIP_CLIENT_DEFAULT_TIMEOUT;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--sessions" && i + 1 < argc) {
+            sessionsPerServer = static_cast<unsigned int>(stoul(argv[++i]));
+        } else if (arg == "--source" && i + 1 < argc) {
+            sourceBase = static_cast<DoIPAddress>(stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--target" && i + 1 < argc) {
+            target = static_cast<DoIPAddress>(stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            timeout = chrono::milliseconds(stoul(argv[++i]));
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            cout << "Unknown argument: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            servers.push_back(arg);
+        }
+    }
+    if (servers.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Logger::setLevel(spdlog::level::warn);
+
+    DoIPClientEngine engine;
+    if (!engine.start()) {
+        return 1;
+    }
+
+    struct Pending {
+        string server;
+        DoIPAddress source;
+        future<DoIPClientResponse> response;
+    };
+    vector<Pending> pending;
+    auto start = chrono::steady_clock::now();
+    for (const auto &server : servers) {
+        for (unsigned int i = 0; i < sessionsPerServer; ++i) {
+            DoIPClientSessionConfig config;
+            config.serverAddress = server;
+            config.sourceAddress = static_cast<DoIPAddress>(sourceBase + pending.size());
+            config.targetAddress = target;
+            config.setupTimeout = timeout;
+            config.responseTimeout = timeout;
+            DoIPSessionId id = engine.openSession(config);
+            pending.push_back({server, config.sourceAddress, engine.sendDiagnosticMessage(id, ByteArray{0x22, 0xF1, 0x90})});
+        }
+    }
+
+    size_t failed = 0;
+    for (auto &p : pending) {
+        DoIPClientResponse response = p.response.get();
+        if (response.result == DoIPClientResult::Response && response.data.size() > 3 && response.data[0] == 0x62) {
+            string vin(response.data.begin() + 3, response.data.end());
+            printf("%-15s 0x%04X  VIN %s  (%.3f ms)\n", p.server.c_str(), p.source, vin.c_str(),
+                   chrono::duration<double, milli>(response.latency).count());
+        } else {
+            printf("%-15s 0x%04X  %s\n", p.server.c_str(), p.source, resultName(response.result));
+            ++failed;
+        }
+    }
+
+    printf("\n%zu of %zu sessions answered in %.1f ms\n", pending.size() - failed, pending.size(),
+           chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    engine.stop();
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,464 @@
+/**
+ * @brief Loopback load generator for a DoIP server
+ *
+ * Opens a number of concurrent TCP connections to a local DoIP server, activates
+ * routing on each of them and drives a mix of diagnostic requests, TesterPresent
+ * and alive check responses at a target rate. Reports throughput, latencies,
+ * connection setup time and the resource usage of the server process.
+ */
+
+#include "DoIPClient.h"
+#include "DoIPFrameDecoder.h"
+#include "DoIPMessage.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace doip;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+struct LoadOptions {
+    string server = "127.0.0.1";
+    unsigned int connections = 10;
+    double rate = 100.0; // requests per second (all connections)
+    unsigned int duration = 10;
+    unsigned int diagWeight = 70;
+    unsigned int testerPresentWeight = 20;
+    unsigned int aliveCheckWeight = 10;
+    DoIPAddress sourceBase = DoIPAddress(0x0E80);
+    DoIPAddress target = DoIPAddress(0x0E00);
+    int serverPid = -1;
+    string serverName = "exampleDoIPServer";
+    milliseconds timeout{2000};
+};
+
+enum class RequestKind { Diagnostic, TesterPresent, AliveCheck };
+
+struct WorkerStats {
+    bool connected{false};
+    nanoseconds setupTime{0};
+    vector<int64_t> ackLatency;      // ns
+    vector<int64_t> responseLatency; // ns
+    uint64_t requests{0};
+    uint64_t aliveChecks{0};
+    uint64_t acks{0};
+    uint64_t nacks{0};
+    uint64_t responses{0};
+    uint64_t timeouts{0};
+    uint64_t errors{0};
+};
+
+struct ServerUsage {
+    long rssKb{-1};
+    long threads{-1};
+};
+
+void printUsage(const char *progName) {
+    cout << "Usage: " << progName << " [OPTIONS]\n";
+    cout << "Options:\n";
+    cout << "  --server <ip>          Server IP address (default: 127.0.0.1)\n";
+    cout << "  --connections <n>      Number of concurrent connections (default: 10)\n";
+    cout << "  --rate <req/s>         Target request rate over all connections (default: 100)\n";
+    cout << "  --duration <s>         Test duration in seconds (default: 10)\n";
+    cout << "  --mix <d>,<t>,<a>      Weights of diagnostic requests, TesterPresent and alive check responses (default: 70,20,10)\n";
+    cout << "  --source <addr>        Source address of the first connection, incremented per connection (default: 0x0E80)\n";
+    cout << "  --target <addr>        Logical address of the server (default: 0x0E00)\n";
+    cout << "  --timeout <ms>         Response timeout (default: 2000)\n";
+    cout << "  --server-pid <pid>     Server process to sample RSS and thread count from\n";
+    cout << "  --server-name <name>   Find the server process by name (default: exampleDoIPServer)\n";
+    cout << "  --help                 Show this help message\n";
+}
+
+bool parseMix(const string &mix, LoadOptions &options) {
+    unsigned int d = 0;
+    unsigned int t = 0;
+    unsigned int a = 0;
+    if (sscanf(mix.c_str(), "%u,%u,%u", &d, &t, &a) != 3 || d + t + a == 0) {
+        return false;
+    }
+    options.diagWeight = d;
+    options.testerPresentWeight = t;
+    options.aliveCheckWeight = a;
+    return true;
+}
+
+/**
+ * @brief Find a process by name (the kernel truncates the name to 15 characters).
+ */
+int findProcess(const string &name) {
+    string comm = name.substr(0, 15);
+    DIR *proc = opendir("/proc");
+    if (proc == nullptr) {
+        return -1;
+    }
+
+    int pid = -1;
+    while (dirent *entry = readdir(proc)) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        ifstream file(string("/proc/") + entry->d_name + "/comm");
+        string processName;
+        if (getline(file, processName) && processName == comm) {
+            pid = stoi(entry->d_name);
+            break;
+        }
+    }
+    closedir(proc);
+    return pid;
+}
+
+ServerUsage sampleProcess(int pid) {
+    ServerUsage usage;
+    ifstream status("/proc/" + to_string(pid) + "/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            usage.rssKb = stol(line.substr(6));
+        } else if (line.rfind("Threads:", 0) == 0) {
+            usage.threads = stol(line.substr(8));
+        }
+    }
+    return usage;
+}
+
+enum class WaitResult { Matched, Timeout, Failed };
+
+using FrameMatcher = function<bool(const DoIPFrame &)>;
+
+constexpr milliseconds DRAIN_QUIET_TIME{50};
+
+constexpr uint8_t UDS_NEGATIVE_RESPONSE = 0x7F;
+constexpr uint8_t UDS_POSITIVE_RESPONSE_OFFSET = 0x40;
+constexpr uint8_t UDS_RESPONSE_PENDING = 0x78;
+
+/**
+ * @brief Receives frames until one is accepted by @p matches or the deadline passes.
+ *
+ * Alive check requests of the server are answered on the way, all other frames
+ * are dropped. The deadline is re-read after every frame, so @p matches may extend it.
+ */
+WaitResult waitForMessage(DoIPClient &client, DoIPFrameDecoder &decoder, const steady_clock::time_point &deadline, const FrameMatcher &matches) {
+    DoIPFrame frame;
+    while (true) {
+        DoIPDecodeStatus status = decoder.nextFrame(frame);
+        if (status == DoIPDecodeStatus::FrameReady) {
+            if (frame.payloadType == DoIPPayloadType::AliveCheckRequest) {
+                (void)client.sendAliveCheckResponse();
+                continue;
+            }
+            if (matches(frame)) {
+                return WaitResult::Matched;
+            }
+            continue;
+        }
+        if (status != DoIPDecodeStatus::NeedMoreData) {
+            return WaitResult::Failed;
+        }
+
+        auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now());
+        if (remaining.count() <= 0) {
+            return WaitResult::Timeout;
+        }
+        pollfd pfd{client.getSockFd(), POLLIN, 0};
+        int ready = poll(&pfd, 1, static_cast<int>(remaining.count()));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0 || (ready > 0 && decoder.readFrom(client.getSockFd()) <= 0)) {
+            return WaitResult::Failed;
+        }
+    }
+}
+
+/**
+ * @brief Drops everything the server still sends until the connection stays quiet.
+ *
+ * Used after a timeout, so late replies are not taken for replies to the next request.
+ */
+bool drainConnection(DoIPClient &client, DoIPFrameDecoder &decoder, const atomic<bool> &running) {
+    while (running.load()) {
+        auto quietUntil = steady_clock::now() + DRAIN_QUIET_TIME;
+        WaitResult result = waitForMessage(client, decoder, quietUntil, [](const DoIPFrame &) noexcept { return true; });
+        if (result != WaitResult::Matched) {
+            return result == WaitResult::Timeout;
+        }
+    }
+    return true;
+}
+
+// Diagnostic messages and their ACKs start with source and target address
+constexpr size_t DIAGNOSTIC_ADDRESSES_SIZE = 4;
+constexpr size_t DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET = 5;
+
+void runConnection(const LoadOptions &options, unsigned int index, const atomic<bool> &running, WorkerStats &stats) {
+    DoIPClient client;
+    DoIPFrameDecoder decoder;
+    DoIPAddress sourceAddress = static_cast<DoIPAddress>(options.sourceBase + index);
+
+    auto setupStart = steady_clock::now();
+    if (!client.startTcpConnection(options.server.c_str(), 1)) {
+        ++stats.errors;
+        return;
+    }
+
+    client.setSourceAddress(sourceAddress);
+    client.setLogicalAddress(options.target);
+    bool activated = false;
+    auto setupDeadline = setupStart + options.timeout;
+    if (client.sendRoutingActivationRequest() < 0 ||
+        waitForMessage(client, decoder, setupDeadline, [&](const DoIPFrame &frame) noexcept {
+            if (frame.payloadType != DoIPPayloadType::RoutingActivationResponse) {
+                return false;
+            }
+            activated = frame.payloadLength >= 5 && frame.payload[4] == 0x10;
+            return true;
+        }) != WaitResult::Matched ||
+        !activated) {
+        ++stats.errors;
+        client.closeTcpConnection();
+        return;
+    }
+    stats.connected = true;
+    stats.setupTime = duration_cast<nanoseconds>(steady_clock::now() - setupStart);
+
+    mt19937 random(index);
+    uniform_int_distribution<unsigned int> pick(1, options.diagWeight + options.testerPresentWeight + options.aliveCheckWeight);
+    auto interval = duration_cast<nanoseconds>(duration<double>(options.connections / options.rate));
+    // Stagger the connections over one interval
+    auto next = steady_clock::now() + interval * index / options.connections;
+
+    while (running.load()) {
+        // Latencies are taken from the schedule, so a stalled server is not hidden by late sends
+        auto scheduled = next;
+        this_thread::sleep_until(scheduled);
+        next += interval;
+
+        unsigned int p = pick(random);
+        RequestKind kind = p <= options.diagWeight                                 ? RequestKind::Diagnostic
+                           : p <= options.diagWeight + options.testerPresentWeight ? RequestKind::TesterPresent
+                                                                                   : RequestKind::AliveCheck;
+
+        if (kind == RequestKind::AliveCheck) {
+            if (client.sendAliveCheckResponse() < 0) {
+                ++stats.errors;
+                break;
+            }
+            ++stats.aliveChecks;
+            continue;
+        }
+
+        ByteArray request = kind == RequestKind::Diagnostic ? ByteArray{0x22, 0xF1, 0x90} : ByteArray{0x3E, 0x00};
+        uint8_t sid = request[0];
+        if (client.sendDiagnosticMessage(request) < 0) {
+            ++stats.errors;
+            break;
+        }
+        ++stats.requests;
+
+        // The ACK may repeat the start of the request
+        bool negative = false;
+        auto deadline = steady_clock::now() + options.timeout;
+        WaitResult result = waitForMessage(client, decoder, deadline, [&](const DoIPFrame &frame) noexcept {
+            if ((frame.payloadType != DoIPPayloadType::DiagnosticMessageAck &&
+                 frame.payloadType != DoIPPayloadType::DiagnosticMessageNegativeAck) ||
+                (frame.payloadLength > DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET && frame.payload[DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET] != sid)) {
+                return false;
+            }
+            negative = frame.payloadType == DoIPPayloadType::DiagnosticMessageNegativeAck;
+            return true;
+        });
+        if (result == WaitResult::Matched) {
+            stats.ackLatency.push_back(duration_cast<nanoseconds>(steady_clock::now() - scheduled).count());
+            if (negative) {
+                ++stats.nacks;
+                continue;
+            }
+            ++stats.acks;
+
+            // SID + 0x40 or 7F SID NRC; "response pending" restarts the timeout
+            deadline = steady_clock::now() + options.timeout;
+            result = waitForMessage(client, decoder, deadline, [&](const DoIPFrame &frame) noexcept {
+                if (frame.payloadType != DoIPPayloadType::DiagnosticMessage || frame.payloadLength <= DIAGNOSTIC_ADDRESSES_SIZE) {
+                    return false;
+                }
+                const uint8_t *data = frame.payload + DIAGNOSTIC_ADDRESSES_SIZE;
+                size_t size = frame.payloadLength - DIAGNOSTIC_ADDRESSES_SIZE;
+                if (size >= 3 && data[0] == UDS_NEGATIVE_RESPONSE && data[1] == sid && data[2] == UDS_RESPONSE_PENDING) {
+                    deadline = steady_clock::now() + options.timeout;
+                    return false;
+                }
+                return (size >= 1 && data[0] == static_cast<uint8_t>(sid + UDS_POSITIVE_RESPONSE_OFFSET)) ||
+                       (size >= 2 && data[0] == UDS_NEGATIVE_RESPONSE && data[1] == sid);
+            });
+            if (result == WaitResult::Matched) {
+                stats.responseLatency.push_back(duration_cast<nanoseconds>(steady_clock::now() - scheduled).count());
+                ++stats.responses;
+                continue;
+            }
+        }
+
+        if (result == WaitResult::Failed) {
+            ++stats.errors;
+            break;
+        }
+        ++stats.timeouts;
+        if (!drainConnection(client, decoder, running)) {
+            ++stats.errors;
+            break;
+        }
+    }
+
+    client.closeTcpConnection();
+}
+
+double percentileMs(vector<int64_t> &values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    auto index = min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())));
+    nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(index), values.end());
+    return static_cast<double>(values[index]) / 1e6;
+}
+
+void printLatency(const char *name, vector<int64_t> &values) {
+    printf("  %-22s n=%-8zu p50=%8.3f ms  p99=%8.3f ms  p999=%8.3f ms\n",
+           name, values.size(), percentileMs(values, 0.5), percentileMs(values, 0.99), percentileMs(values, 0.999));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    LoadOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--server" && i + 1 < argc) {
+            options.server = argv[++i];
+        } else if (arg == "--connections" && i + 1 < argc) {
+            options.connections = static_cast<unsigned int>(max(1ul, stoul(argv[++i])));
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = max(0.1, stod(argv[++i]));
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration = static_cast<unsigned int>(stoul(argv[++i]));
+        } else if (arg == "--mix" && i + 1 < argc) {
+            if (!parseMix(argv[++i], options)) {
+                cout << "Invalid mix: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--source" && i + 1 < argc) {
+            options.sourceBase = static_cast<DoIPAddress>(stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--target" && i + 1 < argc) {
+            options.target = static_cast<DoIPAddress>(stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            options.timeout = milliseconds(stoul(argv[++i]));
+        } else if (arg == "--server-pid" && i + 1 < argc) {
+            options.serverPid = stoi(argv[++i]);
+        } else if (arg == "--server-name" && i + 1 < argc) {
+            options.serverName = argv[++i];
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            cout << "Unknown argument: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Per-message logging would distort the measurement
+    Logger::setLevel(spdlog::level::warn);
+    Logger::getTcp()->set_level(spdlog::level::warn);
+
+    int serverPid = options.serverPid > 0 ? options.serverPid : findProcess(options.serverName);
+    ServerUsage idleUsage = serverPid > 0 ? sampleProcess(serverPid) : ServerUsage{};
+
+    printf("Load: %u connection(s) to %s, %.1f req/s, %u s, mix %u/%u/%u (diag/tester present/alive check)\n",
+           options.connections, options.server.c_str(), options.rate, options.duration,
+           options.diagWeight, options.testerPresentWeight, options.aliveCheckWeight);
+
+    atomic<bool> running{true};
+    vector<WorkerStats> stats(options.connections);
+    vector<thread> workers;
+    auto start = steady_clock::now();
+    for (unsigned int i = 0; i < options.connections; ++i) {
+        workers.emplace_back(runConnection, cref(options), i, cref(running), ref(stats[i]));
+    }
+
+    // Sample the server while the load is applied
+    ServerUsage peakUsage = idleUsage;
+    auto end = start + seconds(options.duration);
+    while (steady_clock::now() < end) {
+        this_thread::sleep_for(100ms);
+        if (serverPid > 0) {
+            ServerUsage usage = sampleProcess(serverPid);
+            peakUsage.rssKb = max(peakUsage.rssKb, usage.rssKb);
+            peakUsage.threads = max(peakUsage.threads, usage.threads);
+        }
+    }
+    running.store(false);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    WorkerStats total;
+    vector<int64_t> setupTimes;
+    unsigned int connected = 0;
+    for (auto &s : stats) {
+        if (s.connected) {
+            ++connected;
+            setupTimes.push_back(s.setupTime.count());
+        }
+        total.ackLatency.insert(total.ackLatency.end(), s.ackLatency.begin(), s.ackLatency.end());
+        total.responseLatency.insert(total.responseLatency.end(), s.responseLatency.begin(), s.responseLatency.end());
+        total.requests += s.requests;
+        total.aliveChecks += s.aliveChecks;
+        total.acks += s.acks;
+        total.nacks += s.nacks;
+        total.responses += s.responses;
+        total.timeouts += s.timeouts;
+        total.errors += s.errors;
+    }
+
+    printf("\nConnections: %u/%u established\n", connected, options.connections);
+    printf("Requests:    %llu diagnostic (%.1f req/s), %llu alive check responses\n",
+           static_cast<unsigned long long>(total.requests), static_cast<double>(total.requests) / elapsed,
+           static_cast<unsigned long long>(total.aliveChecks));
+    // The target rate covers every scheduled message, alive check responses included
+    printf("Rate:        %.1f msg/s achieved, %.1f msg/s target\n",
+           static_cast<double>(total.requests + total.aliveChecks) / elapsed, options.rate);
+    printf("Replies:     %llu ACK, %llu NACK, %llu responses (%.1f rsp/s), %llu timeouts, %llu errors\n",
+           static_cast<unsigned long long>(total.acks), static_cast<unsigned long long>(total.nacks),
+           static_cast<unsigned long long>(total.responses), static_cast<double>(total.responses) / elapsed,
+           static_cast<unsigned long long>(total.timeouts), static_cast<unsigned long long>(total.errors));
+    printf("Latency:\n");
+    printLatency("connection setup", setupTimes);
+    printLatency("request -> ACK", total.ackLatency);
+    printLatency("request -> response", total.responseLatency);
+
+    if (serverPid > 0) {
+        printf("Server (pid %d): RSS %ld kB idle, %ld kB peak; threads %ld idle, %ld peak\n",
+               serverPid, idleUsage.rssKb, peakUsage.rssKb, idleUsage.threads, peakUsage.threads);
+    } else {
+        printf("Server process '%s' not found, no resource usage sampled\n", options.serverName.c_str());
+    }
+
+    return connected == options.connections && total.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
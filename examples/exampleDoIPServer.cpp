@@ -1,11 +1,13 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <thread>
 
 #include "DoIPAddress.h"
 #include "DoIPServer.h"
 #include "Logger.h"
+#include "ProtocolTrace.h"
 
 #include "DoIPServer.h"
 
@@ -17,26 +19,7 @@ using namespace std;
 static const DoIPAddress LOGICAL_ADDRESS(0x0028);
 
 std::unique_ptr<DoIPServer> server;
-std::vector<std::thread> doipReceiver;
 bool serverActive = false;
-std::unique_ptr<DoIPConnection> tcpConnection(nullptr);
-
-void listenTcp();
-
-/*
- * Check permantly if tcp message was received
- */
-void listenTcp() {
-    LOG_UDP_INFO("TCP listener thread started");
-
-    while (true) {
-        tcpConnection = server->waitForTcpConnection<ExampleDoIPServerModel>();
-
-        while (tcpConnection->isSocketActive()) {
-            tcpConnection->receiveTcpMessage();
-        }
-    }
-}
 
 // Default example settings are applied in main when building ServerConfig
 
@@ -49,6 +32,11 @@ static void printUsage(const char *progName) {
     cout << "  --gid <6chars>  Set GID (6 ASCII chars)\n";
     cout << "  --vin <17chars> Set VIN (17 ASCII chars)\n";
     cout << "  --logical-address <hex|dec> Set logical gateway address (default: 0x0E00)\n";
+    cout << "  --event-loop <threads> Serve TCP connections with <threads> epoll reactors instead of one thread per connection\n";
+    cout << "  --udp-batch <n> Handle up to <n> UDP datagrams per recvmmsg()/sendmmsg() call (default: 16)\n";
+    cout << "  --udp-rate <n> Answer at most <n> UDP datagrams per second and source, 0 disables the limit (default: 20)\n";
+    cout << "  --trace <file> Write a binary protocol trace of all frames (decode with doipTraceDecode)\n";
+    cout << "  --metrics <file> Write the server metrics in Prometheus text format every second\n";
     cout << "  --help        Show this help message\n";
 }
 
@@ -59,6 +47,11 @@ int main(int argc, char *argv[]) {
     std::string gid_str;
     std::string vin_str = "EXAMPLESERVER";
     std::string logical_addr_str;
+    unsigned int eventLoopThreads = 0;
+    unsigned int udpBatchSize = DOIP_DEFAULT_UDP_BATCH_SIZE;
+    std::optional<double> udpRate;
+    std::string trace_file;
+    std::string metrics_file;
 
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
@@ -80,6 +73,16 @@ int main(int argc, char *argv[]) {
             vin_str = argv[++i];
         } else if (arg == "--logical-address" && i + 1 < argc) {
             logical_addr_str = argv[++i];
+        } else if (arg == "--event-loop" && i + 1 < argc) {
+            eventLoopThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--udp-batch" && i + 1 < argc) {
+            udpBatchSize = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--udp-rate" && i + 1 < argc) {
+            udpRate = std::stod(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metrics_file = argv[++i];
         } else if (arg == "--help") {
             printUsage(argv[0]);
             return 0;
@@ -94,10 +97,20 @@ int main(int argc, char *argv[]) {
     doip::Logger::setLevel(spdlog::level::debug);
     LOG_DOIP_INFO("Starting DoIP Server Example");
 
+    if (!trace_file.empty() && !ProtocolTrace::instance().start(trace_file)) {
+        return 1;
+    }
+
     // Build server config from example settings and CLI
     doip::ServerConfig cfg;
     cfg.loopback = useLoopback;
     cfg.daemonize = daemonize;
+    cfg.eventLoopThreads = eventLoopThreads;
+    cfg.udpBatchSize = udpBatchSize;
+    if (udpRate.has_value()) {
+        // Keep the default burst of two seconds' worth of datagrams
+        cfg.udpDatagramLimit = DoIPRateLimit{*udpRate, 2.0 * *udpRate};
+    }
     // TODO: Use CLI11 or similar for argument parsing
     if (!vin_str.empty()) cfg.vin = DoIpVin(vin_str);
     if (!eid_str.empty()) cfg.eid = DoIpEid(eid_str);
@@ -136,16 +149,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (!server->startTcpListener<ExampleDoIPServerModel>()) {
+        LOG_DOIP_CRITICAL("Failed to start TCP listener");
+        return 1;
+    }
+    LOG_DOIP_INFO("Started TCP listener ({})", server->isEventLoopMode() ? "event loop" : "thread per connection");
+
     serverActive = true;
 
     // TODO:: Add signal handler
     while(server->isRunning()) {
         sleep(1);
+        if (!metrics_file.empty()) {
+            dumpPrometheusToFile(metrics_file, server->metrics());
+        }
     }
-    doipReceiver.push_back(thread(&listenTcp));
-    LOG_DOIP_INFO("Starting TCP listener threads");
-
-    doipReceiver.at(0).join();
+    ProtocolTrace::instance().stop();
     LOG_DOIP_INFO("DoIP Server Example terminated");
     return 0;
 }
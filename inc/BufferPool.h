@@ -0,0 +1,163 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace doip {
+
+/**
+ * @brief Counters of a BufferPool.
+ */
+struct BufferPoolStats {
+    uint64_t hits{0};            ///< Allocations served from a pooled block
+    uint64_t misses{0};          ///< Allocations which had to request a new block from the system
+    uint64_t oversized{0};       ///< Allocations larger than the largest size class (not pooled)
+    uint64_t globalTransfers{0}; ///< Batches of blocks moved between a thread cache and the global free lists
+};
+
+/**
+ * @brief Size-class pool for message buffers.
+ *
+ * Requests are rounded up to a power of two between MIN_BLOCK_SIZE and
+ * MAX_BLOCK_SIZE. Freed blocks go to a small cache of the calling thread, so
+ * the steady state of a connection thread allocates and frees without locking
+ * and without calling malloc. If a thread cache runs empty or overflows, half
+ * of a cache is exchanged with the global free lists under a mutex. Requests
+ * larger than MAX_BLOCK_SIZE bypass the pool.
+ *
+ * A block may be freed by another thread than the one which allocated it; it
+ * then ends up in the cache of the freeing thread. The caches of a thread are
+ * returned to the global free lists when the thread exits.
+ *
+ * The pool is never destroyed, so buffers may still be released during static
+ * destruction.
+ */
+class BufferPool {
+  public:
+    static constexpr size_t MIN_BLOCK_SIZE = 64;
+    static constexpr size_t SIZE_CLASSES = 8;
+    static constexpr size_t MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (SIZE_CLASSES - 1);
+
+    /// Number of blocks per size class a thread keeps before returning half of them
+    static constexpr size_t THREAD_CACHE_BLOCKS = 32;
+    /// Number of blocks per size class the global free lists keep before freeing them
+    static constexpr size_t GLOBAL_CACHE_BLOCKS = 1024;
+
+    /**
+     * @brief The process wide pool.
+     */
+    static BufferPool &instance();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    BufferPool(BufferPool &&) = delete;
+    BufferPool &operator=(BufferPool &&) = delete;
+
+    /**
+     * @brief Allocate a buffer of at least size bytes.
+     *
+     * @throws std::bad_alloc if the system is out of memory
+     */
+    void *allocate(size_t size);
+
+    /**
+     * @brief Release a buffer obtained from allocate().
+     *
+     * @param p the buffer
+     * @param size the size passed to allocate()
+     */
+    void deallocate(void *p, size_t size) noexcept;
+
+    /**
+     * @brief Counters summed over all threads.
+     */
+    BufferPoolStats stats() const;
+
+    /**
+     * @brief Number of free blocks held by the global free lists.
+     */
+    size_t globalFreeBlocks() const;
+
+    /**
+     * @brief Free all blocks held by the global free lists.
+     */
+    void trim();
+
+    /**
+     * @brief Size class for a request.
+     *
+     * @return the index of the size class, or SIZE_CLASSES if the request is not pooled
+     */
+    static size_t sizeClass(size_t size) noexcept;
+
+    /**
+     * @brief Block size of a size class.
+     */
+    static constexpr size_t blockSize(size_t sizeClass) noexcept { return MIN_BLOCK_SIZE << sizeClass; }
+
+  private:
+    struct ThreadCache;
+    friend struct ThreadCache;
+
+    mutable std::mutex m_mutex;
+    std::array<std::vector<void *>, SIZE_CLASSES> m_free;
+    ThreadCache *m_threadCaches{nullptr}; ///< Caches of running threads
+    BufferPoolStats m_retired;             ///< Counters of exited threads
+
+    BufferPool();
+    ~BufferPool() = default;
+
+    ThreadCache *threadCache() noexcept;
+    void refill(ThreadCache &cache, size_t sizeClass);
+    void release(ThreadCache &cache, size_t sizeClass, size_t count) noexcept;
+    void registerCache(ThreadCache &cache) noexcept;
+    void unregisterCache(ThreadCache &cache) noexcept;
+};
+
+/**
+ * @brief Standard allocator serving allocations from BufferPool::instance().
+ *
+ * Stateless, so containers using it can swap and move buffers freely.
+ *
+ * @tparam T the value type
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T *>(BufferPool::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        BufferPool::instance().deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept {
+    return false;
+}
+
+} // namespace doip
+
+#endif /* BUFFERPOOL_H */
@@ -10,12 +10,16 @@
 #ifndef BYTEARRAY_H
 #define BYTEARRAY_H
 
+#include <cstring>
 #include <iomanip>
 #include <ostream>
 #include <stdint.h>
 #include <type_traits>
 #include <vector>
 
+#include "BufferPool.h"
+#include "DoIPConfig.h"
+
 namespace doip {
 
 namespace util {
@@ -49,37 +53,69 @@ inline uint32_t readU32BE(const uint8_t *data, size_t index) {
 } // namespace util
 
 /**
- * @brief A dynamic array of bytes with utility methods for network protocol handling
+ * @brief Allocator of ByteArray buffers, selected by DOIP_USE_BUFFER_POOL.
+ */
+#if DOIP_USE_BUFFER_POOL
+using ByteArrayAllocator = PoolAllocator<uint8_t>;
+#else
+using ByteArrayAllocator = std::allocator<uint8_t>;
+#endif
+
+/**
+ * @brief Byte container with utility methods for network protocol handling
  *
- * ByteArray extends std::vector<uint8_t> with convenient methods for reading
- * and writing multi-byte integer values in big-endian format (network byte order).
- * This is commonly used in DoIP and other network protocols.
+ * Adds convenient methods for reading and writing multi-byte integer values
+ * in big-endian format (network byte order) to a vector-like byte storage.
+ * ByteArray uses std::vector, SmallByteArray (see SmallByteArray.h) keeps
+ * short buffers inline.
+ *
+ * @tparam Storage the underlying container, providing data(), size(),
+ *         resize(), emplace_back() and operator[] like std::vector<uint8_t>
  *
  * @note All multi-byte read/write operations use big-endian (network) byte order
  */
-struct ByteArray : std::vector<uint8_t> {
+template <typename Storage>
+struct BasicByteArray : Storage {
     /**
-     * @brief Default constructor - creates an empty ByteArray
+     * @brief Default constructor - creates an empty byte array
      */
-    ByteArray() = default;
+    BasicByteArray() = default;
 
     /**
-     * @brief Constructs a ByteArray from a raw byte array
+     * @brief Constructs a byte array from a raw byte array
      *
      * @param data Pointer to the source byte array
      * @param size Number of bytes to copy from the source array
      */
-    explicit ByteArray(const uint8_t *data, size_t size) : std::vector<uint8_t>(data, data + size) {}
+    explicit BasicByteArray(const uint8_t *data, size_t size) { append(data, size); }
 
     /**
-     * @brief Constructs a ByteArray from an initializer list
+     * @brief Constructs a byte array from an initializer list
      *
      * @param init_list Initializer list of bytes
      *
      * @example
      * ByteArray arr = {0x01, 0x02, 0x03, 0xFF};
      */
-    ByteArray(const std::initializer_list<uint8_t> &init_list) : std::vector<uint8_t>(init_list) {}
+    BasicByteArray(const std::initializer_list<uint8_t> &init_list) { append(init_list.begin(), init_list.size()); }
+
+    /**
+     * @brief Appends raw bytes to the end of the byte array
+     *
+     * Unlike insert(), this copies with memcpy regardless of the allocator;
+     * libstdc++ only copies trivial types in bulk for std::allocator.
+     *
+     * @param data Pointer to the bytes to append
+     * @param size Number of bytes to append
+     */
+    void append(const uint8_t *data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const size_t offset = this->size();
+        this->resize(offset + size);
+        std::memcpy(this->data() + offset, data, size);
+    }
 
     /**
      * @brief Writes a 16-bit unsigned integer in big-endian format at a specific index
@@ -108,8 +144,8 @@ struct ByteArray : std::vector<uint8_t> {
      * @param value The 16-bit value to append
      */
     void writeU16BE(uint16_t value) {
-        emplace_back(static_cast<uint8_t>((value >> 8) & 0xFF));
-        emplace_back(static_cast<uint8_t>(value & 0xFF));
+        this->emplace_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+        this->emplace_back(static_cast<uint8_t>(value & 0xFF));
     }
 
     /**
@@ -141,10 +177,10 @@ struct ByteArray : std::vector<uint8_t> {
      * @param value The 32-bit value to append
      */
     void writeU32BE(uint32_t value) {
-        emplace_back(static_cast<uint8_t>((value >> 24) & 0xFF));
-        emplace_back(static_cast<uint8_t>((value >> 16) & 0xFF));
-        emplace_back(static_cast<uint8_t>((value >> 8) & 0xFF));
-        emplace_back(static_cast<uint8_t>(value & 0xFF));
+        this->emplace_back(static_cast<uint8_t>((value >> 24) & 0xFF));
+        this->emplace_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+        this->emplace_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+        this->emplace_back(static_cast<uint8_t>(value & 0xFF));
     }
 
     /**
@@ -169,7 +205,7 @@ struct ByteArray : std::vector<uint8_t> {
         auto integral_value = static_cast<UnderlyingType>(value);
 
         if constexpr (sizeof(UnderlyingType) == 1) {
-            emplace_back(static_cast<uint8_t>(integral_value));
+            this->emplace_back(static_cast<uint8_t>(integral_value));
         } else if constexpr (sizeof(UnderlyingType) == 2) {
             writeU16BE(static_cast<uint16_t>(integral_value));
         } else if constexpr (sizeof(UnderlyingType) == 4) {
@@ -282,6 +318,40 @@ struct ByteArray : std::vector<uint8_t> {
     }
 };
 
+/**
+ * @brief A dynamic array of bytes with utility methods for network protocol handling
+ *
+ * ByteArray extends std::vector<uint8_t, ByteArrayAllocator> with convenient methods for reading
+ * and writing multi-byte integer values in big-endian format (network byte order).
+ * This is commonly used in DoIP and other network protocols.
+ *
+ * @note All multi-byte read/write operations use big-endian (network) byte order
+ * @note Buffers are obtained from ByteArrayAllocator, see DOIP_USE_BUFFER_POOL
+ */
+struct ByteArray : BasicByteArray<std::vector<uint8_t, ByteArrayAllocator>> {
+    using BasicByteArray::BasicByteArray;
+
+    ByteArray() = default;
+
+    /**
+     * @brief Constructs a byte array from a std::vector<uint8_t>
+     *
+     * @param bytes the bytes to copy
+     */
+    explicit ByteArray(const std::vector<uint8_t> &bytes) { append(bytes.data(), bytes.size()); }
+
+#if DOIP_USE_BUFFER_POOL
+    /**
+     * @brief Copies the bytes into a std::vector<uint8_t>
+     *
+     * ByteArray used to derive from std::vector<uint8_t>. With the pool
+     * allocator it no longer does, so code passing a ByteArray where a
+     * std::vector<uint8_t> is expected gets a copy instead.
+     */
+    operator std::vector<uint8_t>() const { return std::vector<uint8_t>(data(), data() + size()); }
+#endif
+};
+
 /**
  * @brief Reference to raw array of bytes.
  *
@@ -291,16 +361,17 @@ struct ByteArray : std::vector<uint8_t> {
 using ByteArrayRef = std::pair<const uint8_t *, size_t>;
 
 /**
- * @brief Stream operator for ByteArray
+ * @brief Stream operator for ByteArray and SmallByteArray
  *
  * Prints each byte as a two-digit hex value separated by dots.
  * Example: {0x01, 0x02, 0xFF} prints as "01.02.FF"
  *
  * @param os Output stream
- * @param arr ByteArray to print
+ * @param arr byte array to print
  * @return std::ostream& Reference to the output stream
  */
-inline std::ostream &operator<<(std::ostream &os, const ByteArray &arr) {
+template <typename Storage>
+std::ostream &operator<<(std::ostream &os, const BasicByteArray<Storage> &arr) {
     std::ios_base::fmtflags flags(os.flags());
 
     for (size_t i = 0; i < arr.size(); ++i) {
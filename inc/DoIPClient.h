@@ -25,6 +25,14 @@ class DoIPClient {
     DoIPClient() {m_receiveBuf.reserve(DOIP_MAXIMUM_MTU);}
 
     void startTcpConnection();
+
+    /**
+     * Connects the TCP socket to a DoIP server
+     * @param ipAddress        IPv4 address of the server
+     * @param maxAttempts      number of connection attempts, 0 retries until connected
+     * @return true if the connection was established
+     */
+    bool startTcpConnection(const char *ipAddress, unsigned int maxAttempts);
     void startUdpConnection();
     void startAnnouncementListener();
     ssize_t sendRoutingActivationRequest();
@@ -49,6 +57,13 @@ class DoIPClient {
      */
     ssize_t sendAliveCheckResponse();
     void setSourceAddress(const DoIPAddress &address);
+
+    /**
+     * Sets the logical address of the server used as target address of diagnostic messages
+     * (usually taken from the vehicle announcement)
+     * @param address          logical address of the server
+     */
+    void setLogicalAddress(const DoIPAddress &address);
     void printVehicleInformationResponse();
     void closeTcpConnection();
     void closeUdpConnection();
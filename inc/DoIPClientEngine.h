@@ -0,0 +1,270 @@
+#ifndef DOIPCLIENTENGINE_H
+#define DOIPCLIENTENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ByteArray.h"
+#include "DoIPAddress.h"
+#include "DoIPConfig.h"
+#include "DoIPFrameDecoder.h"
+#include "DoIPNegativeDiagnosticAck.h"
+#include "DoIPRoutingActivationType.h"
+
+namespace doip {
+
+/**
+ * @brief Identifies a session of a DoIPClientEngine. 0 denotes an invalid session.
+ */
+using DoIPSessionId = uint32_t;
+
+constexpr DoIPSessionId DOIP_INVALID_SESSION = 0;
+
+/**
+ * @brief Default time to wait for the connection, the routing activation or a diagnostic response.
+ */
+constexpr std::chrono::milliseconds DOIP_CLIENT_DEFAULT_TIMEOUT(2000);
+
+/**
+ * @brief Default limit for the user data of a diagnostic response.
+ */
+constexpr size_t DOIP_CLIENT_DEFAULT_MAX_RESPONSE_LENGTH = 16 * 1024 * 1024;
+
+/**
+ * @brief State of a client session.
+ */
+enum class DoIPSessionState : uint8_t {
+    Connecting,        ///< TCP connection is being established
+    ActivatingRouting, ///< Routing activation request sent, waiting for the response
+    Active,            ///< Routing is active, diagnostic messages are sent
+    Closed,            ///< Closed by either side or failed, all requests are completed
+};
+
+/**
+ * @brief Outcome of a diagnostic request sent through a DoIPClientEngine.
+ */
+enum class DoIPClientResult : uint8_t {
+    Response,      ///< The target sent a diagnostic response
+    NegativeAck,   ///< The DoIP entity rejected the request with a diagnostic message NACK
+    Timeout,       ///< No response within the response timeout of the session
+    SessionClosed, ///< The session was closed (or never became active) before a response arrived
+};
+
+/**
+ * @brief Completion of a diagnostic request.
+ */
+struct DoIPClientResponse {
+    DoIPClientResult result{DoIPClientResult::SessionClosed};
+    ByteArray data;                      ///< The UDS response if result is Response
+    DoIPNegativeDiagnosticAck nackCode{}; ///< The NACK code if result is NegativeAck
+    std::chrono::nanoseconds latency{0}; ///< Time from sending the request until completion, 0 if it was never sent
+};
+
+/**
+ * @brief Parameters of a client session.
+ */
+struct DoIPClientSessionConfig {
+    std::string serverAddress = "127.0.0.1"; ///< IPv4 address of the DoIP entity
+    uint16_t port = DOIP_UDP_DISCOVERY_PORT; ///< TCP data port, same number as the discovery port
+    DoIPAddress sourceAddress = DoIPAddress(0xE000); ///< Logical address of this tester
+    DoIPAddress targetAddress = ZERO_ADDRESS;        ///< Logical address diagnostic messages are sent to
+    DoIPRoutingActivationType activationType = DoIPRoutingActivationType::Default;
+    std::chrono::milliseconds setupTimeout = DOIP_CLIENT_DEFAULT_TIMEOUT;    ///< Connection plus routing activation
+    std::chrono::milliseconds responseTimeout = DOIP_CLIENT_DEFAULT_TIMEOUT; ///< Per request, restarted by "response pending"
+    size_t maxResponseLength = DOIP_CLIENT_DEFAULT_MAX_RESPONSE_LENGTH; ///< Larger diagnostic messages close the session
+};
+
+using DoIPClientResponseHandler = std::function<void(const DoIPClientResponse &)>;
+using DoIPSessionStateHandler = std::function<void(DoIPSessionId, DoIPSessionState)>;
+
+/**
+ * @brief Event-driven DoIP tester driving many sessions from a single thread.
+ *
+ * Where DoIPClient blocks a thread per connection, the engine runs one epoll
+ * loop for any number of sessions, e.g. for end-of-line or HIL rigs talking
+ * to hundreds of vehicles at once. Every session has its own TCP connection,
+ * routing activation state, source address and target address.
+ *
+ * Requests may be sent right after openSession(); they are queued until the
+ * routing is active. A session has one request in flight at a time, as UDS
+ * requires, the others wait in order. UDS "response pending" (0x7F xx 0x78)
+ * responses restart the response timeout and are not reported. Alive check
+ * requests are answered by the engine.
+ *
+ * A response is matched to the request in flight by its SID (SID + 0x40 or
+ * 0x7F SID NRC), so a late response to a request which already timed out is
+ * dropped instead of completing the next request.
+ *
+ * All methods are thread-safe and do not block. Response and state handlers
+ * are called on the engine thread; they must not block, but may call the
+ * engine again, except for start() and the destructor. Every response
+ * handler is called exactly once.
+ */
+class DoIPClientEngine {
+  public:
+    DoIPClientEngine();
+
+    /**
+     * @brief Destructor. Stops the engine, see stop().
+     *
+     * Must not be called from a handler.
+     */
+    ~DoIPClientEngine();
+
+    DoIPClientEngine(const DoIPClientEngine &) = delete;
+    DoIPClientEngine &operator=(const DoIPClientEngine &) = delete;
+    DoIPClientEngine(DoIPClientEngine &&) = delete;
+    DoIPClientEngine &operator=(DoIPClientEngine &&) = delete;
+
+    /**
+     * @brief Create the epoll instance and start the engine thread.
+     * @return true on success, false otherwise.
+     */
+    [[nodiscard]]
+    bool start();
+
+    /**
+     * @brief Close all sessions and stop the engine thread.
+     *
+     * Outstanding requests are completed with SessionClosed before stop() returns.
+     * If called from a handler, stop() returns right away and the requests are
+     * completed once the handler returned; the thread is joined by the next
+     * start() or the destructor.
+     */
+    void stop();
+
+    /**
+     * @brief Check if the engine is running.
+     */
+    [[nodiscard]]
+    bool isRunning() const { return m_running.load(); }
+
+    /**
+     * @brief Open a session: connect and activate routing in the background.
+     *
+     * @param config the session parameters
+     * @param onStateChange called on every state change of the session (optional)
+     * @return the session id, or DOIP_INVALID_SESSION if the engine is not
+     * running or the server address is invalid
+     */
+    DoIPSessionId openSession(const DoIPClientSessionConfig &config, DoIPSessionStateHandler onStateChange = nullptr);
+
+    /**
+     * @brief Close a session. Its outstanding requests are completed with SessionClosed.
+     * @param id the session id
+     */
+    void closeSession(DoIPSessionId id);
+
+    /**
+     * @brief Send a diagnostic message to the target address of a session.
+     *
+     * @param id the session id
+     * @param request the UDS request
+     * @param onResponse called once with the response or the failure
+     * @return false if the session does not exist (anymore); onResponse is not called then
+     */
+    bool sendDiagnosticMessage(DoIPSessionId id, const ByteArray &request, DoIPClientResponseHandler onResponse);
+
+    /**
+     * @brief Send a diagnostic message to the target address of a session.
+     *
+     * @param id the session id
+     * @param request the UDS request
+     * @return the future response; SessionClosed if the session does not exist
+     */
+    std::future<DoIPClientResponse> sendDiagnosticMessage(DoIPSessionId id, const ByteArray &request);
+
+    /**
+     * @brief Get the state of a session.
+     * @param id the session id
+     * @return the state, Closed for unknown sessions
+     */
+    DoIPSessionState sessionState(DoIPSessionId id) const;
+
+    /**
+     * @brief Number of sessions which are not closed yet.
+     */
+    [[nodiscard]]
+    size_t sessionCount() const;
+
+  private:
+    struct Request {
+        ByteArray data;
+        DoIPClientResponseHandler onResponse;
+    };
+
+    struct Session {
+        DoIPSessionId id{DOIP_INVALID_SESSION};
+        DoIPClientSessionConfig config;
+        DoIPSessionStateHandler onStateChange;
+        uint32_t serverIp{0}; ///< Parsed serverAddress, network byte order
+        int fd{-1};
+        DoIPSessionState state{DoIPSessionState::Connecting};
+        DoIPFrameDecoder decoder;
+        ByteArray streamed; ///< Reassembled payload of a diagnostic message larger than the decoder buffer
+        ByteArray sendBuffer;
+        bool writeRegistered{false};
+        std::deque<Request> requests; ///< front() is in flight while inFlight is set
+        bool inFlight{false};
+        std::chrono::steady_clock::time_point sentAt{};
+        std::chrono::steady_clock::time_point deadline{};
+    };
+
+    using Command = std::function<void()>;
+
+    int m_epollFd{-1};
+    // Open for the lifetime of the engine, so wake() never races with closing it
+    int m_wakeFd{-1};
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<DoIPSessionId> m_nextId{1};
+
+    // Guards the commands, the states and the thread id; the sessions are touched by the engine thread only
+    mutable std::mutex m_mutex;
+    std::thread::id m_threadId;
+    std::vector<std::unique_ptr<Session>> m_pendingSessions;
+    std::vector<Command> m_commands;
+    std::unordered_map<DoIPSessionId, DoIPSessionState> m_states;
+
+    std::unordered_map<DoIPSessionId, std::unique_ptr<Session>> m_sessions;
+    std::vector<DoIPSessionId> m_closedSessions;
+    // Lower bound of the session deadlines, the engine thread sleeps until then
+    std::chrono::steady_clock::time_point m_nextDeadline{};
+
+    bool post(DoIPSessionId id, Command command);
+    void wake();
+    void joinThread();
+    std::thread::id engineThreadId() const;
+    void run();
+    void runCommands();
+    void releaseClosedSessions();
+
+    void connect(Session &session);
+    void onWritable(Session &session);
+    void onReadable(Session &session);
+    void handleFrame(Session &session, const DoIPFrame &frame);
+    void checkTimeouts(std::chrono::steady_clock::time_point now);
+
+    static bool hasDeadline(const Session &session);
+    void setDeadline(Session &session, std::chrono::steady_clock::time_point deadline);
+    void setState(Session &session, DoIPSessionState state);
+    void queue(Session &session, const uint8_t *data, size_t size);
+    bool flush(Session &session);
+    void sendNextRequest(Session &session);
+    void complete(Session &session, DoIPClientResponse response);
+    void shutdownSession(Session &session);
+};
+
+} // namespace doip
+
+#endif /* DOIPCLIENTENGINE_H */
@@ -3,9 +3,11 @@
 
 
 #include "DoIPConfig.h"
+#include "DoIPFrameDecoder.h"
 #include "DoIPMessage.h"
 #include "DoIPNegativeAck.h"
 #include "DoIPNegativeDiagnosticAck.h"
+#include "DoIPOutboundQueue.h"
 #include "DoIPServerModel.h"
 #include "DoIPDefaultConnection.h"
 #include <arpa/inet.h>
@@ -16,6 +18,7 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 
@@ -30,6 +33,24 @@ class DoIPConnection : public DoIPDefaultConnection {
     int receiveTcpMessage();
     size_t receiveFixedNumberOfBytesFromTCP(uint8_t *receivedData, size_t payloadLength);
 
+    /**
+     * @brief Read everything currently available on a non-blocking socket and
+     * dispatch each complete DoIP message to the state machine.
+     *
+     * Usually costs a single read per burst of pipelined messages. Partially
+     * received messages are kept until the next call. This is used by the event
+     * loop server mode (see DoIPEventLoop).
+     *
+     * @return number of dispatched messages, or -1 if the connection was closed
+     */
+    int processAvailableTcpData();
+
+    /**
+     * @brief Get the TCP socket descriptor of this connection
+     * @return the socket descriptor
+     */
+    int getSocket() const { return m_tcpSocket; }
+
     void sendDiagnosticPayload(const DoIPAddress &sourceAddress, const ByteArray &payload);
     bool isSocketActive() { return m_tcpSocket != 0; };
 
@@ -47,6 +68,21 @@ class DoIPConnection : public DoIPDefaultConnection {
      */
     ssize_t sendProtocolMessage(const DoIPMessage &msg) override;
 
+    using DoIPDefaultConnection::sendProtocolFragments;
+
+    /**
+     * @brief Send a DoIP message given as payload fragments to the client
+     *
+     * Header and fragments are appended to the outbound queue without
+     * building an intermediate message.
+     *
+     * @param payloadType The payload type of the message
+     * @param fragments The payload fragments
+     * @param count Number of fragments
+     * @return Number of bytes sent, or -1 on error
+     */
+    ssize_t sendProtocolFragments(DoIPPayloadType payloadType, const ByteArrayRef *fragments, size_t count) override;
+
     /**
      * @brief Close the TCP connection
      * @param reason Why the connection is being closed
@@ -76,7 +112,7 @@ class DoIPConnection : public DoIPDefaultConnection {
      * @param msg The diagnostic message received
      * @return std::nullopt for ACK, or NACK code
      */
-    DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessage &msg) override;
+    DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessageView &msg) override;
 
     /**
      * @brief Notify application that connection is closing
@@ -90,6 +126,12 @@ class DoIPConnection : public DoIPDefaultConnection {
      */
     void notifyDiagnosticAckSent(DoIPDiagnosticAck ack) override;
 
+    /**
+     * @brief Check if the client reads slower than responses are produced
+     * @return true if the outbound queue exceeds its high watermark
+     */
+    bool isSendCongested() const override;
+
     // === Downstream (Subnet) Operations ===
 
     /**
@@ -103,16 +145,19 @@ class DoIPConnection : public DoIPDefaultConnection {
 
     // TCP socket-specific members
     int m_tcpSocket;
-    std::array<uint8_t, DOIP_MAXIMUM_MTU> m_receiveBuf{};
+    DoIPFrameDecoder m_decoder;
+    DoIPOutboundQueue m_outbound;
     bool m_isClosing{false};  // TODO: Guard against recursive closeConnection calls -> solve this
-    std::optional<DoIPMessage> m_pendingDownstreamRequest;
 
     void closeSocket();
 
     int reactOnReceivedTcpMessage(const DoIPMessage &message);
+    void dispatchReceivedMessage(const DoIPFrame &frame, DoIPDecodeStatus status);
+    void traceReceivedFrame(const DoIPFrame &frame, DoIPDecodeStatus status);
 
     void handleMessage(const DoIPMessage &message);
     ssize_t sendMessage(const uint8_t *message, size_t messageLength);
+    ssize_t enqueueMessage(const iovec *iov, size_t count);
 };
 
 } // namespace doip
@@ -2,12 +2,18 @@
 #define DOIPDEFAULTCONNECTION_H
 
 #include "DoIPConfig.h"
+#include "DoIPMetrics.h"
 #include "DoIPServerModel.h"
 
 #include "DoIPRoutingActivationResult.h"
 #include "DoIPTimes.h"
 #include "IConnectionContext.h"
 #include "TimerManager.h"
+#include "TimerWheel.h"
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 namespace doip {
@@ -40,8 +46,16 @@ inline std::ostream &operator<<(std::ostream &os, ConnectionTimers tid) {
     }
 }
 
+#if DOIP_USE_TIMER_WHEEL
+using ConnectionTimerManager = WheelTimerManager<ConnectionTimers>;
+using DownstreamTimerManager = WheelTimerManager<DoIPAddress>;
+#else
+using ConnectionTimerManager = TimerManager<ConnectionTimers>;
+using DownstreamTimerManager = TimerManager<DoIPAddress>;
+#endif
+
 using StateChangeHandler = std::function<void()>;
-using MessageHandler = std::function<void(std::optional<DoIPMessage>)>;
+using MessageHandler = std::function<void(OptDoIPMessageView)>;
 using TimeOutHandler = std::function<void(ConnectionTimers)>;
 
 /**
@@ -106,6 +120,11 @@ class DoIPDefaultConnection : public IConnectionContext {
      */
     explicit DoIPDefaultConnection(UniqueServerModelPtr model);
 
+    /**
+     * @brief Destructor. Late downstream responses are dropped.
+     */
+    ~DoIPDefaultConnection() override;
+
     /**
      * @brief Sends a DoIP protocol message to the client
      * @param msg The message to send
@@ -113,6 +132,21 @@ class DoIPDefaultConnection : public IConnectionContext {
      */
     ssize_t sendProtocolMessage(const DoIPMessage &msg) override;
 
+    using IConnectionContext::sendProtocolFragments;
+
+    /**
+     * @brief Sends a DoIP protocol message given as payload fragments
+     *
+     * The default implementation concatenates the fragments and calls
+     * sendProtocolMessage(); transports override this to avoid the copy.
+     *
+     * @param payloadType The payload type of the message
+     * @param fragments The payload fragments
+     * @param count Number of fragments
+     * @return Number of bytes sent
+     */
+    ssize_t sendProtocolFragments(DoIPPayloadType payloadType, const ByteArrayRef *fragments, size_t count) override;
+
     /**
      * @brief Closes the connection
      * @param reason The reason for closure
@@ -218,7 +252,7 @@ class DoIPDefaultConnection : public IConnectionContext {
      * @param msg The diagnostic message
      * @return Diagnostic acknowledgment (ACK/NACK)
      */
-    DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessage &msg) override;
+    DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessageView &msg) override;
 
     /**
      * @brief Notifies application that connection is closing
@@ -232,6 +266,12 @@ class DoIPDefaultConnection : public IConnectionContext {
      */
     void notifyDiagnosticAckSent(DoIPDiagnosticAck ack) override;
 
+    /**
+     * @brief Checks if the send path is congested
+     * @return always false, messages are not transmitted
+     */
+    bool isSendCongested() const override;
+
     /**
      * @brief Checks if a downstream handler is present
      * @return true if present, false otherwise
@@ -243,7 +283,7 @@ class DoIPDefaultConnection : public IConnectionContext {
      * @param msg The downstream request message
      * @return Downstream result
      */
-    DoIPDownstreamResult notifyDownstreamRequest(const DoIPMessage &msg) override;
+    DoIPDownstreamResult notifyDownstreamRequest(const DoIPMessageView &msg) override;
 
     /**
      * @brief Receives a downstream response
@@ -252,6 +292,31 @@ class DoIPDefaultConnection : public IConnectionContext {
      */
     void receiveDownstreamResponse(const ByteArray &response, DoIPDownstreamResult result) override;
 
+    /**
+     * @brief Gets the number of downstream requests waiting for a response
+     *
+     * Requests queued behind another request to the same target are included.
+     *
+     * @return The number of outstanding downstream requests
+     */
+    size_t getPendingDownstreamRequestCount() const;
+
+    /**
+     * @brief Gets the counters and latency histograms of this connection
+     * @return A copy of the current values
+     */
+    DoIPMetricsSnapshot metrics() const { return m_metrics.snapshot(); }
+
+    /**
+     * @brief Includes the counters of this connection in server-wide metrics
+     *
+     * Called by the server for each accepted connection. The counters are kept
+     * by the registry when the connection is destroyed.
+     *
+     * @param registry The registry of the server
+     */
+    void setMetricsRegistry(std::shared_ptr<DoIPMetricsRegistry> registry);
+
     /**
      * @brief Gets the current state of the connection
      * @return The current DoIPServerState
@@ -272,22 +337,69 @@ class DoIPDefaultConnection : public IConnectionContext {
      * @brief Handles a message (internal helper)
      * @param message The message to handle
      */
-    void handleMessage2(const DoIPMessage &message);
+    void handleMessage2(const DoIPMessageView &message);
+
+    /**
+     * @brief Handles a chunk of a diagnostic message exceeding the maximum payload length
+     *
+     * Chunks must be passed in order. The user data is forwarded to the
+     * onDiagnosticMessageChunk callback of the server model, the ACK/NACK is
+     * sent after the last chunk.
+     *
+     * @param data the chunk data (part of the DoIP payload, including the address fields)
+     * @param length number of bytes in the chunk
+     * @param offset position of the chunk within the DoIP payload
+     * @param totalLength length of the complete DoIP payload
+     */
+    void handleDiagnosticMessageChunk(const uint8_t *data, size_t length, size_t offset, size_t totalLength);
 
   protected:
     UniqueServerModelPtr m_serverModel;
-    std::array<StateDescriptor, 7> STATE_DESCRIPTORS;
+    std::array<StateDescriptor, 6> STATE_DESCRIPTORS;
     DoIPAddress m_routedClientAddress;
 
     bool m_isOpen;
     DoIPCloseReason m_closeReason = DoIPCloseReason::None;
     const StateDescriptor *m_state = nullptr;
-    TimerManager<ConnectionTimers> m_timerManager;
+    ConnectionTimerManager m_timerManager;
 
     // Alive check retry (not covered by the standard)
     uint8_t m_aliveCheckRetry{0};
     uint8_t m_aliveCheckRetryCount{DOIP_ALIVE_CHECK_RETRIES};
 
+    // Diagnostic message currently received in chunks
+    struct ChunkedDiagnosticMessage {
+        bool active{false};
+        std::array<uint8_t, 4> addresses{};
+        size_t addressBytes{0};
+        DoIPAddress sourceAddress{ZERO_ADDRESS};
+        DoIPAddress targetAddress{ZERO_ADDRESS};
+        DoIPDiagnosticAck ack;
+    };
+    ChunkedDiagnosticMessage m_chunkedMessage;
+
+    // Downstream requests, keyed by target address. Requests to different
+    // targets are forwarded concurrently, requests to the same target are
+    // forwarded one after the other.
+    struct DownstreamTarget {
+        uint32_t requestId{0};                           // Request in flight, 0 if none
+        std::chrono::steady_clock::time_point started{}; // When the request in flight was forwarded
+        std::deque<DoIPMessage> queued;                  // Requests waiting for the one in flight
+    };
+    // Shared with the response handlers passed to the server model, which may
+    // outlive the connection. connection is reset when the connection closes.
+    struct DownstreamRequests {
+        std::recursive_mutex mutex;
+        DoIPDefaultConnection *connection{nullptr};
+        uint32_t lastRequestId{0};
+        std::map<DoIPAddress, DownstreamTarget> targets;
+    };
+    std::shared_ptr<DownstreamRequests> m_downstream;
+
+    // Counters of this connection, summed up by the server's registry (if any)
+    DoIPMetrics m_metrics;
+    std::shared_ptr<DoIPMetricsRegistry> m_metricsRegistry;
+
     // Timer values
     std::chrono::milliseconds m_initialInactivityTimeout{times::server::InitialInactivityTimeout}; // 2 seconds
     std::chrono::milliseconds m_generalInactivityTimeout{times::server::GeneralInactivityTimeout}; // 5 minutes
@@ -304,12 +416,11 @@ class DoIPDefaultConnection : public IConnectionContext {
     void restartStateTimer();
 
     // handlers for each state
-    void handleSocketInitialized(DoIPServerEvent event, OptDoIPMessage msg);
-    void handleWaitRoutingActivation(DoIPServerEvent event, OptDoIPMessage msg);
-    void handleRoutingActivated(DoIPServerEvent event, OptDoIPMessage msg);
-    void handleWaitAliveCheckResponse(DoIPServerEvent event, OptDoIPMessage msg);
-    void handleWaitDownstreamResponse(DoIPServerEvent event, OptDoIPMessage msg);
-    void handleFinalize(DoIPServerEvent event, OptDoIPMessage msg);
+    void handleSocketInitialized(DoIPServerEvent event, OptDoIPMessageView msg);
+    void handleWaitRoutingActivation(DoIPServerEvent event, OptDoIPMessageView msg);
+    void handleRoutingActivated(DoIPServerEvent event, OptDoIPMessageView msg);
+    void handleWaitAliveCheckResponse(DoIPServerEvent event, OptDoIPMessageView msg);
+    void handleFinalize(DoIPServerEvent event, OptDoIPMessageView msg);
 
     /**
      * @brief Default timeout handler
@@ -318,10 +429,32 @@ class DoIPDefaultConnection : public IConnectionContext {
      */
     void handleTimeout(ConnectionTimers timer_id);
 
+    // Downstream requests (m_downstream->mutex must be held by the callers of the *Locked methods)
+    DoIPDownstreamResult startDownstreamRequestLocked(const DoIPMessageView &msg, DoIPAddress targetAddress);
+    void completeDownstreamRequestLocked(DoIPAddress targetAddress, uint32_t requestId, const ByteArray &response, DoIPDownstreamResult result);
+    void finishDownstreamRequestLocked(DoIPAddress targetAddress);
+    void handleDownstreamTimeout(DoIPAddress targetAddress, uint32_t requestId);
+    void dropDownstreamRequests();
+
     ssize_t sendRoutingActivationResponse(const DoIPAddress &source_address, DoIPRoutingActivationResult response_code);
     ssize_t sendAliveCheckRequest();
     ssize_t sendDiagnosticMessageResponse(const DoIPAddress &sourceAddress, DoIPDiagnosticAck ack);
     ssize_t sendDownstreamResponse(const DoIPAddress &sourceAddress, const ByteArray& payload);
+
+    /**
+     * @brief Sends a diagnostic message without copying the user data
+     *
+     * @param sourceAddress the source address
+     * @param targetAddress the target address
+     * @param userData the diagnostic user data (e.g. UDS response)
+     * @return Number of bytes sent
+     */
+    ssize_t sendDiagnosticMessage(const DoIPAddress &sourceAddress, const DoIPAddress &targetAddress, const ByteArray &userData);
+
+  private:
+    // One response timer per downstream target. Declared last, so pending
+    // timeouts have finished before the other members are destroyed.
+    DownstreamTimerManager m_downstreamTimers;
 };
 
 } // namespace doip
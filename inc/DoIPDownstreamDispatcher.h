@@ -0,0 +1,149 @@
+#ifndef DOIPDOWNSTREAMDISPATCHER_H
+#define DOIPDOWNSTREAMDISPATCHER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ByteArray.h"
+#include "DoIPAddress.h"
+#include "DoIPDownstreamResult.h"
+#include "DoIPServerModel.h"
+
+namespace doip {
+
+/**
+ * @brief A diagnostic message to be forwarded to a downstream device.
+ *
+ * Unlike the DoIPMessageView passed to onDownstreamRequest, the request owns
+ * its data, so it can be processed after the callback returned.
+ */
+struct DoIPDownstreamRequest {
+    DoIPAddress sourceAddress{ZERO_ADDRESS};
+    DoIPAddress targetAddress{ZERO_ADDRESS};
+    ByteArray payload; ///< The user data of the diagnostic message (e.g. the UDS request)
+};
+
+/**
+ * @brief Transport forwarding a request to the downstream device (e.g. via CAN).
+ *
+ * Called on the dispatcher thread. The transport calls complete() with the
+ * response and DoIPDownstreamResult::Handled, or with an empty response and
+ * DoIPDownstreamResult::Error. It may call complete() before returning, or
+ * keep a copy and call it later, e.g. from the receive path of the bus.
+ */
+using DownstreamTransport = std::function<void(const DoIPDownstreamRequest &request,
+                                               const ServerModelDownstreamResponseHandler &complete)>;
+
+/**
+ * @brief Worker forwarding downstream requests of a server model to a transport.
+ *
+ * The worker thread sleeps on a condition variable until a request arrives
+ * and hands it to the transport right away, so there is no polling latency
+ * between onDownstreamRequest and the transport, nor between the transport
+ * and the response handler of the connection.
+ *
+ * Typical usage in a DoIPServerModel:
+ * @code
+ * onOpenConnection = [this](IConnectionContext &) { m_dispatcher.start(); };
+ * onCloseConnection = [this](IConnectionContext &, DoIPCloseReason) { m_dispatcher.stop(); };
+ * onDownstreamRequest = m_dispatcher.makeHandler();
+ * @endcode
+ */
+class DoIPDownstreamDispatcher {
+  public:
+    /**
+     * @brief Construct a dispatcher. The worker is not started yet.
+     *
+     * @param transport the transport requests are forwarded to
+     */
+    explicit DoIPDownstreamDispatcher(DownstreamTransport transport);
+
+    /**
+     * @brief Destructor. Stops and joins the worker.
+     *
+     * Must not be called from the transport.
+     */
+    ~DoIPDownstreamDispatcher();
+
+    DoIPDownstreamDispatcher(const DoIPDownstreamDispatcher &) = delete;
+    DoIPDownstreamDispatcher &operator=(const DoIPDownstreamDispatcher &) = delete;
+    DoIPDownstreamDispatcher(DoIPDownstreamDispatcher &&) = delete;
+    DoIPDownstreamDispatcher &operator=(DoIPDownstreamDispatcher &&) = delete;
+
+    /**
+     * @brief Start the worker thread. Does nothing if it is already running.
+     *
+     * Must not be called from the transport. If the worker was stopped by the
+     * transport, it is joined before the new one is started.
+     */
+    void start();
+
+    /**
+     * @brief Stop the worker thread.
+     *
+     * Requests that were not handed to the transport yet are dropped without
+     * calling their response handler, since the connection they belong to is
+     * usually closing. A request currently processed by the transport is
+     * finished first.
+     *
+     * If called from the transport (e.g. by a response handler closing the
+     * connection), stop() returns without waiting; the worker exits as soon
+     * as the transport returns.
+     */
+    void stop();
+
+    /**
+     * @brief Check if the worker thread is running.
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Queue a request for the transport.
+     *
+     * @param request the request
+     * @param callback the handler receiving the response
+     * @return DoIPDownstreamResult::Pending if the request was queued,
+     *         DoIPDownstreamResult::Error if the dispatcher is not running
+     */
+    DoIPDownstreamResult submit(DoIPDownstreamRequest request, ServerModelDownstreamResponseHandler callback);
+
+    /**
+     * @brief Create a handler for DoIPServerModel::onDownstreamRequest.
+     *
+     * The handler copies the diagnostic message and submits it to this
+     * dispatcher. The dispatcher must outlive the returned handler's use.
+     */
+    ServerModelDownstreamHandler makeHandler();
+
+    /**
+     * @brief Number of requests waiting for the worker.
+     */
+    size_t pendingRequests() const;
+
+  private:
+    struct Job {
+        DoIPDownstreamRequest request;
+        ServerModelDownstreamResponseHandler callback;
+    };
+
+    DownstreamTransport m_transport;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs;
+    bool m_running{false};
+    std::thread::id m_workerId;
+
+    // Serializes joining and replacing the worker; never taken by the worker itself
+    std::mutex m_lifecycleMutex;
+    std::thread m_worker;
+
+    void run();
+};
+
+} // namespace doip
+
+#endif /* DOIPDOWNSTREAMDISPATCHER_H */
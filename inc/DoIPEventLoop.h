@@ -0,0 +1,112 @@
+#ifndef DOIPEVENTLOOP_H
+#define DOIPEVENTLOOP_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DoIPConnection.h"
+
+namespace doip {
+
+/**
+ * @brief Default number of reactor threads used by the event loop server mode.
+ */
+constexpr unsigned int DOIP_DEFAULT_EVENT_LOOP_THREADS = 2;
+
+/**
+ * @brief Fixed-size pool of epoll reactors driving DoIP TCP connections.
+ *
+ * Instead of spending one blocking thread per accepted socket, the event loop
+ * distributes connections round-robin over a small set of reactor threads.
+ * Each reactor owns its connections, switches their sockets to non-blocking
+ * mode and calls DoIPConnection::processAvailableTcpData() whenever the socket
+ * becomes readable. Connections that were closed (by the peer, the state
+ * machine or a timer) are released by the owning reactor.
+ */
+class DoIPEventLoop {
+  public:
+    /**
+     * @brief Construct an event loop.
+     * @param threadCount Number of reactor threads (at least one is used).
+     */
+    explicit DoIPEventLoop(unsigned int threadCount = DOIP_DEFAULT_EVENT_LOOP_THREADS);
+
+    /**
+     * @brief Destructor. Stops all reactors and closes remaining connections.
+     */
+    ~DoIPEventLoop();
+
+    DoIPEventLoop(const DoIPEventLoop &) = delete;
+    DoIPEventLoop &operator=(const DoIPEventLoop &) = delete;
+    DoIPEventLoop(DoIPEventLoop &&) = delete;
+    DoIPEventLoop &operator=(DoIPEventLoop &&) = delete;
+
+    /**
+     * @brief Create the epoll instances and start the reactor threads.
+     * @return true on success, false otherwise.
+     */
+    [[nodiscard]]
+    bool start();
+
+    /**
+     * @brief Stop all reactor threads and close the connections they own.
+     */
+    void stop();
+
+    /**
+     * @brief Hand over a connection to one of the reactors.
+     *
+     * The socket is switched to non-blocking mode. From now on, the connection
+     * is owned and driven by the event loop. A rejected connection is closed.
+     *
+     * @param connection the accepted connection
+     * @return true if the connection was accepted by a reactor, false otherwise
+     */
+    bool addConnection(std::unique_ptr<DoIPConnection> connection);
+
+    /**
+     * @brief Check if the reactors are running.
+     */
+    [[nodiscard]]
+    bool isRunning() const { return m_running.load(); }
+
+    /**
+     * @brief Number of reactor threads.
+     */
+    [[nodiscard]]
+    size_t threadCount() const { return m_reactors.size(); }
+
+    /**
+     * @brief Number of connections currently owned by the event loop.
+     */
+    [[nodiscard]]
+    size_t connectionCount() const { return m_connectionCount.load(); }
+
+  private:
+    struct Reactor {
+        int epollFd{-1};
+        int wakeFd{-1};
+        std::thread thread;
+        std::mutex mutex;
+        std::vector<std::unique_ptr<DoIPConnection>> pending;
+        std::unordered_map<DoIPConnection *, std::unique_ptr<DoIPConnection>> connections;
+    };
+
+    std::vector<std::unique_ptr<Reactor>> m_reactors;
+    std::atomic<size_t> m_nextReactor{0};
+    std::atomic<size_t> m_connectionCount{0};
+    std::atomic<bool> m_running{false};
+
+    void run(Reactor &reactor);
+    void adoptPending(Reactor &reactor);
+    void releaseConnection(Reactor &reactor, DoIPConnection *connection);
+    void releaseClosedConnections(Reactor &reactor);
+};
+
+} // namespace doip
+
+#endif /* DOIPEVENTLOOP_H */
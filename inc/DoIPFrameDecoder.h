@@ -0,0 +1,146 @@
+#ifndef DOIPFRAMEDECODER_H
+#define DOIPFRAMEDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+#include "DoIPConfig.h"
+#include "DoIPMessage.h"
+#include "DoIPPayloadType.h"
+
+namespace doip {
+
+/**
+ * @brief A complete DoIP frame or a chunk of a streamed frame yielded by DoIPFrameDecoder.
+ *
+ * The payload pointer refers to memory owned by the decoder and is only valid
+ * until the next call to DoIPFrameDecoder::readFrom(), feed() or nextFrame().
+ * For chunks, payload and payloadLength describe the chunk only, offset is its
+ * position within the payload of the frame and totalLength the full payload length.
+ */
+struct DoIPFrame {
+    DoIPPayloadType payloadType{DoIPPayloadType::NegativeAck};
+    const uint8_t *payload{nullptr};
+    size_t payloadLength{0};
+    size_t offset{0};
+    size_t totalLength{0};
+};
+
+/**
+ * @brief Result of DoIPFrameDecoder::nextFrame().
+ */
+enum class DoIPDecodeStatus : uint8_t {
+    FrameReady,      ///< A complete frame was returned
+    ChunkReady,      ///< A chunk of a streamed diagnostic message was returned
+    NeedMoreData,    ///< The buffered data does not contain a complete frame yet
+    InvalidHeader,   ///< The next header was rejected by DoIPMessage::tryParseHeader()
+    PayloadTooLarge, ///< The next header announces a payload larger than the maximum
+};
+
+/**
+ * @brief Incremental decoder for a stream of DoIP frames.
+ *
+ * Received bytes are kept in a ring buffer which is filled with a single
+ * readv() per call to readFrom(), taking as much as the socket has available.
+ * nextFrame() then yields every complete frame in the buffer; a partially
+ * received frame stays buffered until the rest arrives. Payloads are returned
+ * in place, only frames wrapping around the end of the ring are copied.
+ *
+ * If streaming is enabled, diagnostic messages with a payload larger than the
+ * maximum are not rejected but returned as a sequence of chunks, each holding
+ * the payload bytes buffered so far. This way, large messages (e.g. TransferData
+ * during flashing) can be processed while they arrive without having to size
+ * the buffer for them.
+ *
+ * After InvalidHeader or PayloadTooLarge the stream is out of sync and the
+ * connection should be closed; call reset() before reusing the decoder.
+ */
+class DoIPFrameDecoder {
+  public:
+    /**
+     * @brief Construct a decoder.
+     * @param maxPayloadLength the maximum accepted payload length
+     */
+    explicit DoIPFrameDecoder(size_t maxPayloadLength = DOIP_MAXIMUM_MTU);
+
+    /**
+     * @brief Read as many bytes as available (up to the free buffer space) from a file descriptor.
+     *
+     * Performs exactly one readv() call. Blocks if the descriptor is blocking
+     * and no data is available.
+     *
+     * @param fd the file descriptor (usually a TCP socket)
+     * @return number of bytes read, 0 if the peer closed the connection, or -1 on
+     * error (errno is set; ENOBUFS if the buffer is full)
+     */
+    ssize_t readFrom(int fd);
+
+    /**
+     * @brief Append received bytes to the buffer.
+     * @param data the received data
+     * @param length number of bytes
+     * @return number of bytes taken (less than length if the buffer is full)
+     */
+    size_t feed(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Extract the next complete frame or chunk from the buffer.
+     * @param[out] frame the frame, only set if FrameReady or ChunkReady is returned
+     * @return the decode status
+     */
+    DoIPDecodeStatus nextFrame(DoIPFrame &frame);
+
+    /**
+     * @brief Enable streaming of diagnostic messages exceeding the maximum payload length.
+     * @param enabled true to return such messages as chunks, false to reject them
+     */
+    void setStreamingEnabled(bool enabled) { m_streamingEnabled = enabled; }
+
+    /**
+     * @brief Check if a streamed message is currently being received.
+     */
+    bool isStreaming() const { return m_streamRemaining > 0; }
+
+    /**
+     * @brief Discard all buffered data.
+     */
+    void reset() {
+        m_head = 0;
+        m_size = 0;
+        m_streamRemaining = 0;
+    }
+
+    /**
+     * @brief Number of buffered bytes which were not yet returned as frame.
+     */
+    size_t bufferedBytes() const { return m_size; }
+
+    /**
+     * @brief Size of the ring buffer.
+     */
+    size_t capacity() const { return m_buffer.size(); }
+
+  private:
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> m_scratch; ///< Linearized payload of frames wrapping around the ring end
+    size_t m_maxPayloadLength;
+    size_t m_head{0}; ///< Position of the first buffered byte
+    size_t m_size{0}; ///< Number of buffered bytes
+
+    bool m_streamingEnabled{false};
+    DoIPPayloadType m_streamType{DoIPPayloadType::DiagnosticMessage};
+    size_t m_streamOffset{0};    ///< Payload bytes of the streamed message returned so far
+    size_t m_streamLength{0};    ///< Payload length of the streamed message
+    size_t m_streamRemaining{0}; ///< Payload bytes of the streamed message still to be returned
+
+    DoIPDecodeStatus nextChunk(DoIPFrame &frame);
+
+    void copyOut(size_t offset, uint8_t *dest, size_t length) const;
+    void consume(size_t length);
+};
+
+} // namespace doip
+
+#endif /* DOIPFRAMEDECODER_H */
@@ -1,6 +1,7 @@
 #ifndef DOIPMESSAGE_IMPROVED_H
 #define DOIPMESSAGE_IMPROVED_H
 
+#include <array>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -12,11 +13,15 @@
 #include "DoIPAddress.h"
 #include "DoIPFurtherAction.h"
 #include "DoIPIdentifiers.h"
+#include "DoIPMessageView.h"
 #include "DoIPNegativeAck.h"
 #include "DoIPNegativeDiagnosticAck.h"
+#include "DoIPNodeType.h"
 #include "DoIPPayloadType.h"
+#include "DoIPPowerMode.h"
 #include "DoIPRoutingActivationType.h"
 #include "DoIPSyncStatus.h"
+#include "SmallByteArray.h"
 
 namespace doip {
 
@@ -52,23 +57,25 @@ constexpr uint8_t PROTOCOL_VERSION_INV = static_cast<uint8_t>(~ISO_13400_2025);
 constexpr uint8_t DIAGNOSTIC_MESSAGE_ACK = 0;
 
 /**
- * @brief Size of the DoIP header
+ * @brief Number of message bytes (header included) a DoIPMessage stores without allocation
  */
-constexpr size_t DOIP_HEADER_SIZE = 8;
+constexpr size_t DOIP_MESSAGE_INLINE_SIZE = 64;
 
 /**
- * @brief Size of the DoIP diagnostic message header
+ * @brief Storage of a complete DoIP message
  */
-constexpr size_t DOIP_DIAG_HEADER_SIZE = DOIP_HEADER_SIZE + 4;
+using DoIPMessageBuffer = SmallByteArray<DOIP_MESSAGE_INLINE_SIZE>;
 
 class DoIPMessage;
 using OptDoIPMessage = std::optional<DoIPMessage>;
 
 /**
- * @brief Represents a complete DoIP message with internal ByteArray representation.
+ * @brief Represents a complete DoIP message with internal byte array representation.
  *
- * The message is stored internally as a complete ByteArray including the 8-byte header
+ * The message is stored internally as a complete byte array including the 8-byte header
  * and payload. This eliminates the need for copying when sending messages.
+ * Messages up to DOIP_MESSAGE_INLINE_SIZE bytes, i.e. all protocol control messages,
+ * are stored inline and do not allocate.
  *
  * Memory layout:
  * [0]      Protocol Version
@@ -114,8 +121,7 @@ class DoIPMessage {
      * @param init_list Initializer list of bytes for the payload
      */
     DoIPMessage(DoIPPayloadType payloadType, std::initializer_list<uint8_t> init_list) {
-        ByteArray payload(init_list);
-        buildMessage(payloadType, payload);
+        buildMessage(payloadType, init_list.begin(), init_list.size());
     }
 
     /**
@@ -126,8 +132,17 @@ class DoIPMessage {
      * @param size Number of bytes to copy from payload data
      */
     explicit DoIPMessage(DoIPPayloadType payloadType, const uint8_t *data, size_t size) {
-        ByteArray payload(data, size);
-        buildMessage(payloadType, payload);
+        buildMessage(payloadType, data, size);
+    }
+
+    /**
+     * @brief Constructs a DoIP message from a view, i.e. takes ownership by copying the payload.
+     *
+     * @param messageView The message view to copy
+     */
+    explicit DoIPMessage(const DoIPMessageView &messageView) {
+        auto payload = messageView.getPayload();
+        buildMessage(messageView.getPayloadType(), payload.first, payload.second);
     }
 
     /**
@@ -170,15 +185,31 @@ class DoIPMessage {
     }
 
     /**
-     * @brief Gets the payload data (without header).
+     * @brief Gets the user data of a diagnostic message (without source and target address).
      *
-     * @return ByteArrayRef pointing to the payload portion
+     * @return ByteArrayRef pointing to the user data
      */
     ByteArrayRef getDiagnosticMessagePayload() const {
-        if (m_data.size() <= DOIP_DIAG_HEADER_SIZE) {
-            return {nullptr, 0};
-        }
-        return {m_data.data() + DOIP_DIAG_HEADER_SIZE, m_data.size() - DOIP_DIAG_HEADER_SIZE};
+        return view().getDiagnosticMessagePayload();
+    }
+
+    /**
+     * @brief Gets a non-owning view of this message.
+     *
+     * The view is only valid as long as this message is neither modified nor destroyed.
+     *
+     * @return DoIPMessageView the view
+     */
+    DoIPMessageView view() const {
+        auto payload = getPayload();
+        return DoIPMessageView(getPayloadType(), payload.first, payload.second);
+    }
+
+    /**
+     * @brief Implicit conversion, so that messages can be passed to handlers taking a view.
+     */
+    operator DoIPMessageView() const {
+        return view();
     }
 
     /**
@@ -235,9 +266,21 @@ class DoIPMessage {
     /**
      * @brief Get the complete message as ByteArray.
      *
-     * @return const ByteArray& Reference to the complete message data
+     * The message is stored in a DoIPMessageBuffer, so this is a copy; use
+     * getData() or buffer() to access the data without copying.
+     *
+     * @return ByteArray The complete message data
+     */
+    ByteArray asByteArray() const {
+        return ByteArray(m_data.data(), m_data.size());
+    }
+
+    /**
+     * @brief Get the storage of the complete message.
+     *
+     * @return const DoIPMessageBuffer& Reference to the complete message data
      */
-    const ByteArray &asByteArray() const {
+    const DoIPMessageBuffer &buffer() const {
         return m_data;
     }
 
@@ -247,7 +290,7 @@ class DoIPMessage {
      * @return ByteArray A copy of the complete message data
      */
     ByteArray copyAsByteArray() const {
-        return m_data;
+        return ByteArray(m_data.data(), m_data.size());
     }
 
     /**
@@ -256,14 +299,7 @@ class DoIPMessage {
      * @return Returns @c true in the case of success, @c false otherwise.
      */
     bool hasSourceAddress() const {
-        auto payloadRef = getPayload();
-        auto plType = getPayloadType();
-        bool result = plType == DoIPPayloadType::DiagnosticMessage ||
-                      plType == DoIPPayloadType::RoutingActivationRequest ||
-                      plType == DoIPPayloadType::RoutingActivationResponse ||
-                      plType == DoIPPayloadType::AliveCheckResponse;
-
-        return result && payloadRef.second >= 2;
+        return view().hasSourceAddress();
     }
 
     /**
@@ -272,12 +308,7 @@ class DoIPMessage {
      * @return std::optional<DoIPAddress> The source address if present, std::nullopt otherwise
      */
     std::optional<DoIPAddress> getSourceAddress() const {
-        auto payloadRef = getPayload();
-        // todo: Simplify
-        if (hasSourceAddress()) {
-            return readAddressFrom(payloadRef.first, 0);
-        }
-        return std::nullopt;
+        return view().getSourceAddress();
     }
 
     /**
@@ -286,11 +317,7 @@ class DoIPMessage {
      * @return std::optional<DoIPAddress> The logical address if present, std::nullopt otherwise
      */
     std::optional<DoIPAddress> getLogicalAddress() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::VehicleIdentificationResponse && payloadRef.second >= 19) {
-            return readAddressFrom(payloadRef.first + 17);
-        }
-        return std::nullopt;
+        return view().getLogicalAddress();
     }
 
     /**
@@ -299,50 +326,34 @@ class DoIPMessage {
      * @return std::optional<DoIPAddress> The target address if present, std::nullopt otherwise
      */
     std::optional<DoIPAddress> getTargetAddress() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::DiagnosticMessage && payloadRef.second >= 4) {
-            return readAddressFrom(payloadRef.first, 2);
-        }
-        return std::nullopt;
+        return view().getTargetAddress();
     }
 
     /**
      * @brief Get the vehicle identification number (VIN) if message is a Vehicle Identification Response.
      *
-     * @return std::optional<DoIPAddress> The VIN if present, std::nullopt otherwise
+     * @return std::optional<DoIpVin> The VIN if present, std::nullopt otherwise
      */
     std::optional<DoIpVin> getVin() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::VehicleIdentificationResponse && payloadRef.second >= 17) {
-            return DoIpVin(payloadRef.first, 17);
-        }
-        return std::nullopt;
+        return view().getVin();
     }
 
     /**
      * @brief Get the entity id (EID) if message is a Vehicle Identification Response.
      *
-     * @return std::optional<DoIPAddress> The VIN if present, std::nullopt otherwise
+     * @return std::optional<DoIpEid> The EID if present, std::nullopt otherwise
      */
     std::optional<DoIpEid> getEid() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::VehicleIdentificationResponse && payloadRef.second >= 25) {
-            return DoIpEid(payloadRef.first + 19, 6);
-        }
-        return std::nullopt;
+        return view().getEid();
     }
 
     /**
      * @brief Get the group id (GID) if message is a Vehicle Identification Response.
      *
-     * @return std::optional<DoIPAddress> The VIN if present, std::nullopt otherwise
+     * @return std::optional<DoIpGid> The GID if present, std::nullopt otherwise
      */
     std::optional<DoIpGid> getGid() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::VehicleIdentificationResponse && payloadRef.second >= 31) {
-            return DoIpGid(payloadRef.first + 25, 6);
-        }
-        return std::nullopt;
+        return view().getGid();
     }
 
     /**
@@ -351,11 +362,7 @@ class DoIPMessage {
      * @return std::optional<DoIPFurtherAction> The Further Action Request if present, std::nullopt otherwise
      */
     std::optional<DoIPFurtherAction> getFurtherActionRequest() const {
-        auto payloadRef = getPayload();
-        if (getPayloadType() == DoIPPayloadType::VehicleIdentificationResponse && payloadRef.second >= 31) {
-            return DoIPFurtherAction(payloadRef.first[31]);
-        }
-        return std::nullopt;
+        return view().getFurtherActionRequest();
     }
 
     /**
@@ -415,6 +422,43 @@ class DoIPMessage {
         return std::make_pair(payloadType.value(), payloadLength);
     }
 
+    /**
+     * @brief Builds a DoIP header for the current protocol version.
+     *
+     * Used to send header and payload separately without building a message.
+     *
+     * @param payloadType The payload type
+     * @param payloadLength The payload length
+     * @return std::array<uint8_t, DOIP_HEADER_SIZE> the header bytes
+     */
+    static std::array<uint8_t, DOIP_HEADER_SIZE> makeHeader(DoIPPayloadType payloadType, uint32_t payloadLength) {
+        auto type = static_cast<uint16_t>(payloadType);
+        return {PROTOCOL_VERSION,
+                PROTOCOL_VERSION_INV,
+                static_cast<uint8_t>(type >> 8),
+                static_cast<uint8_t>(type & 0xFF),
+                static_cast<uint8_t>(payloadLength >> 24),
+                static_cast<uint8_t>((payloadLength >> 16) & 0xFF),
+                static_cast<uint8_t>((payloadLength >> 8) & 0xFF),
+                static_cast<uint8_t>(payloadLength & 0xFF)};
+    }
+
+    /**
+     * @brief Takes over a buffer holding a complete message, e.g. one whose payload was serialized in place.
+     *
+     * The payload length in the header is set from the buffer size, so the
+     * header may be written before the payload length is known.
+     *
+     * @param buffer Header and payload, at least DOIP_HEADER_SIZE bytes
+     * @return DoIPMessage The message owning the buffer
+     */
+    static DoIPMessage fromBuffer(DoIPMessageBuffer &&buffer) {
+        DoIPMessage msg;
+        msg.m_data = std::move(buffer);
+        msg.m_data.writeU32At(4, static_cast<uint32_t>(msg.m_data.size() - DOIP_HEADER_SIZE));
+        return msg;
+    }
+
     /**
      * @brief Parse a DoIP message from raw data.
      *
@@ -435,13 +479,13 @@ class DoIPMessage {
 
         // Create message from complete data
         DoIPMessage msg;
-        msg.m_data.assign(data, data + DOIP_HEADER_SIZE + optHeader->second);
+        msg.m_data.append(data, DOIP_HEADER_SIZE + optHeader->second);
 
         return msg;
     }
 
   protected:
-    ByteArray m_data; ///< Complete message data (header + payload)
+    DoIPMessageBuffer m_data; ///< Complete message data (header + payload)
 
     /**
      * @brief Builds the internal message representation.
@@ -450,8 +494,19 @@ class DoIPMessage {
      * @param payload The payload data
      */
     void buildMessage(DoIPPayloadType payloadType, const ByteArray &payload) {
+        buildMessage(payloadType, payload.data(), payload.size());
+    }
+
+    /**
+     * @brief Builds the internal message representation from raw payload data.
+     *
+     * @param payloadType The payload type
+     * @param payload Pointer to the payload data
+     * @param size Number of payload bytes
+     */
+    void buildMessage(DoIPPayloadType payloadType, const uint8_t *payload, size_t size) {
         m_data.clear();
-        m_data.reserve(DOIP_HEADER_SIZE + payload.size());
+        m_data.reserve(DOIP_HEADER_SIZE + size);
 
         // Protocol version
         m_data.emplace_back(PROTOCOL_VERSION);
@@ -461,11 +516,11 @@ class DoIPMessage {
         m_data.writeEnum(payloadType);
 
         // Payload length (big-endian uint32_t)
-        uint32_t payloadLength = static_cast<uint32_t>(payload.size());
+        uint32_t payloadLength = static_cast<uint32_t>(size);
         m_data.writeU32BE(payloadLength);
 
         // Payload data
-        m_data.insert(m_data.end(), payload.begin(), payload.end());
+        m_data.append(payload, size);
     }
 
     /**
@@ -514,6 +569,30 @@ inline DoIPMessage makeVehicleIdentificationRequest() {
     return DoIPMessage(DoIPPayloadType::VehicleIdentificationRequest, {});
 }
 
+/**
+ * @brief Creates a vehicle identification request message with EID.
+ *
+ * Only the entity with this EID responds.
+ *
+ * @param eid the entity identifier (EID)
+ * @return DoIPMessage the vehicle identification request
+ */
+inline DoIPMessage makeVehicleIdentificationRequestWithEid(const DoIpEid &eid) {
+    return DoIPMessage(DoIPPayloadType::VehicleIdentificationRequestWithEid, eid.data(), eid.size());
+}
+
+/**
+ * @brief Creates a vehicle identification request message with VIN.
+ *
+ * Only the entities of the vehicle with this VIN respond.
+ *
+ * @param vin the vehicle identification number (VIN)
+ * @return DoIPMessage the vehicle identification request
+ */
+inline DoIPMessage makeVehicleIdentificationRequestWithVin(const DoIpVin &vin) {
+    return DoIPMessage(DoIPPayloadType::VehicleIdentificationRequestWithVin, vin.data(), vin.size());
+}
+
 /**
  * @brief Creates a vehicle identification response message.
  *
@@ -533,7 +612,7 @@ inline DoIPMessage makeVehicleIdentificationResponse(
     DoIPFurtherAction furtherAction = DoIPFurtherAction::NoFurtherAction,
     DoIPSyncStatus syncStatus = DoIPSyncStatus::GidVinSynchronized) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(vin.size() + sizeof(logicalAddress) + entityType.size() + groupId.size() + 2);
 
     payload.insert(payload.end(), vin.begin(), vin.end());
@@ -543,7 +622,59 @@ inline DoIPMessage makeVehicleIdentificationResponse(
     payload.writeEnum(furtherAction);
     payload.writeEnum(syncStatus);
 
-    return DoIPMessage(DoIPPayloadType::VehicleIdentificationResponse, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::VehicleIdentificationResponse, payload.data(), payload.size());
+}
+
+/**
+ * @brief Creates a DoIP entity status request message.
+ *
+ * @return DoIPMessage the entity status request
+ */
+inline DoIPMessage makeEntityStatusRequest() {
+    return DoIPMessage(DoIPPayloadType::EntityStatusRequest, {});
+}
+
+/**
+ * @brief Creates a DoIP entity status response message.
+ *
+ * @param nodeType the node type of the entity
+ * @param maxOpenSockets the maximum number of concurrent TCP sockets
+ * @param openSockets the number of currently open TCP sockets
+ * @param maxDataSize the maximum size of a logical request the entity can process
+ * @return DoIPMessage the entity status response
+ */
+inline DoIPMessage makeEntityStatusResponse(
+    DoIPNodeType nodeType,
+    uint8_t maxOpenSockets,
+    uint8_t openSockets,
+    uint32_t maxDataSize) {
+
+    DoIPMessageBuffer payload;
+    payload.writeEnum(nodeType);
+    payload.emplace_back(maxOpenSockets);
+    payload.emplace_back(openSockets);
+    payload.writeU32BE(maxDataSize);
+
+    return DoIPMessage(DoIPPayloadType::EntityStatusResponse, payload.data(), payload.size());
+}
+
+/**
+ * @brief Creates a diagnostic power mode information request message.
+ *
+ * @return DoIPMessage the diagnostic power mode request
+ */
+inline DoIPMessage makeDiagnosticPowerModeRequest() {
+    return DoIPMessage(DoIPPayloadType::DiagnosticPowerModeRequest, {});
+}
+
+/**
+ * @brief Creates a diagnostic power mode information response message.
+ *
+ * @param powerMode the diagnostic power mode
+ * @return DoIPMessage the diagnostic power mode response
+ */
+inline DoIPMessage makeDiagnosticPowerModeResponse(DoIPPowerMode powerMode) {
+    return DoIPMessage(DoIPPayloadType::DiagnosticPowerModeResponse, {static_cast<uint8_t>(powerMode)});
 }
 
 /**
@@ -569,14 +700,14 @@ inline DoIPMessage makeDiagnosticMessage(
     const DoIPAddress &ta,
     const ByteArray &msg_payload) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(sizeof(sa) + sizeof(ta) + msg_payload.size());
 
     payload.writeU16BE(sa);
     payload.writeU16BE(ta);
-    payload.insert(payload.end(), msg_payload.begin(), msg_payload.end());
+    payload.append(msg_payload.data(), msg_payload.size());
 
-    return DoIPMessage(DoIPPayloadType::DiagnosticMessage, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::DiagnosticMessage, payload.data(), payload.size());
 }
 
 /** void b
@@ -592,15 +723,15 @@ inline DoIPMessage makeDiagnosticPositiveResponse(
     const DoIPAddress &ta,
     const ByteArray &msg_payload) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(sizeof(sa) + sizeof(ta) + msg_payload.size() + 1);
 
     payload.writeU16BE(sa);
     payload.writeU16BE(ta);
     payload.emplace_back(DIAGNOSTIC_MESSAGE_ACK);
-    payload.insert(payload.end(), msg_payload.begin(), msg_payload.end());
+    payload.append(msg_payload.data(), msg_payload.size());
 
-    return DoIPMessage(DoIPPayloadType::DiagnosticMessageAck, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::DiagnosticMessageAck, payload.data(), payload.size());
 }
 
 /**
@@ -618,15 +749,15 @@ inline DoIPMessage makeDiagnosticNegativeResponse(
     DoIPNegativeDiagnosticAck nack,
     const ByteArray &msg_payload) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(sizeof(sa) + sizeof(ta) + msg_payload.size() + 1);
 
     payload.writeU16BE(sa);
     payload.writeU16BE(ta);
     payload.emplace_back(static_cast<uint8_t>(nack));
-    payload.insert(payload.end(), msg_payload.begin(), msg_payload.end());
+    payload.append(msg_payload.data(), msg_payload.size());
 
-    return DoIPMessage(DoIPPayloadType::DiagnosticMessageNegativeAck, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::DiagnosticMessageNegativeAck, payload.data(), payload.size());
 }
 
 /**
@@ -645,9 +776,9 @@ inline DoIPMessage makeAliveCheckRequest() {
  * @return DoIPMessage
  */
 inline DoIPMessage makeAliveCheckResponse(const DoIPAddress &sa) {
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.writeU16BE(sa);
-    return DoIPMessage(DoIPPayloadType::AliveCheckResponse, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::AliveCheckResponse, payload.data(), payload.size());
 }
 
 /**
@@ -661,14 +792,14 @@ inline DoIPMessage makeRoutingActivationRequest(
     const DoIPAddress &ea,
     DoIPRoutingActivationType actType = DoIPRoutingActivationType::Default) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(sizeof(ea) + 1 + 4);
     payload.writeU16BE(ea);
     payload.writeEnum(actType);
     // Reserved 4 bytes for future use
     payload.insert(payload.end(), {0, 0, 0, 0});
 
-    return DoIPMessage(DoIPPayloadType::RoutingActivationRequest, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::RoutingActivationRequest, payload.data(), payload.size());
 }
 
 /**
@@ -684,7 +815,7 @@ inline DoIPMessage makeRoutingActivationResponse(
     const DoIPAddress &ea,
     DoIPRoutingActivationType actType = DoIPRoutingActivationType::Default) {
 
-    ByteArray payload;
+    DoIPMessageBuffer payload;
     payload.reserve(sizeof(ea) + 1 + 4);
 
     auto optSourceAddress = routingReq.getSourceAddress();
@@ -697,21 +828,21 @@ inline DoIPMessage makeRoutingActivationResponse(
     // Reserved 4 bytes for future use
     payload.insert(payload.end(), {0, 0, 0, 0});
 
-    return DoIPMessage(DoIPPayloadType::RoutingActivationResponse, std::move(payload));
+    return DoIPMessage(DoIPPayloadType::RoutingActivationResponse, payload.data(), payload.size());
 }
 
 } // namespace message
 
 /**
- * @brief Stream operator for DoIPMessage
+ * @brief Stream operator for DoIPMessageView
  *
  * Prints the protocol version, payload type, payload size, and payload data.
  *
  * @param os Output stream
- * @param msg DoIPMessage to print
+ * @param msg DoIPMessageView to print
  * @return std::ostream& Reference to the output stream
  */
-inline std::ostream &operator<<(std::ostream &os, const DoIPMessage &msg) {
+inline std::ostream &operator<<(std::ostream &os, const DoIPMessageView &msg) {
     os << ansi::dim << "V" << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
        << static_cast<unsigned int>(PROTOCOL_VERSION) << std::dec << ansi::reset;
 
@@ -771,6 +902,17 @@ inline std::ostream &operator<<(std::ostream &os, const DoIPMessage &msg) {
     return os;
 }
 
+/**
+ * @brief Stream operator for DoIPMessage
+ *
+ * @param os Output stream
+ * @param msg DoIPMessage to print
+ * @return std::ostream& Reference to the output stream
+ */
+inline std::ostream &operator<<(std::ostream &os, const DoIPMessage &msg) {
+    return os << msg.view();
+}
+
 } // namespace doip
 
 #endif /* DOIPMESSAGE_IMPROVED_H */
@@ -0,0 +1,202 @@
+#ifndef DOIPMESSAGEVIEW_H
+#define DOIPMESSAGEVIEW_H
+
+#include <optional>
+#include <stdint.h>
+
+#include "ByteArray.h"
+#include "DoIPAddress.h"
+#include "DoIPFurtherAction.h"
+#include "DoIPIdentifiers.h"
+#include "DoIPPayloadType.h"
+
+namespace doip {
+
+/**
+ * @brief Size of the DoIP header
+ */
+constexpr size_t DOIP_HEADER_SIZE = 8;
+
+/**
+ * @brief Size of the DoIP diagnostic message header
+ */
+constexpr size_t DOIP_DIAG_HEADER_SIZE = DOIP_HEADER_SIZE + 4;
+
+/**
+ * @brief Non-owning view of a DoIP message.
+ *
+ * Offers the same accessors as DoIPMessage, but borrows the payload from a
+ * buffer owned by someone else (usually the receive buffer of a connection).
+ * A view is cheap to copy and is only valid as long as the underlying buffer;
+ * handlers that need the message beyond the call must take ownership by
+ * creating a DoIPMessage from it.
+ */
+class DoIPMessageView {
+  public:
+    /**
+     * @brief Default constructor - creates an empty view
+     */
+    DoIPMessageView() = default;
+
+    /**
+     * @brief Constructs a view over a payload.
+     *
+     * @param payloadType The payload type of the message
+     * @param payload Pointer to the payload data (without header)
+     * @param payloadLength Number of payload bytes
+     */
+    DoIPMessageView(DoIPPayloadType payloadType, const uint8_t *payload, size_t payloadLength)
+        : m_payloadType(payloadType), m_payload(payload), m_payloadLength(payloadLength) {}
+
+    /**
+     * @brief Gets the payload type of this message.
+     *
+     * @return The DoIP payload type
+     */
+    DoIPPayloadType getPayloadType() const {
+        return m_payloadType;
+    }
+
+    /**
+     * @brief Gets the payload data (without header).
+     *
+     * @return ByteArrayRef pointing to the payload portion
+     */
+    ByteArrayRef getPayload() const {
+        if (m_payloadLength == 0) {
+            return {nullptr, 0};
+        }
+        return {m_payload, m_payloadLength};
+    }
+
+    /**
+     * @brief Gets the user data of a diagnostic message (without source and target address).
+     *
+     * @return ByteArrayRef pointing to the user data
+     */
+    ByteArrayRef getDiagnosticMessagePayload() const {
+        constexpr size_t offset = DOIP_DIAG_HEADER_SIZE - DOIP_HEADER_SIZE;
+        if (m_payloadLength <= offset) {
+            return {nullptr, 0};
+        }
+        return {m_payload + offset, m_payloadLength - offset};
+    }
+
+    /**
+     * @brief Gets the payload size in bytes (without header).
+     *
+     * @return size_t Number of bytes in the payload
+     */
+    size_t getPayloadSize() const {
+        return m_payloadLength;
+    }
+
+    /**
+     * @brief Check if the message has a Source Address field.
+     *
+     * @return Returns @c true in the case of success, @c false otherwise.
+     */
+    bool hasSourceAddress() const {
+        bool result = m_payloadType == DoIPPayloadType::DiagnosticMessage ||
+                      m_payloadType == DoIPPayloadType::RoutingActivationRequest ||
+                      m_payloadType == DoIPPayloadType::RoutingActivationResponse ||
+                      m_payloadType == DoIPPayloadType::AliveCheckResponse;
+
+        return result && m_payloadLength >= 2;
+    }
+
+    /**
+     * @brief Get the Source Address of the message (if message is a Diagnostic Message).
+     *
+     * @return std::optional<DoIPAddress> The source address if present, std::nullopt otherwise
+     */
+    std::optional<DoIPAddress> getSourceAddress() const {
+        if (hasSourceAddress()) {
+            return readAddressFrom(m_payload, 0);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the Logical Address of the message (if message is a Vehicle Identification Response).
+     *
+     * @return std::optional<DoIPAddress> The logical address if present, std::nullopt otherwise
+     */
+    std::optional<DoIPAddress> getLogicalAddress() const {
+        if (m_payloadType == DoIPPayloadType::VehicleIdentificationResponse && m_payloadLength >= 19) {
+            return readAddressFrom(m_payload + 17);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the Target Address of the message (if message is a Diagnostic Message).
+     *
+     * @return std::optional<DoIPAddress> The target address if present, std::nullopt otherwise
+     */
+    std::optional<DoIPAddress> getTargetAddress() const {
+        if (m_payloadType == DoIPPayloadType::DiagnosticMessage && m_payloadLength >= DOIP_DIAG_HEADER_SIZE - DOIP_HEADER_SIZE) {
+            return readAddressFrom(m_payload, 2);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the vehicle identification number (VIN) if message is a Vehicle Identification Response.
+     *
+     * @return std::optional<DoIpVin> The VIN if present, std::nullopt otherwise
+     */
+    std::optional<DoIpVin> getVin() const {
+        if (m_payloadType == DoIPPayloadType::VehicleIdentificationResponse && m_payloadLength >= 17) {
+            return DoIpVin(m_payload, 17);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the entity id (EID) if message is a Vehicle Identification Response.
+     *
+     * @return std::optional<DoIpEid> The EID if present, std::nullopt otherwise
+     */
+    std::optional<DoIpEid> getEid() const {
+        if (m_payloadType == DoIPPayloadType::VehicleIdentificationResponse && m_payloadLength >= 25) {
+            return DoIpEid(m_payload + 19, 6);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the group id (GID) if message is a Vehicle Identification Response.
+     *
+     * @return std::optional<DoIpGid> The GID if present, std::nullopt otherwise
+     */
+    std::optional<DoIpGid> getGid() const {
+        if (m_payloadType == DoIPPayloadType::VehicleIdentificationResponse && m_payloadLength >= 31) {
+            return DoIpGid(m_payload + 25, 6);
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the Further Action Request object if message is a Vehicle Identification Response.
+     *
+     * @return std::optional<DoIPFurtherAction> The Further Action Request if present, std::nullopt otherwise
+     */
+    std::optional<DoIPFurtherAction> getFurtherActionRequest() const {
+        if (m_payloadType == DoIPPayloadType::VehicleIdentificationResponse && m_payloadLength >= 32) {
+            return DoIPFurtherAction(m_payload[31]);
+        }
+        return std::nullopt;
+    }
+
+  private:
+    DoIPPayloadType m_payloadType{DoIPPayloadType::NegativeAck};
+    const uint8_t *m_payload{nullptr};
+    size_t m_payloadLength{0};
+};
+
+using OptDoIPMessageView = std::optional<DoIPMessageView>;
+
+} // namespace doip
+
+#endif /* DOIPMESSAGEVIEW_H */
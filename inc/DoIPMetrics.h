@@ -0,0 +1,298 @@
+#ifndef DOIPMETRICS_H
+#define DOIPMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DoIPCloseReason.h"
+#include "DoIPNegativeDiagnosticAck.h"
+#include "DoIPPayloadType.h"
+
+namespace doip {
+
+enum class ConnectionTimers : uint8_t; // see DoIPDefaultConnection.h
+
+/**
+ * @brief Payload types with their own frame and byte counters.
+ *
+ * Frames of other (reserved or manufacturer specific) payload types are
+ * counted in an additional slot at index METRICS_PAYLOAD_TYPES.size().
+ */
+constexpr std::array<DoIPPayloadType, 17> METRICS_PAYLOAD_TYPES = {
+    DoIPPayloadType::NegativeAck,
+    DoIPPayloadType::VehicleIdentificationRequest,
+    DoIPPayloadType::VehicleIdentificationRequestWithEid,
+    DoIPPayloadType::VehicleIdentificationRequestWithVin,
+    DoIPPayloadType::VehicleIdentificationResponse,
+    DoIPPayloadType::RoutingActivationRequest,
+    DoIPPayloadType::RoutingActivationResponse,
+    DoIPPayloadType::AliveCheckRequest,
+    DoIPPayloadType::AliveCheckResponse,
+    DoIPPayloadType::EntityStatusRequest,
+    DoIPPayloadType::EntityStatusResponse,
+    DoIPPayloadType::DiagnosticPowerModeRequest,
+    DoIPPayloadType::DiagnosticPowerModeResponse,
+    DoIPPayloadType::DiagnosticMessage,
+    DoIPPayloadType::DiagnosticMessageAck,
+    DoIPPayloadType::DiagnosticMessageNegativeAck,
+    DoIPPayloadType::PeriodicDiagnosticMessage,
+};
+
+constexpr size_t METRICS_PAYLOAD_SLOTS = METRICS_PAYLOAD_TYPES.size() + 1;
+constexpr size_t METRICS_NACK_SLOTS = static_cast<size_t>(DoIPNegativeDiagnosticAck::TargetBusy) + 1;
+constexpr size_t METRICS_CLOSE_REASON_SLOTS = static_cast<size_t>(DoIPCloseReason::RoutingActivationDenied) + 1;
+constexpr size_t METRICS_TIMER_SLOTS = 5; // ConnectionTimers::UserDefined + 1
+
+/**
+ * @brief Upper bounds of the latency histogram buckets in microseconds.
+ *
+ * A final bucket without upper bound (+Inf) follows.
+ */
+constexpr std::array<uint64_t, 16> METRICS_LATENCY_BUCKETS_US = {
+    10, 25, 50, 100, 250, 500,
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000};
+
+constexpr size_t METRICS_LATENCY_SLOTS = METRICS_LATENCY_BUCKETS_US.size() + 1;
+
+/**
+ * @brief Maps a payload type to its counter slot.
+ *
+ * @param type the payload type
+ * @return the index into the per payload type counters
+ */
+constexpr size_t metricsPayloadIndex(DoIPPayloadType type) noexcept {
+    // The payload types form three contiguous ranges, see METRICS_PAYLOAD_TYPES
+    auto value = static_cast<size_t>(type);
+    if (value <= 0x0008) {
+        return value;
+    }
+    if (value >= 0x4001 && value <= 0x4004) {
+        return value - 0x4001 + 9;
+    }
+    if (value >= 0x8001 && value <= 0x8004) {
+        return value - 0x8001 + 13;
+    }
+    return METRICS_PAYLOAD_TYPES.size();
+}
+
+/**
+ * @brief Plain copy of a latency histogram.
+ */
+struct LatencyHistogramSnapshot {
+    std::array<uint64_t, METRICS_LATENCY_SLOTS> buckets{}; ///< Non-cumulative count per bucket
+    uint64_t count{0};                                     ///< Number of observations
+    uint64_t sumNs{0};                                     ///< Sum of all observations in ns
+
+    LatencyHistogramSnapshot &operator+=(const LatencyHistogramSnapshot &other);
+};
+
+/**
+ * @brief Plain copy of a set of metrics, as returned by DoIPServer::metrics().
+ */
+struct DoIPMetricsSnapshot {
+    std::array<uint64_t, METRICS_PAYLOAD_SLOTS> framesReceived{};
+    std::array<uint64_t, METRICS_PAYLOAD_SLOTS> bytesReceived{};
+    std::array<uint64_t, METRICS_PAYLOAD_SLOTS> framesSent{};
+    std::array<uint64_t, METRICS_PAYLOAD_SLOTS> bytesSent{};
+    std::array<uint64_t, METRICS_NACK_SLOTS> diagnosticNacks{};
+    std::array<uint64_t, METRICS_CLOSE_REASON_SLOTS> closeReasons{};
+    std::array<uint64_t, METRICS_TIMER_SLOTS> timerExpirations{};
+    uint64_t connectionsAccepted{0};
+    uint64_t connectionsRejected{0};
+    uint64_t connectionsActive{0};
+    uint64_t udpDatagramsDropped{0}; ///< UDP datagrams dropped by the per source rate limit
+    uint64_t udpNacksSuppressed{0};  ///< UDP negative acknowledgements not sent due to the rate limit
+    LatencyHistogramSnapshot diagnosticHandlerLatency; ///< Time spent in onDiagnosticMessage
+    LatencyHistogramSnapshot downstreamLatency;        ///< Downstream request until response or timeout
+
+    uint64_t framesReceivedOf(DoIPPayloadType type) const { return framesReceived[metricsPayloadIndex(type)]; }
+    uint64_t bytesReceivedOf(DoIPPayloadType type) const { return bytesReceived[metricsPayloadIndex(type)]; }
+    uint64_t framesSentOf(DoIPPayloadType type) const { return framesSent[metricsPayloadIndex(type)]; }
+    uint64_t bytesSentOf(DoIPPayloadType type) const { return bytesSent[metricsPayloadIndex(type)]; }
+    uint64_t nacksOf(DoIPNegativeDiagnosticAck code) const { return diagnosticNacks[static_cast<size_t>(code)]; }
+    uint64_t closedBy(DoIPCloseReason reason) const { return closeReasons[static_cast<size_t>(reason)]; }
+    uint64_t expirationsOf(ConnectionTimers timer) const { return timerExpirations[static_cast<size_t>(timer)]; }
+
+    DoIPMetricsSnapshot &operator+=(const DoIPMetricsSnapshot &other);
+};
+
+/**
+ * @brief Lock-free latency histogram with fixed buckets (see METRICS_LATENCY_BUCKETS_US).
+ */
+class LatencyHistogram {
+  public:
+    /**
+     * @brief Add an observation.
+     * @param duration the measured latency
+     */
+    void observe(std::chrono::nanoseconds duration) noexcept;
+
+    LatencyHistogramSnapshot snapshot() const noexcept;
+
+  private:
+    std::array<std::atomic<uint64_t>, METRICS_LATENCY_SLOTS> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sumNs{0};
+};
+
+/**
+ * @brief Counters and latency histograms of a connection or of a server.
+ *
+ * All updates are relaxed atomic increments, so they may be done from any
+ * thread (connection, timer and downstream threads) without locking. A
+ * snapshot taken concurrently is not atomic as a whole, but every counter in
+ * it is exact.
+ */
+class DoIPMetrics {
+  public:
+    void countReceived(DoIPPayloadType type, size_t bytes, bool newFrame = true) noexcept {
+        size_t index = metricsPayloadIndex(type);
+        if (newFrame) {
+            increment(m_framesReceived[index]);
+        }
+        increment(m_bytesReceived[index], bytes);
+    }
+
+    void countSent(DoIPPayloadType type, size_t bytes) noexcept {
+        size_t index = metricsPayloadIndex(type);
+        increment(m_framesSent[index]);
+        increment(m_bytesSent[index], bytes);
+    }
+
+    void countNack(DoIPNegativeDiagnosticAck code) noexcept {
+        increment(m_diagnosticNacks[slot(static_cast<size_t>(code), METRICS_NACK_SLOTS)]);
+    }
+
+    void countClose(DoIPCloseReason reason) noexcept {
+        increment(m_closeReasons[slot(static_cast<size_t>(reason), METRICS_CLOSE_REASON_SLOTS)]);
+    }
+
+    void countTimerExpiration(ConnectionTimers timer) noexcept {
+        increment(m_timerExpirations[slot(static_cast<size_t>(timer), METRICS_TIMER_SLOTS)]);
+    }
+
+    void countAccepted() noexcept { increment(m_connectionsAccepted); }
+    void countRejected() noexcept { increment(m_connectionsRejected); }
+    void countUdpDropped() noexcept { increment(m_udpDatagramsDropped); }
+    void countUdpNackSuppressed() noexcept { increment(m_udpNacksSuppressed); }
+
+    LatencyHistogram &diagnosticHandlerLatency() noexcept { return m_diagnosticHandlerLatency; }
+    LatencyHistogram &downstreamLatency() noexcept { return m_downstreamLatency; }
+
+    /**
+     * @brief Copy all counters.
+     */
+    DoIPMetricsSnapshot snapshot() const noexcept;
+
+  private:
+    std::array<std::atomic<uint64_t>, METRICS_PAYLOAD_SLOTS> m_framesReceived{};
+    std::array<std::atomic<uint64_t>, METRICS_PAYLOAD_SLOTS> m_bytesReceived{};
+    std::array<std::atomic<uint64_t>, METRICS_PAYLOAD_SLOTS> m_framesSent{};
+    std::array<std::atomic<uint64_t>, METRICS_PAYLOAD_SLOTS> m_bytesSent{};
+    std::array<std::atomic<uint64_t>, METRICS_NACK_SLOTS> m_diagnosticNacks{};
+    std::array<std::atomic<uint64_t>, METRICS_CLOSE_REASON_SLOTS> m_closeReasons{};
+    std::array<std::atomic<uint64_t>, METRICS_TIMER_SLOTS> m_timerExpirations{};
+    std::atomic<uint64_t> m_connectionsAccepted{0};
+    std::atomic<uint64_t> m_connectionsRejected{0};
+    std::atomic<uint64_t> m_udpDatagramsDropped{0};
+    std::atomic<uint64_t> m_udpNacksSuppressed{0};
+    LatencyHistogram m_diagnosticHandlerLatency;
+    LatencyHistogram m_downstreamLatency;
+
+    static void increment(std::atomic<uint64_t> &counter, uint64_t value = 1) noexcept {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Out of range enum values are counted in the last slot
+    static size_t slot(size_t index, size_t slots) noexcept {
+        return index < slots ? index : slots - 1;
+    }
+};
+
+/**
+ * @brief Server-wide metrics: the server's own counters plus those of all connections.
+ *
+ * Each connection updates only its own DoIPMetrics, so connection threads never
+ * contend on shared counters. A snapshot sums the counters of the live
+ * connections, of the connections closed before and of the server itself.
+ */
+class DoIPMetricsRegistry {
+  public:
+    /**
+     * @brief Counters of events not tied to a connection (accepts, rejects, UDP).
+     */
+    DoIPMetrics &serverMetrics() noexcept { return m_server; }
+
+    /**
+     * @brief Include the counters of a connection in the snapshots.
+     * @param metrics the connection's counters, must stay valid until removeConnection()
+     */
+    void addConnection(const DoIPMetrics *metrics);
+
+    /**
+     * @brief Keep the final counters of a connection and forget the connection.
+     * @param metrics the counters passed to addConnection()
+     */
+    void removeConnection(const DoIPMetrics *metrics);
+
+    /**
+     * @brief Number of connections added and not yet removed.
+     *
+     * Read without locking, e.g. for the entity status response.
+     */
+    size_t openConnections() const noexcept { return m_openConnections.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sum up the counters of the server and all connections.
+     */
+    DoIPMetricsSnapshot snapshot() const;
+
+  private:
+    DoIPMetrics m_server;
+    std::atomic<size_t> m_openConnections{0};
+    mutable std::mutex m_mutex;
+    std::vector<const DoIPMetrics *> m_connections;
+    DoIPMetricsSnapshot m_closedConnections;
+};
+
+/**
+ * @brief Write a snapshot in the Prometheus text exposition format.
+ *
+ * @param os the output stream
+ * @param snapshot the metrics to write
+ */
+void writePrometheusText(std::ostream &os, const DoIPMetricsSnapshot &snapshot);
+
+/**
+ * @brief Write a snapshot in Prometheus text format to a file.
+ *
+ * The file is replaced atomically, so a collector (e.g. the node exporter's
+ * textfile collector) never reads a partially written file.
+ *
+ * @param path the file to write
+ * @param snapshot the metrics to write
+ * @return true on success
+ */
+bool dumpPrometheusToFile(const std::string &path, const DoIPMetricsSnapshot &snapshot);
+
+/**
+ * @brief Send a snapshot in Prometheus text format to a local (Unix domain) stream socket.
+ *
+ * Connects to the socket, writes the text and closes the connection.
+ *
+ * @param socketPath path of the listening socket
+ * @param snapshot the metrics to write
+ * @return true on success
+ */
+bool dumpPrometheusToSocket(const std::string &socketPath, const DoIPMetricsSnapshot &snapshot);
+
+} // namespace doip
+
+#endif /* DOIPMETRICS_H */
@@ -0,0 +1,15 @@
+#ifndef DOIPNODETYPE_H
+#define DOIPNODETYPE_H
+
+#include <stdint.h>
+
+namespace doip {
+    // Node type values of the DoIP entity status response
+    enum class DoIPNodeType : uint8_t {
+        Gateway = 0x00,
+        Node = 0x01,
+        // 0x02 to 0xFF: reserved
+    };
+} // namespace doip
+
+#endif /* DOIPNODETYPE_H */
@@ -0,0 +1,161 @@
+#ifndef DOIPOUTBOUNDQUEUE_H
+#define DOIPOUTBOUNDQUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include "DoIPConfig.h"
+#include "TimerManager.h"
+#include "TimerWheel.h"
+
+namespace doip {
+
+/**
+ * @brief Callback invoked when the congestion state of an outbound queue changes.
+ *
+ * @param congested true if the high watermark was exceeded, false if the queue drained again
+ */
+using OutboundCongestionHandler = std::function<void(bool congested)>;
+
+#if DOIP_USE_TIMER_WHEEL
+using OutboundTimerManager = WheelTimerManager<uint8_t>;
+#else
+using OutboundTimerManager = TimerManager<uint8_t>;
+#endif
+
+/**
+ * @brief Per-connection queue of outbound DoIP messages.
+ *
+ * Messages are never written with a blocking call. While the queue is corked
+ * (e.g. while a connection dispatches a burst of received messages), small
+ * messages are collected and written with a single send call on uncork, or
+ * together with the next large message, so an ACK and the response produced
+ * in the same dispatch cycle end up in one send call.
+ * A message is never held back longer than the flush deadline.
+ *
+ * If the peer does not read fast enough, unsent data stays queued and is
+ * retried from a flush timer. Once the number of unsent bytes exceeds
+ * the high watermark the queue reports congestion, and further messages are
+ * rejected with ENOBUFS when they would raise the number of unsent bytes above
+ * four times the high watermark. A message is always accepted while nothing is
+ * pending, whatever its size.
+ *
+ * All methods are thread-safe.
+ */
+class DoIPOutboundQueue {
+  public:
+    /**
+     * @brief Construct an outbound queue for a socket.
+     *
+     * @param fd the connected socket
+     * @param flushDeadline maximum time a message is held back
+     * @param highWatermark number of unsent bytes at which congestion is reported
+     */
+    explicit DoIPOutboundQueue(int fd,
+                               std::chrono::milliseconds flushDeadline = std::chrono::milliseconds(DOIP_TX_FLUSH_DEADLINE_MS),
+                               size_t highWatermark = DOIP_TX_HIGH_WATERMARK);
+
+    /**
+     * @brief Destructor. Pending data is dropped.
+     */
+    ~DoIPOutboundQueue();
+
+    DoIPOutboundQueue(const DoIPOutboundQueue &) = delete;
+    DoIPOutboundQueue &operator=(const DoIPOutboundQueue &) = delete;
+    DoIPOutboundQueue(DoIPOutboundQueue &&) = delete;
+    DoIPOutboundQueue &operator=(DoIPOutboundQueue &&) = delete;
+
+    /**
+     * @brief Queue a message given as a list of buffers.
+     *
+     * Unless the queue is corked, the data is written immediately, together
+     * with any data still pending, using one sendmsg call. Only what the socket
+     * does not accept is copied; small messages are copied while the queue is
+     * corked. Either way, the buffers may be released when the call returns.
+     *
+     * @param iov the buffers forming the message
+     * @param count number of buffers
+     * @return number of bytes accepted, or -1 on error (errno is ENOBUFS if the
+     *         queue is full, EPIPE if the queue was closed)
+     */
+    ssize_t enqueue(const iovec *iov, size_t count);
+
+    /**
+     * @brief Hold back writes until the matching uncork() call. Calls may be nested.
+     */
+    void cork();
+
+    /**
+     * @brief Release one cork() level and write the collected data if it was the last one.
+     */
+    void uncork();
+
+    /**
+     * @brief Write as much queued data as the socket accepts, regardless of corking.
+     *
+     * @return false if a socket error occurred, true otherwise
+     */
+    bool flush();
+
+    /**
+     * @brief Try to write the pending data and stop using the socket.
+     *
+     * Data the socket does not accept without blocking is dropped. Subsequent
+     * calls to enqueue() fail.
+     */
+    void close();
+
+    /**
+     * @brief Set the handler notified about congestion state changes.
+     *
+     * The handler is called without holding the queue lock, so it may send.
+     *
+     * @param handler the handler
+     */
+    void setCongestionHandler(OutboundCongestionHandler handler);
+
+    /**
+     * @brief Number of bytes waiting to be written.
+     */
+    size_t pendingBytes() const;
+
+    /**
+     * @brief Check if the number of unsent bytes exceeds the high watermark.
+     */
+    bool isCongested() const;
+
+  private:
+    int m_fd;
+    std::chrono::milliseconds m_flushDeadline;
+    size_t m_highWatermark;
+
+    mutable std::mutex m_mutex;
+    std::vector<uint8_t> m_pending;
+    size_t m_offset{0};
+    unsigned int m_corkDepth{0};
+    bool m_congested{false};
+    bool m_closed{false};
+    std::chrono::steady_clock::time_point m_heldSince;
+    OutboundCongestionHandler m_congestionHandler;
+
+    // Declared last, so it is destroyed (and no callback runs anymore) before the other members
+    OutboundTimerManager m_timers;
+
+    bool flushLocked();
+    bool writeLocked(const iovec *iov, size_t count);
+    void appendLocked(const iovec *iov, size_t count);
+    void armFlushTimerLocked();
+    void onFlushTimer();
+    bool updateCongestionLocked();
+    void notifyCongestion(bool congested);
+};
+
+} // namespace doip
+
+#endif /* DOIPOUTBOUNDQUEUE_H */
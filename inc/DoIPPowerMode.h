@@ -0,0 +1,16 @@
+#ifndef DOIPPOWERMODE_H
+#define DOIPPOWERMODE_H
+
+#include <stdint.h>
+
+namespace doip {
+    // Diagnostic power mode values of the diagnostic power mode information response
+    enum class DoIPPowerMode : uint8_t {
+        NotReady = 0x00,
+        Ready = 0x01,
+        NotSupported = 0x02,
+        // 0x03 to 0xFF: reserved
+    };
+} // namespace doip
+
+#endif /* DOIPPOWERMODE_H */
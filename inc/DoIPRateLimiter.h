@@ -0,0 +1,114 @@
+#ifndef DOIPRATELIMITER_H
+#define DOIPRATELIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace doip {
+
+/**
+ * @brief Default number of sources tracked by a DoIPRateLimiter.
+ */
+constexpr unsigned int DOIP_DEFAULT_RATE_LIMIT_SOURCES = 1024;
+
+/**
+ * @brief Token bucket parameters.
+ */
+struct DoIPRateLimit {
+    double ratePerSecond = 0.0; ///< Tokens added per second, 0 disables the limit
+    double burst = 1.0;         ///< Maximum number of tokens (at least 1 is used)
+
+    bool isEnabled() const { return ratePerSecond > 0.0; }
+};
+
+/**
+ * @brief Per source address token buckets, e.g. for the UDP discovery port.
+ *
+ * Every source has two buckets: one for received datagrams and one for
+ * negative acknowledgements sent back. The sources are kept in a fixed-size
+ * open addressing table; a new source takes a free slot within a short probe
+ * window of its home slot, or evicts the least recently seen source of that
+ * window. The table never grows, so a flood from many (spoofed) addresses
+ * costs neither memory nor more than a few probes per datagram.
+ *
+ * Not thread-safe: meant to be used by the single UDP listener thread.
+ */
+class DoIPRateLimiter {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Number of slots searched for a source, starting at its home slot.
+     */
+    static constexpr size_t PROBE_LIMIT = 8;
+
+    /**
+     * @brief Construct the table.
+     * @param sources Number of sources tracked, rounded up to a power of two
+     * @param datagrams Limit for received datagrams per source
+     * @param nacks Limit for negative acknowledgements per source
+     */
+    DoIPRateLimiter(size_t sources, const DoIPRateLimit &datagrams, const DoIPRateLimit &nacks);
+
+    /**
+     * @brief Take a token from the datagram bucket of a source.
+     * @param address the IPv4 source address (any byte order, used as key only)
+     * @param now the current time
+     * @return false if the datagram should be dropped
+     */
+    bool allowDatagram(uint32_t address, Clock::time_point now);
+
+    /**
+     * @brief Take a token from the negative acknowledgement bucket of a source.
+     * @param address the IPv4 source address (any byte order, used as key only)
+     * @param now the current time
+     * @return false if the negative acknowledgement should be suppressed
+     */
+    bool allowNack(uint32_t address, Clock::time_point now);
+
+    /**
+     * @brief Number of slots of the table.
+     */
+    size_t capacity() const { return m_entries.size(); }
+
+    /**
+     * @brief Number of sources currently tracked.
+     */
+    size_t sourceCount() const { return m_sources; }
+
+    /**
+     * @brief Number of sources evicted to make room for new ones.
+     */
+    uint64_t evictions() const { return m_evictions; }
+
+  private:
+    struct Bucket {
+        double tokens{0.0};
+        Clock::time_point refilled{};
+    };
+
+    struct Entry {
+        uint32_t address{0};
+        bool used{false};
+        Clock::time_point lastSeen{};
+        Bucket datagrams;
+        Bucket nacks;
+    };
+
+    std::vector<Entry> m_entries;
+    size_t m_mask;
+    DoIPRateLimit m_datagramLimit;
+    DoIPRateLimit m_nackLimit;
+    size_t m_sources{0};
+    uint64_t m_evictions{0};
+
+    Entry &lookup(uint32_t address, Clock::time_point now);
+    void reset(Entry &entry, uint32_t address, Clock::time_point now) const;
+    static bool take(Bucket &bucket, const DoIPRateLimit &limit, Clock::time_point now);
+};
+
+} // namespace doip
+
+#endif /* DOIPRATELIMITER_H */
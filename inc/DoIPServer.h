@@ -20,10 +20,16 @@
 #include "ByteArray.h"
 #include "DoIPConfig.h"
 #include "DoIPConnection.h"
+#include "DoIPEventLoop.h"
 #include "DoIPFurtherAction.h"
 #include "DoIPIdentifiers.h"
+#include "DoIPMetrics.h"
 #include "DoIPNegativeAck.h"
+#include "DoIPNodeType.h"
+#include "DoIPPowerMode.h"
+#include "DoIPRateLimiter.h"
 #include "DoIPServerModel.h"
+#include "DoIPUdpBatch.h"
 #include "MacAddress.h"
 
 namespace doip {
@@ -48,8 +54,32 @@ struct ServerConfig {
     // Run the server as a daemon by default
     bool daemonize = false;
 
+    // Node type reported in the entity status response
+    DoIPNodeType nodeType = DoIPNodeType::Gateway;
+
+    // Maximum number of concurrently open TCP connections, reported in the
+    // entity status response. Further connections are closed right after accept.
+    uint8_t maxConnections = 255;
+
     int announceCount = 3;               // Default Value = 3
     unsigned int announceInterval = 500; // Default Value = 500ms
+
+    // Number of epoll reactor threads serving TCP connections.
+    // 0 selects the blocking thread-per-connection mode (default).
+    unsigned int eventLoopThreads = 0;
+
+    // Maximum number of UDP datagrams received with one recvmmsg() call; their
+    // replies are sent with one sendmmsg() call. 1 handles one datagram at a time.
+    unsigned int udpBatchSize = DOIP_DEFAULT_UDP_BATCH_SIZE;
+
+    // Per source IP token buckets on the UDP discovery port. Datagrams above the
+    // datagram rate (after a burst) are dropped silently, negative acknowledgements
+    // above the NACK rate are not sent. A rate of 0 disables the limit.
+    DoIPRateLimit udpDatagramLimit{20.0, 40.0};
+    DoIPRateLimit udpNackLimit{2.0, 5.0};
+
+    // Number of sources tracked; when full, the least recently seen one is evicted
+    unsigned int udpRateLimitSources = DOIP_DEFAULT_RATE_LIMIT_SOURCES;
 };
 
 const ServerConfig DefaultServerConfig{};
@@ -101,6 +131,26 @@ class DoIPServer {
      */
     std::unique_ptr<DoIPConnection> waitForTcpConnection();
 
+    template <typename Model = DefaultDoIPServerModel>
+    /**
+     * @brief Start accepting TCP connections in a background thread.
+     *
+     * Depending on `ServerConfig::eventLoopThreads`, accepted connections are either
+     * served by a dedicated blocking thread each, or handed over to a fixed set of
+     * epoll reactor threads (see DoIPEventLoop). `setupTcpSocket()` must have been
+     * called before.
+     *
+     * @tparam Model Server model type used by the connections (default `DefaultDoIPServerModel`).
+     * @return true if the listener was started, false otherwise.
+     */
+    bool startTcpListener();
+
+    /**
+     * @brief Check if the TCP connections are served by the event loop.
+     */
+    [[nodiscard]]
+    bool isEventLoopMode() const { return m_eventLoop != nullptr; }
+
     [[nodiscard]]
     /**
      * @brief Initialize and bind the UDP socket for announcements and UDP messages.
@@ -202,6 +252,30 @@ class DoIPServer {
      */
     void setFurtherActionRequired(DoIPFurtherAction furtherActionRequired);
 
+    /**
+     * @brief Get the diagnostic power mode reported to testers.
+     * @return Current `DoIPPowerMode` value.
+     */
+    DoIPPowerMode getDiagnosticPowerMode() const { return m_powerMode.load(std::memory_order_relaxed); }
+    /**
+     * @brief Set the diagnostic power mode reported to testers (default: Ready).
+     * @param powerMode Value to set.
+     */
+    void setDiagnosticPowerMode(DoIPPowerMode powerMode) { m_powerMode.store(powerMode, std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the vehicle identification response sent for discovery requests and announcements.
+     *
+     * The response is encoded once and replaced whenever VIN, EID, GID,
+     * logical address or further action requirement change. A replaced
+     * response is released once the last reader dropped it.
+     *
+     * @return The current pre-encoded response
+     */
+    std::shared_ptr<const DoIPMessage> getVehicleIdentificationResponse() const {
+        return std::atomic_load_explicit(&m_vehicleIdentificationResponse, std::memory_order_acquire);
+    }
+
     /**
      * @brief Get last accepted client IP (string form).
      * @return IP address string.
@@ -213,30 +287,61 @@ class DoIPServer {
      */
     int getClientPort() const { return m_clientPort; }
 
+    /**
+     * @brief Get the server-wide counters and latency histograms.
+     *
+     * Sums up the counters of the server (accepts, rejects, UDP frames), of all
+     * open connections and of the connections closed before. Use
+     * writePrometheusText(), dumpPrometheusToFile() or dumpPrometheusToSocket()
+     * to export the snapshot.
+     *
+     * @return A copy of the current values
+     */
+    DoIPMetricsSnapshot metrics() const { return m_metrics->snapshot(); }
+
   private:
     int m_tcp_sock{-1};
     int m_udp_sock{-1};
     struct sockaddr_in m_serverAddress{};
-    struct sockaddr_in m_clientAddress{};
-    ByteArray m_receiveBuf{};
     std::string m_clientIp{};
     int m_clientPort{};
     DoIPFurtherAction m_FurtherActionReq = DoIPFurtherAction::NoFurtherAction;
+    std::atomic<DoIPPowerMode> m_powerMode{DoIPPowerMode::Ready};
 
     // Automatic mode state
     std::atomic<bool> m_running{false};
     std::vector<std::thread> m_workerThreads;
     std::mutex m_mutex;
 
+    // Event loop server mode (nullptr in thread-per-connection mode)
+    std::unique_ptr<DoIPEventLoop> m_eventLoop;
+
     // Server configuration
     ServerConfig m_config;
 
+    // Encoded from m_config. Only accessed with std::atomic_load/std::atomic_store,
+    // so the UDP threads read it without taking m_mutex.
+    std::shared_ptr<const DoIPMessage> m_vehicleIdentificationResponse;
+
+    // Used by the UDP listener thread only
+    DoIPRateLimiter m_udpRateLimiter;
+
+    // Shared with the connections, which may outlive the server in thread-per-connection mode
+    std::shared_ptr<DoIPMetricsRegistry> m_metrics = std::make_shared<DoIPMetricsRegistry>();
+
     void stop();
     void daemonize();
+    bool startEventLoop();
 
     void setMulticastGroup(const char *address) const;
+    void updateVehicleIdentificationResponse();
 
-    ssize_t sendNegativeUdpAck(DoIPNegativeAck ackCode);
+    void addUdpReply(DoIPUdpBatch &batch, const sockaddr_in &destination, const DoIPMessage &msg);
+    void addNegativeUdpAck(DoIPUdpBatch &batch, const sockaddr_in &destination, DoIPNegativeAck ackCode);
+
+    // Like waitForTcpConnection(), atCapacity tells a maxConnections rejection from a failure
+    template <typename Model>
+    std::unique_ptr<DoIPConnection> acceptTcpConnection(bool &atCapacity);
 
     template <typename Model>
     void tcpListenerThread();
@@ -247,15 +352,24 @@ class DoIPServer {
     void udpAnnouncementThread();
     ssize_t sendVehicleAnnouncement();
 
-    ssize_t sendUdpResponse(DoIPMessage msg);
+    void handleUdpDatagram(DoIPUdpBatch &batch, size_t index);
+    void sendUdpReplies(DoIPUdpBatch &batch);
 };
 
 // Template implementation must be in header for external linkage
 template <typename Model>
 std::unique_ptr<DoIPConnection> DoIPServer::waitForTcpConnection() {
+    bool atCapacity;
+    return acceptTcpConnection<Model>(atCapacity);
+}
+
+template <typename Model>
+std::unique_ptr<DoIPConnection> DoIPServer::acceptTcpConnection(bool &atCapacity) {
     static_assert(std::is_default_constructible<Model>::value,
                   "Model must be default-constructible");
 
+    atCapacity = false;
+
     // waits till client approach to make connection
     if (listen(m_tcp_sock, 5) < 0) {
         return nullptr;
@@ -266,7 +380,34 @@ std::unique_ptr<DoIPConnection> DoIPServer::waitForTcpConnection() {
         return nullptr;
     }
 
-    return std::unique_ptr<DoIPConnection>(new DoIPConnection(tcpSocket, std::make_unique<Model>()));
+    if (m_metrics->openConnections() >= m_config.maxConnections) {
+        LOG_TCP_WARN("Closing connection, all {} sockets are in use", m_config.maxConnections);
+        m_metrics->serverMetrics().countRejected();
+        close(tcpSocket);
+        atCapacity = true;
+        return nullptr;
+    }
+
+    m_metrics->serverMetrics().countAccepted();
+    auto connection = std::unique_ptr<DoIPConnection>(new DoIPConnection(tcpSocket, std::make_unique<Model>()));
+    connection->setMetricsRegistry(m_metrics);
+    return connection;
+}
+
+template <typename Model>
+bool DoIPServer::startTcpListener() {
+    if (m_tcp_sock < 0) {
+        LOG_TCP_ERROR("TCP socket not set up, cannot start listener");
+        return false;
+    }
+
+    if (m_config.eventLoopThreads > 0 && !startEventLoop()) {
+        return false;
+    }
+
+    m_running.store(true);
+    m_workerThreads.emplace_back([this]() { tcpListenerThread<Model>(); });
+    return true;
 }
 
 /*
@@ -277,16 +418,31 @@ void DoIPServer::tcpListenerThread() {
     LOG_DOIP_INFO("TCP listener thread started");
 
     while (m_running.load()) {
-        auto connection = waitForTcpConnection<Model>();
+        bool atCapacity;
+        auto connection = acceptTcpConnection<Model>(atCapacity);
 
+        if (atCapacity) {
+            // The socket is fine, accept the next client right away
+            continue;
+        }
         if (!connection) {
             if (m_running.load()) {
+                m_metrics->serverMetrics().countRejected();
                 LOG_TCP_DEBUG("Failed to accept connection, retrying...");
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
             continue;
         }
 
+        if (m_eventLoop) {
+            // Event loop mode: one of the reactors takes over the connection
+            if (!m_eventLoop->addConnection(std::move(connection))) {
+                m_metrics->serverMetrics().countRejected();
+                LOG_TCP_WARN("Event loop rejected connection");
+            }
+            continue;
+        }
+
         // Spawn a dedicated thread for this connection
         // Note: We detach because the connection thread manages its own lifecycle
         std::thread(&DoIPServer::connectionHandlerThread, this, std::move(connection)).detach();
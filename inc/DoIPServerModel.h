@@ -20,8 +20,36 @@ class IConnectionContext;
 // Callback type definitions
 using ServerModelOpenHandler = std::function<void(IConnectionContext &)>;
 using ServerModelCloseHandler = std::function<void(IConnectionContext &, DoIPCloseReason)>;
-using ServerModelDiagnosticHandler = std::function<DoIPDiagnosticAck(IConnectionContext &, const DoIPMessage &)>;
+using ServerModelDiagnosticHandler = std::function<DoIPDiagnosticAck(IConnectionContext &, const DoIPMessageView &)>;
 using ServerModelDiagnosticNotificationHandler = std::function<void(IConnectionContext &, DoIPDiagnosticAck)>;
+using ServerModelBackpressureHandler = std::function<void(IConnectionContext &, bool congested)>;
+
+/**
+ * @brief A chunk of a diagnostic message exceeding DOIP_MAXIMUM_MTU
+ *
+ * The data only refers to the user data of the diagnostic message (without
+ * source and target address) and is only valid during the callback.
+ */
+struct DoIPDiagnosticChunk {
+    DoIPAddress sourceAddress{ZERO_ADDRESS};
+    DoIPAddress targetAddress{ZERO_ADDRESS};
+    const uint8_t *data{nullptr};
+    size_t length{0};      ///< Number of bytes in this chunk
+    size_t offset{0};      ///< Position of the chunk within the user data
+    size_t totalLength{0}; ///< Length of the complete user data
+
+    /// Check if this is the last chunk of the message
+    bool isLast() const { return offset + length == totalLength; }
+};
+
+/**
+ * @brief Callback for chunks of large diagnostic messages
+ *
+ * Called in order for every chunk as it arrives. Returning a NACK stops the
+ * delivery of further chunks of the message; the ACK or NACK is sent to the
+ * client once the message was received completely.
+ */
+using ServerModelDiagnosticChunkHandler = std::function<DoIPDiagnosticAck(IConnectionContext &, const DoIPDiagnosticChunk &)>;
 
 /**
  * @brief Callback for downstream response notification
@@ -44,7 +72,8 @@ using ServerModelDownstreamResponseHandler = std::function<void(const ByteArray
  * The state machine will handle timeout management internally.
  *
  * @param ctx The connection context (use for receiveDownstreamResponse callback)
- * @param msg The diagnostic message to forward downstream
+ * @param msg The diagnostic message to forward downstream. The view is only valid during the call,
+ *            so the handler has to copy the data it queues (e.g. into a DoIPMessage or ByteArray).
  * @param callback the callback method to call when the downstream response arrived
  * @return DoIPDownstreamResult indicating the result of the request initiation
  *         - Pending: Async request initiated, response will come via receiveDownstreamResponse
@@ -52,7 +81,7 @@ using ServerModelDownstreamResponseHandler = std::function<void(const ByteArray
  *         - Error: Failed to initiate request, connection should handle error
  */
 using ServerModelDownstreamHandler = std::function<DoIPDownstreamResult(IConnectionContext &ctx,
-                                                                        const DoIPMessage &msg,
+                                                                        const DoIPMessageView &msg,
                                                                         ServerModelDownstreamResponseHandler callback)>;
 
 /**
@@ -75,6 +104,10 @@ struct DoIPServerModel {
     /// Called after a diagnostic ACK/NACK was sent to the client
     ServerModelDiagnosticNotificationHandler onDiagnosticNotification;
 
+    /// Called when the send queue of the connection becomes congested (true) or drains again (false).
+    /// May be called from the timer thread.
+    ServerModelBackpressureHandler onSendBackpressure;
+
     // === Downstream (subnet) callbacks ===
 
     /**
@@ -90,6 +123,17 @@ struct DoIPServerModel {
      */
     ServerModelDownstreamHandler onDownstreamRequest;
 
+    /**
+     * @brief Called for chunks of diagnostic messages larger than DOIP_MAXIMUM_MTU
+     *
+     * If set, such messages (e.g. TransferData blocks while flashing) are
+     * streamed to this callback while they arrive instead of being rejected.
+     * Streamed messages are neither passed to onDiagnosticMessage nor to
+     * onDownstreamRequest, so gateways forward the chunks themselves and send
+     * the response via ctx.receiveDownstreamResponse().
+     */
+    ServerModelDiagnosticChunkHandler onDiagnosticMessageChunk;
+
     /// The logical address of this DoIP server
     DoIPAddress serverAddress = DoIPAddress(0x0E00);
 
@@ -98,6 +142,12 @@ struct DoIPServerModel {
      * @return true if onDownstreamRequest callback is set
      */
     bool hasDownstreamHandler() const { return onDownstreamRequest != nullptr; }
+
+    /**
+     * @brief Check if streaming of large diagnostic messages is enabled
+     * @return true if onDiagnosticMessageChunk callback is set
+     */
+    bool hasDiagnosticChunkHandler() const { return onDiagnosticMessageChunk != nullptr; }
 };
 
 using UniqueServerModelPtr = std::unique_ptr<DoIPServerModel>;
@@ -120,7 +170,7 @@ struct DefaultDoIPServerModel : public DoIPServerModel {
             (void)reason;
         };
 
-        onDiagnosticMessage = [](IConnectionContext &ctx, const DoIPMessage &msg) noexcept -> DoIPDiagnosticAck {
+        onDiagnosticMessage = [](IConnectionContext &ctx, const DoIPMessageView &msg) noexcept -> DoIPDiagnosticAck {
             (void)ctx;
             (void)msg;
             LOG_DOIP_DEBUG("Diagnostic message received on DefaultDoIPServerModel");
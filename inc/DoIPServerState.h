@@ -11,7 +11,6 @@ enum class DoIPServerState {
     WaitRoutingActivation,  // Waiting for routing activation request
     RoutingActivated,       // Routing is active, ready for diagnostics
     WaitAliveCheckResponse, // D& config  Waiting for alive check response
-    WaitDownstreamResponse, // Waiting for response from downstream device
     Finalize,               // Cleanup state
     Closed                  // Connection closed
 };
@@ -27,8 +26,6 @@ inline std::ostream &operator<<(std::ostream &os, DoIPServerState state) {
         return os << "RoutingActivated";
     case DoIPServerState::WaitAliveCheckResponse:
         return os << "WaitAliveCheckResponse";
-    case DoIPServerState::WaitDownstreamResponse:
-        return os << "WaitDownstreamResponse";
     case DoIPServerState::Finalize:
         return os << "Finalize";
     case DoIPServerState::Closed:
@@ -0,0 +1,149 @@
+#ifndef DOIPUDPBATCH_H
+#define DOIPUDPBATCH_H
+
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "ByteArray.h"
+#include "DoIPConfig.h"
+
+namespace doip {
+
+/**
+ * @brief Default number of datagrams handled per UDP receive call.
+ */
+constexpr unsigned int DOIP_DEFAULT_UDP_BATCH_SIZE = 16;
+
+/**
+ * @brief Maximum size of a UDP reply (vehicle identification response, entity status, NACK, ...).
+ */
+constexpr size_t DOIP_UDP_REPLY_MAX_SIZE = 64;
+
+/**
+ * @brief Receive and reply buffers for batched UDP handling.
+ *
+ * receive() reads up to capacity() datagrams with a single recvmmsg() call,
+ * each into its own DOIP_MAXIMUM_MTU sized slot of a preallocated arena.
+ * Replies are collected with addReply(), each with its own destination
+ * address, and sent with a single sendmmsg() call by flush(). No memory is
+ * allocated after construction.
+ */
+class DoIPUdpBatch {
+  public:
+    /**
+     * @brief Construct the buffers.
+     * @param capacity Maximum number of datagrams per batch (at least one is used).
+     */
+    explicit DoIPUdpBatch(size_t capacity = DOIP_DEFAULT_UDP_BATCH_SIZE);
+
+    DoIPUdpBatch(const DoIPUdpBatch &) = delete;
+    DoIPUdpBatch &operator=(const DoIPUdpBatch &) = delete;
+    DoIPUdpBatch(DoIPUdpBatch &&) = delete;
+    DoIPUdpBatch &operator=(DoIPUdpBatch &&) = delete;
+
+    /**
+     * @brief Maximum number of datagrams (and replies) per batch.
+     */
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * @brief Start a new batch: drop all replies and receive up to capacity() datagrams.
+     *
+     * Blocks until a datagram arrives or the socket's receive timeout
+     * expires, then takes all further datagrams already queued without
+     * waiting. Datagrams larger than DOIP_MAXIMUM_MTU are truncated.
+     *
+     * @param fd the UDP socket
+     * @return number of datagrams received, or -1 on error (see errno)
+     */
+    int receive(int fd);
+
+    /**
+     * @brief Number of datagrams received by the last receive().
+     */
+    size_t size() const { return m_received; }
+
+    /**
+     * @brief The data of a received datagram.
+     * @param index the datagram index, less than size()
+     */
+    ByteArrayRef datagram(size_t index) const;
+
+    /**
+     * @brief Check if a received datagram was larger than DOIP_MAXIMUM_MTU and therefore truncated.
+     * @param index the datagram index, less than size()
+     */
+    bool isTruncated(size_t index) const { return (m_receiveHeaders[index].msg_hdr.msg_flags & MSG_TRUNC) != 0; }
+
+    /**
+     * @brief The sender address of a received datagram.
+     * @param index the datagram index, less than size()
+     */
+    const sockaddr_in &sender(size_t index) const { return m_senders[index]; }
+
+    /**
+     * @brief Queue a reply.
+     *
+     * @param destination the address to send the reply to
+     * @param data the reply data
+     * @param size the reply size, at most DOIP_UDP_REPLY_MAX_SIZE
+     * @return false if the reply is too large or capacity() replies are queued already
+     */
+    bool addReply(const sockaddr_in &destination, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Number of queued replies.
+     */
+    size_t replyCount() const { return m_replies; }
+
+    /**
+     * @brief The data of a queued reply.
+     * @param index the reply index, less than replyCount()
+     */
+    ByteArrayRef reply(size_t index) const;
+
+    /**
+     * @brief The destination address of a queued reply.
+     * @param index the reply index, less than replyCount()
+     */
+    const sockaddr_in &replyDestination(size_t index) const { return m_destinations[index]; }
+
+    /**
+     * @brief Check if a reply was sent by the last flush().
+     * @param index the reply index, less than replyCount()
+     */
+    bool isReplySent(size_t index) const { return m_replyHeaders[index].msg_len > 0; }
+
+    /**
+     * @brief Send all queued replies.
+     *
+     * Uses as few sendmmsg() calls as possible. A reply that cannot be sent is
+     * skipped, the remaining replies are still sent. The replies stay queued
+     * until the next receive(), so the caller may inspect them.
+     *
+     * @param fd the UDP socket
+     * @return number of replies sent
+     */
+    size_t flush(int fd);
+
+  private:
+    size_t m_capacity;
+
+    std::unique_ptr<uint8_t[]> m_receiveArena;
+    std::vector<iovec> m_receiveIov;
+    std::vector<mmsghdr> m_receiveHeaders;
+    std::vector<sockaddr_in> m_senders;
+    size_t m_received{0};
+
+    std::unique_ptr<uint8_t[]> m_replyArena;
+    std::vector<iovec> m_replyIov;
+    std::vector<mmsghdr> m_replyHeaders;
+    std::vector<sockaddr_in> m_destinations;
+    size_t m_replies{0};
+};
+
+} // namespace doip
+
+#endif /* DOIPUDPBATCH_H */
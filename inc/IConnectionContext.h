@@ -8,6 +8,7 @@
 #include "DoIPNegativeDiagnosticAck.h"
 
 #include <cstdint>
+#include <initializer_list>
 
 namespace doip {
 
@@ -39,6 +40,32 @@ class IConnectionContext {
      */
     [[nodiscard]] virtual ssize_t sendProtocolMessage(const DoIPMessage &msg) = 0;
 
+    /**
+     * @brief Send a DoIP protocol message given as a list of payload fragments
+     *
+     * The header is generated from the payload type and the total length of the
+     * fragments. Implementations should pass header and fragments to the
+     * transport without concatenating them (scatter-gather I/O), so large
+     * payloads are only copied if the socket does not accept them right away.
+     *
+     * @param payloadType The payload type of the message
+     * @param fragments The payload fragments in transmission order
+     * @param count Number of fragments
+     * @return Number of bytes sent (including the header), or negative value on error
+     */
+    [[nodiscard]] virtual ssize_t sendProtocolFragments(DoIPPayloadType payloadType, const ByteArrayRef *fragments, size_t count) = 0;
+
+    /**
+     * @brief Send a DoIP protocol message given as a list of payload fragments
+     *
+     * @param payloadType The payload type of the message
+     * @param fragments The payload fragments in transmission order
+     * @return Number of bytes sent (including the header), or negative value on error
+     */
+    [[nodiscard]] ssize_t sendProtocolFragments(DoIPPayloadType payloadType, std::initializer_list<ByteArrayRef> fragments) {
+        return sendProtocolFragments(payloadType, fragments.begin(), fragments.size());
+    }
+
     /**
      * @brief Close the TCP connection
      *
@@ -63,6 +90,16 @@ class IConnectionContext {
      */
     virtual DoIPCloseReason getCloseReason() const = 0;
 
+    /**
+     * @brief Check if outbound data backs up because the client reads slowly
+     *
+     * Applications should defer producing further responses (e.g. stop
+     * forwarding requests downstream) while this returns true.
+     *
+     * @return true if the send queue exceeds its high watermark, false otherwise
+     */
+    virtual bool isSendCongested() const = 0;
+
     /**
      * @brief Get the server's logical address
      *
@@ -98,10 +135,10 @@ class IConnectionContext {
      * - std::nullopt: Send positive ACK
      * - DoIPNegativeDiagnosticAck value: Send negative ACK with this code
      *
-     * @param msg The diagnostic message received
+     * @param msg The diagnostic message received. Only valid during the call.
      * @return std::nullopt for ACK, or NACK code
      */
-    virtual DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessage &msg) = 0;
+    virtual DoIPDiagnosticAck notifyDiagnosticMessage(const DoIPMessageView &msg) = 0;
 
     /**
      * @brief Notify application that connection is closing
@@ -142,25 +179,29 @@ class IConnectionContext {
      *
      * The downstream handler is responsible for:
      * 1. Sending the message via the appropriate transport (CAN, LIN, etc.)
-     * 2. Storing the connection context for async response delivery
-     * 3. Calling receiveDownstreamResponse() when the response arrives
+     * 2. Calling the response handler passed to it when the response arrives
      *
      * The state machine handles:
-     * - Transition to WaitDownstreamResponse state
-     * - Starting the downstream response timeout timer
-     * - Processing the response when it arrives
-     *
-     * @param msg The diagnostic message to forward
+     * - Tracking the outstanding requests per target address. Requests to
+     *   different targets are in flight at the same time, a request to a
+     *   target that has not answered yet is forwarded after the response
+     * - Starting a response timeout timer per request
+     * - Sending each response to the client as soon as it arrives
+     *
+     * @param msg The diagnostic message to forward. Only valid during the call,
+     *            the handler must copy what it needs for the asynchronous request.
      * @return Result indicating if the request was initiated successfully
      */
-    virtual DoIPDownstreamResult notifyDownstreamRequest(const DoIPMessage &msg) = 0;
+    virtual DoIPDownstreamResult notifyDownstreamRequest(const DoIPMessageView &msg) = 0;
 
     /**
      * @brief Receive a response from downstream device
      *
      * Called by the application layer when a response is received from
      * a downstream device. This injects the response back into the
-     * state machine for processing.
+     * state machine for processing. The response is assigned to the oldest
+     * outstanding request; use the response handler passed to
+     * onDownstreamRequest to complete a specific request.
      *
      * Thread-safety: This method may be called from a different thread
      * than the one running the state machine. Implementations should
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AnsiColors.h"
+#include "DoIPConfig.h"
 #include <cstdlib>
 #include <memory>
 #include <mutex>
@@ -9,6 +10,7 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <string>
+#include <unordered_map>
 
 #if !defined(FMT_VERSION) || FMT_VERSION < 90000
 #include <optional>
@@ -85,11 +87,40 @@ class Logger {
     }
 
     static std::shared_ptr<spdlog::logger> getUdp() {
-        return get("udp ");
+        static const std::shared_ptr<spdlog::logger> logger = get("udp ");
+        return logger;
     }
 
     static std::shared_ptr<spdlog::logger> getTcp() {
-        return get("tcp ");
+        static const std::shared_ptr<spdlog::logger> logger = get("tcp ");
+        return logger;
+    }
+
+    /**
+     * @brief Cached handle of the "doip" logger, used by the LOG_DOIP_* macros.
+     *
+     * Resolved once on first use; afterwards no lock, lookup or reference counting is
+     * involved. The logger stays registered, so setLevel() and setPattern() still apply.
+     */
+    static spdlog::logger &doipLogger() {
+        static spdlog::logger *const logger = get().get();
+        return *logger;
+    }
+
+    /**
+     * @brief Cached handle of the UDP logger, used by the LOG_UDP_* macros.
+     */
+    static spdlog::logger &udpLogger() {
+        static spdlog::logger *const logger = getUdp().get();
+        return *logger;
+    }
+
+    /**
+     * @brief Cached handle of the TCP logger, used by the LOG_TCP_* macros.
+     */
+    static spdlog::logger &tcpLogger() {
+        static spdlog::logger *const logger = getTcp().get();
+        return *logger;
     }
 
     static void setLevel(spdlog::level::level_enum level) {
@@ -120,45 +151,63 @@ class Logger {
 
 } // namespace doip
 
+/**
+ * @brief Logs a message if the level is compiled in and enabled on the logger.
+ *
+ * Statements below DOIP_LOG_ACTIVE_LEVEL are discarded at compile time. Otherwise the
+ * logger's level is checked before the arguments are evaluated, so expensive arguments
+ * (e.g. fmt::format calls) cost nothing while the level is disabled at runtime.
+ */
+#define DOIP_LOG_AT(handle, level, ...)                                          \
+    do {                                                                         \
+        if constexpr (static_cast<int>(level) >= DOIP_LOG_ACTIVE_LEVEL) {        \
+            spdlog::logger &doip_log_logger_ = (handle);                         \
+            if (doip_log_logger_.should_log(level)) {                            \
+                doip_log_logger_.log(level, __VA_ARGS__);                        \
+            }                                                                    \
+        }                                                                        \
+    } while (0)
+
+/**
+ * @brief Logs a formatted message wrapped in an ANSI color.
+ */
+#define DOIP_LOG_COLORED(color, level, ...) \
+    DOIP_LOG_AT(doip::Logger::doipLogger(), level, std::string(color) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+
 // Logging macros
-#define LOG_DOIP_TRACE(...) doip::Logger::get()->trace(__VA_ARGS__)
-#define LOG_DOIP_DEBUG(...) doip::Logger::get()->debug(__VA_ARGS__)
-#define LOG_DOIP_INFO(...) doip::Logger::get()->info(__VA_ARGS__)
-#define LOG_DOIP_WARN(...) doip::Logger::get()->warn(__VA_ARGS__)
-#define LOG_DOIP_ERROR(...) doip::Logger::get()->error(__VA_ARGS__)
-#define LOG_DOIP_CRITICAL(...) doip::Logger::get()->critical(__VA_ARGS__)
+#define LOG_DOIP_TRACE(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::trace, __VA_ARGS__)
+#define LOG_DOIP_DEBUG(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::debug, __VA_ARGS__)
+#define LOG_DOIP_INFO(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::info, __VA_ARGS__)
+#define LOG_DOIP_WARN(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::warn, __VA_ARGS__)
+#define LOG_DOIP_ERROR(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::err, __VA_ARGS__)
+#define LOG_DOIP_CRITICAL(...) DOIP_LOG_AT(doip::Logger::doipLogger(), spdlog::level::critical, __VA_ARGS__)
 
 // Logging macros for UDP socket
-#define LOG_UDP_TRACE(...) doip::Logger::getUdp()->trace(__VA_ARGS__)
-#define LOG_UDP_DEBUG(...) doip::Logger::getUdp()->debug(__VA_ARGS__)
-#define LOG_UDP_INFO(...) doip::Logger::getUdp()->info(__VA_ARGS__)
-#define LOG_UDP_WARN(...) doip::Logger::getUdp()->warn(__VA_ARGS__)
-#define LOG_UDP_ERROR(...) doip::Logger::getUdp()->error(__VA_ARGS__)
-#define LOG_UDP_CRITICAL(...) doip::Logger::getUdp()->critical(__VA_ARGS__)
+#define LOG_UDP_TRACE(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::trace, __VA_ARGS__)
+#define LOG_UDP_DEBUG(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::debug, __VA_ARGS__)
+#define LOG_UDP_INFO(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::info, __VA_ARGS__)
+#define LOG_UDP_WARN(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::warn, __VA_ARGS__)
+#define LOG_UDP_ERROR(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::err, __VA_ARGS__)
+#define LOG_UDP_CRITICAL(...) DOIP_LOG_AT(doip::Logger::udpLogger(), spdlog::level::critical, __VA_ARGS__)
 
 // Logging macros for TCP socket
-#define LOG_TCP_TRACE(...) doip::Logger::getTcp()->trace(__VA_ARGS__)
-#define LOG_TCP_DEBUG(...) doip::Logger::getTcp()->debug(__VA_ARGS__)
-#define LOG_TCP_INFO(...) doip::Logger::getTcp()->info(__VA_ARGS__)
-#define LOG_TCP_WARN(...) doip::Logger::getTcp()->warn(__VA_ARGS__)
-#define LOG_TCP_ERROR(...) doip::Logger::getTcp()->error(__VA_ARGS__)
-#define LOG_TCP_CRITICAL(...) doip::Logger::getTcp()->critical(__VA_ARGS__)
+#define LOG_TCP_TRACE(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::trace, __VA_ARGS__)
+#define LOG_TCP_DEBUG(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::debug, __VA_ARGS__)
+#define LOG_TCP_INFO(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::info, __VA_ARGS__)
+#define LOG_TCP_WARN(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::warn, __VA_ARGS__)
+#define LOG_TCP_ERROR(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::err, __VA_ARGS__)
+#define LOG_TCP_CRITICAL(...) DOIP_LOG_AT(doip::Logger::tcpLogger(), spdlog::level::critical, __VA_ARGS__)
 
 // Colored logging macros
-#define LOG_DOIP_SUCCESS(...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_green) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+#define LOG_DOIP_SUCCESS(...) DOIP_LOG_COLORED(doip::ansi::bold_green, spdlog::level::info, __VA_ARGS__)
 
-#define LOG_DOIP_ERROR_COLORED(...) \
-    doip::Logger::get()->error(std::string(doip::ansi::bold_red) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+#define LOG_DOIP_ERROR_COLORED(...) DOIP_LOG_COLORED(doip::ansi::bold_red, spdlog::level::err, __VA_ARGS__)
 
-#define LOG_DOIP_PROTOCOL(...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_blue) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+#define LOG_DOIP_PROTOCOL(...) DOIP_LOG_COLORED(doip::ansi::bold_blue, spdlog::level::info, __VA_ARGS__)
 
-#define LOG_DOIP_CONNECTION(...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_magenta) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+#define LOG_DOIP_CONNECTION(...) DOIP_LOG_COLORED(doip::ansi::bold_magenta, spdlog::level::info, __VA_ARGS__)
 
-#define LOG_DOIP_HIGHLIGHT(...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_cyan) + fmt::format(__VA_ARGS__) + doip::ansi::reset)
+#define LOG_DOIP_HIGHLIGHT(...) DOIP_LOG_COLORED(doip::ansi::bold_cyan, spdlog::level::info, __VA_ARGS__)
 
 // Convenience macros for types with stream operators (using fmt::streamed)
 // These automatically wrap arguments with fmt::streamed() for seamless logging of DoIP types
@@ -169,10 +218,10 @@ class Logger {
 
 // Colored stream logging macros for DoIP types
 #define LOG_DOIP_STREAM_SUCCESS(obj, ...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_green) + fmt::format("{} " __VA_ARGS__, fmt::streamed(obj)) + doip::ansi::reset)
+    DOIP_LOG_COLORED(doip::ansi::bold_green, spdlog::level::info, "{} " __VA_ARGS__, fmt::streamed(obj))
 
 #define LOG_DOIP_STREAM_PROTOCOL(obj, ...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_blue) + fmt::format("{} " __VA_ARGS__, fmt::streamed(obj)) + doip::ansi::reset)
+    DOIP_LOG_COLORED(doip::ansi::bold_blue, spdlog::level::info, "{} " __VA_ARGS__, fmt::streamed(obj))
 
 #define LOG_DOIP_STREAM_CONNECTION(obj, ...) \
-    doip::Logger::get()->info(std::string(doip::ansi::bold_magenta) + fmt::format("{} " __VA_ARGS__, fmt::streamed(obj)) + doip::ansi::reset)
+    DOIP_LOG_COLORED(doip::ansi::bold_magenta, spdlog::level::info, "{} " __VA_ARGS__, fmt::streamed(obj))
@@ -0,0 +1,224 @@
+#ifndef PROTOCOLTRACE_H
+#define PROTOCOLTRACE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+#include "ByteArray.h"
+
+namespace doip {
+
+/**
+ * @brief Direction of a traced frame, seen from the local side.
+ */
+enum class TraceDirection : uint8_t {
+    Rx = 0, ///< Received from the peer
+    Tx = 1, ///< Sent to the peer
+};
+
+/**
+ * @brief Transport a traced frame was received or sent on.
+ */
+enum class TraceTransport : uint8_t {
+    Tcp = 0,
+    Udp = 1,
+};
+
+/**
+ * @brief Magic number at the start of a trace file ("DOIPTRC" followed by the format version).
+ */
+constexpr uint8_t PROTOCOL_TRACE_MAGIC[8] = {'D', 'O', 'I', 'P', 'T', 'R', 'C', 1};
+
+/**
+ * @brief Size of a record header in a trace file.
+ *
+ * Layout (big-endian):
+ * [0..7]   Timestamp in ns since the Unix epoch
+ * [8..11]  Connection id (the TCP socket, 0 for UDP)
+ * [12]     Direction (see TraceDirection)
+ * [13]     Flags (see PROTOCOL_TRACE_FLAG_UDP, PROTOCOL_TRACE_FLAG_CONTINUATION)
+ * [14..17] Number of frame bytes following the header
+ */
+constexpr size_t PROTOCOL_TRACE_RECORD_HEADER_SIZE = 18;
+
+/**
+ * @brief Record flag: the frame was received or sent via UDP.
+ */
+constexpr uint8_t PROTOCOL_TRACE_FLAG_UDP = 0x01;
+
+/**
+ * @brief Record flag: the bytes continue a message of a preceding record (streamed diagnostic message).
+ */
+constexpr uint8_t PROTOCOL_TRACE_FLAG_CONTINUATION = 0x02;
+
+/**
+ * @brief A record read from a trace file.
+ */
+struct TraceRecord {
+    uint64_t timestampNs{0};
+    uint32_t connectionId{0};
+    TraceDirection direction{TraceDirection::Rx};
+    TraceTransport transport{TraceTransport::Tcp};
+    bool continuation{false};
+    ByteArray data;
+};
+
+class TraceBuffer;
+
+/**
+ * @brief Process-wide binary trace of all DoIP frames.
+ *
+ * Once started, connection threads call record() for every received and
+ * sent frame. record() copies the frame into a lock-free ring buffer owned by
+ * the calling thread and returns; it never blocks and never allocates after
+ * the first call on a thread. If the buffer is full the record is dropped and
+ * counted (see droppedRecords()).
+ *
+ * A background writer thread drains the buffers of all threads into a binary
+ * file (see PROTOCOL_TRACE_MAGIC, PROTOCOL_TRACE_RECORD_HEADER_SIZE). Records of
+ * different threads may appear out of timestamp order. The file is decoded with
+ * ProtocolTraceReader or the doipTraceDecode tool.
+ *
+ * While the trace is stopped, record() only costs a relaxed atomic load.
+ */
+class ProtocolTrace {
+  public:
+    /**
+     * @brief Get the process-wide trace instance.
+     *
+     * The instance is created on first use and intentionally never destroyed,
+     * since thread-local buffers may be released during static destruction.
+     * Call stop() before exiting to flush the file.
+     *
+     * @return ProtocolTrace& the shared trace
+     */
+    static ProtocolTrace &instance();
+
+    ProtocolTrace(const ProtocolTrace &) = delete;
+    ProtocolTrace &operator=(const ProtocolTrace &) = delete;
+    ProtocolTrace(ProtocolTrace &&) = delete;
+    ProtocolTrace &operator=(ProtocolTrace &&) = delete;
+
+    /**
+     * @brief Open the trace file and start recording.
+     *
+     * @param path the file to write; an existing file is overwritten
+     * @param bufferSize size of the ring buffer of each recording thread in bytes
+     * @return true on success, false if the file could not be opened or the trace is already running
+     */
+    bool start(const std::string &path, size_t bufferSize = 256 * 1024);
+
+    /**
+     * @brief Stop recording, write all buffered records and close the file.
+     */
+    void stop();
+
+    /**
+     * @brief Check if frames are currently recorded.
+     */
+    bool isEnabled() const noexcept {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record a frame given as a list of buffers.
+     *
+     * Does nothing if the trace is not enabled.
+     *
+     * @param direction whether the frame was received or sent
+     * @param transport TCP or UDP
+     * @param connectionId identifies the connection, e.g. the socket descriptor
+     * @param iov the buffers forming the frame
+     * @param count number of buffers
+     * @param continuation true if the bytes continue the message of a preceding record
+     */
+    void record(TraceDirection direction, TraceTransport transport, uint32_t connectionId,
+                const iovec *iov, size_t count, bool continuation = false);
+
+    /**
+     * @brief Record a frame given as a single buffer.
+     */
+    void record(TraceDirection direction, TraceTransport transport, uint32_t connectionId,
+                const uint8_t *data, size_t size) {
+        iovec iov{const_cast<uint8_t *>(data), size};
+        record(direction, transport, connectionId, &iov, 1);
+    }
+
+    /**
+     * @brief Get the number of records dropped because a thread buffer was full.
+     */
+    uint64_t droppedRecords() const noexcept {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<bool> m_enabled{false};
+    std::atomic<uint64_t> m_dropped{0};
+
+    // Guards the buffer list and the running flag; never held during file I/O,
+    // since record() takes it when a thread records its first frame
+    std::mutex m_mutex;
+    size_t m_bufferSize{256 * 1024};
+    std::condition_variable m_cv;
+    std::vector<std::shared_ptr<TraceBuffer>> m_buffers;
+    bool m_running{false};
+
+    // Serializes start() and stop(), which own the file and the writer thread
+    std::mutex m_lifecycleMutex;
+    std::FILE *m_file{nullptr};
+    std::thread m_writer;
+
+    ProtocolTrace() = default;
+    ~ProtocolTrace() = default;
+
+    TraceBuffer *localBuffer();
+    void run();
+    static bool drainAll(const std::vector<std::shared_ptr<TraceBuffer>> &buffers, std::FILE *file,
+                         std::vector<TraceBuffer *> &retired);
+};
+
+/**
+ * @brief Sequential reader for trace files written by ProtocolTrace.
+ */
+class ProtocolTraceReader {
+  public:
+    /**
+     * @brief Open a trace file and check its header.
+     *
+     * @param path the trace file
+     */
+    explicit ProtocolTraceReader(const std::string &path);
+
+    ~ProtocolTraceReader();
+
+    ProtocolTraceReader(const ProtocolTraceReader &) = delete;
+    ProtocolTraceReader &operator=(const ProtocolTraceReader &) = delete;
+
+    /**
+     * @brief Check if the file was opened and has a valid trace header.
+     */
+    bool isValid() const { return m_file != nullptr; }
+
+    /**
+     * @brief Read the next record.
+     *
+     * @return the record, or std::nullopt at the end of the file or if the last record is truncated
+     */
+    std::optional<TraceRecord> next();
+
+  private:
+    std::FILE *m_file{nullptr};
+};
+
+} // namespace doip
+
+#endif /* PROTOCOLTRACE_H */
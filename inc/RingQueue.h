@@ -0,0 +1,433 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+/*
+ * Lock-free bounded ring queues with the same push/pop/stop contract as
+ * ThreadSafeQueue:
+ *  - push() is ignored (returns false) once the queue is stopped
+ *  - pop() waits up to the timeout for an item and returns false on timeout
+ *  - after stop(), pop() still returns the remaining items and then fails
+ *    without waiting
+ *
+ * Unlike ThreadSafeQueue the capacity is fixed (rounded up to a power of two),
+ * so push() waits while the queue is full. Waiting threads spin, then yield,
+ * then back off with short sleeps; there is no condition variable to notify.
+ */
+
+namespace ring_queue_detail {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+inline size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Wait until the predicate returns true or the deadline passes.
+ */
+template<typename Predicate>
+bool waitUntil(Predicate &&ready, std::chrono::steady_clock::time_point deadline) {
+    for (unsigned int round = 0;; ++round) {
+        if (ready()) {
+            return true;
+        }
+        if (round < 64) {
+            continue;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        if (round < 1024) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+/**
+ * @brief Uninitialized storage for one queue element.
+ */
+template<typename T>
+struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *get() { return std::launder(reinterpret_cast<T *>(storage)); }
+
+    template<typename U>
+    void construct(U &&value) { new (storage) T(std::forward<U>(value)); }
+
+    T take() {
+        T *element = get();
+        T value = std::move(*element);
+        element->~T();
+        return value;
+    }
+};
+
+} // namespace ring_queue_detail
+
+/**
+ * @brief Bounded single-producer/single-consumer queue.
+ *
+ * Exactly one thread may push and exactly one thread may pop. Each side keeps
+ * a cached copy of the other side's index, so the shared indices are only read
+ * when the queue looks full or empty. push_n()/pop_n() publish a whole batch
+ * with a single atomic store.
+ */
+template<typename T>
+class SpscRingQueue {
+private:
+    using Slot = ring_queue_detail::Slot<T>;
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<bool> stopped_{false};
+
+    // Consumer side
+    alignas(ring_queue_detail::CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+    size_t tailCache_{0};
+
+    // Producer side
+    alignas(ring_queue_detail::CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+    size_t headCache_{0};
+
+    size_t freeSlots(size_t tail) {
+        if (tail - headCache_ == capacity_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+        }
+        return capacity_ - (tail - headCache_);
+    }
+
+    size_t usedSlots(size_t head) {
+        if (tailCache_ == head) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+        }
+        return tailCache_ - head;
+    }
+
+public:
+    explicit SpscRingQueue(size_t capacity = 1024)
+        : capacity_(ring_queue_detail::roundUpToPowerOfTwo(capacity)),
+          mask_(capacity_ - 1),
+          slots_(new Slot[capacity_]) {}
+
+    ~SpscRingQueue() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (size_t head = head_.load(std::memory_order_relaxed); head != tail; ++head) {
+            slots_[head & mask_].get()->~T();
+        }
+    }
+
+    SpscRingQueue(const SpscRingQueue &) = delete;
+    SpscRingQueue &operator=(const SpscRingQueue &) = delete;
+
+    /**
+     * @brief Push without waiting. The item is only moved from on success.
+     * @return false if the queue is full or stopped
+     */
+    template<typename U>
+    bool try_push(U &&item) {
+        if (stopped_.load(std::memory_order_relaxed)) return false;
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (freeSlots(tail) == 0) return false;
+        slots_[tail & mask_].construct(std::forward<U>(item));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Push an item, waiting while the queue is full.
+     * @return false if the queue was stopped and the item was dropped
+     */
+    bool push(T item) {
+        bool pushed = false;
+        ring_queue_detail::waitUntil([&] {
+            pushed = try_push(std::move(item));
+            return pushed || stopped_.load(std::memory_order_relaxed);
+        }, std::chrono::steady_clock::time_point::max());
+        return pushed;
+    }
+
+    /**
+     * @brief Push a batch of items, waiting while the queue is full.
+     * @return number of items moved into the queue (less than count only if stopped)
+     */
+    size_t push_n(T *items, size_t count) {
+        size_t pushed = 0;
+        ring_queue_detail::waitUntil([&] {
+            if (stopped_.load(std::memory_order_relaxed)) return true;
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            size_t batch = std::min(freeSlots(tail), count - pushed);
+            for (size_t i = 0; i < batch; ++i) {
+                slots_[(tail + i) & mask_].construct(std::move(items[pushed + i]));
+            }
+            tail_.store(tail + batch, std::memory_order_release);
+            pushed += batch;
+            return pushed == count;
+        }, std::chrono::steady_clock::time_point::max());
+        return pushed;
+    }
+
+    /**
+     * @brief Pop without waiting.
+     * @return false if the queue is empty
+     */
+    bool try_pop(T &item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (usedSlots(head) == 0) return false;
+        item = slots_[head & mask_].take();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item, std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        bool found = false;
+        ring_queue_detail::waitUntil([&] {
+            found = try_pop(item);
+            return found || stopped_.load(std::memory_order_acquire);
+        }, deadline);
+        // An item may have been pushed right before stop()
+        return found || try_pop(item);
+    }
+
+    /**
+     * @brief Pop up to maxItems items, waiting up to the timeout for the first one.
+     * @return number of items written to items
+     */
+    size_t pop_n(T *items, size_t maxItems, std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = 0;
+        ring_queue_detail::waitUntil([&] {
+            available = usedSlots(head);
+            return available > 0 || stopped_.load(std::memory_order_acquire);
+        }, deadline);
+        if (available == 0) {
+            available = usedSlots(head);
+        }
+
+        size_t batch = std::min(available, maxItems);
+        for (size_t i = 0; i < batch; ++i) {
+            items[i] = slots_[(head + i) & mask_].take();
+        }
+        head_.store(head + batch, std::memory_order_release);
+        return batch;
+    }
+
+    void stop() {
+        stopped_.store(true, std::memory_order_release);
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return capacity_; }
+};
+
+/**
+ * @brief Bounded multi-producer/multi-consumer queue.
+ *
+ * Each cell carries a sequence number telling whether it is free or holds an
+ * item for a given position (D. Vyukov's bounded MPMC queue), so producers and
+ * consumers only contend on one compare-and-swap per operation. push_n() and
+ * pop_n() claim a contiguous range of cells with a single compare-and-swap.
+ */
+template<typename T>
+class MpmcRingQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        ring_queue_detail::Slot<T> slot;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    std::atomic<bool> stopped_{false};
+
+    alignas(ring_queue_detail::CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos_{0};
+    alignas(ring_queue_detail::CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos_{0};
+
+    static std::ptrdiff_t distance(size_t sequence, size_t position) {
+        return static_cast<std::ptrdiff_t>(sequence - position);
+    }
+
+    /**
+     * @brief Claim up to maxCount consecutive cells whose sequence is pos + offset.
+     * @return the first claimed position and the number of claimed cells
+     */
+    std::pair<size_t, size_t> claim(std::atomic<size_t> &position, size_t offset, size_t maxCount) {
+        size_t pos = position.load(std::memory_order_relaxed);
+        while (true) {
+            size_t count = 0;
+            while (count < maxCount) {
+                size_t sequence = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t diff = distance(sequence, pos + count + offset);
+                if (diff == 0) {
+                    ++count;
+                    continue;
+                }
+                if (diff > 0 && count == 0) {
+                    // Another thread claimed this cell, start over from the new position
+                    count = SIZE_MAX;
+                }
+                break;
+            }
+            if (count == SIZE_MAX) {
+                pos = position.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (count == 0) {
+                return {pos, 0};
+            }
+            if (position.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                return {pos, count};
+            }
+        }
+    }
+
+public:
+    explicit MpmcRingQueue(size_t capacity = 1024)
+        : capacity_(ring_queue_detail::roundUpToPowerOfTwo(capacity)),
+          mask_(capacity_ - 1),
+          cells_(new Cell[capacity_]) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcRingQueue() {
+        size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+        for (size_t head = dequeuePos_.load(std::memory_order_relaxed); head != tail; ++head) {
+            cells_[head & mask_].slot.get()->~T();
+        }
+    }
+
+    MpmcRingQueue(const MpmcRingQueue &) = delete;
+    MpmcRingQueue &operator=(const MpmcRingQueue &) = delete;
+
+    /**
+     * @brief Push without waiting. The item is only moved from on success.
+     * @return false if the queue is full or stopped
+     */
+    template<typename U>
+    bool try_push(U &&item) {
+        if (stopped_.load(std::memory_order_relaxed)) return false;
+        auto [pos, count] = claim(enqueuePos_, 0, 1);
+        if (count == 0) return false;
+        Cell &cell = cells_[pos & mask_];
+        cell.slot.construct(std::forward<U>(item));
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Push an item, waiting while the queue is full.
+     * @return false if the queue was stopped and the item was dropped
+     */
+    bool push(T item) {
+        bool pushed = false;
+        ring_queue_detail::waitUntil([&] {
+            pushed = try_push(std::move(item));
+            return pushed || stopped_.load(std::memory_order_relaxed);
+        }, std::chrono::steady_clock::time_point::max());
+        return pushed;
+    }
+
+    /**
+     * @brief Push a batch of items, waiting while the queue is full.
+     *
+     * Items of one batch stay in order, but may interleave with items of
+     * other producers if the queue fills up in between.
+     *
+     * @return number of items moved into the queue (less than count only if stopped)
+     */
+    size_t push_n(T *items, size_t count) {
+        size_t pushed = 0;
+        ring_queue_detail::waitUntil([&] {
+            if (stopped_.load(std::memory_order_relaxed)) return true;
+            auto [pos, batch] = claim(enqueuePos_, 0, count - pushed);
+            for (size_t i = 0; i < batch; ++i) {
+                Cell &cell = cells_[(pos + i) & mask_];
+                cell.slot.construct(std::move(items[pushed + i]));
+                cell.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            pushed += batch;
+            return pushed == count;
+        }, std::chrono::steady_clock::time_point::max());
+        return pushed;
+    }
+
+    /**
+     * @brief Pop without waiting.
+     * @return false if the queue is empty
+     */
+    bool try_pop(T &item) {
+        return try_pop_n(&item, 1) == 1;
+    }
+
+    bool pop(T &item, std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) {
+        return pop_n(&item, 1, timeout) == 1;
+    }
+
+    /**
+     * @brief Pop up to maxItems items without waiting.
+     * @return number of items written to items
+     */
+    size_t try_pop_n(T *items, size_t maxItems) {
+        auto [pos, batch] = claim(dequeuePos_, 1, maxItems);
+        for (size_t i = 0; i < batch; ++i) {
+            Cell &cell = cells_[(pos + i) & mask_];
+            items[i] = cell.slot.take();
+            cell.sequence.store(pos + i + capacity_, std::memory_order_release);
+        }
+        return batch;
+    }
+
+    /**
+     * @brief Pop up to maxItems items, waiting up to the timeout for the first one.
+     * @return number of items written to items
+     */
+    size_t pop_n(T *items, size_t maxItems, std::chrono::milliseconds timeout = std::chrono::milliseconds(100)) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t popped = 0;
+        ring_queue_detail::waitUntil([&] {
+            popped = try_pop_n(items, maxItems);
+            return popped > 0 || stopped_.load(std::memory_order_acquire);
+        }, deadline);
+        // Items may have been pushed right before stop()
+        return popped > 0 ? popped : try_pop_n(items, maxItems);
+    }
+
+    void stop() {
+        stopped_.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Approximate number of queued items (exact if no operation is in progress).
+     */
+    size_t size() const {
+        size_t tail = enqueuePos_.load(std::memory_order_acquire);
+        size_t head = dequeuePos_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+};
@@ -0,0 +1,268 @@
+/**
+ * @file SmallByteArray.h
+ * @brief Defines the SmallByteArray type, a ByteArray with inline storage
+ *
+ * Most DoIP frames are a few bytes long (an alive check request has 8 bytes,
+ * a routing activation response 21). SmallByteArray keeps up to a fixed number
+ * of bytes inside the object and only allocates for larger contents.
+ */
+
+#ifndef SMALLBYTEARRAY_H
+#define SMALLBYTEARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "ByteArray.h"
+
+namespace doip {
+
+/**
+ * @brief Vector-like byte storage with an inline buffer
+ *
+ * Provides the subset of the std::vector<uint8_t> interface used by
+ * BasicByteArray and the DoIP message code. Contents up to InlineCapacity
+ * bytes live in the object itself; larger contents are moved to a heap
+ * buffer obtained from Allocator. Iterators are plain pointers.
+ *
+ * @tparam InlineCapacity number of bytes stored without allocation
+ * @tparam Allocator allocator for the heap buffer (stateless)
+ */
+template <size_t InlineCapacity, typename Allocator = ByteArrayAllocator>
+class InlineByteStorage {
+  public:
+    static_assert(InlineCapacity > 0, "InlineCapacity must not be zero");
+
+    using value_type = uint8_t;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = uint8_t &;
+    using const_reference = const uint8_t &;
+    using pointer = uint8_t *;
+    using const_pointer = const uint8_t *;
+    using iterator = uint8_t *;
+    using const_iterator = const uint8_t *;
+
+    InlineByteStorage() noexcept = default;
+
+    InlineByteStorage(const InlineByteStorage &other) {
+        appendBytes(other.data(), other.size());
+    }
+
+    InlineByteStorage(InlineByteStorage &&other) noexcept {
+        moveFrom(other);
+    }
+
+    InlineByteStorage &operator=(const InlineByteStorage &other) {
+        if (this != &other) {
+            m_size = 0;
+            appendBytes(other.data(), other.size());
+        }
+        return *this;
+    }
+
+    InlineByteStorage &operator=(InlineByteStorage &&other) noexcept {
+        if (this != &other) {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~InlineByteStorage() {
+        release();
+    }
+
+    uint8_t *data() noexcept { return m_data; }
+    const uint8_t *data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t capacity() const noexcept { return m_capacity; }
+
+    /**
+     * @brief Check if the contents are stored in the object itself.
+     */
+    bool isInline() const noexcept { return m_data == m_inline; }
+
+    iterator begin() noexcept { return m_data; }
+    iterator end() noexcept { return m_data + m_size; }
+    const_iterator begin() const noexcept { return m_data; }
+    const_iterator end() const noexcept { return m_data + m_size; }
+    const_iterator cbegin() const noexcept { return m_data; }
+    const_iterator cend() const noexcept { return m_data + m_size; }
+
+    uint8_t &operator[](size_t index) noexcept { return m_data[index]; }
+    const uint8_t &operator[](size_t index) const noexcept { return m_data[index]; }
+
+    uint8_t &at(size_t index) {
+        if (index >= m_size) {
+            throw std::out_of_range("Index out of range for InlineByteStorage::at");
+        }
+        return m_data[index];
+    }
+
+    const uint8_t &at(size_t index) const {
+        if (index >= m_size) {
+            throw std::out_of_range("Index out of range for InlineByteStorage::at");
+        }
+        return m_data[index];
+    }
+
+    uint8_t &front() noexcept { return m_data[0]; }
+    const uint8_t &front() const noexcept { return m_data[0]; }
+    uint8_t &back() noexcept { return m_data[m_size - 1]; }
+    const uint8_t &back() const noexcept { return m_data[m_size - 1]; }
+
+    void reserve(size_t capacity) {
+        if (capacity > m_capacity) {
+            grow(capacity);
+        }
+    }
+
+    /**
+     * @brief Resize the contents, new bytes are zero.
+     */
+    void resize(size_t size) {
+        resize(size, 0);
+    }
+
+    void resize(size_t size, uint8_t value) {
+        reserve(size);
+        if (size > m_size) {
+            std::memset(m_data + m_size, value, size - m_size);
+        }
+        m_size = size;
+    }
+
+    /**
+     * @brief Remove all bytes. A heap buffer is kept for reuse.
+     */
+    void clear() noexcept {
+        m_size = 0;
+    }
+
+    void push_back(uint8_t value) {
+        emplace_back(value);
+    }
+
+    uint8_t &emplace_back(uint8_t value) {
+        if (m_size == m_capacity) {
+            grow(m_size + 1);
+        }
+        m_data[m_size] = value;
+        return m_data[m_size++];
+    }
+
+    void pop_back() noexcept {
+        --m_size;
+    }
+
+    /**
+     * @brief Insert a range of bytes before pos.
+     *
+     * @note The range must not point into this storage.
+     */
+    template <typename ForwardIterator>
+    iterator insert(const_iterator pos, ForwardIterator first, ForwardIterator last) {
+        const auto offset = static_cast<size_t>(pos - m_data);
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        reserve(m_size + count);
+        std::memmove(m_data + offset + count, m_data + offset, m_size - offset);
+        std::copy(first, last, m_data + offset);
+        m_size += count;
+        return m_data + offset;
+    }
+
+    iterator insert(const_iterator pos, std::initializer_list<uint8_t> bytes) {
+        return insert(pos, bytes.begin(), bytes.end());
+    }
+
+    template <typename ForwardIterator>
+    void assign(ForwardIterator first, ForwardIterator last) {
+        m_size = 0;
+        insert(end(), first, last);
+    }
+
+    friend bool operator==(const InlineByteStorage &lhs, const InlineByteStorage &rhs) noexcept {
+        return lhs.m_size == rhs.m_size && std::memcmp(lhs.m_data, rhs.m_data, lhs.m_size) == 0;
+    }
+
+    friend bool operator!=(const InlineByteStorage &lhs, const InlineByteStorage &rhs) noexcept {
+        return !(lhs == rhs);
+    }
+
+  private:
+    uint8_t *m_data{m_inline};
+    size_t m_size{0};
+    size_t m_capacity{InlineCapacity};
+    uint8_t m_inline[InlineCapacity];
+
+    void appendBytes(const uint8_t *bytes, size_t count) {
+        reserve(m_size + count);
+        if (count > 0) {
+            std::memcpy(m_data + m_size, bytes, count);
+        }
+        m_size += count;
+    }
+
+    void grow(size_t capacity) {
+        capacity = std::max(capacity, 2 * m_capacity);
+        Allocator allocator;
+        uint8_t *buffer = allocator.allocate(capacity);
+        if (m_size > 0) {
+            std::memcpy(buffer, m_data, m_size);
+        }
+        release();
+        m_data = buffer;
+        m_capacity = capacity;
+    }
+
+    void release() noexcept {
+        if (!isInline()) {
+            Allocator allocator;
+            allocator.deallocate(m_data, m_capacity);
+        }
+    }
+
+    // Expects this storage to hold no heap buffer
+    void moveFrom(InlineByteStorage &other) noexcept {
+        if (other.isInline()) {
+            if (other.m_size > 0) {
+                std::memcpy(m_inline, other.m_inline, other.m_size);
+            }
+            m_data = m_inline;
+            m_capacity = InlineCapacity;
+        } else {
+            m_data = other.m_data;
+            m_capacity = other.m_capacity;
+            other.m_data = other.m_inline;
+            other.m_capacity = InlineCapacity;
+        }
+        m_size = other.m_size;
+        other.m_size = 0;
+    }
+};
+
+/**
+ * @brief A byte array storing up to InlineCapacity bytes without allocation
+ *
+ * Offers the same read/write API as ByteArray (writeU16BE(), writeEnum(),
+ * readU32BE(), ...). Larger contents spill to a buffer from ByteArrayAllocator.
+ * Moving a SmallByteArray with inline contents copies the bytes, so it is
+ * meant for short frames rather than bulk data.
+ *
+ * @tparam InlineCapacity number of bytes stored without allocation
+ */
+template <size_t InlineCapacity>
+struct SmallByteArray : BasicByteArray<InlineByteStorage<InlineCapacity>> {
+    using BasicByteArray<InlineByteStorage<InlineCapacity>>::BasicByteArray;
+};
+
+} // namespace doip
+
+#endif /* SMALLBYTEARRAY_H */
@@ -1,3 +1,6 @@
+#ifndef TIMERMANAGER_H
+#define TIMERMANAGER_H
+
 
 #include <atomic>
 #include <chrono>
@@ -285,4 +288,6 @@ class TimerManager {
     }
 };
 
-} // namespace doip
\ No newline at end of file
+} // namespace doip
+
+#endif /* TIMERMANAGER_H */
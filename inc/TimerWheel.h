@@ -0,0 +1,354 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace doip {
+
+/**
+ * @brief Process-wide hierarchical timing wheel.
+ *
+ * All timers are served by a single background thread. The wheel consists of
+ * four levels with 64 slots each (1ms, 64ms, 4.096s and 262.144s granularity),
+ * so timers of up to ~4.6 hours are stored without overflow lists. Timers on
+ * higher levels cascade down as their expiry approaches, which keeps a 1ms
+ * resolution for every timer.
+ *
+ * Starting, restarting and cancelling a timer are O(1) operations. The worker
+ * thread only wakes up when a timer is due or a cascade is required; restarting
+ * a timer to a later expiry (e.g. an inactivity timer) never wakes it.
+ *
+ * Callbacks are invoked on the wheel thread without holding the internal lock,
+ * so they may start, restart or cancel timers themselves. Callbacks should be
+ * short since they delay all other timers.
+ */
+class TimerWheel {
+  public:
+    using Callback = std::function<void()>;
+
+    /**
+     * @brief Opaque timer handle. A value of 0 denotes an invalid handle.
+     */
+    using TimerHandle = uint64_t;
+
+    static constexpr TimerHandle INVALID_HANDLE = 0;
+
+    /**
+     * @brief Get the process-wide timer wheel instance.
+     *
+     * The instance is created on first use and intentionally never destroyed,
+     * so that timers owned by static objects can be released safely at exit.
+     *
+     * @return TimerWheel& the shared timer wheel
+     */
+    static TimerWheel &instance();
+
+    /**
+     * @brief Construct a timer wheel and start its worker thread.
+     */
+    TimerWheel();
+
+    /**
+     * @brief Destructor. Stops the worker thread; pending timers are discarded.
+     */
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+    TimerWheel(TimerWheel &&) = delete;
+    TimerWheel &operator=(TimerWheel &&) = delete;
+
+    /**
+     * @brief Start a timer.
+     *
+     * @param duration the timer duration
+     * @param callback the callback to invoke when the timer expires. Must not be null.
+     * @param periodic true, if the timer should start again when expired
+     * @param owner optional owner tag, see waitForCallbacks()
+     * @return TimerHandle the timer handle, or INVALID_HANDLE if callback is null
+     */
+    [[nodiscard]]
+    TimerHandle start(std::chrono::milliseconds duration, Callback callback, bool periodic = false, const void *owner = nullptr);
+
+    /**
+     * @brief Restart a timer with its original duration, counted from now.
+     *
+     * @param handle the timer handle
+     * @return true timer was restarted
+     * @return false timer does not exist (anymore)
+     */
+    bool restart(TimerHandle handle);
+
+    /**
+     * @brief Cancel a timer.
+     *
+     * A callback of this timer that is already executing is not interrupted.
+     *
+     * @param handle the timer handle
+     * @return true timer was cancelled
+     * @return false timer does not exist (anymore)
+     */
+    bool cancel(TimerHandle handle);
+
+    /**
+     * @brief Check if a timer is pending.
+     *
+     * @param handle the timer handle
+     * @return true if the timer exists and has not expired yet
+     */
+    [[nodiscard]]
+    bool isActive(TimerHandle handle) const;
+
+    /**
+     * @brief Block until no callback of the given owner is executing.
+     *
+     * Returns immediately when called from the wheel thread itself (i.e. from
+     * within a callback). Used by owners to make sure no callback references
+     * them after destruction.
+     *
+     * @param owner the owner tag passed to start()
+     */
+    void waitForCallbacks(const void *owner);
+
+    /**
+     * @brief Number of pending timers.
+     */
+    [[nodiscard]]
+    size_t timerCount() const;
+
+    /**
+     * @brief Stop the worker thread. Pending timers will not fire anymore.
+     */
+    void stop();
+
+  private:
+    static constexpr size_t LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr int32_t NIL = -1;
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class EntryState : uint8_t {
+        Free,
+        Armed,
+        Firing
+    };
+
+    struct Entry {
+        Callback callback;
+        const void *owner = nullptr;
+        uint64_t expiry = 0;
+        std::chrono::milliseconds interval{0};
+        uint32_t generation = 0;
+        int32_t prev = NIL;
+        int32_t next = NIL;
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        bool periodic = false;
+        EntryState state = EntryState::Free;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_callbackDone;
+    std::thread m_thread;
+    bool m_running{true};
+
+    Clock::time_point m_epoch;
+    uint64_t m_currentTick{0}; ///< next tick to be processed
+    uint64_t m_wakeTick{UINT64_MAX};
+    size_t m_count{0};
+
+    std::vector<Entry> m_entries;
+    std::vector<int32_t> m_freeList;
+    std::array<std::array<int32_t, SLOTS>, LEVELS> m_slots;
+
+    const void *m_runningOwner{nullptr};
+
+    void run();
+    uint64_t nowTick() const;
+    uint64_t expiryTick(std::chrono::milliseconds duration) const;
+    uint64_t computeWakeTick() const;
+    void processTick(uint64_t tick, std::vector<TimerHandle> &expired);
+    void cascade(size_t level, size_t slot);
+    void fire(TimerHandle handle, std::unique_lock<std::mutex> &lock);
+
+    Entry *lookup(TimerHandle handle);
+    const Entry *lookup(TimerHandle handle) const;
+    void link(int32_t index);
+    void unlink(int32_t index);
+    void release(int32_t index);
+    void arm(int32_t index, uint64_t expiry);
+};
+
+/**
+ * @brief Keyed timer set backed by the shared TimerWheel.
+ *
+ * Offers the subset of the TimerManager interface used by connections, but
+ * does not own a thread. Any number of instances share the wheel thread.
+ *
+ * @tparam TimerIdType the timer ID type
+ */
+template <typename TimerIdType = uint8_t>
+class WheelTimerManager {
+  public:
+    using TimerId = TimerIdType;
+
+    explicit WheelTimerManager(TimerWheel &wheel = TimerWheel::instance()) : m_wheel(wheel) {}
+
+    ~WheelTimerManager() {
+        stopAll();
+        m_wheel.waitForCallbacks(this);
+    }
+
+    WheelTimerManager(const WheelTimerManager &) = delete;
+    WheelTimerManager &operator=(const WheelTimerManager &) = delete;
+    WheelTimerManager(WheelTimerManager &&) = delete;
+    WheelTimerManager &operator=(WheelTimerManager &&) = delete;
+
+    /**
+     * @brief Add a timer. An existing timer with the same ID is replaced.
+     *
+     * @param id the timer ID
+     * @param duration the timer duration in ms
+     * @param callback the callback function to invoke when timer expired. Must not be null.
+     * @param periodic true, if timer should start again when expired
+     * @return std::optional<TimerId>
+     */
+    [[nodiscard]]
+    std::optional<TimerId> addTimer(TimerId id, std::chrono::milliseconds duration,
+                                    std::function<void(TimerIdType)> callback,
+                                    bool periodic = false) {
+        if (!callback) {
+            return std::nullopt;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_timers.find(id);
+        if (it != m_timers.end()) {
+            m_wheel.cancel(it->second.handle);
+            m_timers.erase(it);
+        }
+
+        auto handle = m_wheel.start(
+            duration, [this, id]() { onExpired(id); }, periodic, this);
+        m_timers[id] = Entry{handle, std::move(callback), periodic};
+        return id;
+    }
+
+    /**
+     * @brief Removes the timer.
+     *
+     * @param id the id of the timer
+     * @return true timer was removed
+     * @return false timer with given id does not exist
+     */
+    bool removeTimer(TimerId id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_timers.find(id);
+        if (it == m_timers.end()) {
+            return false;
+        }
+        m_wheel.cancel(it->second.handle);
+        m_timers.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Restarts a timer with its original duration.
+     *
+     * @param id the id of the timer
+     * @return true timer was restarted
+     * @return false timer with given id does not exist
+     */
+    [[nodiscard]]
+    bool restartTimer(TimerId id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_timers.find(id);
+        if (it == m_timers.end()) {
+            return false;
+        }
+        return m_wheel.restart(it->second.handle);
+    }
+
+    /**
+     * @brief Stops all timers and clears the timer list.
+     */
+    void stopAll() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[id, entry] : m_timers) {
+            m_wheel.cancel(entry.handle);
+        }
+        m_timers.clear();
+    }
+
+    /**
+     * @brief Check if specified timer exists.
+     *
+     * @param id the id of the timer
+     * @return true timer exists
+     */
+    [[nodiscard]]
+    bool hasTimer(TimerId id) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_timers.find(id) != m_timers.end();
+    }
+
+    /**
+     * @brief The number of timers.
+     *
+     * @return size_t number of timers.
+     */
+    [[nodiscard]]
+    size_t timerCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_timers.size();
+    }
+
+  private:
+    struct Entry {
+        TimerWheel::TimerHandle handle;
+        std::function<void(TimerIdType)> callback;
+        bool periodic;
+    };
+
+    TimerWheel &m_wheel;
+    std::map<TimerId, Entry> m_timers;
+    mutable std::mutex m_mutex;
+
+    void onExpired(TimerId id) {
+        std::function<void(TimerIdType)> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_timers.find(id);
+            if (it == m_timers.end()) {
+                return;
+            }
+            callback = it->second.callback;
+            if (!it->second.periodic) {
+                m_timers.erase(it);
+            }
+        }
+
+        try {
+            callback(id);
+        } catch (...) {
+            // Swallow exceptions to keep the wheel thread alive
+        }
+    }
+};
+
+} // namespace doip
+
+#endif /* TIMERWHEEL_H */
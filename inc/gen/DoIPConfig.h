@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+#define DOIP_TIMEOUT_MS 
+
+#define DOIP_MAX_CONNECTIONS 
+
+/**
+ * @brief Number of retries for DoIP alive check messages.
+ * @details Used in DoIPServerStateMachine for retrying alive check requests.
+ * @note This value is configurable via CMake option DOIP_ALIVE_CHECK_RETRIES.
+ * @note The standard does not mandate retries, so the default is 1 (no retries). For robustness, retries can be enabled.
+ */
+constexpr uint8_t DOIP_ALIVE_CHECK_RETRIES = 1;
+
+/**
+ * @brief Maximum Transmission Unit (MTU) size for DoIP messages.
+ * Currently set to 4095 bytes as per ISO 13400-2:2019 recommendations.
+ */
+constexpr uint32_t DOIP_MAXIMUM_MTU = 4095;
+
+/**
+ * @brief Flush deadline for coalesced outbound messages in milliseconds.
+ * @details Messages produced while a connection dispatches received data are collected and
+ * written with a single send call. A message is never held back longer than this deadline.
+ * @note This value is configurable via CMake option DOIP_TX_FLUSH_DEADLINE_MS.
+ */
+constexpr uint32_t DOIP_TX_FLUSH_DEADLINE_MS = 2;
+
+/**
+ * @brief Number of unsent bytes per connection at which backpressure is reported.
+ * @details Sending fails with ENOBUFS once four times this amount is queued.
+ * @note This value is configurable via CMake option DOIP_TX_HIGH_WATERMARK.
+ */
+constexpr uint32_t DOIP_TX_HIGH_WATERMARK = 65536;
+
+/**
+ * @brief Use the shared timer wheel for connection timers.
+ * @details If 1, all connections share a single timer thread (see TimerWheel). If 0, every
+ * connection runs its own TimerManager thread.
+ * @note This value is configurable via CMake option DOIP_USE_TIMER_WHEEL.
+ */
+#define DOIP_USE_TIMER_WHEEL 1
+
+/**
+ * @brief Allocate ByteArray buffers from the BufferPool.
+ * @details If 1, ByteArray (and thus DoIPMessage) uses PoolAllocator, so buffers are recycled
+ * through thread-local size-class caches. If 0, the standard allocator is used.
+ * @note This value is configurable via CMake option DOIP_USE_BUFFER_POOL.
+ */
+#define DOIP_USE_BUFFER_POOL 1
+
+/**
+ * @brief Lowest log level compiled into the library.
+ * @details Uses the spdlog level numbers (0 = trace ... 6 = off). LOG_* statements below this
+ * level are removed at compile time, including the evaluation of their arguments.
+ * @note This value is configurable via CMake option DOIP_LOG_ACTIVE_LEVEL (by name, e.g. "info").
+ */
+#define DOIP_LOG_ACTIVE_LEVEL 0
+
+
+// Table 48: UDP Ports for DoIP
+/**
+ * @brief UDP discovery port for DoIP as per ISO 13400-2:2019
+ */
+constexpr int DOIP_UDP_DISCOVERY_PORT = 13400;
+
+/**
+ * @brief UDP test equipment request port for DoIP as per ISO 13400-2:2019.
+ */
+constexpr int DOIP_UDP_TEST_EQUIPMENT_REQUEST_PORT = 13401;
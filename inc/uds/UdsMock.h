@@ -4,12 +4,12 @@
 #include <array>
 #include <functional>
 #include <memory>
-#include <unordered_map>
 
 #include "DoIPMessage.h"
 #include "IUdsServiceHandler.h"
 #include "LambdaUdsHandler.h"
 #include "UdsResponseCode.h"
+#include "UdsResponseWriter.h"
 #include "UdsServices.h"
 
 using namespace doip;
@@ -18,27 +18,54 @@ namespace doip::uds {
 
 constexpr uint8_t UDS_POSITIVE_RESPONSE_OFFSET = 0x40;
 
+using UdsServiceFunction = std::function<UdsResponse(const ByteArray &)>;
+
+/**
+ * @brief Handler serializing its positive response parameters in place.
+ *
+ * Returns the response code; for a negative response code, the bytes written
+ * are discarded and a negative response is sent instead.
+ */
+using UdsServiceWriterFunction = std::function<UdsResponseCode(const ByteArray &request, UdsResponseWriter &writer)>;
+
 class UdsMock {
   public:
     UdsMock() = default;
 
     // Register a handler owning pointer
     void registerService(UdsService serviceId, IUdsServiceHandlerPtr handler) {
-        m_handlers[static_cast<uint8_t>(serviceId)] = std::move(handler);
+        if (!handler) {
+            unregisterService(serviceId);
+            return;
+        }
+        m_handlers[static_cast<uint8_t>(serviceId)] = [handler = std::shared_ptr<IUdsServiceHandler>(std::move(handler))](const ByteArray &request, UdsResponseWriter &writer) {
+            return writeResponse(handler->handle(request), writer);
+        };
     }
 
-    // Register a lambda/function
-    void registerService(UdsService serviceId, std::function<UdsResponse(const ByteArray &)> fn) {
-        m_handlers[static_cast<uint8_t>(serviceId)] = std::make_unique<LambdaUdsHandler>(std::move(fn));
+    // Register a lambda/function returning the response parameters
+    void registerService(UdsService serviceId, UdsServiceFunction fn) {
+        if (!fn) {
+            unregisterService(serviceId);
+            return;
+        }
+        m_handlers[static_cast<uint8_t>(serviceId)] = [fn = std::move(fn)](const ByteArray &request, UdsResponseWriter &writer) {
+            return writeResponse(fn(request), writer);
+        };
+    }
+
+    // Register a lambda/function writing the response parameters in place
+    void registerService(UdsService serviceId, UdsServiceWriterFunction fn) {
+        m_handlers[static_cast<uint8_t>(serviceId)] = std::move(fn);
     }
 
     // Unregister
     void unregisterService(UdsService serviceId) {
-        m_handlers.erase(static_cast<uint8_t>(serviceId));
+        m_handlers[static_cast<uint8_t>(serviceId)] = nullptr;
     }
 
     // Convenience: clear all
-    void clear() { m_handlers.clear(); }
+    void clear() { m_handlers.fill(nullptr); }
 
     // --- Typed registration helpers (convenience wrappers) ---
     // Diagnostic Session Control (0x10): handler(sessionType)
@@ -50,6 +77,9 @@ class UdsMock {
     // Read Data By Identifier (0x22): handler(did, params)
     void registerReadDataByIdentifierHandler(std::function<UdsResponse(uint16_t did)> handler);
 
+    // Read Data By Identifier (0x22): handler(did, writer), the DID is already written
+    void registerReadDataByIdentifierHandler(std::function<UdsResponseCode(uint16_t did, UdsResponseWriter &writer)> handler);
+
     // Write Data By Identifier (0x2E): handler(did, data)
     void registerWriteDataByIdentifierHandler(std::function<UdsResponse(uint16_t did, ByteArray value)> handler);
 
@@ -59,6 +89,18 @@ class UdsMock {
 
     ByteArray handleDiagnosticRequest(const ByteArray &request) const;
 
+    /**
+     * @brief Handle a UDS request and build the DoIP diagnostic message carrying the response.
+     *
+     * The handler writes its response directly into the returned message.
+     *
+     * @param sa the source address of the request (the tester)
+     * @param ta the target address of the request (this ECU)
+     * @param request the UDS request
+     * @return DoIPMessage the diagnostic message from ta to sa
+     */
+    DoIPMessage handleDiagnosticMessage(const DoIPAddress &sa, const DoIPAddress &ta, const ByteArray &request) const;
+
     // Register default handlers for all known services.
     // By default these handlers simply return ServiceNotSupported. Tests
     // can register custom handlers afterwards to override behavior.
@@ -94,22 +136,17 @@ class UdsMock {
     }
 
   private:
-    static ByteArray makeResponse(const ByteArray &request, UdsResponseCode responseCode = UdsResponseCode::OK, const ByteArray &extraData = {}) {
-        if (responseCode != UdsResponseCode::OK) {
-            ByteArray negativeResponse;
-            negativeResponse.emplace_back(0x7F);                                // Negative response indicator
-            negativeResponse.emplace_back(request.empty() ? 0x00 : request[0]); // Original service ID or 0
-            negativeResponse.emplace_back(static_cast<uint8_t>(responseCode));  // NRC
-            return negativeResponse;
-        }
-
-        ByteArray positiveResponse;
-        positiveResponse.emplace_back(static_cast<uint8_t>((request.empty() ? 0x00 : request[0]) + UDS_POSITIVE_RESPONSE_OFFSET)); // Positive response SID
-        positiveResponse.insert(positiveResponse.end(), extraData.begin(), extraData.end());
-        return positiveResponse;
+    static UdsResponseCode writeResponse(const UdsResponse &response, UdsResponseWriter &writer) {
+        writer.write(response.second);
+        return response.first;
     }
 
-    std::unordered_map<uint8_t, IUdsServiceHandlerPtr> m_handlers;
+    // Appends the response to the request to buffer (ByteArray or DoIPMessageBuffer), which must end at sidOffset
+    template <typename Buffer>
+    void dispatch(const ByteArray &request, Buffer &buffer, size_t sidOffset) const;
+
+    // Indexed by service ID, like UDS_SERVICE_DESCRIPTOR_TABLE
+    std::array<UdsServiceWriterFunction, 256> m_handlers;
 };
 
 } // namespace doip::uds
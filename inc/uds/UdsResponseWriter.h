@@ -0,0 +1,91 @@
+#ifndef UDSRESPONSEWRITER_H
+#define UDSRESPONSEWRITER_H
+
+#include "DoIPMessage.h"
+
+namespace doip::uds {
+
+/**
+ * @brief Serializes the parameters of a positive UDS response directly into the response buffer.
+ *
+ * The writer is positioned after the positive response SID, so a handler only
+ * appends its response parameters (e.g. DID and data record). The buffer is
+ * either the ByteArray returned by UdsMock::handleDiagnosticRequest() or the
+ * outbound DoIP diagnostic message built by UdsMock::handleDiagnosticMessage(),
+ * so the response is never copied between intermediate buffers.
+ */
+class UdsResponseWriter {
+  public:
+    /**
+     * @brief Creates a writer appending to a buffer.
+     *
+     * @param buffer the buffer (a ByteArray or DoIPMessageBuffer), ending with the positive response SID
+     * @param sidOffset the offset of the positive response SID in the buffer
+     */
+    template <typename Storage>
+    UdsResponseWriter(BasicByteArray<Storage> &buffer, size_t sidOffset)
+        : m_buffer(&buffer), m_ops(&OPS<BasicByteArray<Storage>>), m_start(sidOffset + 1) {}
+
+    UdsResponseWriter(const UdsResponseWriter &) = delete;
+    UdsResponseWriter &operator=(const UdsResponseWriter &) = delete;
+
+    void writeU8(uint8_t value) { write(&value, 1); }
+    void writeU16BE(uint16_t value) {
+        uint8_t bytes[] = {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+        write(bytes, sizeof(bytes));
+    }
+    void writeU32BE(uint32_t value) {
+        uint8_t bytes[] = {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                           static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+        write(bytes, sizeof(bytes));
+    }
+    void write(const uint8_t *data, size_t size) { m_ops->append(m_buffer, data, size); }
+    void write(const ByteArray &data) { write(data.data(), data.size()); }
+
+    /**
+     * @brief Reserve space for a number of parameter bytes.
+     */
+    void reserve(size_t size) { m_ops->reserve(m_buffer, m_start + size); }
+
+    /**
+     * @brief Drop all parameter bytes written so far.
+     */
+    void clear() { m_ops->resize(m_buffer, m_start); }
+
+    /**
+     * @brief Number of parameter bytes written (without the SID).
+     */
+    size_t size() const { return m_ops->size(m_buffer) - m_start; }
+
+    /**
+     * @brief The parameter bytes written so far.
+     */
+    ByteArrayRef data() const { return {m_ops->data(m_buffer) + m_start, size()}; }
+
+  private:
+    // Operations on the buffer, so handlers see one writer type for both buffer types
+    struct Ops {
+        void (*append)(void *buffer, const uint8_t *data, size_t size);
+        void (*reserve)(void *buffer, size_t size);
+        void (*resize)(void *buffer, size_t size);
+        size_t (*size)(const void *buffer);
+        const uint8_t *(*data)(const void *buffer);
+    };
+
+    template <typename Buffer>
+    static constexpr Ops OPS{
+        [](void *buffer, const uint8_t *data, size_t size) { static_cast<Buffer *>(buffer)->append(data, size); },
+        [](void *buffer, size_t size) { static_cast<Buffer *>(buffer)->reserve(size); },
+        [](void *buffer, size_t size) { static_cast<Buffer *>(buffer)->resize(size); },
+        [](const void *buffer) { return static_cast<const Buffer *>(buffer)->size(); },
+        [](const void *buffer) { return static_cast<const uint8_t *>(static_cast<const Buffer *>(buffer)->data()); },
+    };
+
+    void *m_buffer;
+    const Ops *m_ops;
+    size_t m_start;
+};
+
+} // namespace doip::uds
+
+#endif /* UDSRESPONSEWRITER_H */
@@ -4,6 +4,7 @@
 #include <type_traits>
 #include <utility>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 
@@ -64,21 +65,32 @@ constexpr std::array<UdsServiceDescriptor, 19> UDS_SERVICE_DESCRIPTORS = {{
     { UdsService::ReadDTCInformation, 2, MAX_UDS_MESSAGE_LENGTH, 3, MAX_UDS_MESSAGE_LENGTH }
 }};
 
+/**
+ * @brief Service descriptors indexed by service ID
+ *
+ * Built from UDS_SERVICE_DESCRIPTORS at compile time. Entries of unknown
+ * services have a maximum request length of 0.
+ */
+constexpr std::array<UdsServiceDescriptor, 256> UDS_SERVICE_DESCRIPTOR_TABLE = [] {
+    std::array<UdsServiceDescriptor, 256> table{};
+    for (size_t sid = 0; sid < table.size(); ++sid) {
+        table[sid] = {static_cast<UdsService>(sid), 0, 0, 0, 0};
+    }
+    for (const auto &desc : UDS_SERVICE_DESCRIPTORS) {
+        table[static_cast<uint8_t>(desc.service)] = desc;
+    }
+    return table;
+}();
+
 /**
  * @brief Find service descriptor by service ID
  *
  * @param sid the UDS service ID
  * @return const UdsServiceDescriptor* the service descriptor or nullptr if not found
  */
-inline const UdsServiceDescriptor* findServiceDescriptor(UdsService sid) {
-    auto it = std::find_if(UDS_SERVICE_DESCRIPTORS.begin(), UDS_SERVICE_DESCRIPTORS.end(),
-                               [sid](const UdsServiceDescriptor& desc) {
-                                   return desc.service == sid;
-                               });
-    if (it != UDS_SERVICE_DESCRIPTORS.end()) {
-        return &(*it);
-    }
-    return nullptr;
+constexpr const UdsServiceDescriptor* findServiceDescriptor(UdsService sid) {
+    const UdsServiceDescriptor &desc = UDS_SERVICE_DESCRIPTOR_TABLE[static_cast<uint8_t>(sid)];
+    return desc.maxReqLength != 0 ? &desc : nullptr;
 }
 
 } // namespace doip::uds
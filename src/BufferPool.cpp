@@ -0,0 +1,246 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace doip {
+
+namespace {
+
+// Counters are written by their owning thread only, so a relaxed
+// load/store pair suffices and avoids a locked instruction
+inline void bump(std::atomic<uint64_t> &counter) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+/**
+ * @brief Free blocks and counters of one thread.
+ *
+ * Linked into the pool while the thread is alive, so stats() can sum the
+ * counters. Linking does not allocate, since it may happen in deallocate().
+ */
+struct BufferPool::ThreadCache {
+    std::array<std::array<void *, THREAD_CACHE_BLOCKS>, SIZE_CLASSES> blocks{};
+    std::array<size_t, SIZE_CLASSES> count{};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> oversized{0};
+    std::atomic<uint64_t> globalTransfers{0};
+    ThreadCache *prev{nullptr};
+    ThreadCache *next{nullptr};
+
+    static thread_local ThreadCache *current;
+    static thread_local bool destroyed;
+
+    ThreadCache() noexcept {
+        BufferPool::instance().registerCache(*this);
+    }
+
+    ~ThreadCache() {
+        BufferPool &pool = BufferPool::instance();
+        for (size_t cls = 0; cls < SIZE_CLASSES; ++cls) {
+            pool.release(*this, cls, count[cls]);
+        }
+        pool.unregisterCache(*this);
+        current = nullptr;
+        destroyed = true;
+    }
+
+    ThreadCache(const ThreadCache &) = delete;
+    ThreadCache &operator=(const ThreadCache &) = delete;
+    ThreadCache(ThreadCache &&) = delete;
+    ThreadCache &operator=(ThreadCache &&) = delete;
+};
+
+thread_local BufferPool::ThreadCache *BufferPool::ThreadCache::current = nullptr;
+thread_local bool BufferPool::ThreadCache::destroyed = false;
+
+BufferPool &BufferPool::instance() {
+    // Intentionally leaked, see class documentation
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+BufferPool::BufferPool() {
+    // Returning a block must not allocate
+    for (auto &freeList : m_free) {
+        freeList.reserve(GLOBAL_CACHE_BLOCKS);
+    }
+}
+
+size_t BufferPool::sizeClass(size_t size) noexcept {
+    if (size > MAX_BLOCK_SIZE) {
+        return SIZE_CLASSES;
+    }
+    size_t cls = 0;
+    while (blockSize(cls) < size) {
+        ++cls;
+    }
+    return cls;
+}
+
+void *BufferPool::allocate(size_t size) {
+    const size_t cls = sizeClass(size);
+    ThreadCache *cache = threadCache();
+
+    if (cls == SIZE_CLASSES) {
+        if (cache != nullptr) {
+            bump(cache->oversized);
+        } else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_retired.oversized;
+        }
+        return ::operator new(size);
+    }
+
+    if (cache == nullptr) {
+        // Thread is exiting, serve from the global free lists directly
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_free[cls].empty()) {
+                void *p = m_free[cls].back();
+                m_free[cls].pop_back();
+                ++m_retired.hits;
+                return p;
+            }
+            ++m_retired.misses;
+        }
+        return ::operator new(blockSize(cls));
+    }
+
+    if (cache->count[cls] == 0) {
+        refill(*cache, cls);
+    }
+    if (cache->count[cls] > 0) {
+        bump(cache->hits);
+        return cache->blocks[cls][--cache->count[cls]];
+    }
+    bump(cache->misses);
+    return ::operator new(blockSize(cls));
+}
+
+void BufferPool::deallocate(void *p, size_t size) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    const size_t cls = sizeClass(size);
+    if (cls == SIZE_CLASSES) {
+        ::operator delete(p);
+        return;
+    }
+
+    ThreadCache *cache = threadCache();
+    if (cache == nullptr) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free[cls].size() < GLOBAL_CACHE_BLOCKS) {
+            m_free[cls].push_back(p);
+        } else {
+            ::operator delete(p);
+        }
+        return;
+    }
+
+    if (cache->count[cls] == THREAD_CACHE_BLOCKS) {
+        release(*cache, cls, THREAD_CACHE_BLOCKS / 2);
+    }
+    cache->blocks[cls][cache->count[cls]++] = p;
+}
+
+BufferPoolStats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    BufferPoolStats result = m_retired;
+    for (const ThreadCache *cache = m_threadCaches; cache != nullptr; cache = cache->next) {
+        result.hits += cache->hits.load(std::memory_order_relaxed);
+        result.misses += cache->misses.load(std::memory_order_relaxed);
+        result.oversized += cache->oversized.load(std::memory_order_relaxed);
+        result.globalTransfers += cache->globalTransfers.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+size_t BufferPool::globalFreeBlocks() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t blocks = 0;
+    for (const auto &freeList : m_free) {
+        blocks += freeList.size();
+    }
+    return blocks;
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &freeList : m_free) {
+        for (void *p : freeList) {
+            ::operator delete(p);
+        }
+        freeList.clear();
+    }
+}
+
+BufferPool::ThreadCache *BufferPool::threadCache() noexcept {
+    if (ThreadCache::current != nullptr || ThreadCache::destroyed) {
+        return ThreadCache::current;
+    }
+    static thread_local ThreadCache cache;
+    ThreadCache::current = &cache;
+    return ThreadCache::current;
+}
+
+void BufferPool::refill(ThreadCache &cache, size_t sizeClass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &freeList = m_free[sizeClass];
+    const size_t count = std::min(freeList.size(), THREAD_CACHE_BLOCKS / 2);
+    if (count == 0) {
+        return;
+    }
+    std::copy(freeList.end() - static_cast<std::ptrdiff_t>(count), freeList.end(), cache.blocks[sizeClass].begin());
+    freeList.resize(freeList.size() - count);
+    cache.count[sizeClass] = count;
+    bump(cache.globalTransfers);
+}
+
+void BufferPool::release(ThreadCache &cache, size_t sizeClass, size_t count) noexcept {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &freeList = m_free[sizeClass];
+    for (size_t i = 0; i < count; ++i) {
+        void *p = cache.blocks[sizeClass][--cache.count[sizeClass]];
+        if (freeList.size() < GLOBAL_CACHE_BLOCKS) {
+            freeList.push_back(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+    bump(cache.globalTransfers);
+}
+
+void BufferPool::registerCache(ThreadCache &cache) noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cache.next = m_threadCaches;
+    if (m_threadCaches != nullptr) {
+        m_threadCaches->prev = &cache;
+    }
+    m_threadCaches = &cache;
+}
+
+void BufferPool::unregisterCache(ThreadCache &cache) noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (cache.prev != nullptr) {
+        cache.prev->next = cache.next;
+    } else {
+        m_threadCaches = cache.next;
+    }
+    if (cache.next != nullptr) {
+        cache.next->prev = cache.prev;
+    }
+    m_retired.hits += cache.hits.load(std::memory_order_relaxed);
+    m_retired.misses += cache.misses.load(std::memory_order_relaxed);
+    m_retired.oversized += cache.oversized.load(std::memory_order_relaxed);
+    m_retired.globalTransfers += cache.globalTransfers.load(std::memory_order_relaxed);
+}
+
+} // namespace doip
@@ -11,26 +11,30 @@ using namespace doip;
  *Set up the connection between client and server
  */
 void DoIPClient::startTcpConnection() {
+    startTcpConnection("127.0.0.1", 0);
+}
+
+bool DoIPClient::startTcpConnection(const char *ipAddress, unsigned int maxAttempts) {
 
     m_tcpSocket = socket(AF_INET, SOCK_STREAM, 0);
 
     if (m_tcpSocket >= 0) {
         LOG_TCP_INFO("Client TCP-Socket created successfully");
 
-        bool connectedFlag = false;
-        const char *ipAddr = "127.0.0.1";
         m_serverAddress.sin_family = AF_INET;
         m_serverAddress.sin_port = htons(DOIP_UDP_DISCOVERY_PORT);
-        inet_aton(ipAddr, &(m_serverAddress.sin_addr));
+        inet_aton(ipAddress, &(m_serverAddress.sin_addr));
 
-        while (!connectedFlag) {
+        for (unsigned int attempt = 0; maxAttempts == 0 || attempt < maxAttempts; ++attempt) {
             m_connected = connect(m_tcpSocket, reinterpret_cast<struct sockaddr *>(&m_serverAddress), sizeof(m_serverAddress));
             if (m_connected != -1) {
-                connectedFlag = true;
                 LOG_TCP_INFO("Connection to server established");
+                return true;
             }
         }
+        LOG_TCP_ERROR("Could not connect to {}: {}", ipAddress, strerror(errno));
     }
+    return false;
 }
 
 void DoIPClient::startUdpConnection() {
@@ -267,6 +271,10 @@ void DoIPClient::setSourceAddress(const DoIPAddress &address) {
     m_sourceAddress = address;
 }
 
+void DoIPClient::setLogicalAddress(const DoIPAddress &address) {
+    m_logicalAddress = address;
+}
+
 /*
  * Getter for _sockFD
  */
@@ -0,0 +1,646 @@
+#include "DoIPClientEngine.h"
+#include "DoIPMessage.h"
+#include "DoIPMessageView.h"
+#include "DoIPRoutingActivationResult.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace doip {
+
+namespace {
+
+constexpr int EPOLL_MAX_EVENTS = 64;
+
+constexpr auto NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+// Epoll data of the wake-up eventfd; sessions are registered with their id
+constexpr uint64_t WAKE_MARKER = DOIP_INVALID_SESSION;
+
+constexpr size_t ROUTING_ACTIVATION_RESPONSE_CODE_OFFSET = 4;
+constexpr size_t DIAGNOSTIC_ADDRESSES_SIZE = DOIP_DIAG_HEADER_SIZE - DOIP_HEADER_SIZE;
+constexpr size_t DIAGNOSTIC_ACK_CODE_OFFSET = 4;
+constexpr size_t DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET = 5;
+
+constexpr uint8_t UDS_NEGATIVE_RESPONSE = 0x7F;
+constexpr uint8_t UDS_POSITIVE_RESPONSE_OFFSET = 0x40;
+constexpr uint8_t UDS_RESPONSE_PENDING = 0x78;
+
+bool isResponsePending(const uint8_t *data, size_t size) {
+    return size >= 3 && data[0] == UDS_NEGATIVE_RESPONSE && data[2] == UDS_RESPONSE_PENDING;
+}
+
+// SID + 0x40, or 7F SID NRC. Without a SID in the request there is nothing to match.
+bool isResponseTo(const ByteArray &request, const uint8_t *data, size_t size) {
+    if (request.empty()) {
+        return true;
+    }
+    uint8_t sid = request[0];
+    return (size >= 1 && data[0] == static_cast<uint8_t>(sid + UDS_POSITIVE_RESPONSE_OFFSET)) ||
+           (size >= 2 && data[0] == UDS_NEGATIVE_RESPONSE && data[1] == sid);
+}
+
+// Diagnostic messages and their ACKs start with source and target address
+bool isFromTarget(const DoIPClientSessionConfig &config, const uint8_t *payload, size_t payloadLength) {
+    return payloadLength >= DIAGNOSTIC_ADDRESSES_SIZE && readAddressFrom(payload, 0) == config.targetAddress &&
+           readAddressFrom(payload, 2) == config.sourceAddress;
+}
+
+} // namespace
+
+DoIPClientEngine::DoIPClientEngine()
+    : m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+}
+
+DoIPClientEngine::~DoIPClientEngine() {
+    assert(std::this_thread::get_id() != engineThreadId() && "An engine must not be destroyed by its handlers");
+    stop();
+    joinThread();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+}
+
+bool DoIPClientEngine::start() {
+    if (m_running.load()) {
+        return true;
+    }
+    assert(std::this_thread::get_id() != engineThreadId() && "start() must not be called by a handler");
+
+    // An engine stopped by one of its handlers may still be finishing
+    joinThread();
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_MARKER;
+    if (m_epollFd < 0 || m_wakeFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0) {
+        LOG_TCP_ERROR("Failed to create client engine: {}", strerror(errno));
+        joinThread();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.store(true);
+    m_thread = std::thread([this]() { run(); });
+    m_threadId = m_thread.get_id();
+    LOG_TCP_INFO("Client engine started");
+    return true;
+}
+
+void DoIPClientEngine::stop() {
+    bool wasRunning;
+    bool onEngineThread;
+    {
+        // Taken under the lock, so no command is posted after the thread drained the queue
+        std::lock_guard<std::mutex> lock(m_mutex);
+        wasRunning = m_running.exchange(false);
+        onEngineThread = std::this_thread::get_id() == m_threadId;
+    }
+
+    // Called by a handler: the engine completes the outstanding requests once
+    // the handler returned and is joined by the next start() or the destructor
+    if (onEngineThread) {
+        return;
+    }
+
+    wake();
+    joinThread();
+
+    if (wasRunning) {
+        LOG_TCP_INFO("Client engine stopped");
+    }
+}
+
+void DoIPClientEngine::joinThread() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+        // Ids of joined threads are reused
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threadId = std::thread::id();
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+        m_epollFd = -1;
+    }
+}
+
+std::thread::id DoIPClientEngine::engineThreadId() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_threadId;
+}
+
+DoIPSessionId DoIPClientEngine::openSession(const DoIPClientSessionConfig &config, DoIPSessionStateHandler onStateChange) {
+    auto session = std::make_unique<Session>();
+    in_addr address{};
+    if (inet_pton(AF_INET, config.serverAddress.c_str(), &address) != 1) {
+        LOG_TCP_ERROR("Invalid server address '{}'", config.serverAddress);
+        return DOIP_INVALID_SESSION;
+    }
+    session->id = m_nextId.fetch_add(1);
+    session->config = config;
+    session->onStateChange = std::move(onStateChange);
+    session->serverIp = address.s_addr;
+    // Diagnostic messages larger than the MTU are received in chunks and reassembled
+    session->decoder.setStreamingEnabled(true);
+
+    DoIPSessionId id = session->id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running.load()) {
+            return DOIP_INVALID_SESSION;
+        }
+        m_states.emplace(id, DoIPSessionState::Connecting);
+        m_pendingSessions.emplace_back(std::move(session));
+    }
+    wake();
+    return id;
+}
+
+void DoIPClientEngine::closeSession(DoIPSessionId id) {
+    post(id, [this, id]() {
+        auto it = m_sessions.find(id);
+        if (it != m_sessions.end()) {
+            shutdownSession(*it->second);
+        }
+    });
+}
+
+bool DoIPClientEngine::sendDiagnosticMessage(DoIPSessionId id, const ByteArray &request, DoIPClientResponseHandler onResponse) {
+    return post(id, [this, id, data = request, onResponse = std::move(onResponse)]() mutable {
+        auto it = m_sessions.find(id);
+        if (it == m_sessions.end() || it->second->state == DoIPSessionState::Closed) {
+            onResponse(DoIPClientResponse{});
+            return;
+        }
+        Session &session = *it->second;
+        session.requests.push_back(Request{std::move(data), std::move(onResponse)});
+        sendNextRequest(session);
+    });
+}
+
+std::future<DoIPClientResponse> DoIPClientEngine::sendDiagnosticMessage(DoIPSessionId id, const ByteArray &request) {
+    auto promise = std::make_shared<std::promise<DoIPClientResponse>>();
+    auto future = promise->get_future();
+    if (!sendDiagnosticMessage(id, request, [promise](const DoIPClientResponse &response) { promise->set_value(response); })) {
+        promise->set_value(DoIPClientResponse{});
+    }
+    return future;
+}
+
+DoIPSessionState DoIPClientEngine::sessionState(DoIPSessionId id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_states.find(id);
+    return it != m_states.end() ? it->second : DoIPSessionState::Closed;
+}
+
+size_t DoIPClientEngine::sessionCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_states.size();
+}
+
+bool DoIPClientEngine::post(DoIPSessionId id, Command command) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running.load() || m_states.find(id) == m_states.end()) {
+            return false;
+        }
+        m_commands.emplace_back(std::move(command));
+    }
+    wake();
+    return true;
+}
+
+void DoIPClientEngine::wake() {
+    if (m_wakeFd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_TCP_WARN("Failed to wake client engine: {}", strerror(errno));
+    }
+}
+
+void DoIPClientEngine::run() {
+    std::array<epoll_event, EPOLL_MAX_EVENTS> events{};
+    m_nextDeadline = NO_DEADLINE;
+
+    while (m_running.load()) {
+        // Sleep until the earliest setup or response deadline, or until woken up
+        int timeoutMs = -1;
+        if (m_nextDeadline != NO_DEADLINE) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(m_nextDeadline - std::chrono::steady_clock::now());
+            timeoutMs = static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 0));
+        }
+        int count = epoll_wait(m_epollFd, events.data(), EPOLL_MAX_EVENTS, timeoutMs);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_TCP_ERROR("epoll_wait failed: {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const epoll_event &event = events[static_cast<size_t>(i)];
+            if (event.data.u64 == WAKE_MARKER) {
+                uint64_t value = 0;
+                ssize_t readBytes = read(m_wakeFd, &value, sizeof(value));
+                (void)readBytes;
+                runCommands();
+                continue;
+            }
+
+            // The session may have been closed by an earlier event of this batch
+            auto it = m_sessions.find(static_cast<DoIPSessionId>(event.data.u64));
+            if (it == m_sessions.end() || it->second->state == DoIPSessionState::Closed) {
+                continue;
+            }
+            Session &session = *it->second;
+            if (event.events & (EPOLLOUT | EPOLLERR)) {
+                onWritable(session);
+            }
+            if (session.state != DoIPSessionState::Closed && session.state != DoIPSessionState::Connecting &&
+                (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                onReadable(session);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_nextDeadline) {
+            checkTimeouts(now);
+        }
+        releaseClosedSessions();
+    }
+
+    // Complete everything posted before stop()
+    runCommands();
+    for (auto &entry : m_sessions) {
+        shutdownSession(*entry.second);
+    }
+    releaseClosedSessions();
+}
+
+void DoIPClientEngine::runCommands() {
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<Command> commands;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sessions.swap(m_pendingSessions);
+        commands.swap(m_commands);
+    }
+
+    // Sessions first, commands may refer to them
+    for (auto &session : sessions) {
+        Session &adopted = *session;
+        m_sessions.emplace(adopted.id, std::move(session));
+        connect(adopted);
+    }
+    for (auto &command : commands) {
+        command();
+    }
+}
+
+void DoIPClientEngine::releaseClosedSessions() {
+    for (DoIPSessionId id : m_closedSessions) {
+        m_sessions.erase(id);
+    }
+    m_closedSessions.clear();
+}
+
+void DoIPClientEngine::connect(Session &session) {
+    setDeadline(session, std::chrono::steady_clock::now() + session.config.setupTimeout);
+    session.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (session.fd < 0) {
+        LOG_TCP_ERROR("Session {}: failed to create socket: {}", session.id, strerror(errno));
+        shutdownSession(session);
+        return;
+    }
+    int noDelay = 1;
+    setsockopt(session.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    // Writable as soon as the connection is established
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    ev.data.u64 = session.id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, session.fd, &ev) < 0) {
+        LOG_TCP_ERROR("Session {}: failed to register socket: {}", session.id, strerror(errno));
+        shutdownSession(session);
+        return;
+    }
+    session.writeRegistered = true;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(session.config.port);
+    address.sin_addr.s_addr = session.serverIp;
+    if (::connect(session.fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0 && errno != EINPROGRESS) {
+        LOG_TCP_ERROR("Session {}: could not connect to {}: {}", session.id, session.config.serverAddress, strerror(errno));
+        shutdownSession(session);
+    }
+}
+
+void DoIPClientEngine::onWritable(Session &session) {
+    if (session.state == DoIPSessionState::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(session.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            LOG_TCP_ERROR("Session {}: could not connect to {}: {}", session.id, session.config.serverAddress, strerror(error));
+            shutdownSession(session);
+            return;
+        }
+        LOG_TCP_DEBUG("Session {}: connected to {}", session.id, session.config.serverAddress);
+        setState(session, DoIPSessionState::ActivatingRouting);
+        auto request = message::makeRoutingActivationRequest(session.config.sourceAddress, session.config.activationType);
+        queue(session, request.data(), request.size());
+    }
+
+    if (!flush(session)) {
+        shutdownSession(session);
+    }
+}
+
+void DoIPClientEngine::onReadable(Session &session) {
+    ssize_t received = session.decoder.readFrom(session.fd);
+    if (received == 0) {
+        LOG_TCP_INFO("Session {}: connection closed by the server", session.id);
+        shutdownSession(session);
+        return;
+    }
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            LOG_TCP_ERROR("Session {}: receive failed: {}", session.id, strerror(errno));
+            shutdownSession(session);
+        }
+        return;
+    }
+
+    DoIPFrame frame;
+    while (session.state != DoIPSessionState::Closed) {
+        DoIPDecodeStatus status = session.decoder.nextFrame(frame);
+        if (status == DoIPDecodeStatus::NeedMoreData) {
+            break;
+        }
+        if (status != DoIPDecodeStatus::FrameReady && status != DoIPDecodeStatus::ChunkReady) {
+            LOG_TCP_ERROR("Session {}: invalid frame received", session.id);
+            shutdownSession(session);
+            break;
+        }
+        if (status == DoIPDecodeStatus::ChunkReady) {
+            if (frame.totalLength > DIAGNOSTIC_ADDRESSES_SIZE + session.config.maxResponseLength) {
+                LOG_TCP_ERROR("Session {}: diagnostic message of {} bytes exceeds the limit", session.id, frame.totalLength);
+                shutdownSession(session);
+                break;
+            }
+            if (frame.offset == 0) {
+                session.streamed.clear();
+            }
+            session.streamed.insert(session.streamed.end(), frame.payload, frame.payload + frame.payloadLength);
+            if (frame.offset + frame.payloadLength < frame.totalLength) {
+                continue;
+            }
+            frame.payload = session.streamed.data();
+            frame.payloadLength = session.streamed.size();
+            frame.offset = 0;
+            handleFrame(session, frame);
+            // Do not keep a large buffer for the lifetime of the session
+            session.streamed = ByteArray{};
+            continue;
+        }
+        handleFrame(session, frame);
+    }
+}
+
+void DoIPClientEngine::handleFrame(Session &session, const DoIPFrame &frame) {
+    DoIPMessageView msg(frame.payloadType, frame.payload, frame.payloadLength);
+
+    switch (frame.payloadType) {
+    case DoIPPayloadType::RoutingActivationResponse: {
+        if (session.state != DoIPSessionState::ActivatingRouting || frame.payloadLength <= ROUTING_ACTIVATION_RESPONSE_CODE_OFFSET) {
+            break;
+        }
+        auto result = static_cast<DoIPRoutingActivationResult>(frame.payload[ROUTING_ACTIVATION_RESPONSE_CODE_OFFSET]);
+        if (result != DoIPRoutingActivationResult::RouteActivated &&
+            result != DoIPRoutingActivationResult::RouteActivatedConfirmationRequired) {
+            LOG_TCP_WARN("Session {}: routing activation denied (0x{:02X})", session.id, static_cast<uint8_t>(result));
+            shutdownSession(session);
+            break;
+        }
+        setState(session, DoIPSessionState::Active);
+        sendNextRequest(session);
+    } break;
+
+    case DoIPPayloadType::AliveCheckRequest: {
+        auto response = message::makeAliveCheckResponse(session.config.sourceAddress);
+        queue(session, response.data(), response.size());
+        if (!flush(session)) {
+            shutdownSession(session);
+        }
+    } break;
+
+    case DoIPPayloadType::DiagnosticMessageNegativeAck: {
+        if (!session.inFlight || frame.payloadLength <= DIAGNOSTIC_ACK_CODE_OFFSET ||
+            !isFromTarget(session.config, frame.payload, frame.payloadLength)) {
+            break;
+        }
+        // The NACK may repeat the start of the rejected request
+        if (frame.payloadLength > DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET) {
+            const ByteArray &request = session.requests.front().data;
+            if (!request.empty() && frame.payload[DIAGNOSTIC_ACK_PREVIOUS_MESSAGE_OFFSET] != request[0]) {
+                LOG_TCP_DEBUG("Session {}: dropping NACK of an earlier request", session.id);
+                break;
+            }
+        }
+        DoIPClientResponse response;
+        response.result = DoIPClientResult::NegativeAck;
+        response.nackCode = static_cast<DoIPNegativeDiagnosticAck>(frame.payload[DIAGNOSTIC_ACK_CODE_OFFSET]);
+        complete(session, std::move(response));
+    } break;
+
+    case DoIPPayloadType::DiagnosticMessage: {
+        // Responses of other targets (or to other testers) are not ours
+        if (!session.inFlight || !isFromTarget(session.config, frame.payload, frame.payloadLength)) {
+            break;
+        }
+        auto [data, size] = msg.getDiagnosticMessagePayload();
+        // A late response to a request which already timed out
+        if (!isResponseTo(session.requests.front().data, data, size)) {
+            LOG_TCP_DEBUG("Session {}: dropping response of an earlier request", session.id);
+            break;
+        }
+        if (isResponsePending(data, size)) {
+            setDeadline(session, std::chrono::steady_clock::now() + session.config.responseTimeout);
+            break;
+        }
+        DoIPClientResponse response;
+        response.result = DoIPClientResult::Response;
+        response.data = ByteArray(data, size);
+        complete(session, std::move(response));
+    } break;
+
+    default:
+        // Positive diagnostic ACKs need no action, other payload types are not expected
+        break;
+    }
+}
+
+void DoIPClientEngine::checkTimeouts(std::chrono::steady_clock::time_point now) {
+    // Recomputed below; requests sent by completion handlers lower it again via setDeadline()
+    m_nextDeadline = NO_DEADLINE;
+    for (auto &entry : m_sessions) {
+        Session &session = *entry.second;
+        if (now < session.deadline) {
+            if (hasDeadline(session)) {
+                m_nextDeadline = std::min(m_nextDeadline, session.deadline);
+            }
+            continue;
+        }
+        switch (session.state) {
+        case DoIPSessionState::Connecting:
+        case DoIPSessionState::ActivatingRouting:
+            LOG_TCP_WARN("Session {}: no routing activation within {} ms", session.id, session.config.setupTimeout.count());
+            shutdownSession(session);
+            break;
+        case DoIPSessionState::Active:
+            if (session.inFlight) {
+                DoIPClientResponse response;
+                response.result = DoIPClientResult::Timeout;
+                complete(session, std::move(response));
+            }
+            break;
+        case DoIPSessionState::Closed:
+            break;
+        }
+    }
+}
+
+bool DoIPClientEngine::hasDeadline(const Session &session) {
+    switch (session.state) {
+    case DoIPSessionState::Connecting:
+    case DoIPSessionState::ActivatingRouting:
+        return true;
+    case DoIPSessionState::Active:
+        return session.inFlight;
+    case DoIPSessionState::Closed:
+        break;
+    }
+    return false;
+}
+
+void DoIPClientEngine::setDeadline(Session &session, std::chrono::steady_clock::time_point deadline) {
+    session.deadline = deadline;
+    m_nextDeadline = std::min(m_nextDeadline, deadline);
+}
+
+void DoIPClientEngine::setState(Session &session, DoIPSessionState state) {
+    session.state = state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (state == DoIPSessionState::Closed) {
+            m_states.erase(session.id);
+        } else {
+            m_states[session.id] = state;
+        }
+    }
+    if (session.onStateChange) {
+        session.onStateChange(session.id, state);
+    }
+}
+
+void DoIPClientEngine::queue(Session &session, const uint8_t *data, size_t size) {
+    session.sendBuffer.insert(session.sendBuffer.end(), data, data + size);
+}
+
+bool DoIPClientEngine::flush(Session &session) {
+    size_t sent = 0;
+    while (sent < session.sendBuffer.size()) {
+        ssize_t result = send(session.fd, session.sendBuffer.data() + sent, session.sendBuffer.size() - sent, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                LOG_TCP_ERROR("Session {}: send failed: {}", session.id, strerror(errno));
+                return false;
+            }
+            break;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    session.sendBuffer.erase(session.sendBuffer.begin(), session.sendBuffer.begin() + static_cast<ptrdiff_t>(sent));
+
+    // Only wait for writability while data is left
+    bool needWrite = !session.sendBuffer.empty();
+    if (needWrite != session.writeRegistered) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (needWrite ? EPOLLOUT : 0u);
+        ev.data.u64 = session.id;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, session.fd, &ev) < 0) {
+            LOG_TCP_ERROR("Session {}: failed to update socket registration: {}", session.id, strerror(errno));
+            return false;
+        }
+        session.writeRegistered = needWrite;
+    }
+    return true;
+}
+
+void DoIPClientEngine::sendNextRequest(Session &session) {
+    if (session.inFlight || session.requests.empty() || session.state != DoIPSessionState::Active) {
+        return;
+    }
+    auto msg = message::makeDiagnosticMessage(session.config.sourceAddress, session.config.targetAddress, session.requests.front().data);
+    queue(session, msg.data(), msg.size());
+    session.inFlight = true;
+    session.sentAt = std::chrono::steady_clock::now();
+    setDeadline(session, session.sentAt + session.config.responseTimeout);
+    if (!flush(session)) {
+        shutdownSession(session);
+    }
+}
+
+void DoIPClientEngine::complete(Session &session, DoIPClientResponse response) {
+    Request request = std::move(session.requests.front());
+    session.requests.pop_front();
+    session.inFlight = false;
+    response.latency = std::chrono::steady_clock::now() - session.sentAt;
+    request.onResponse(response);
+    sendNextRequest(session);
+}
+
+void DoIPClientEngine::shutdownSession(Session &session) {
+    if (session.state == DoIPSessionState::Closed) {
+        return;
+    }
+    if (session.fd >= 0) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+        close(session.fd);
+        session.fd = -1;
+    }
+    setState(session, DoIPSessionState::Closed);
+    m_closedSessions.push_back(session.id);
+
+    auto now = std::chrono::steady_clock::now();
+    while (!session.requests.empty()) {
+        Request request = std::move(session.requests.front());
+        session.requests.pop_front();
+        DoIPClientResponse response;
+        if (session.inFlight) {
+            response.latency = now - session.sentAt;
+            session.inFlight = false;
+        }
+        request.onResponse(response);
+    }
+}
+
+} // namespace doip
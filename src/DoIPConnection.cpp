@@ -2,16 +2,33 @@
 #include "DoIPMessage.h"
 #include "DoIPPayloadType.h"
 #include "Logger.h"
+#include "ProtocolTrace.h"
 
+#include <cerrno>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <netinet/tcp.h>
 
 namespace doip {
 
 DoIPConnection::DoIPConnection(int tcpSocket, UniqueServerModelPtr model)
     : DoIPDefaultConnection(std::move(model)),
       m_logicalAddress(ZERO_ADDRESS),
-      m_tcpSocket(tcpSocket) {
+      m_tcpSocket(tcpSocket),
+      m_outbound(tcpSocket) {
+    m_decoder.setStreamingEnabled(m_serverModel->hasDiagnosticChunkHandler());
+    // Coalescing is done by the outbound queue. Nagle would hold back responses
+    // completed outside of a dispatch cycle (e.g. downstream responses) until
+    // the client's delayed ACK
+    int noDelay = 1;
+    setsockopt(tcpSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    m_outbound.setCongestionHandler([this](bool congested) {
+        LOG_TCP_WARN("Send queue {} ({} bytes pending)", congested ? "congested" : "drained", m_outbound.pendingBytes());
+        if (m_serverModel->onSendBackpressure) {
+            m_serverModel->onSendBackpressure(*this, congested);
+        }
+    });
 }
 
 /*
@@ -23,56 +40,130 @@ void DoIPConnection::closeSocket() {
 
 /*
  * Receives a message from the client and calls reactToReceivedTcpMessage method
- * @return      amount of bytes which were send back to client
- *              or -1 if error occurred
+ * @return      1 if a message was dispatched, 0 if the peer closed the connection
+ *              or a negative value if error occurred
  */
 int DoIPConnection::receiveTcpMessage() {
-    LOG_DOIP_INFO("Waiting for DoIP Header...");
-    uint8_t genericHeader[DOIP_HEADER_SIZE];
-    unsigned int readBytes = receiveFixedNumberOfBytesFromTCP(genericHeader, DOIP_HEADER_SIZE);
-    if (readBytes == DOIP_HEADER_SIZE /*&& !m_aliveCheckTimer.hasTimeout()*/) {
-        LOG_DOIP_INFO("Received DoIP Header.");
-
-        auto optHeader = DoIPMessage::tryParseHeader(genericHeader, DOIP_HEADER_SIZE);
-        if (!optHeader.has_value()) {
-            // m_stateMachine.processEvent(DoIPServerEvent::InvalidMessage);
-            //  TODO: Notify application of invalid message?
-            LOG_DOIP_ERROR("DoIP message header parsing failed");
+    DoIPFrame frame;
+    while (true) {
+        // Frames pipelined by the client may already be buffered
+        DoIPDecodeStatus status = m_decoder.nextFrame(frame);
+        if (status == DoIPDecodeStatus::FrameReady || status == DoIPDecodeStatus::ChunkReady) {
+            // Coalesce the ACK and a synchronously produced response
+            m_outbound.cork();
+            dispatchReceivedMessage(frame, status);
+            m_outbound.uncork();
+            return 1;
+        }
+        if (status != DoIPDecodeStatus::NeedMoreData) {
+            LOG_DOIP_ERROR("DoIP message header parsing failed ({})", status == DoIPDecodeStatus::PayloadTooLarge ? "payload too large" : "invalid header");
             closeSocket();
             return -2;
         }
 
-        auto plType = optHeader->first;
-        auto payloadLength = optHeader->second;
-
-        LOG_DOIP_INFO("Payload Type: {}, length: {} ", fmt::streamed(plType), payloadLength);
-
-        if (payloadLength > 0) {
-            LOG_DOIP_DEBUG("Waiting for {} bytes of payload...", payloadLength);
-            unsigned int receivedPayloadBytes = receiveFixedNumberOfBytesFromTCP(m_receiveBuf.data(), payloadLength);
-            if (receivedPayloadBytes < payloadLength) {
+        LOG_DOIP_DEBUG("Waiting for DoIP data...");
+        ssize_t result = m_decoder.readFrom(m_tcpSocket);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            bool incomplete = m_decoder.bufferedBytes() > 0 || m_decoder.isStreaming();
+            if (incomplete) {
                 LOG_DOIP_ERROR("DoIP message incomplete");
-                // m_stateMachine.processEvent(DoIPServerEvent::InvalidMessage);
-                //  todo: Notify application of invalid message?
-                closeSocket();
-                return -2;
             }
+            closeSocket();
+            return incomplete ? -2 : 0;
+        }
+    }
+}
 
-            DoIPMessage msg = DoIPMessage(plType, m_receiveBuf.data(), receivedPayloadBytes);
-            LOG_DOIP_INFO("RX: {}", fmt::streamed(msg));
+/*
+ * Reads all bytes available on a non-blocking socket and dispatches complete messages
+ */
+int DoIPConnection::processAvailableTcpData() {
+    int dispatched = 0;
+
+    while (isSocketActive()) {
+        size_t freeSpace = m_decoder.capacity() - m_decoder.bufferedBytes();
+        ssize_t result = m_decoder.readFrom(m_tcpSocket);
+        if (result < 0) {
+            if (errno == EAGAIN /* || errno == EWOULDBLOCK */) {
+                return dispatched;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_TCP_ERROR("recv failed: {}", strerror(errno));
+            closeConnection(DoIPCloseReason::SocketError);
+            return -1;
+        }
+        if (result == 0) {
+            LOG_TCP_INFO("Connection closed by peer");
+            closeSocket();
+            return -1;
         }
 
-        DoIPMessage message(plType, m_receiveBuf.data(), payloadLength);
-        handleMessage2(message);
+        // Responses to all messages of the burst are written together
+        DoIPFrame frame;
+        DoIPDecodeStatus status;
+        m_outbound.cork();
+        while ((status = m_decoder.nextFrame(frame)) == DoIPDecodeStatus::FrameReady || status == DoIPDecodeStatus::ChunkReady) {
+            dispatchReceivedMessage(frame, status);
+            ++dispatched;
+            if (!isSocketActive()) {
+                break;
+            }
+        }
+        m_outbound.uncork();
+        if (!isSocketActive()) {
+            return -1;
+        }
+        if (status != DoIPDecodeStatus::NeedMoreData) {
+            LOG_DOIP_ERROR("DoIP message header parsing failed ({})", status == DoIPDecodeStatus::PayloadTooLarge ? "payload too large" : "invalid header");
+            closeConnection(DoIPCloseReason::InvalidMessage);
+            return -1;
+        }
 
-        return 1;
-    } else {
-        closeSocket();
-        return 0;
+        // The socket is level-triggered: a short read means it is drained for now
+        if (static_cast<size_t>(result) < freeSpace) {
+            return dispatched;
+        }
     }
+
     return -1;
 }
 
+void DoIPConnection::dispatchReceivedMessage(const DoIPFrame &frame, DoIPDecodeStatus status) {
+    if (ProtocolTrace::instance().isEnabled()) {
+        traceReceivedFrame(frame, status);
+    }
+
+    if (status == DoIPDecodeStatus::ChunkReady) {
+        LOG_DOIP_DEBUG("RX: chunk {}..{} of {} bytes", frame.offset, frame.offset + frame.payloadLength, frame.totalLength);
+        handleDiagnosticMessageChunk(frame.payload, frame.payloadLength, frame.offset, frame.totalLength);
+        return;
+    }
+
+    // Borrows from the decoder buffer, handlers copy only what they keep
+    DoIPMessageView message(frame.payloadType, frame.payload, frame.payloadLength);
+    LOG_DOIP_INFO("RX: {}", fmt::streamed(message));
+    handleMessage2(message);
+}
+
+void DoIPConnection::traceReceivedFrame(const DoIPFrame &frame, DoIPDecodeStatus status) {
+    // Chunks of a streamed message after the first one carry no header
+    bool continuation = status == DoIPDecodeStatus::ChunkReady && frame.offset > 0;
+    auto header = DoIPMessage::makeHeader(frame.payloadType, static_cast<uint32_t>(status == DoIPDecodeStatus::ChunkReady ? frame.totalLength : frame.payloadLength));
+
+    std::array<iovec, 2> iov{};
+    size_t iovCount = 0;
+    if (!continuation) {
+        iov[iovCount++] = {header.data(), header.size()};
+    }
+    iov[iovCount++] = {const_cast<uint8_t *>(frame.payload), frame.payloadLength};
+    ProtocolTrace::instance().record(TraceDirection::Rx, TraceTransport::Tcp, static_cast<uint32_t>(m_tcpSocket), iov.data(), iovCount, continuation);
+}
+
 /**
  * Receive exactly payloadLength bytes from the TCP stream and put them into receivedData.
  * The method blocks until receivedData bytes are received or the socket is closed.
@@ -105,15 +196,30 @@ void DoIPConnection::triggerDisconnection() {
 }
 
 /**
- * Sends a message back to the connected client
+ * Queues a message for the connected client. The message is written immediately
+ * unless the connection is dispatching received messages.
  * @param message           contains generic header and payload specific content
  * @param messageLength     length of the complete message
- * @return                  number of bytes written is returned,
+ * @return                  number of bytes accepted is returned,
  *                          or -1 if error occurred
  */
 ssize_t DoIPConnection::sendMessage(const uint8_t *message, size_t messageLength) {
-    ssize_t result = write(m_tcpSocket, message, messageLength);
-    return result;
+    iovec iov{const_cast<uint8_t *>(message), messageLength};
+    return enqueueMessage(&iov, 1);
+}
+
+ssize_t DoIPConnection::enqueueMessage(const iovec *iov, size_t count) {
+    ssize_t accepted = m_outbound.enqueue(iov, count);
+    if (accepted >= 0) {
+        ProtocolTrace::instance().record(TraceDirection::Tx, TraceTransport::Tcp, static_cast<uint32_t>(m_tcpSocket), iov, count);
+        // The first buffer always starts with the generic header
+        if (count > 0 && iov[0].iov_len >= DOIP_HEADER_SIZE) {
+            const auto *header = static_cast<const uint8_t *>(iov[0].iov_base);
+            auto payloadType = static_cast<DoIPPayloadType>((header[2] << 8) | header[3]);
+            m_metrics.countSent(payloadType, static_cast<size_t>(accepted));
+        }
+    }
+    return accepted;
 }
 
 // === IConnectionContext interface implementation ===
@@ -127,6 +233,36 @@ ssize_t DoIPConnection::sendProtocolMessage(const DoIPMessage &msg) {
     return sentBytes;
 }
 
+ssize_t DoIPConnection::sendProtocolFragments(DoIPPayloadType payloadType, const ByteArrayRef *fragments, size_t count) {
+    constexpr size_t kMaxFragments = 8;
+    if (count > kMaxFragments) {
+        return DoIPDefaultConnection::sendProtocolFragments(payloadType, fragments, count);
+    }
+
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < count; ++i) {
+        payloadLength += fragments[i].second;
+    }
+    auto header = DoIPMessage::makeHeader(payloadType, static_cast<uint32_t>(payloadLength));
+
+    std::array<iovec, kMaxFragments + 1> iov{};
+    size_t iovCount = 0;
+    iov[iovCount++] = {header.data(), header.size()};
+    for (size_t i = 0; i < count; ++i) {
+        if (fragments[i].second > 0) {
+            iov[iovCount++] = {const_cast<uint8_t *>(fragments[i].first), fragments[i].second};
+        }
+    }
+
+    ssize_t sentBytes = enqueueMessage(iov.data(), iovCount);
+    if (sentBytes < 0) {
+        LOG_DOIP_ERROR("Error sending {} message to client: {}", fmt::streamed(payloadType), strerror(errno));
+    } else {
+        LOG_DOIP_INFO("Sent {} bytes to client: {} ({} payload fragments)", sentBytes, fmt::streamed(payloadType), count);
+    }
+    return sentBytes;
+}
+
 void DoIPConnection::closeConnection(DoIPCloseReason reason) {
     // Guard against recursive calls
     if (m_isClosing) {
@@ -140,6 +276,7 @@ void DoIPConnection::closeConnection(DoIPCloseReason reason) {
     // Call base class to handle state machine and notification
     DoIPDefaultConnection::closeConnection(reason);
 
+    m_outbound.close();
     close(m_tcpSocket);
     m_tcpSocket = 0;
 }
@@ -156,7 +293,7 @@ void DoIPConnection::setClientAddress(const DoIPAddress &address) {
     m_logicalAddress = address;
 }
 
-DoIPDiagnosticAck DoIPConnection::notifyDiagnosticMessage(const DoIPMessage &msg) {
+DoIPDiagnosticAck DoIPConnection::notifyDiagnosticMessage(const DoIPMessageView &msg) {
     // Forward to application callback
     if (m_serverModel->onDiagnosticMessage) {
         return m_serverModel->onDiagnosticMessage(*this, msg);
@@ -178,6 +315,10 @@ void DoIPConnection::notifyDiagnosticAckSent(DoIPDiagnosticAck ack) {
     }
 }
 
+bool DoIPConnection::isSendCongested() const {
+    return m_outbound.isCongested();
+}
+
 bool DoIPConnection::hasDownstreamHandler() const {
     return m_serverModel->hasDownstreamHandler();
 }
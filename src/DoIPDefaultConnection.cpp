@@ -12,40 +12,34 @@ DoIPDefaultConnection::DoIPDefaultConnection(UniqueServerModelPtr model)
           StateDescriptor(
               DoIPServerState::SocketInitialized,
               DoIPServerState::WaitRoutingActivation,
-              [this](std::optional<DoIPMessage> msg) { this->handleSocketInitialized(DoIPServerEvent{}, msg); }),
+              [this](OptDoIPMessageView msg) { this->handleSocketInitialized(DoIPServerEvent{}, msg); }),
           StateDescriptor(
               DoIPServerState::WaitRoutingActivation,
               DoIPServerState::Finalize,
-              [this](std::optional<DoIPMessage> msg) { this->handleWaitRoutingActivation(DoIPServerEvent{}, msg); },
+              [this](OptDoIPMessageView msg) { this->handleWaitRoutingActivation(DoIPServerEvent{}, msg); },
               ConnectionTimers::InitialInactivity),
           StateDescriptor(
               DoIPServerState::RoutingActivated,
               DoIPServerState::Finalize,
-              [this](std::optional<DoIPMessage> msg) { this->handleRoutingActivated(DoIPServerEvent{}, msg); },
+              [this](OptDoIPMessageView msg) { this->handleRoutingActivated(DoIPServerEvent{}, msg); },
               ConnectionTimers::GeneralInactivity,
               [this]() noexcept { m_aliveCheckRetry = 0; }),
           StateDescriptor(
               DoIPServerState::WaitAliveCheckResponse,
               DoIPServerState::Finalize,
-              [this](std::optional<DoIPMessage> msg) { this->handleWaitAliveCheckResponse(DoIPServerEvent{}, msg); },
+              [this](OptDoIPMessageView msg) { this->handleWaitAliveCheckResponse(DoIPServerEvent{}, msg); },
               ConnectionTimers::AliveCheck,
               [this]() { ++m_aliveCheckRetry; LOG_DOIP_WARN("Alive check #{}/{}", m_aliveCheckRetry, m_aliveCheckRetryCount); }),
-          StateDescriptor(
-              DoIPServerState::WaitDownstreamResponse,
-              DoIPServerState::Finalize,
-              [this](std::optional<DoIPMessage> msg) { this->handleWaitDownstreamResponse(DoIPServerEvent{}, msg); },
-              ConnectionTimers::UserDefined,
-              nullptr,
-              nullptr,
-              2s),
           StateDescriptor(
               DoIPServerState::Finalize,
               DoIPServerState::Closed,
-              [this](std::optional<DoIPMessage> msg) { this->handleFinalize(DoIPServerEvent{}, msg); }),
+              [this](OptDoIPMessageView msg) { this->handleFinalize(DoIPServerEvent{}, msg); }),
           StateDescriptor(
               DoIPServerState::Closed,
               DoIPServerState::Closed,
-              nullptr)} {
+              nullptr)},
+      m_downstream(std::make_shared<DownstreamRequests>()) {
+    m_downstream->connection = this;
     m_isOpen = true;
     m_serverModel->onOpenConnection(*this);
     m_state = &STATE_DESCRIPTORS[0];
@@ -54,17 +48,49 @@ DoIPDefaultConnection::DoIPDefaultConnection(UniqueServerModelPtr model)
     transitionTo(DoIPServerState::WaitRoutingActivation);
 }
 
+DoIPDefaultConnection::~DoIPDefaultConnection() {
+    dropDownstreamRequests();
+    if (m_metricsRegistry) {
+        m_metricsRegistry->removeConnection(&m_metrics);
+    }
+}
+
+void DoIPDefaultConnection::setMetricsRegistry(std::shared_ptr<DoIPMetricsRegistry> registry) {
+    if (m_metricsRegistry) {
+        m_metricsRegistry->removeConnection(&m_metrics);
+    }
+    m_metricsRegistry = std::move(registry);
+    if (m_metricsRegistry) {
+        m_metricsRegistry->addConnection(&m_metrics);
+    }
+}
+
 ssize_t DoIPDefaultConnection::sendProtocolMessage(const DoIPMessage &msg) {
     LOG_DOIP_INFO("Default connection: Sending protocol message: {}", fmt::streamed(msg));
+    m_metrics.countSent(msg.getPayloadType(), msg.size());
     return static_cast<ssize_t>(msg.size()); // Simulate sending by returning the message size
 }
 
+ssize_t DoIPDefaultConnection::sendProtocolFragments(DoIPPayloadType payloadType, const ByteArrayRef *fragments, size_t count) {
+    ByteArray payload;
+    for (size_t i = 0; i < count; ++i) {
+        if (fragments[i].second > 0) {
+            payload.insert(payload.end(), fragments[i].first, fragments[i].first + fragments[i].second);
+        }
+    }
+    return sendProtocolMessage(DoIPMessage(payloadType, std::move(payload)));
+}
+
 void DoIPDefaultConnection::closeConnection(DoIPCloseReason reason) {
+    if (m_isOpen) {
+        m_metrics.countClose(reason);
+    }
     try {
         LOG_DOIP_INFO("Default connection: Closing connection, reason: {}", fmt::streamed(reason));
         transitionTo(DoIPServerState::Closed);
         m_closeReason = reason;
         m_timerManager.stopAll();
+        dropDownstreamRequests();
         notifyConnectionClosed(reason);
     } catch (const std::exception &e) {
         LOG_DOIP_ERROR("Error notifying connection closed: {}", e.what());
@@ -95,7 +121,8 @@ void DoIPDefaultConnection::setClientAddress(const DoIPAddress &address) {
     m_routedClientAddress = address;
 }
 
-void DoIPDefaultConnection::handleMessage2(const DoIPMessage &message) {
+void DoIPDefaultConnection::handleMessage2(const DoIPMessageView &message) {
+    m_metrics.countReceived(message.getPayloadType(), DOIP_HEADER_SIZE + message.getPayloadSize());
     m_state->messageHandler(message);
 }
 
@@ -181,14 +208,14 @@ void DoIPDefaultConnection::restartStateTimer() {
     }
 }
 
-void DoIPDefaultConnection::handleSocketInitialized(DoIPServerEvent event, OptDoIPMessage msg) {
+void DoIPDefaultConnection::handleSocketInitialized(DoIPServerEvent event, OptDoIPMessageView msg) {
     (void)event; // Unused parameter
     (void)msg;   // Unused parameter
 
     transitionTo(DoIPServerState::WaitRoutingActivation);
 }
 
-void DoIPDefaultConnection::handleWaitRoutingActivation(DoIPServerEvent event, OptDoIPMessage msg) {
+void DoIPDefaultConnection::handleWaitRoutingActivation(DoIPServerEvent event, OptDoIPMessageView msg) {
     (void)event; // Unused parameter
     (void)msg;   // Unused parameter
 
@@ -216,7 +243,7 @@ void DoIPDefaultConnection::handleWaitRoutingActivation(DoIPServerEvent event, O
     transitionTo(DoIPServerState::RoutingActivated);
 }
 
-void DoIPDefaultConnection::handleRoutingActivated(DoIPServerEvent event, OptDoIPMessage msg) {
+void DoIPDefaultConnection::handleRoutingActivated(DoIPServerEvent event, OptDoIPMessageView msg) {
     (void)event; // Unused parameter
 
     if (!msg) {
@@ -224,7 +251,7 @@ void DoIPDefaultConnection::handleRoutingActivated(DoIPServerEvent event, OptDoI
         return;
     }
 
-    auto message = msg.value();
+    const DoIPMessageView &message = *msg;
 
     switch (message.getPayloadType()) {
     case DoIPPayloadType::DiagnosticMessage:
@@ -250,7 +277,9 @@ void DoIPDefaultConnection::handleRoutingActivated(DoIPServerEvent event, OptDoI
         return;
     }
 
+    auto handlerStart = std::chrono::steady_clock::now();
     auto ack = notifyDiagnosticMessage(message);
+    m_metrics.diagnosticHandlerLatency().observe(std::chrono::steady_clock::now() - handlerStart);
     sendDiagnosticMessageResponse(sourceAddress.value(), ack);
 
     // Reset general inactivity timer
@@ -263,23 +292,63 @@ void DoIPDefaultConnection::handleRoutingActivated(DoIPServerEvent event, OptDoI
     }
 
     if (hasDownstreamHandler()) {
+        // Stay in RoutingActivated, so further requests (e.g. to other ECUs)
+        // are forwarded while this one is pending
         auto result = notifyDownstreamRequest(message);
         LOG_DOIP_DEBUG("Downstream req -> {}", fmt::streamed(result));
-        if (result == DoIPDownstreamResult::Pending) {
-            // wait for downstream response
-            transitionTo(DoIPServerState::WaitDownstreamResponse);
-        } else if (result == DoIPDownstreamResult::Handled) {
-            // no downstream response expected -> go back to "idle"
-            transitionTo(DoIPServerState::RoutingActivated);
-        } else if (result == DoIPDownstreamResult::Error) {
-            // request could not be handled -> issue error and back to idle
-            sendDiagnosticMessageResponse(sourceAddress.value(), DoIPNegativeDiagnosticAck::TargetUnreachable);
-            transitionTo(DoIPServerState::RoutingActivated);
+    }
+}
+
+void DoIPDefaultConnection::handleDiagnosticMessageChunk(const uint8_t *data, size_t length, size_t offset, size_t totalLength) {
+    ChunkedDiagnosticMessage &msg = m_chunkedMessage;
+    bool last = offset + length == totalLength;
+    m_metrics.countReceived(DoIPPayloadType::DiagnosticMessage, length + (offset == 0 ? DOIP_HEADER_SIZE : 0), offset == 0);
+
+    if (offset == 0) {
+        msg = ChunkedDiagnosticMessage{};
+        if (!isRoutingActivated()) {
+            LOG_DOIP_WARN("Received diagnostic message without active routing");
+            closeConnection(DoIPCloseReason::InvalidMessage);
+            return;
+        }
+        msg.active = true;
+        LOG_DOIP_INFO("Receiving large diagnostic message ({} bytes)", totalLength);
+    }
+    if (!msg.active) {
+        return;
+    }
+
+    // Source and target address may be split across chunks as well
+    while (msg.addressBytes < msg.addresses.size() && length > 0) {
+        msg.addresses[msg.addressBytes++] = *data++;
+        ++offset;
+        --length;
+        if (msg.addressBytes == msg.addresses.size()) {
+            msg.sourceAddress = readAddressFrom(msg.addresses.data(), 0);
+            msg.targetAddress = readAddressFrom(msg.addresses.data(), 2);
+            if (msg.sourceAddress != getClientAddress()) {
+                LOG_DOIP_WARN("Received diagnostic message from unexpected source address {}", fmt::streamed(msg.sourceAddress));
+                msg.ack = DoIPNegativeDiagnosticAck::InvalidSourceAddress;
+            }
         }
     }
+
+    if (length > 0 && !msg.ack.has_value() && m_serverModel->onDiagnosticMessageChunk) {
+        constexpr size_t addressBytes = DOIP_DIAG_HEADER_SIZE - DOIP_HEADER_SIZE;
+        DoIPDiagnosticChunk chunk{msg.sourceAddress, msg.targetAddress, data, length, offset - addressBytes, totalLength - addressBytes};
+        msg.ack = m_serverModel->onDiagnosticMessageChunk(*this, chunk);
+    }
+
+    // Reset general inactivity timer, the transfer may take a while
+    restartStateTimer();
+
+    if (last) {
+        msg.active = false;
+        sendDiagnosticMessageResponse(msg.sourceAddress, msg.ack);
+    }
 }
 
-void DoIPDefaultConnection::handleWaitAliveCheckResponse(DoIPServerEvent event, OptDoIPMessage msg) {
+void DoIPDefaultConnection::handleWaitAliveCheckResponse(DoIPServerEvent event, OptDoIPMessageView msg) {
     (void)event; // Unused parameter
     (void)msg;   // Unused parameter
 
@@ -291,7 +360,7 @@ void DoIPDefaultConnection::handleWaitAliveCheckResponse(DoIPServerEvent event,
         return;
     }
 
-    auto message = msg.value();
+    const DoIPMessageView &message = *msg;
 
     switch (message.getPayloadType()) {
     case DoIPPayloadType::DiagnosticMessage: /* fall-through expected */
@@ -305,16 +374,7 @@ void DoIPDefaultConnection::handleWaitAliveCheckResponse(DoIPServerEvent event,
     }
 }
 
-void DoIPDefaultConnection::handleWaitDownstreamResponse(DoIPServerEvent event, OptDoIPMessage msg) {
-    (void)event; // Unused parameter
-    (void)msg;   // Unused parameter
-
-    // Implementation of handling wait downstream response would go here
-    LOG_DOIP_CRITICAL("handleWaitDownstreamResponse NOT IMPL");
-
-}
-
-void DoIPDefaultConnection::handleFinalize(DoIPServerEvent event, OptDoIPMessage msg) {
+void DoIPDefaultConnection::handleFinalize(DoIPServerEvent event, OptDoIPMessageView msg) {
     (void)event; // Unused parameter
     (void)msg;   // Unused parameter
 
@@ -324,6 +384,7 @@ void DoIPDefaultConnection::handleFinalize(DoIPServerEvent event, OptDoIPMessage
 
 void DoIPDefaultConnection::handleTimeout(ConnectionTimers timer_id) {
     LOG_DOIP_WARN("Timeout '{}'", fmt::streamed(timer_id));
+    m_metrics.countTimerExpiration(timer_id);
 
     switch (timer_id) {
     case ConnectionTimers::InitialInactivity:
@@ -380,6 +441,7 @@ ssize_t DoIPDefaultConnection::sendDiagnosticMessageResponse(const DoIPAddress &
     DoIPMessage message;
 
     if (ack.has_value()) {
+        m_metrics.countNack(ack.value());
         message = message::makeDiagnosticNegativeResponse(
             sourceAddress,
             targetAddress,
@@ -399,13 +461,20 @@ ssize_t DoIPDefaultConnection::sendDiagnosticMessageResponse(const DoIPAddress &
 }
 
 ssize_t DoIPDefaultConnection::sendDownstreamResponse(const DoIPAddress &sourceAddress, const ByteArray& payload) {
-    DoIPAddress targetAddress = getServerAddress();
-    DoIPMessage message = message::makeDiagnosticMessage(sourceAddress, targetAddress, payload);
+    return sendDiagnosticMessage(sourceAddress, getServerAddress(), payload);
+}
 
-    return sendProtocolMessage(message);
+ssize_t DoIPDefaultConnection::sendDiagnosticMessage(const DoIPAddress &sourceAddress, const DoIPAddress &targetAddress, const ByteArray &userData) {
+    std::array<uint8_t, 4> addresses{
+        static_cast<uint8_t>(sourceAddress >> 8), static_cast<uint8_t>(sourceAddress & 0xFF),
+        static_cast<uint8_t>(targetAddress >> 8), static_cast<uint8_t>(targetAddress & 0xFF)};
+
+    return sendProtocolFragments(DoIPPayloadType::DiagnosticMessage,
+                                 {ByteArrayRef{addresses.data(), addresses.size()},
+                                  ByteArrayRef{userData.data(), userData.size()}});
 }
 
-DoIPDiagnosticAck DoIPDefaultConnection::notifyDiagnosticMessage(const DoIPMessage &msg) {
+DoIPDiagnosticAck DoIPDefaultConnection::notifyDiagnosticMessage(const DoIPMessageView &msg) {
     if (m_serverModel->onDiagnosticMessage) {
         return m_serverModel->onDiagnosticMessage(*this, msg);
     }
@@ -424,32 +493,178 @@ void DoIPDefaultConnection::notifyDiagnosticAckSent(DoIPDiagnosticAck ack) {
     }
 }
 
+bool DoIPDefaultConnection::isSendCongested() const {
+    return false;
+}
+
 bool DoIPDefaultConnection::hasDownstreamHandler() const {
     return m_serverModel->hasDownstreamHandler();
 }
 
 
 
-DoIPDownstreamResult DoIPDefaultConnection::notifyDownstreamRequest(const DoIPMessage &msg) {
-    if (m_serverModel->onDownstreamRequest) {
-        auto handler = [this](const ByteArray &response, DoIPDownstreamResult result) {
-            this->receiveDownstreamResponse(response, result);
-        };
-        return m_serverModel->onDownstreamRequest(*this, msg, handler);
+DoIPDownstreamResult DoIPDefaultConnection::notifyDownstreamRequest(const DoIPMessageView &msg) {
+    if (!m_serverModel->onDownstreamRequest) {
+        return DoIPDownstreamResult::Error;
+    }
+
+    DoIPAddress targetAddress = msg.getTargetAddress().value_or(ZERO_ADDRESS);
+    std::lock_guard<std::recursive_mutex> lock(m_downstream->mutex);
+    if (m_downstream->connection == nullptr) {
+        return DoIPDownstreamResult::Error;
+    }
+
+    DownstreamTarget &target = m_downstream->targets[targetAddress];
+    if (target.requestId != 0) {
+        // The target answers one request at a time, forward this one when it is done
+        auto [data, size] = msg.getPayload();
+        target.queued.emplace_back(DoIPPayloadType::DiagnosticMessage, ByteArray(data, size));
+        LOG_DOIP_DEBUG("Downstream request to {} queued ({} waiting)", fmt::streamed(targetAddress), target.queued.size());
+        return DoIPDownstreamResult::Pending;
+    }
+    return startDownstreamRequestLocked(msg, targetAddress);
+}
+
+DoIPDownstreamResult DoIPDefaultConnection::startDownstreamRequestLocked(const DoIPMessageView &msg, DoIPAddress targetAddress) {
+    uint32_t requestId = ++m_downstream->lastRequestId;
+    if (requestId == 0) {
+        requestId = ++m_downstream->lastRequestId;
+    }
+    DownstreamTarget &target = m_downstream->targets[targetAddress];
+    target.requestId = requestId;
+    target.started = std::chrono::steady_clock::now();
+
+    // Started before forwarding, since the response may arrive during the call
+    auto timer = m_downstreamTimers.addTimer(targetAddress, m_downstreamResponseTimeout, [this, requestId](DoIPAddress address) {
+        handleDownstreamTimeout(address, requestId);
+    });
+    if (!timer.has_value()) {
+        LOG_DOIP_ERROR("Failed to start downstream response timer for {}", fmt::streamed(targetAddress));
+    }
+
+    std::weak_ptr<DownstreamRequests> downstream = m_downstream;
+    auto handler = [downstream, targetAddress, requestId](const ByteArray &response, DoIPDownstreamResult result) {
+        auto requests = downstream.lock();
+        if (!requests) {
+            return;
+        }
+        std::lock_guard<std::recursive_mutex> lock(requests->mutex);
+        if (requests->connection != nullptr) {
+            requests->connection->completeDownstreamRequestLocked(targetAddress, requestId, response, result);
+        }
+    };
+
+    auto result = m_serverModel->onDownstreamRequest(*this, msg, handler);
+    if (result == DoIPDownstreamResult::Handled) {
+        // No downstream response expected
+        auto it = m_downstream->targets.find(targetAddress);
+        if (it != m_downstream->targets.end() && it->second.requestId == requestId) {
+            finishDownstreamRequestLocked(targetAddress);
+        }
+    } else if (result == DoIPDownstreamResult::Error) {
+        completeDownstreamRequestLocked(targetAddress, requestId, ByteArray{}, DoIPDownstreamResult::Error);
     }
-    return DoIPDownstreamResult::Error;
+    return result;
+}
+
+void DoIPDefaultConnection::completeDownstreamRequestLocked(DoIPAddress targetAddress, uint32_t requestId, const ByteArray &response, DoIPDownstreamResult result) {
+    auto it = m_downstream->targets.find(targetAddress);
+    if (it == m_downstream->targets.end() || it->second.requestId != requestId) {
+        LOG_DOIP_WARN("Dropping downstream response from {} (request timed out or connection closed)", fmt::streamed(targetAddress));
+        return;
+    }
+
+    m_metrics.downstreamLatency().observe(std::chrono::steady_clock::now() - it->second.started);
+
+    // Responses are sent in the order they complete, on behalf of the target
+    DoIPAddress clientAddress = getClientAddress();
+    LOG_DOIP_INFO("Downstream rsp from {}: {} ({})", fmt::streamed(targetAddress), fmt::streamed(response), fmt::streamed(result));
+    if (result == DoIPDownstreamResult::Handled) {
+        sendDiagnosticMessage(targetAddress, clientAddress, response);
+    } else {
+        m_metrics.countNack(DoIPNegativeDiagnosticAck::TargetUnreachable);
+        sendProtocolMessage(message::makeDiagnosticNegativeResponse(targetAddress, clientAddress, DoIPNegativeDiagnosticAck::TargetUnreachable, {}));
+    }
+    finishDownstreamRequestLocked(targetAddress);
+}
+
+void DoIPDefaultConnection::finishDownstreamRequestLocked(DoIPAddress targetAddress) {
+    m_downstreamTimers.removeTimer(targetAddress);
+
+    auto it = m_downstream->targets.find(targetAddress);
+    if (it == m_downstream->targets.end()) {
+        return;
+    }
+    it->second.requestId = 0;
+    if (it->second.queued.empty()) {
+        m_downstream->targets.erase(it);
+        return;
+    }
+
+    DoIPMessage next = std::move(it->second.queued.front());
+    it->second.queued.pop_front();
+    startDownstreamRequestLocked(next, targetAddress);
+}
+
+void DoIPDefaultConnection::handleDownstreamTimeout(DoIPAddress targetAddress, uint32_t requestId) {
+    std::lock_guard<std::recursive_mutex> lock(m_downstream->mutex);
+    if (m_downstream->connection == nullptr) {
+        return;
+    }
+    auto it = m_downstream->targets.find(targetAddress);
+    if (it == m_downstream->targets.end() || it->second.requestId != requestId) {
+        return; // completed in the meantime
+    }
+
+    LOG_DOIP_WARN("Downstream response timeout for target {}", fmt::streamed(targetAddress));
+    m_metrics.countTimerExpiration(ConnectionTimers::DownstreamResponse);
+    completeDownstreamRequestLocked(targetAddress, requestId, ByteArray{}, DoIPDownstreamResult::Error);
+}
+
+void DoIPDefaultConnection::dropDownstreamRequests() {
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_downstream->mutex);
+        m_downstream->connection = nullptr;
+        m_downstream->targets.clear();
+    }
+    m_downstreamTimers.stopAll();
+}
+
+size_t DoIPDefaultConnection::getPendingDownstreamRequestCount() const {
+    std::lock_guard<std::recursive_mutex> lock(m_downstream->mutex);
+    size_t count = 0;
+    for (const auto &[address, target] : m_downstream->targets) {
+        count += (target.requestId != 0 ? 1u : 0u) + target.queued.size();
+    }
+    return count;
 }
 
 void DoIPDefaultConnection::receiveDownstreamResponse(const ByteArray &response, DoIPDownstreamResult result) {
+    std::lock_guard<std::recursive_mutex> lock(m_downstream->mutex);
+
+    // Without a target address, the response belongs to the oldest request in flight
+    const DoIPAddress *oldestTarget = nullptr;
+    uint32_t oldestId = 0;
+    for (const auto &[address, target] : m_downstream->targets) {
+        if (target.requestId != 0 && (oldestTarget == nullptr || target.requestId < oldestId)) {
+            oldestTarget = &address;
+            oldestId = target.requestId;
+        }
+    }
+    if (oldestTarget != nullptr) {
+        completeDownstreamRequestLocked(*oldestTarget, oldestId, response, result);
+        return;
+    }
+
     DoIPAddress sa = getServerAddress();
     DoIPAddress ta = getClientAddress();
     LOG_DOIP_INFO("Downstream rsp: {} ({})", fmt::streamed(response), fmt::streamed(result));
     if (result == DoIPDownstreamResult::Handled) {
-        sendProtocolMessage(message::makeDiagnosticMessage(sa, ta, response));
+        sendDiagnosticMessage(sa, ta, response);
     } else {
+        m_metrics.countNack(DoIPNegativeDiagnosticAck::TargetUnreachable);
         sendProtocolMessage(message::makeDiagnosticNegativeResponse(sa, ta, DoIPNegativeDiagnosticAck::TargetUnreachable, {}));
     }
-    transitionTo(DoIPServerState::RoutingActivated);
 }
 
 } // namespace doip
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "DoIPDownstreamDispatcher.h"
+
+#include "DoIPMessageView.h"
+#include "Logger.h"
+
+#include <cassert>
+
+namespace doip {
+
+DoIPDownstreamDispatcher::DoIPDownstreamDispatcher(DownstreamTransport transport)
+    : m_transport(std::move(transport)) {
+}
+
+DoIPDownstreamDispatcher::~DoIPDownstreamDispatcher() {
+    assert(std::this_thread::get_id() != m_workerId && "A dispatcher must not be destroyed by its transport");
+    stop();
+}
+
+void DoIPDownstreamDispatcher::start() {
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(std::this_thread::get_id() != m_workerId && "start() must not be called by the transport");
+        if (m_running) {
+            return;
+        }
+    }
+
+    // A worker stopped by its own transport may still be finishing its batch
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = true;
+    m_worker = std::thread([this]() { run(); });
+    m_workerId = m_worker.get_id();
+}
+
+void DoIPDownstreamDispatcher::stop() {
+    bool onWorker;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_jobs.clear();
+        onWorker = std::this_thread::get_id() == m_workerId;
+    }
+    m_cv.notify_all();
+
+    // stop() may be called by the transport itself (e.g. via onCloseConnection).
+    // The worker then leaves run() once the transport returns and is joined by
+    // the next start() or the destructor.
+    if (onWorker) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool DoIPDownstreamDispatcher::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+DoIPDownstreamResult DoIPDownstreamDispatcher::submit(DoIPDownstreamRequest request, ServerModelDownstreamResponseHandler callback) {
+    if (!callback) {
+        LOG_DOIP_ERROR("Downstream request without response handler");
+        return DoIPDownstreamResult::Error;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            LOG_DOIP_WARN("Downstream dispatcher not running, dropping request to {}", fmt::streamed(request.targetAddress));
+            return DoIPDownstreamResult::Error;
+        }
+        m_jobs.push_back(Job{std::move(request), std::move(callback)});
+    }
+    m_cv.notify_one();
+    return DoIPDownstreamResult::Pending;
+}
+
+ServerModelDownstreamHandler DoIPDownstreamDispatcher::makeHandler() {
+    return [this](IConnectionContext &ctx, const DoIPMessageView &msg, ServerModelDownstreamResponseHandler callback) {
+        (void)ctx;
+        // Copy, since the view is only valid during this call
+        auto [data, size] = msg.getDiagnosticMessagePayload();
+        DoIPDownstreamRequest request{msg.getSourceAddress().value_or(ZERO_ADDRESS),
+                                      msg.getTargetAddress().value_or(ZERO_ADDRESS),
+                                      ByteArray(data, size)};
+        return submit(std::move(request), std::move(callback));
+    };
+}
+
+size_t DoIPDownstreamDispatcher::pendingRequests() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size();
+}
+
+void DoIPDownstreamDispatcher::run() {
+    std::deque<Job> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+            if (!m_running) {
+                return;
+            }
+            // Take everything queued so far with one lock acquisition
+            batch.swap(m_jobs);
+        }
+
+        for (auto &job : batch) {
+            if (!isRunning()) {
+                break;
+            }
+            LOG_DOIP_DEBUG("Forward downstream request to {}", fmt::streamed(job.request.targetAddress));
+            if (m_transport) {
+                m_transport(job.request, job.callback);
+            } else {
+                job.callback(ByteArray{}, DoIPDownstreamResult::Error);
+            }
+        }
+        batch.clear();
+    }
+}
+
+} // namespace doip
@@ -0,0 +1,245 @@
+#include "DoIPEventLoop.h"
+#include "Logger.h"
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace doip {
+
+namespace {
+
+constexpr int EPOLL_MAX_EVENTS = 64;
+constexpr int EPOLL_TIMEOUT_MS = 100;
+constexpr std::chrono::milliseconds SWEEP_INTERVAL(100);
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+} // namespace
+
+DoIPEventLoop::DoIPEventLoop(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_reactors.emplace_back(std::make_unique<Reactor>());
+    }
+}
+
+DoIPEventLoop::~DoIPEventLoop() {
+    stop();
+}
+
+bool DoIPEventLoop::start() {
+    if (m_running.load()) {
+        return true;
+    }
+
+    for (auto &reactor : m_reactors) {
+        reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        reactor->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (reactor->epollFd < 0 || reactor->wakeFd < 0) {
+            LOG_TCP_ERROR("Failed to create reactor: {}", strerror(errno));
+            stop();
+            return false;
+        }
+
+        // The wake-up eventfd is registered with a null pointer as marker
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        if (epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, reactor->wakeFd, &ev) < 0) {
+            LOG_TCP_ERROR("Failed to register reactor wake-up fd: {}", strerror(errno));
+            stop();
+            return false;
+        }
+    }
+
+    m_running.store(true);
+    for (auto &reactor : m_reactors) {
+        Reactor *r = reactor.get();
+        reactor->thread = std::thread([this, r]() { run(*r); });
+    }
+
+    LOG_TCP_INFO("Event loop started with {} reactor thread(s)", m_reactors.size());
+    return true;
+}
+
+void DoIPEventLoop::stop() {
+    bool wasRunning = m_running.exchange(false);
+
+    for (auto &reactor : m_reactors) {
+        if (reactor->wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t written = write(reactor->wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    for (auto &reactor : m_reactors) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+        if (reactor->epollFd >= 0) {
+            close(reactor->epollFd);
+            reactor->epollFd = -1;
+        }
+        if (reactor->wakeFd >= 0) {
+            close(reactor->wakeFd);
+            reactor->wakeFd = -1;
+        }
+    }
+
+    if (wasRunning) {
+        LOG_TCP_INFO("Event loop stopped");
+    }
+}
+
+bool DoIPEventLoop::addConnection(std::unique_ptr<DoIPConnection> connection) {
+    if (!connection) {
+        return false;
+    }
+
+    if (!setNonBlocking(connection->getSocket())) {
+        LOG_TCP_ERROR("Failed to set socket {} non-blocking: {}", connection->getSocket(), strerror(errno));
+        connection->closeConnection(DoIPCloseReason::SocketError);
+        return false;
+    }
+
+    auto &reactor = *m_reactors[m_nextReactor.fetch_add(1) % m_reactors.size()];
+    bool queued = false;
+    {
+        // Checked under the lock, so a stopping reactor adopts (and closes) every queued connection
+        std::lock_guard<std::mutex> lock(reactor.mutex);
+        if (m_running.load()) {
+            reactor.pending.emplace_back(std::move(connection));
+            queued = true;
+        }
+    }
+    if (!queued) {
+        LOG_TCP_WARN("Event loop not running, closing connection on socket {}", connection->getSocket());
+        connection->closeConnection(DoIPCloseReason::ApplicationRequest);
+        return false;
+    }
+    m_connectionCount.fetch_add(1);
+
+    uint64_t one = 1;
+    if (write(reactor.wakeFd, &one, sizeof(one)) < 0) {
+        LOG_TCP_WARN("Failed to wake reactor: {}", strerror(errno));
+    }
+    return true;
+}
+
+void DoIPEventLoop::run(Reactor &reactor) {
+    LOG_TCP_INFO("Reactor thread started");
+
+    std::array<epoll_event, EPOLL_MAX_EVENTS> events{};
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    while (m_running.load()) {
+        int count = epoll_wait(reactor.epollFd, events.data(), EPOLL_MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_TCP_ERROR("epoll_wait failed: {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            auto *connection = static_cast<DoIPConnection *>(events[static_cast<size_t>(i)].data.ptr);
+            if (connection == nullptr) {
+                uint64_t value = 0;
+                ssize_t readBytes = read(reactor.wakeFd, &value, sizeof(value));
+                (void)readBytes;
+                adoptPending(reactor);
+                continue;
+            }
+
+            // Connection may have been released by an earlier event of this batch
+            if (reactor.connections.find(connection) == reactor.connections.end()) {
+                continue;
+            }
+
+            if (connection->processAvailableTcpData() < 0 || !connection->isSocketActive()) {
+                releaseConnection(reactor, connection);
+            }
+        }
+
+        // Connections may also be closed by their timers -> release them periodically
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= SWEEP_INTERVAL) {
+            releaseClosedConnections(reactor);
+            lastSweep = now;
+        }
+    }
+
+    adoptPending(reactor);
+    while (!reactor.connections.empty()) {
+        releaseConnection(reactor, reactor.connections.begin()->first);
+    }
+
+    LOG_TCP_INFO("Reactor thread stopped");
+}
+
+void DoIPEventLoop::adoptPending(Reactor &reactor) {
+    std::vector<std::unique_ptr<DoIPConnection>> pending;
+    {
+        std::lock_guard<std::mutex> lock(reactor.mutex);
+        pending.swap(reactor.pending);
+    }
+
+    for (auto &connection : pending) {
+        DoIPConnection *raw = connection.get();
+        reactor.connections.emplace(raw, std::move(connection));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = raw;
+        if (!raw->isSocketActive() || epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, raw->getSocket(), &ev) < 0) {
+            LOG_TCP_ERROR("Failed to register connection with reactor: {}", strerror(errno));
+            releaseConnection(reactor, raw);
+            continue;
+        }
+        LOG_TCP_DEBUG("Reactor adopted connection on socket {}", raw->getSocket());
+    }
+}
+
+void DoIPEventLoop::releaseConnection(Reactor &reactor, DoIPConnection *connection) {
+    auto it = reactor.connections.find(connection);
+    if (it == reactor.connections.end()) {
+        return;
+    }
+
+    if (connection->isSocketActive()) {
+        epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, connection->getSocket(), nullptr);
+        connection->closeConnection(DoIPCloseReason::ApplicationRequest);
+    }
+
+    reactor.connections.erase(it);
+    m_connectionCount.fetch_sub(1);
+}
+
+void DoIPEventLoop::releaseClosedConnections(Reactor &reactor) {
+    for (auto it = reactor.connections.begin(); it != reactor.connections.end();) {
+        if (!it->first->isSocketActive()) {
+            it = reactor.connections.erase(it);
+            m_connectionCount.fetch_sub(1);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace doip
@@ -0,0 +1,136 @@
+#include "DoIPFrameDecoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+
+namespace doip {
+
+DoIPFrameDecoder::DoIPFrameDecoder(size_t maxPayloadLength)
+    : m_buffer(2 * (DOIP_HEADER_SIZE + maxPayloadLength)),
+      m_scratch(maxPayloadLength),
+      m_maxPayloadLength(maxPayloadLength) {
+}
+
+ssize_t DoIPFrameDecoder::readFrom(int fd) {
+    size_t free = m_buffer.size() - m_size;
+    if (free == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    size_t tail = (m_head + m_size) % m_buffer.size();
+    size_t first = std::min(free, m_buffer.size() - tail);
+
+    std::array<iovec, 2> iov{};
+    iov[0].iov_base = m_buffer.data() + tail;
+    iov[0].iov_len = first;
+    iov[1].iov_base = m_buffer.data();
+    iov[1].iov_len = free - first;
+
+    ssize_t result = readv(fd, iov.data(), iov[1].iov_len > 0 ? 2 : 1);
+    if (result > 0) {
+        m_size += static_cast<size_t>(result);
+    }
+    return result;
+}
+
+size_t DoIPFrameDecoder::feed(const uint8_t *data, size_t length) {
+    size_t taken = std::min(length, m_buffer.size() - m_size);
+    if (taken == 0) {
+        return 0;
+    }
+
+    size_t tail = (m_head + m_size) % m_buffer.size();
+    size_t first = std::min(taken, m_buffer.size() - tail);
+
+    std::memcpy(m_buffer.data() + tail, data, first);
+    std::memcpy(m_buffer.data(), data + first, taken - first);
+    m_size += taken;
+    return taken;
+}
+
+DoIPDecodeStatus DoIPFrameDecoder::nextFrame(DoIPFrame &frame) {
+    if (m_streamRemaining > 0) {
+        return nextChunk(frame);
+    }
+    if (m_size < DOIP_HEADER_SIZE) {
+        return DoIPDecodeStatus::NeedMoreData;
+    }
+
+    std::array<uint8_t, DOIP_HEADER_SIZE> header{};
+    copyOut(0, header.data(), header.size());
+
+    auto optHeader = DoIPMessage::tryParseHeader(header.data(), header.size());
+    if (!optHeader.has_value()) {
+        return DoIPDecodeStatus::InvalidHeader;
+    }
+    if (optHeader->second > m_maxPayloadLength) {
+        if (!m_streamingEnabled || optHeader->first != DoIPPayloadType::DiagnosticMessage) {
+            return DoIPDecodeStatus::PayloadTooLarge;
+        }
+        consume(DOIP_HEADER_SIZE);
+        m_streamType = optHeader->first;
+        m_streamOffset = 0;
+        m_streamLength = optHeader->second;
+        m_streamRemaining = optHeader->second;
+        return nextChunk(frame);
+    }
+
+    size_t payloadLength = optHeader->second;
+    if (m_size < DOIP_HEADER_SIZE + payloadLength) {
+        return DoIPDecodeStatus::NeedMoreData;
+    }
+
+    size_t payloadStart = (m_head + DOIP_HEADER_SIZE) % m_buffer.size();
+    if (payloadStart + payloadLength <= m_buffer.size()) {
+        frame.payload = m_buffer.data() + payloadStart;
+    } else {
+        copyOut(DOIP_HEADER_SIZE, m_scratch.data(), payloadLength);
+        frame.payload = m_scratch.data();
+    }
+    frame.payloadType = optHeader->first;
+    frame.payloadLength = payloadLength;
+    frame.offset = 0;
+    frame.totalLength = payloadLength;
+
+    consume(DOIP_HEADER_SIZE + payloadLength);
+    return DoIPDecodeStatus::FrameReady;
+}
+
+DoIPDecodeStatus DoIPFrameDecoder::nextChunk(DoIPFrame &frame) {
+    if (m_size == 0) {
+        return DoIPDecodeStatus::NeedMoreData;
+    }
+
+    // Chunks are returned in place, so a chunk ends at the end of the ring
+    size_t length = std::min({m_size, m_buffer.size() - m_head, m_streamRemaining});
+    frame.payloadType = m_streamType;
+    frame.payload = m_buffer.data() + m_head;
+    frame.payloadLength = length;
+    frame.offset = m_streamOffset;
+    frame.totalLength = m_streamLength;
+
+    m_streamOffset += length;
+    m_streamRemaining -= length;
+    consume(length);
+    return DoIPDecodeStatus::ChunkReady;
+}
+
+void DoIPFrameDecoder::copyOut(size_t offset, uint8_t *dest, size_t length) const {
+    size_t start = (m_head + offset) % m_buffer.size();
+    size_t first = std::min(length, m_buffer.size() - start);
+
+    std::memcpy(dest, m_buffer.data() + start, first);
+    std::memcpy(dest + first, m_buffer.data(), length - first);
+}
+
+void DoIPFrameDecoder::consume(size_t length) {
+    m_size -= length;
+    // Restart at the beginning when empty, so subsequent frames are less likely to wrap
+    m_head = m_size == 0 ? 0 : (m_head + length) % m_buffer.size();
+}
+
+} // namespace doip
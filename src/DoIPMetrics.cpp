@@ -0,0 +1,324 @@
+#include "DoIPMetrics.h"
+#include "DoIPDefaultConnection.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace doip {
+
+static_assert(METRICS_TIMER_SLOTS == static_cast<size_t>(ConnectionTimers::UserDefined) + 1,
+              "METRICS_TIMER_SLOTS must cover all ConnectionTimers");
+
+constexpr bool checkPayloadIndices() {
+    for (size_t i = 0; i < METRICS_PAYLOAD_TYPES.size(); ++i) {
+        if (metricsPayloadIndex(METRICS_PAYLOAD_TYPES[i]) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(checkPayloadIndices(), "metricsPayloadIndex must match METRICS_PAYLOAD_TYPES");
+
+namespace {
+
+template <typename T, size_t N>
+void addArray(std::array<T, N> &sum, const std::array<T, N> &other) {
+    for (size_t i = 0; i < N; ++i) {
+        sum[i] += other[i];
+    }
+}
+
+template <size_t N>
+std::array<uint64_t, N> loadArray(const std::array<std::atomic<uint64_t>, N> &counters) {
+    std::array<uint64_t, N> values{};
+    for (size_t i = 0; i < N; ++i) {
+        values[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    return values;
+}
+
+const char *payloadTypeLabel(size_t index) {
+    static constexpr std::array<const char *, METRICS_PAYLOAD_SLOTS> labels = {
+        "NegativeAck",
+        "VehicleIdentificationRequest",
+        "VehicleIdentificationRequestWithEid",
+        "VehicleIdentificationRequestWithVin",
+        "VehicleIdentificationResponse",
+        "RoutingActivationRequest",
+        "RoutingActivationResponse",
+        "AliveCheckRequest",
+        "AliveCheckResponse",
+        "EntityStatusRequest",
+        "EntityStatusResponse",
+        "DiagnosticPowerModeRequest",
+        "DiagnosticPowerModeResponse",
+        "DiagnosticMessage",
+        "DiagnosticMessageAck",
+        "DiagnosticMessageNegativeAck",
+        "PeriodicDiagnosticMessage",
+        "Other"};
+    return labels[index];
+}
+
+// Codes 0 and 1 are reserved and never counted
+const char *nackLabel(size_t index) {
+    static constexpr std::array<const char *, METRICS_NACK_SLOTS> labels = {
+        nullptr,
+        nullptr,
+        "InvalidSourceAddress",
+        "UnknownTargetAddress",
+        "DiagnosticMessageTooLarge",
+        "OutOfMemory",
+        "TargetUnreachable",
+        "UnknownNetwork",
+        "TransportProtocolError",
+        "TargetBusy"};
+    return labels[index];
+}
+
+const char *closeReasonLabel(size_t index) {
+    static constexpr std::array<const char *, METRICS_CLOSE_REASON_SLOTS> labels = {
+        "None",
+        "InitialInactivityTimeout",
+        "GeneralInactivityTimeout",
+        "AliveCheckTimeout",
+        "SocketError",
+        "InvalidMessage",
+        "ApplicationRequest",
+        "RoutingActivationDenied"};
+    return labels[index];
+}
+
+const char *timerLabel(size_t index) {
+    static constexpr std::array<const char *, METRICS_TIMER_SLOTS> labels = {
+        "InitialInactivity",
+        "GeneralInactivity",
+        "AliveCheck",
+        "DownstreamResponse",
+        "UserDefined"};
+    return labels[index];
+}
+
+void writeHeader(std::ostream &os, const char *name, const char *type, const char *help) {
+    os << "# HELP " << name << ' ' << help << '\n'
+       << "# TYPE " << name << ' ' << type << '\n';
+}
+
+template <size_t N>
+void writeLabeledCounter(std::ostream &os, const char *name, const char *help, const char *label,
+                         const std::array<uint64_t, N> &values, const char *(*labelOf)(size_t)) {
+    writeHeader(os, name, "counter", help);
+    for (size_t i = 0; i < N; ++i) {
+        if (const char *value = labelOf(i)) {
+            os << name << '{' << label << "=\"" << value << "\"} " << values[i] << '\n';
+        }
+    }
+}
+
+void writeValue(std::ostream &os, const char *name, const char *type, const char *help, uint64_t value) {
+    writeHeader(os, name, type, help);
+    os << name << ' ' << value << '\n';
+}
+
+void writeHistogram(std::ostream &os, const char *name, const char *help, const LatencyHistogramSnapshot &histogram) {
+    writeHeader(os, name, "histogram", help);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < METRICS_LATENCY_BUCKETS_US.size(); ++i) {
+        cumulative += histogram.buckets[i];
+        os << name << "_bucket{le=\"" << static_cast<double>(METRICS_LATENCY_BUCKETS_US[i]) / 1e6 << "\"} " << cumulative << '\n';
+    }
+    os << name << "_bucket{le=\"+Inf\"} " << histogram.count << '\n'
+       << name << "_sum " << static_cast<double>(histogram.sumNs) / 1e9 << '\n'
+       << name << "_count " << histogram.count << '\n';
+}
+
+} // namespace
+
+LatencyHistogramSnapshot &LatencyHistogramSnapshot::operator+=(const LatencyHistogramSnapshot &other) {
+    addArray(buckets, other.buckets);
+    count += other.count;
+    sumNs += other.sumNs;
+    return *this;
+}
+
+DoIPMetricsSnapshot &DoIPMetricsSnapshot::operator+=(const DoIPMetricsSnapshot &other) {
+    addArray(framesReceived, other.framesReceived);
+    addArray(bytesReceived, other.bytesReceived);
+    addArray(framesSent, other.framesSent);
+    addArray(bytesSent, other.bytesSent);
+    addArray(diagnosticNacks, other.diagnosticNacks);
+    addArray(closeReasons, other.closeReasons);
+    addArray(timerExpirations, other.timerExpirations);
+    connectionsAccepted += other.connectionsAccepted;
+    connectionsRejected += other.connectionsRejected;
+    connectionsActive += other.connectionsActive;
+    udpDatagramsDropped += other.udpDatagramsDropped;
+    udpNacksSuppressed += other.udpNacksSuppressed;
+    diagnosticHandlerLatency += other.diagnosticHandlerLatency;
+    downstreamLatency += other.downstreamLatency;
+    return *this;
+}
+
+void LatencyHistogram::observe(std::chrono::nanoseconds duration) noexcept {
+    uint64_t ns = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+    size_t bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS_US.size() && ns > METRICS_LATENCY_BUCKETS_US[bucket] * 1000) {
+        ++bucket;
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::snapshot() const noexcept {
+    LatencyHistogramSnapshot result;
+    result.buckets = loadArray(m_buckets);
+    result.count = m_count.load(std::memory_order_relaxed);
+    result.sumNs = m_sumNs.load(std::memory_order_relaxed);
+    return result;
+}
+
+DoIPMetricsSnapshot DoIPMetrics::snapshot() const noexcept {
+    DoIPMetricsSnapshot result;
+    result.framesReceived = loadArray(m_framesReceived);
+    result.bytesReceived = loadArray(m_bytesReceived);
+    result.framesSent = loadArray(m_framesSent);
+    result.bytesSent = loadArray(m_bytesSent);
+    result.diagnosticNacks = loadArray(m_diagnosticNacks);
+    result.closeReasons = loadArray(m_closeReasons);
+    result.timerExpirations = loadArray(m_timerExpirations);
+    result.connectionsAccepted = m_connectionsAccepted.load(std::memory_order_relaxed);
+    result.connectionsRejected = m_connectionsRejected.load(std::memory_order_relaxed);
+    result.udpDatagramsDropped = m_udpDatagramsDropped.load(std::memory_order_relaxed);
+    result.udpNacksSuppressed = m_udpNacksSuppressed.load(std::memory_order_relaxed);
+    result.diagnosticHandlerLatency = m_diagnosticHandlerLatency.snapshot();
+    result.downstreamLatency = m_downstreamLatency.snapshot();
+    return result;
+}
+
+void DoIPMetricsRegistry::addConnection(const DoIPMetrics *metrics) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connections.push_back(metrics);
+    m_openConnections.store(m_connections.size(), std::memory_order_relaxed);
+}
+
+void DoIPMetricsRegistry::removeConnection(const DoIPMetrics *metrics) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_connections.begin(), m_connections.end(), metrics);
+    if (it == m_connections.end()) {
+        return;
+    }
+    m_closedConnections += metrics->snapshot();
+    m_connections.erase(it);
+    m_openConnections.store(m_connections.size(), std::memory_order_relaxed);
+}
+
+DoIPMetricsSnapshot DoIPMetricsRegistry::snapshot() const {
+    DoIPMetricsSnapshot result = m_server.snapshot();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result += m_closedConnections;
+    for (const DoIPMetrics *metrics : m_connections) {
+        result += metrics->snapshot();
+    }
+    result.connectionsActive = m_connections.size();
+    return result;
+}
+
+void writePrometheusText(std::ostream &os, const DoIPMetricsSnapshot &snapshot) {
+    writeLabeledCounter(os, "doip_frames_received_total", "DoIP frames received per payload type.",
+                        "payload_type", snapshot.framesReceived, payloadTypeLabel);
+    writeLabeledCounter(os, "doip_bytes_received_total", "DoIP bytes received per payload type, including the header.",
+                        "payload_type", snapshot.bytesReceived, payloadTypeLabel);
+    writeLabeledCounter(os, "doip_frames_sent_total", "DoIP frames sent per payload type.",
+                        "payload_type", snapshot.framesSent, payloadTypeLabel);
+    writeLabeledCounter(os, "doip_bytes_sent_total", "DoIP bytes sent per payload type, including the header.",
+                        "payload_type", snapshot.bytesSent, payloadTypeLabel);
+    writeLabeledCounter(os, "doip_diagnostic_nacks_total", "Diagnostic message negative acknowledgements sent per code.",
+                        "code", snapshot.diagnosticNacks, nackLabel);
+    writeLabeledCounter(os, "doip_connections_closed_total", "TCP connections closed per reason.",
+                        "reason", snapshot.closeReasons, closeReasonLabel);
+    writeLabeledCounter(os, "doip_timer_expirations_total", "Connection timer expirations per timer.",
+                        "timer", snapshot.timerExpirations, timerLabel);
+    writeValue(os, "doip_connections_accepted_total", "counter", "TCP connections accepted.", snapshot.connectionsAccepted);
+    writeValue(os, "doip_connections_rejected_total", "counter", "TCP connections that could not be accepted or served.", snapshot.connectionsRejected);
+    writeValue(os, "doip_connections_active", "gauge", "TCP connections currently open.", snapshot.connectionsActive);
+    writeValue(os, "doip_udp_datagrams_dropped_total", "counter", "UDP datagrams dropped by the per source rate limit.", snapshot.udpDatagramsDropped);
+    writeValue(os, "doip_udp_nacks_suppressed_total", "counter", "UDP negative acknowledgements not sent due to the per source rate limit.", snapshot.udpNacksSuppressed);
+    writeHistogram(os, "doip_diagnostic_handler_duration_seconds", "Time spent in the onDiagnosticMessage handler.",
+                   snapshot.diagnosticHandlerLatency);
+    writeHistogram(os, "doip_downstream_round_trip_seconds", "Time from forwarding a downstream request until its response or timeout.",
+                   snapshot.downstreamLatency);
+}
+
+bool dumpPrometheusToFile(const std::string &path, const DoIPMetricsSnapshot &snapshot) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file) {
+            LOG_DOIP_ERROR("Could not open metrics file {}: {}", tempPath, strerror(errno));
+            return false;
+        }
+        writePrometheusText(file, snapshot);
+        if (!file.flush()) {
+            LOG_DOIP_ERROR("Could not write metrics file {}", tempPath);
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOG_DOIP_ERROR("Could not replace metrics file {}: {}", path, strerror(errno));
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool dumpPrometheusToSocket(const std::string &socketPath, const DoIPMetricsSnapshot &snapshot) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        LOG_DOIP_ERROR("Metrics socket path too long: {}", socketPath);
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        LOG_DOIP_ERROR("Could not create metrics socket: {}", strerror(errno));
+        return false;
+    }
+    if (connect(sock, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+        LOG_DOIP_ERROR("Could not connect to metrics socket {}: {}", socketPath, strerror(errno));
+        close(sock);
+        return false;
+    }
+
+    std::ostringstream text;
+    writePrometheusText(text, snapshot);
+    std::string data = text.str();
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = send(sock, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            LOG_DOIP_ERROR("Could not write to metrics socket {}: {}", socketPath, strerror(errno));
+            close(sock);
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    close(sock);
+    return true;
+}
+
+} // namespace doip
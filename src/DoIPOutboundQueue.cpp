@@ -0,0 +1,286 @@
+#include "DoIPOutboundQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <sys/socket.h>
+
+namespace doip {
+
+namespace {
+
+constexpr uint8_t FLUSH_TIMER = 0;
+
+// Pending data plus the buffers of one message, written with one sendmsg call
+constexpr size_t MAX_WRITE_BUFFERS = 16;
+
+// Corked messages up to this size are copied and held back for coalescing;
+// larger ones are written right away together with the held back data
+constexpr size_t MAX_HELD_MESSAGE_SIZE = 512;
+
+} // namespace
+
+DoIPOutboundQueue::DoIPOutboundQueue(int fd, std::chrono::milliseconds flushDeadline, size_t highWatermark)
+    : m_fd(fd),
+      m_flushDeadline(flushDeadline),
+      m_highWatermark(highWatermark) {
+}
+
+DoIPOutboundQueue::~DoIPOutboundQueue() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+    // Cancels a timer re-armed by a running callback as well; destroying
+    // m_timers then waits for that callback to return
+    m_timers.stopAll();
+}
+
+ssize_t DoIPOutboundQueue::enqueue(const iovec *iov, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += iov[i].iov_len;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        errno = EPIPE;
+        return -1;
+    }
+    // The limit applies to data already queued, so a single message of any size is accepted
+    size_t pending = m_pending.size() - m_offset;
+    if (pending > 0 && pending + total > 4 * m_highWatermark) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    bool empty = pending == 0;
+    bool hold = m_corkDepth > 0 && total <= MAX_HELD_MESSAGE_SIZE && (empty || now - m_heldSince < m_flushDeadline);
+
+    bool ok = true;
+    if (hold || count >= MAX_WRITE_BUFFERS) {
+        if (empty) {
+            m_heldSince = now;
+        }
+        appendLocked(iov, count);
+        if (hold) {
+            armFlushTimerLocked();
+        } else {
+            ok = flushLocked();
+        }
+    } else {
+        ok = writeLocked(iov, count);
+    }
+
+    bool changed = updateCongestionLocked();
+    bool congested = m_congested;
+    lock.unlock();
+
+    if (changed) {
+        notifyCongestion(congested);
+    }
+    return ok ? static_cast<ssize_t>(total) : -1;
+}
+
+void DoIPOutboundQueue::cork() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_corkDepth;
+}
+
+void DoIPOutboundQueue::uncork() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_corkDepth > 0) {
+        --m_corkDepth;
+    }
+    if (m_corkDepth > 0 || m_closed || m_pending.size() == m_offset) {
+        return;
+    }
+
+    flushLocked();
+    bool changed = updateCongestionLocked();
+    bool congested = m_congested;
+    lock.unlock();
+
+    if (changed) {
+        notifyCongestion(congested);
+    }
+}
+
+bool DoIPOutboundQueue::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        return false;
+    }
+
+    bool ok = flushLocked();
+    bool changed = updateCongestionLocked();
+    bool congested = m_congested;
+    lock.unlock();
+
+    if (changed) {
+        notifyCongestion(congested);
+    }
+    return ok;
+}
+
+void DoIPOutboundQueue::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        return;
+    }
+
+    flushLocked();
+    m_closed = true;
+    m_pending.clear();
+    m_offset = 0;
+    m_timers.removeTimer(FLUSH_TIMER);
+}
+
+void DoIPOutboundQueue::setCongestionHandler(OutboundCongestionHandler handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_congestionHandler = std::move(handler);
+}
+
+size_t DoIPOutboundQueue::pendingBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size() - m_offset;
+}
+
+bool DoIPOutboundQueue::isCongested() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_congested;
+}
+
+bool DoIPOutboundQueue::flushLocked() {
+    return writeLocked(nullptr, 0);
+}
+
+bool DoIPOutboundQueue::writeLocked(const iovec *iov, size_t count) {
+    // The pending data first, then the caller's buffers, which are not copied
+    std::array<iovec, MAX_WRITE_BUFFERS> buffers{};
+    size_t bufferCount = 0;
+    size_t pending = m_pending.size() - m_offset;
+    if (pending > 0) {
+        buffers[bufferCount++] = {m_pending.data() + m_offset, pending};
+    }
+    size_t firstCallerBuffer = bufferCount;
+    for (size_t i = 0; i < count; ++i) {
+        if (iov[i].iov_len > 0) {
+            buffers[bufferCount++] = iov[i];
+        }
+    }
+
+    size_t first = 0;
+    size_t written = 0;
+    while (first < bufferCount) {
+        msghdr msg{};
+        msg.msg_iov = &buffers[first];
+        msg.msg_iovlen = bufferCount - first;
+        ssize_t result = sendmsg(m_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN /* || errno == EWOULDBLOCK */) {
+                break;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(result);
+
+        // Skip what was written, the first remaining buffer may be partially written
+        auto remaining = static_cast<size_t>(result);
+        while (remaining > 0 && remaining >= buffers[first].iov_len) {
+            remaining -= buffers[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            buffers[first].iov_base = static_cast<uint8_t *>(buffers[first].iov_base) + remaining;
+            buffers[first].iov_len -= remaining;
+        }
+    }
+
+    m_offset += std::min(written, pending);
+    if (first < bufferCount) {
+        // Only the unsent tail of the caller's buffers is copied
+        if (m_offset == m_pending.size()) {
+            m_pending.clear();
+            m_offset = 0;
+            m_heldSince = std::chrono::steady_clock::now();
+        }
+        size_t tail = std::max(first, firstCallerBuffer);
+        appendLocked(&buffers[tail], bufferCount - tail);
+        // The peer reads slowly, retry later instead of blocking the caller
+        armFlushTimerLocked();
+    }
+
+    if (m_offset == m_pending.size()) {
+        m_pending.clear();
+        m_offset = 0;
+        m_timers.removeTimer(FLUSH_TIMER);
+    } else if (m_offset > m_pending.size() / 2) {
+        m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(m_offset));
+        m_offset = 0;
+    }
+    return true;
+}
+
+void DoIPOutboundQueue::appendLocked(const iovec *iov, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const auto *data = static_cast<const uint8_t *>(iov[i].iov_base);
+        m_pending.insert(m_pending.end(), data, data + iov[i].iov_len);
+    }
+}
+
+void DoIPOutboundQueue::armFlushTimerLocked() {
+    // An expired timer is removed before its callback runs, so a callback
+    // flushing a slow peer arms a new one here
+    if (m_timers.hasTimer(FLUSH_TIMER)) {
+        return;
+    }
+    (void)m_timers.addTimer(FLUSH_TIMER, m_flushDeadline, [this](uint8_t) { onFlushTimer(); });
+}
+
+void DoIPOutboundQueue::onFlushTimer() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        return;
+    }
+
+    flushLocked();
+    bool changed = updateCongestionLocked();
+    bool congested = m_congested;
+    lock.unlock();
+
+    if (changed) {
+        notifyCongestion(congested);
+    }
+}
+
+bool DoIPOutboundQueue::updateCongestionLocked() {
+    size_t pending = m_pending.size() - m_offset;
+    if (!m_congested && pending >= m_highWatermark) {
+        m_congested = true;
+        return true;
+    }
+    // Hysteresis, so the state does not toggle with every message
+    if (m_congested && pending <= m_highWatermark / 2) {
+        m_congested = false;
+        return true;
+    }
+    return false;
+}
+
+void DoIPOutboundQueue::notifyCongestion(bool congested) {
+    OutboundCongestionHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        handler = m_congestionHandler;
+    }
+    if (handler) {
+        handler(congested);
+    }
+}
+
+} // namespace doip
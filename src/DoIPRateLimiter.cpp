@@ -0,0 +1,95 @@
+#include "DoIPRateLimiter.h"
+
+#include <algorithm>
+
+namespace doip {
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+double burstOf(const DoIPRateLimit &limit) {
+    return std::max(limit.burst, 1.0);
+}
+
+} // namespace
+
+DoIPRateLimiter::DoIPRateLimiter(size_t sources, const DoIPRateLimit &datagrams, const DoIPRateLimit &nacks)
+    : m_entries(roundUpToPowerOfTwo(std::max<size_t>(sources, 1))),
+      m_mask(m_entries.size() - 1),
+      m_datagramLimit(datagrams),
+      m_nackLimit(nacks) {
+}
+
+bool DoIPRateLimiter::allowDatagram(uint32_t address, Clock::time_point now) {
+    if (!m_datagramLimit.isEnabled()) {
+        return true;
+    }
+    return take(lookup(address, now).datagrams, m_datagramLimit, now);
+}
+
+bool DoIPRateLimiter::allowNack(uint32_t address, Clock::time_point now) {
+    if (!m_nackLimit.isEnabled()) {
+        return true;
+    }
+    return take(lookup(address, now).nacks, m_nackLimit, now);
+}
+
+DoIPRateLimiter::Entry &DoIPRateLimiter::lookup(uint32_t address, Clock::time_point now) {
+    // Fibonacci hashing spreads neighbouring addresses of a subnet over the table
+    size_t home = static_cast<size_t>((uint64_t{address} * 0x9E3779B97F4A7C15ULL) >> 32) & m_mask;
+    size_t probes = std::min(PROBE_LIMIT, m_entries.size());
+    Entry *oldest = nullptr;
+
+    // Entries are only ever replaced, never emptied, so a source is always
+    // found within the probe window of its home slot
+    for (size_t i = 0; i < probes; ++i) {
+        Entry &entry = m_entries[(home + i) & m_mask];
+        if (!entry.used) {
+            reset(entry, address, now);
+            ++m_sources;
+            return entry;
+        }
+        if (entry.address == address) {
+            entry.lastSeen = now;
+            return entry;
+        }
+        if (oldest == nullptr || entry.lastSeen < oldest->lastSeen) {
+            oldest = &entry;
+        }
+    }
+
+    ++m_evictions;
+    reset(*oldest, address, now);
+    return *oldest;
+}
+
+void DoIPRateLimiter::reset(Entry &entry, uint32_t address, Clock::time_point now) const {
+    // A new source starts with full buckets
+    entry.address = address;
+    entry.used = true;
+    entry.lastSeen = now;
+    entry.datagrams = {burstOf(m_datagramLimit), now};
+    entry.nacks = {burstOf(m_nackLimit), now};
+}
+
+bool DoIPRateLimiter::take(Bucket &bucket, const DoIPRateLimit &limit, Clock::time_point now) {
+    if (now > bucket.refilled) {
+        double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+        bucket.tokens = std::min(burstOf(limit), bucket.tokens + elapsed * limit.ratePerSecond);
+        bucket.refilled = now;
+    }
+    if (bucket.tokens < 1.0) {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+} // namespace doip
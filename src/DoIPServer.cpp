@@ -9,12 +9,50 @@
 #include "DoIPConnection.h"
 #include "DoIPMessage.h"
 #include "DoIPServer.h"
+#include "ProtocolTrace.h"
 #include "DoIPServerModel.h"
 #include "Logger.h"
 #include "MacAddress.h"
 
 using namespace doip;
 
+namespace {
+
+// Identifier offsets in the vehicle identification response payload
+constexpr size_t VEHICLE_IDENTIFICATION_VIN_OFFSET = 0;
+constexpr size_t VEHICLE_IDENTIFICATION_EID_OFFSET = DoIpVin::ID_LENGTH + sizeof(uint16_t);
+
+/**
+ * @brief Required payload length of the requests handled on UDP.
+ *
+ * @return the length, or std::nullopt for payload types not handled on UDP
+ */
+std::optional<uint32_t> udpRequestPayloadLength(DoIPPayloadType type) {
+    switch (type) {
+    case DoIPPayloadType::VehicleIdentificationRequest:
+    case DoIPPayloadType::EntityStatusRequest:
+    case DoIPPayloadType::DiagnosticPowerModeRequest:
+        return 0;
+    case DoIPPayloadType::VehicleIdentificationRequestWithEid:
+        return static_cast<uint32_t>(DoIpEid::ID_LENGTH);
+    case DoIPPayloadType::VehicleIdentificationRequestWithVin:
+        return static_cast<uint32_t>(DoIpVin::ID_LENGTH);
+    default:
+        return std::nullopt;
+    }
+}
+
+// Runs in the same time whether and where the identifiers differ
+bool constantTimeEquals(const uint8_t *a, const uint8_t *b, size_t size) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < size; ++i) {
+        difference = static_cast<uint8_t>(difference | (a[i] ^ b[i]));
+    }
+    return difference == 0;
+}
+
+} // namespace
+
 DoIPServer::~DoIPServer() {
     if (m_running.load()) {
         stop();
@@ -22,9 +60,9 @@ DoIPServer::~DoIPServer() {
 }
 
 DoIPServer::DoIPServer(const ServerConfig &config)
-    : m_config(config) {
-    m_receiveBuf.reserve(DOIP_MAXIMUM_MTU);
-
+    : m_config(config),
+      m_udpRateLimiter(config.udpRateLimitSources, config.udpDatagramLimit, config.udpNackLimit) {
+    updateVehicleIdentificationResponse();
     setLoopbackMode(m_config.loopback);
 
     if (m_config.daemonize) {
@@ -93,10 +131,11 @@ void DoIPServer::stop() {
     m_running.store(false);
 
     // Close sockets to unblock any pending accept/recv calls
-    closeUdpSocket();
     closeTcpSocket();
+    closeUdpSocket();
 
-    // Wait for all threads to finish
+    // Wait for all threads to finish. The TCP listener hands connections to
+    // the event loop, so it must be gone before the event loop is released.
     for (auto &thread : m_workerThreads) {
         if (thread.joinable()) {
             thread.join();
@@ -104,6 +143,11 @@ void DoIPServer::stop() {
     }
     m_workerThreads.clear();
 
+    if (m_eventLoop) {
+        m_eventLoop->stop();
+        m_eventLoop.reset();
+    }
+
     LOG_DOIP_INFO("DoIP Server stopped");
 }
 
@@ -162,7 +206,27 @@ bool DoIPServer::setupTcpSocket() {
  * Closes the socket for this server
  */
 void DoIPServer::closeTcpSocket() {
+    if (m_tcp_sock < 0) {
+        return;
+    }
+    // shutdown() wakes up a listener thread blocked in accept()
+    shutdown(m_tcp_sock, SHUT_RDWR);
     close(m_tcp_sock);
+    m_tcp_sock = -1;
+}
+
+bool DoIPServer::startEventLoop() {
+    if (m_eventLoop) {
+        return true;
+    }
+
+    auto eventLoop = std::make_unique<DoIPEventLoop>(m_config.eventLoopThreads);
+    if (!eventLoop->start()) {
+        LOG_TCP_ERROR("Failed to start event loop");
+        return false;
+    }
+    m_eventLoop = std::move(eventLoop);
+    return true;
 }
 
 bool DoIPServer::setupUdpSocket() {
@@ -232,36 +296,50 @@ bool DoIPServer::setDefaultEid() {
     if (!getFirstMacAddress(mac)) {
         LOG_DOIP_ERROR("Failed to get MAC address, using default EID");
         m_config.eid = DoIpEid::Zero;
+        updateVehicleIdentificationResponse();
         return false;
     }
     // Set EID based on MAC address (last 6 bytes)
     m_config.eid = DoIpEid(mac.data(), m_config.eid.ID_LENGTH);
+    updateVehicleIdentificationResponse();
     return true;
 }
 
 void DoIPServer::setVin(const std::string &VINString) {
 
     m_config.vin = DoIpVin(VINString);
+    updateVehicleIdentificationResponse();
 }
 
 void DoIPServer::setVin(const DoIpVin &vin) {
     m_config.vin = vin;
+    updateVehicleIdentificationResponse();
 }
 
 void DoIPServer::setLogicalGatewayAddress(DoIPAddress logicalAddress) {
     m_config.logicalAddress = logicalAddress;
+    updateVehicleIdentificationResponse();
 }
 
 void DoIPServer::setEid(const uint64_t inputEID) {
     m_config.eid = DoIpEid(inputEID);
+    updateVehicleIdentificationResponse();
 }
 
 void DoIPServer::setGid(const uint64_t inputGID) {
     m_config.gid = DoIpGid(inputGID);
+    updateVehicleIdentificationResponse();
 }
 
 void DoIPServer::setFurtherActionRequired(DoIPFurtherAction furtherActionRequired) {
     m_FurtherActionReq = furtherActionRequired;
+    updateVehicleIdentificationResponse();
+}
+
+void DoIPServer::updateVehicleIdentificationResponse() {
+    auto response = std::make_shared<const DoIPMessage>(message::makeVehicleIdentificationResponse(
+        m_config.vin, m_config.logicalAddress, m_config.eid, m_config.gid, m_FurtherActionReq));
+    std::atomic_store_explicit(&m_vehicleIdentificationResponse, std::move(response), std::memory_order_release);
 }
 
 void DoIPServer::setAnnounceNum(int Num) {
@@ -304,83 +382,152 @@ void DoIPServer::setMulticastGroup(const char *address) const {
     }
 }
 
-ssize_t DoIPServer::sendNegativeUdpAck(DoIPNegativeAck ackCode) {
-    DoIPMessage msg = message::makeNegativeAckMessage(ackCode);
+void DoIPServer::addUdpReply(DoIPUdpBatch &batch, const sockaddr_in &destination, const DoIPMessage &msg) {
+    if (!batch.addReply(destination, msg.data(), msg.size())) {
+        LOG_UDP_ERROR("Dropping UDP reply {} ({} bytes)", fmt::streamed(msg.getPayloadType()), msg.size());
+    }
+}
 
-    return sendUdpResponse(msg);
+void DoIPServer::addNegativeUdpAck(DoIPUdpBatch &batch, const sockaddr_in &destination, DoIPNegativeAck ackCode) {
+    if (!m_udpRateLimiter.allowNack(destination.sin_addr.s_addr, DoIPRateLimiter::Clock::now())) {
+        m_metrics->serverMetrics().countUdpNackSuppressed();
+        return;
+    }
+    addUdpReply(batch, destination, message::makeNegativeAckMessage(ackCode));
 }
 
-// new version starts here
 void DoIPServer::udpListenerThread() {
-    socklen_t client_len = sizeof(m_clientAddress);
+    DoIPUdpBatch batch(m_config.udpBatchSize);
 
-    LOG_UDP_INFO("UDP listener thread started");
+    LOG_UDP_INFO("UDP listener thread started (up to {} datagrams per batch)", batch.capacity());
 
     while (m_running) {
-        ssize_t received = recvfrom(m_udp_sock, m_receiveBuf.data(), sizeof(m_receiveBuf), 0,
-                                    reinterpret_cast<struct sockaddr *>(&m_clientAddress), &client_len);
-
+        int received = batch.receive(m_udp_sock);
         if (received < 0) {
-            if (errno == EAGAIN /* || errno == EWOULDBLOCK*/) {
+            if (errno == EAGAIN || errno == EINTR) {
                 // Timeout, continue
                 continue;
             }
             if (m_running) {
-                perror("recvfrom error");
+                LOG_UDP_ERROR("recvmmsg error: {}", strerror(errno));
             }
             break;
         }
 
-        if (received > 0) {
-            std::scoped_lock lock(m_mutex);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            handleUdpDatagram(batch, i);
+        }
+        sendUdpReplies(batch);
+
+        if (batch.size() > 0) {
+            const sockaddr_in &lastSender = batch.sender(batch.size() - 1);
             char client_ip[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &m_clientAddress.sin_addr, client_ip, sizeof(client_ip));
+            inet_ntop(AF_INET, &lastSender.sin_addr, client_ip, sizeof(client_ip));
+            std::scoped_lock lock(m_mutex);
             m_clientIp = std::string(client_ip);
-            m_clientPort = ntohs(m_clientAddress.sin_port);
-
-            LOG_UDP_INFO("Received {} bytes from {}:{}", received, m_clientIp, m_clientPort);
-
-            auto optHeader = DoIPMessage::tryParseHeader(m_receiveBuf.data(), DOIP_HEADER_SIZE);
-            if (!optHeader.has_value()) {
-                auto sentBytes = sendNegativeUdpAck(DoIPNegativeAck::IncorrectPatternFormat);
-                if (sentBytes < 0) {
-                    if (errno == EAGAIN /*|| errno == EWOULDBLOCK*/) {
-                        usleep(100);
-                        continue;
-                    }
-                    break;
-                }
-            }
-            auto plType = optHeader->first;
-            // auto payloadLength = optHeader->second;
-            LOG_UDP_INFO("RX: {}", fmt::streamed(plType));
-
-            ssize_t sentBytes = 0;
-            switch (plType) {
-            case DoIPPayloadType::VehicleIdentificationRequest: {
-                DoIPMessage msg = message::makeVehicleIdentificationResponse(m_config.vin, m_config.logicalAddress, m_config.eid, m_config.gid);
-                sentBytes = sendUdpResponse(msg);
-            } break;
-
-            default:
-                LOG_DOIP_ERROR("Invalid payload type 0x{:04X} received (receiveUdpMessage())", static_cast<uint16_t>(plType));
-                sentBytes = sendNegativeUdpAck(DoIPNegativeAck::UnknownPayloadType);
-
-            } // switch
-
-            if (sentBytes < 0) {
-                if (errno == EAGAIN /*|| errno == EWOULDBLOCK*/) {
-                    usleep(100);
-                    continue;
-                }
-                break;
-            }
+            m_clientPort = ntohs(lastSender.sin_port);
         }
     }
 
     LOG_UDP_INFO("UDP listener thread stopped");
 }
 
+void DoIPServer::handleUdpDatagram(DoIPUdpBatch &batch, size_t index) {
+    auto [data, size] = batch.datagram(index);
+    const sockaddr_in &sender = batch.sender(index);
+
+    // Checked first, so a flood costs as little as possible
+    if (!m_udpRateLimiter.allowDatagram(sender.sin_addr.s_addr, DoIPRateLimiter::Clock::now())) {
+        m_metrics->serverMetrics().countUdpDropped();
+        return;
+    }
+
+    LOG_UDP_INFO("Received {} bytes from {}:{}", size, inet_ntoa(sender.sin_addr), ntohs(sender.sin_port));
+    ProtocolTrace::instance().record(TraceDirection::Rx, TraceTransport::Udp, 0, data, size);
+
+    auto optHeader = DoIPMessage::tryParseHeader(data, size);
+    if (!optHeader.has_value()) {
+        addNegativeUdpAck(batch, sender, DoIPNegativeAck::IncorrectPatternFormat);
+        return;
+    }
+    auto [plType, payloadLength] = *optHeader;
+    m_metrics->serverMetrics().countReceived(plType, size);
+    LOG_UDP_INFO("RX: {}", fmt::streamed(plType));
+
+    if (batch.isTruncated(index)) {
+        addNegativeUdpAck(batch, sender, DoIPNegativeAck::MessageTooLarge);
+        return;
+    }
+
+    auto expectedLength = udpRequestPayloadLength(plType);
+    if (!expectedLength.has_value()) {
+        LOG_DOIP_ERROR("Invalid payload type 0x{:04X} received (receiveUdpMessage())", static_cast<uint16_t>(plType));
+        addNegativeUdpAck(batch, sender, DoIPNegativeAck::UnknownPayloadType);
+        return;
+    }
+    if (payloadLength != *expectedLength || size != DOIP_HEADER_SIZE + payloadLength) {
+        addNegativeUdpAck(batch, sender, DoIPNegativeAck::InvalidPayloadLength);
+        return;
+    }
+
+    const uint8_t *payload = data + DOIP_HEADER_SIZE;
+    const auto response = getVehicleIdentificationResponse();
+    const DoIPMessage &identification = *response;
+    const uint8_t *identity = identification.data() + DOIP_HEADER_SIZE;
+
+    switch (plType) {
+    case DoIPPayloadType::VehicleIdentificationRequest:
+        addUdpReply(batch, sender, identification);
+        break;
+
+    case DoIPPayloadType::VehicleIdentificationRequestWithEid:
+        // Only the addressed entity answers
+        if (constantTimeEquals(payload, identity + VEHICLE_IDENTIFICATION_EID_OFFSET, DoIpEid::ID_LENGTH)) {
+            addUdpReply(batch, sender, identification);
+        }
+        break;
+
+    case DoIPPayloadType::VehicleIdentificationRequestWithVin:
+        if (constantTimeEquals(payload, identity + VEHICLE_IDENTIFICATION_VIN_OFFSET, DoIpVin::ID_LENGTH)) {
+            addUdpReply(batch, sender, identification);
+        }
+        break;
+
+    case DoIPPayloadType::EntityStatusRequest: {
+        size_t openConnections = std::min<size_t>(m_metrics->openConnections(), UINT8_MAX);
+        addUdpReply(batch, sender, message::makeEntityStatusResponse(m_config.nodeType, m_config.maxConnections,
+                                                                     static_cast<uint8_t>(openConnections), DOIP_MAXIMUM_MTU));
+    } break;
+
+    case DoIPPayloadType::DiagnosticPowerModeRequest:
+        addUdpReply(batch, sender, message::makeDiagnosticPowerModeResponse(getDiagnosticPowerMode()));
+        break;
+
+    default:
+        break;
+    }
+}
+
+void DoIPServer::sendUdpReplies(DoIPUdpBatch &batch) {
+    if (batch.replyCount() == 0) {
+        return;
+    }
+    batch.flush(m_udp_sock);
+
+    for (size_t i = 0; i < batch.replyCount(); ++i) {
+        if (!batch.isReplySent(i)) {
+            continue;
+        }
+        auto [data, size] = batch.reply(i);
+        const sockaddr_in &destination = batch.replyDestination(i);
+        auto payloadType = static_cast<DoIPPayloadType>((static_cast<uint16_t>(data[2]) << 8) | data[3]);
+        ProtocolTrace::instance().record(TraceDirection::Tx, TraceTransport::Udp, 0, data, size);
+        m_metrics->serverMetrics().countSent(payloadType, size);
+        LOG_UDP_INFO("Sent {}: {} bytes to {}:{}",
+                     fmt::streamed(payloadType), size, inet_ntoa(destination.sin_addr), ntohs(destination.sin_port));
+    }
+}
+
 void DoIPServer::udpAnnouncementThread() {
     LOG_DOIP_INFO("Announcement thread started");
 
@@ -394,7 +541,8 @@ void DoIPServer::udpAnnouncementThread() {
 }
 
 ssize_t DoIPServer::sendVehicleAnnouncement() {
-    DoIPMessage msg = message::makeVehicleIdentificationResponse(m_config.vin, m_config.logicalAddress, m_config.eid, m_config.gid);
+    const auto response = getVehicleIdentificationResponse();
+    const DoIPMessage &msg = *response;
 
     struct sockaddr_in dest_addr;
     memset(&dest_addr, 0, sizeof(dest_addr));
@@ -419,6 +567,8 @@ ssize_t DoIPServer::sendVehicleAnnouncement() {
 
     LOG_DOIP_INFO("TX {}", fmt::streamed(msg));
     if (sentBytes > 0) {
+        ProtocolTrace::instance().record(TraceDirection::Tx, TraceTransport::Udp, 0, msg.data(), msg.size());
+        m_metrics->serverMetrics().countSent(msg.getPayloadType(), msg.size());
         LOG_UDP_INFO("Sent Vehicle Announcement: {} bytes to {}:{}",
                      sentBytes, dest_ip, DOIP_UDP_TEST_EQUIPMENT_REQUEST_PORT);
     } else {
@@ -426,17 +576,3 @@ ssize_t DoIPServer::sendVehicleAnnouncement() {
     }
     return sentBytes;
 }
-
-ssize_t DoIPServer::sendUdpResponse(DoIPMessage msg) {
-    auto sentBytes = sendto(m_udp_sock, msg.data(), msg.size(), 0,
-                            reinterpret_cast<struct sockaddr *>(&m_clientAddress), sizeof(m_clientAddress));
-
-    if (sentBytes > 0) {
-        LOG_DOIP_INFO("TX {}", fmt::streamed(msg));
-        LOG_UDP_INFO("Sent UDS response: {} bytes to {}:{}",
-                     sentBytes, m_clientIp, ntohs(m_clientAddress.sin_port));
-    } else {
-        LOG_DOIP_ERROR("Failed to send message: {}", strerror(errno));
-    }
-    return sentBytes;
-}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "DoIPUdpBatch.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace doip {
+
+DoIPUdpBatch::DoIPUdpBatch(size_t capacity)
+    : m_capacity(capacity > 0 ? capacity : 1),
+      m_receiveArena(new uint8_t[m_capacity * DOIP_MAXIMUM_MTU]),
+      m_receiveIov(m_capacity),
+      m_receiveHeaders(m_capacity),
+      m_senders(m_capacity),
+      m_replyArena(new uint8_t[m_capacity * DOIP_UDP_REPLY_MAX_SIZE]),
+      m_replyIov(m_capacity),
+      m_replyHeaders(m_capacity),
+      m_destinations(m_capacity) {
+    for (size_t i = 0; i < m_capacity; ++i) {
+        m_receiveIov[i].iov_base = m_receiveArena.get() + i * DOIP_MAXIMUM_MTU;
+        m_receiveIov[i].iov_len = DOIP_MAXIMUM_MTU;
+        m_replyIov[i].iov_base = m_replyArena.get() + i * DOIP_UDP_REPLY_MAX_SIZE;
+    }
+}
+
+int DoIPUdpBatch::receive(int fd) {
+    m_received = 0;
+    m_replies = 0;
+
+    // recvmmsg() overwrites the address lengths, so the headers are set up again each time
+    for (size_t i = 0; i < m_capacity; ++i) {
+        msghdr &header = m_receiveHeaders[i].msg_hdr;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_name = &m_senders[i];
+        header.msg_namelen = sizeof(sockaddr_in);
+        header.msg_iov = &m_receiveIov[i];
+        header.msg_iovlen = 1;
+        m_receiveHeaders[i].msg_len = 0;
+    }
+
+    int received = recvmmsg(fd, m_receiveHeaders.data(), static_cast<unsigned int>(m_capacity), MSG_WAITFORONE, nullptr);
+    if (received > 0) {
+        m_received = static_cast<size_t>(received);
+    }
+    return received;
+}
+
+ByteArrayRef DoIPUdpBatch::datagram(size_t index) const {
+    return {static_cast<const uint8_t *>(m_receiveIov[index].iov_base), m_receiveHeaders[index].msg_len};
+}
+
+bool DoIPUdpBatch::addReply(const sockaddr_in &destination, const uint8_t *data, size_t size) {
+    if (m_replies >= m_capacity || size > DOIP_UDP_REPLY_MAX_SIZE) {
+        return false;
+    }
+    std::memcpy(m_replyIov[m_replies].iov_base, data, size);
+    m_replyIov[m_replies].iov_len = size;
+    m_destinations[m_replies] = destination;
+
+    msghdr &header = m_replyHeaders[m_replies].msg_hdr;
+    std::memset(&header, 0, sizeof(header));
+    header.msg_name = &m_destinations[m_replies];
+    header.msg_namelen = sizeof(sockaddr_in);
+    header.msg_iov = &m_replyIov[m_replies];
+    header.msg_iovlen = 1;
+    m_replyHeaders[m_replies].msg_len = 0;
+
+    ++m_replies;
+    return true;
+}
+
+ByteArrayRef DoIPUdpBatch::reply(size_t index) const {
+    return {static_cast<const uint8_t *>(m_replyIov[index].iov_base), m_replyIov[index].iov_len};
+}
+
+size_t DoIPUdpBatch::flush(int fd) {
+    size_t sent = 0;
+    size_t next = 0;
+    while (next < m_replies) {
+        int result = sendmmsg(fd, m_replyHeaders.data() + next, static_cast<unsigned int>(m_replies - next), 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // sendmmsg() reports an error only for the first message, skip it
+            LOG_UDP_ERROR("Failed to send UDP reply: {}", strerror(errno));
+            ++next;
+            continue;
+        }
+        sent += static_cast<size_t>(result);
+        next += static_cast<size_t>(result);
+    }
+    return sent;
+}
+
+} // namespace doip
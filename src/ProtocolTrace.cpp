@@ -0,0 +1,329 @@
+#include "ProtocolTrace.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace doip {
+
+namespace {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr auto WRITER_IDLE_INTERVAL = std::chrono::milliseconds(5);
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1024;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void writeBE(uint8_t *dest, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        dest[i] = static_cast<uint8_t>(value >> (8 * (size - 1 - i)));
+    }
+}
+
+uint64_t readBE(const uint8_t *src, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+} // namespace
+
+/**
+ * @brief Single-producer/single-consumer byte ring holding encoded trace records.
+ *
+ * The owning thread appends complete records, the writer thread copies
+ * everything up to the published tail to the file. A record is published
+ * with a single release store, so the writer never sees partial records.
+ */
+class TraceBuffer {
+  public:
+    explicit TraceBuffer(size_t capacity)
+        : m_capacity(roundUpToPowerOfTwo(capacity)),
+          m_mask(m_capacity - 1),
+          m_data(new uint8_t[m_capacity]) {}
+
+    /**
+     * @brief Append a record (producer side).
+     * @return false if the record does not fit into the free space
+     */
+    bool write(const uint8_t *header, size_t headerSize, const iovec *iov, size_t count, size_t payloadSize) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        if (m_capacity - (tail - head) < headerSize + payloadSize) {
+            return false;
+        }
+        copyIn(tail, header, headerSize);
+        tail += headerSize;
+        for (size_t i = 0; i < count; ++i) {
+            copyIn(tail, static_cast<const uint8_t *>(iov[i].iov_base), iov[i].iov_len);
+            tail += iov[i].iov_len;
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Write all published records to the file (consumer side).
+     * @return number of bytes written
+     */
+    size_t drainTo(std::FILE *file) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t available = tail - head;
+        if (available == 0) {
+            return 0;
+        }
+        size_t offset = head & m_mask;
+        size_t first = std::min(available, m_capacity - offset);
+        std::fwrite(m_data.get() + offset, 1, first, file);
+        if (first < available) {
+            std::fwrite(m_data.get(), 1, available - first, file);
+        }
+        m_head.store(tail, std::memory_order_release);
+        return available;
+    }
+
+    /**
+     * @brief Drop all published records (consumer side).
+     */
+    void discard() {
+        m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    void retire() { m_retired.store(true, std::memory_order_release); }
+    bool isRetired() const { return m_retired.load(std::memory_order_acquire); }
+
+  private:
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<uint8_t[]> m_data;
+    std::atomic<bool> m_retired{false};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+
+    void copyIn(size_t position, const uint8_t *src, size_t size) {
+        size_t offset = position & m_mask;
+        size_t first = std::min(size, m_capacity - offset);
+        std::memcpy(m_data.get() + offset, src, first);
+        if (first < size) {
+            std::memcpy(m_data.get(), src + first, size - first);
+        }
+    }
+};
+
+ProtocolTrace &ProtocolTrace::instance() {
+    // Never destroyed: thread-local buffers are retired during static destruction
+    static ProtocolTrace *trace = new ProtocolTrace();
+    return *trace;
+}
+
+bool ProtocolTrace::start(const std::string &path, size_t bufferSize) {
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_writer.joinable()) {
+        LOG_DOIP_WARN("Protocol trace is already running");
+        return false;
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_DOIP_ERROR("Could not open protocol trace file {}: {}", path, strerror(errno));
+        return false;
+    }
+    std::fwrite(PROTOCOL_TRACE_MAGIC, 1, sizeof(PROTOCOL_TRACE_MAGIC), file);
+    m_file = file;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Records pushed after the previous stop() belong to no file
+        for (auto &buffer : m_buffers) {
+            buffer->discard();
+        }
+        m_bufferSize = bufferSize;
+        m_running = true;
+    }
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_writer = std::thread([this]() { run(); });
+    m_enabled.store(true, std::memory_order_release);
+
+    LOG_DOIP_INFO("Protocol trace started: {}", path);
+    return true;
+}
+
+void ProtocolTrace::stop() {
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (!m_writer.joinable()) {
+        return;
+    }
+
+    m_enabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+
+    std::fclose(m_file);
+    m_file = nullptr;
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped > 0) {
+        LOG_DOIP_WARN("Protocol trace stopped, {} records dropped", dropped);
+    } else {
+        LOG_DOIP_INFO("Protocol trace stopped");
+    }
+}
+
+void ProtocolTrace::record(TraceDirection direction, TraceTransport transport, uint32_t connectionId,
+                           const iovec *iov, size_t count, bool continuation) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    size_t payloadSize = 0;
+    for (size_t i = 0; i < count; ++i) {
+        payloadSize += iov[i].iov_len;
+    }
+
+    auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+
+    uint8_t header[PROTOCOL_TRACE_RECORD_HEADER_SIZE];
+    writeBE(header, static_cast<uint64_t>(timestamp.count()), 8);
+    writeBE(header + 8, connectionId, 4);
+    header[12] = static_cast<uint8_t>(direction);
+    header[13] = static_cast<uint8_t>((transport == TraceTransport::Udp ? PROTOCOL_TRACE_FLAG_UDP : 0) |
+                                      (continuation ? PROTOCOL_TRACE_FLAG_CONTINUATION : 0));
+    writeBE(header + 14, payloadSize, 4);
+
+    if (!localBuffer()->write(header, sizeof(header), iov, count, payloadSize)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+TraceBuffer *ProtocolTrace::localBuffer() {
+    struct LocalBuffer {
+        std::shared_ptr<TraceBuffer> buffer;
+
+        explicit LocalBuffer(ProtocolTrace &trace) {
+            std::lock_guard<std::mutex> lock(trace.m_mutex);
+            buffer = std::make_shared<TraceBuffer>(trace.m_bufferSize);
+            trace.m_buffers.push_back(buffer);
+        }
+
+        ~LocalBuffer() {
+            buffer->retire();
+        }
+
+        LocalBuffer(const LocalBuffer &) = delete;
+        LocalBuffer &operator=(const LocalBuffer &) = delete;
+    };
+
+    thread_local LocalBuffer local(*this);
+    return local.buffer.get();
+}
+
+void ProtocolTrace::run() {
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer *> retired;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        // Write outside the lock, so registering a new thread never waits for the disk
+        buffers = m_buffers;
+        bool running = m_running;
+        lock.unlock();
+
+        // Flushed after every pass, so a killed process loses only the last few ms
+        bool wroteData = drainAll(buffers, m_file, retired);
+        if (wroteData || !running) {
+            std::fflush(m_file);
+        }
+        buffers.clear();
+
+        lock.lock();
+        if (!retired.empty()) {
+            m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(),
+                                           [&retired](const std::shared_ptr<TraceBuffer> &buffer) {
+                                               return std::find(retired.begin(), retired.end(), buffer.get()) != retired.end();
+                                           }),
+                            m_buffers.end());
+            retired.clear();
+        }
+        if (!running) {
+            return;
+        }
+        if (!wroteData) {
+            m_cv.wait_for(lock, WRITER_IDLE_INTERVAL, [this]() { return !m_running; });
+        }
+    }
+}
+
+bool ProtocolTrace::drainAll(const std::vector<std::shared_ptr<TraceBuffer>> &buffers, std::FILE *file,
+                             std::vector<TraceBuffer *> &retired) {
+    bool wroteData = false;
+    for (const auto &buffer : buffers) {
+        // Check before draining: a retired buffer receives no more records
+        bool isRetired = buffer->isRetired();
+        wroteData = buffer->drainTo(file) > 0 || wroteData;
+        if (isRetired) {
+            retired.push_back(buffer.get());
+        }
+    }
+    return wroteData;
+}
+
+ProtocolTraceReader::ProtocolTraceReader(const std::string &path) {
+    m_file = std::fopen(path.c_str(), "rb");
+    if (m_file == nullptr) {
+        return;
+    }
+    uint8_t magic[sizeof(PROTOCOL_TRACE_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) ||
+        std::memcmp(magic, PROTOCOL_TRACE_MAGIC, sizeof(magic)) != 0) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+ProtocolTraceReader::~ProtocolTraceReader() {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+std::optional<TraceRecord> ProtocolTraceReader::next() {
+    if (m_file == nullptr) {
+        return std::nullopt;
+    }
+
+    uint8_t header[PROTOCOL_TRACE_RECORD_HEADER_SIZE];
+    if (std::fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        return std::nullopt;
+    }
+
+    TraceRecord record;
+    record.timestampNs = readBE(header, 8);
+    record.connectionId = static_cast<uint32_t>(readBE(header + 8, 4));
+    record.direction = header[12] == 0 ? TraceDirection::Rx : TraceDirection::Tx;
+    record.transport = (header[13] & PROTOCOL_TRACE_FLAG_UDP) != 0 ? TraceTransport::Udp : TraceTransport::Tcp;
+    record.continuation = (header[13] & PROTOCOL_TRACE_FLAG_CONTINUATION) != 0;
+
+    size_t size = readBE(header + 14, 4);
+    record.data.resize(size);
+    if (std::fread(record.data.data(), 1, size, m_file) != size) {
+        return std::nullopt;
+    }
+    return record;
+}
+
+} // namespace doip
@@ -0,0 +1,349 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace doip {
+
+namespace {
+
+constexpr uint32_t handleIndexBits = 32;
+
+} // namespace
+
+TimerWheel &TimerWheel::instance() {
+    // Never destroyed: connections may release their timers during static destruction
+    static TimerWheel *wheel = new TimerWheel();
+    return *wheel;
+}
+
+TimerWheel::TimerWheel() : m_epoch(Clock::now()) {
+    for (auto &level : m_slots) {
+        level.fill(NIL);
+    }
+    m_thread = std::thread([this]() { run(); });
+}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+TimerWheel::TimerHandle TimerWheel::start(std::chrono::milliseconds duration, Callback callback, bool periodic, const void *owner) {
+    if (!callback) {
+        return INVALID_HANDLE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int32_t index;
+    if (!m_freeList.empty()) {
+        index = m_freeList.back();
+        m_freeList.pop_back();
+    } else {
+        index = static_cast<int32_t>(m_entries.size());
+        m_entries.emplace_back();
+    }
+
+    // An empty wheel does not need to catch up with the ticks it slept through
+    if (m_count == 0) {
+        m_currentTick = std::max(m_currentTick, nowTick());
+    }
+
+    Entry &entry = m_entries[static_cast<size_t>(index)];
+    entry.callback = std::move(callback);
+    entry.owner = owner;
+    entry.interval = std::max(duration, std::chrono::milliseconds(0));
+    entry.periodic = periodic;
+
+    arm(index, expiryTick(entry.interval));
+    ++m_count;
+
+    if (entry.expiry < m_wakeTick) {
+        m_cv.notify_one();
+    }
+
+    return (static_cast<TimerHandle>(entry.generation) << handleIndexBits) | static_cast<TimerHandle>(index + 1);
+}
+
+bool TimerWheel::restart(TimerHandle handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry *entry = lookup(handle);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    auto index = static_cast<int32_t>((handle & 0xFFFFFFFFu) - 1);
+    if (entry->state == EntryState::Armed) {
+        unlink(index);
+    } else {
+        // Restarted from within its own callback
+        ++m_count;
+    }
+
+    arm(index, expiryTick(entry->interval));
+    if (entry->expiry < m_wakeTick) {
+        m_cv.notify_one();
+    }
+    return true;
+}
+
+bool TimerWheel::cancel(TimerHandle handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry *entry = lookup(handle);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    auto index = static_cast<int32_t>((handle & 0xFFFFFFFFu) - 1);
+    if (entry->state == EntryState::Armed) {
+        unlink(index);
+        --m_count;
+    }
+    release(index);
+    return true;
+}
+
+bool TimerWheel::isActive(TimerHandle handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry *entry = lookup(handle);
+    return entry != nullptr && entry->state == EntryState::Armed;
+}
+
+void TimerWheel::waitForCallbacks(const void *owner) {
+    if (owner == nullptr || std::this_thread::get_id() == m_thread.get_id()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_callbackDone.wait(lock, [this, owner]() { return m_runningOwner != owner; });
+}
+
+size_t TimerWheel::timerCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+void TimerWheel::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable() && std::this_thread::get_id() != m_thread.get_id()) {
+        m_thread.join();
+    }
+}
+
+void TimerWheel::run() {
+    std::vector<TimerHandle> expired;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_running) {
+        uint64_t now = nowTick();
+        if (m_count == 0) {
+            m_currentTick = std::max(m_currentTick, now + 1);
+        }
+        while (m_currentTick <= now) {
+            processTick(m_currentTick, expired);
+            ++m_currentTick;
+        }
+
+        if (!expired.empty()) {
+            m_wakeTick = 0; // timers started by callbacks must not notify
+            for (auto handle : expired) {
+                fire(handle, lock);
+            }
+            expired.clear();
+            continue;
+        }
+
+        m_wakeTick = computeWakeTick();
+        if (m_wakeTick == UINT64_MAX) {
+            m_cv.wait(lock);
+        } else {
+            m_cv.wait_until(lock, m_epoch + std::chrono::milliseconds(m_wakeTick));
+        }
+    }
+}
+
+uint64_t TimerWheel::nowTick() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_epoch).count();
+    return static_cast<uint64_t>(elapsed);
+}
+
+uint64_t TimerWheel::expiryTick(std::chrono::milliseconds duration) const {
+    // The current tick has already begun, so round up to never expire early
+    return nowTick() + 1 + static_cast<uint64_t>(duration.count());
+}
+
+uint64_t TimerWheel::computeWakeTick() const {
+    if (m_count == 0) {
+        return UINT64_MAX;
+    }
+
+    // Level 0 holds all timers expiring within the next SLOTS ticks
+    for (uint64_t tick = m_currentTick; tick < m_currentTick + SLOTS; ++tick) {
+        if (m_slots[0][tick & SLOT_MASK] != NIL) {
+            return tick;
+        }
+    }
+
+    // Otherwise wake up at the next boundary which has something to cascade
+    uint64_t boundary = (m_currentTick + SLOT_MASK) & ~SLOT_MASK;
+    for (size_t i = 0; i < SLOTS; ++i, boundary += SLOTS) {
+        for (size_t level = 1; level < LEVELS; ++level) {
+            uint64_t slot = (boundary >> (SLOT_BITS * level)) & SLOT_MASK;
+            if (m_slots[level][slot] != NIL) {
+                return boundary;
+            }
+            if (slot != 0) {
+                break;
+            }
+        }
+    }
+    return boundary;
+}
+
+void TimerWheel::processTick(uint64_t tick, std::vector<TimerHandle> &expired) {
+    if ((tick & SLOT_MASK) == 0) {
+        // Cascade from the highest affected level down, so entries can move through several levels
+        size_t levels = 1;
+        while (levels < LEVELS - 1 && ((tick >> (SLOT_BITS * levels)) & SLOT_MASK) == 0) {
+            ++levels;
+        }
+        for (size_t level = levels; level >= 1; --level) {
+            cascade(level, (tick >> (SLOT_BITS * level)) & SLOT_MASK);
+        }
+    }
+
+    auto &head = m_slots[0][tick & SLOT_MASK];
+    int32_t index = head;
+    head = NIL;
+    while (index != NIL) {
+        Entry &entry = m_entries[static_cast<size_t>(index)];
+        int32_t next = entry.next;
+        if (entry.expiry > tick) {
+            link(index);
+        } else {
+            entry.state = EntryState::Firing;
+            entry.prev = entry.next = NIL;
+            --m_count;
+            expired.push_back((static_cast<TimerHandle>(entry.generation) << handleIndexBits) | static_cast<TimerHandle>(index + 1));
+        }
+        index = next;
+    }
+}
+
+void TimerWheel::cascade(size_t level, size_t slot) {
+    auto &head = m_slots[level][slot];
+    int32_t index = head;
+    head = NIL;
+    while (index != NIL) {
+        int32_t next = m_entries[static_cast<size_t>(index)].next;
+        link(index);
+        index = next;
+    }
+}
+
+void TimerWheel::fire(TimerHandle handle, std::unique_lock<std::mutex> &lock) {
+    Entry *entry = lookup(handle);
+    if (entry == nullptr || entry->state != EntryState::Firing) {
+        return;
+    }
+
+    // Copy, since the callback may cancel its own timer
+    Callback callback = entry->callback;
+    m_runningOwner = entry->owner;
+
+    lock.unlock();
+    try {
+        callback();
+    } catch (...) {
+        // Swallow exceptions to keep the wheel thread alive
+    }
+    lock.lock();
+
+    m_runningOwner = nullptr;
+    m_callbackDone.notify_all();
+
+    entry = lookup(handle);
+    if (entry == nullptr || entry->state != EntryState::Firing) {
+        return; // cancelled or restarted by the callback
+    }
+
+    auto index = static_cast<int32_t>((handle & 0xFFFFFFFFu) - 1);
+    if (entry->periodic) {
+        // Scheduled relative to the last expiry to avoid drift
+        uint64_t interval = std::max<uint64_t>(1, static_cast<uint64_t>(entry->interval.count()));
+        arm(index, entry->expiry + interval);
+        ++m_count;
+    } else {
+        release(index);
+    }
+}
+
+TimerWheel::Entry *TimerWheel::lookup(TimerHandle handle) {
+    return const_cast<Entry *>(static_cast<const TimerWheel *>(this)->lookup(handle));
+}
+
+const TimerWheel::Entry *TimerWheel::lookup(TimerHandle handle) const {
+    uint64_t slot = handle & 0xFFFFFFFFu;
+    if (slot == 0 || slot > m_entries.size()) {
+        return nullptr;
+    }
+    const Entry &entry = m_entries[slot - 1];
+    if (entry.state == EntryState::Free || entry.generation != static_cast<uint32_t>(handle >> handleIndexBits)) {
+        return nullptr;
+    }
+    return &entry;
+}
+
+void TimerWheel::link(int32_t index) {
+    Entry &entry = m_entries[static_cast<size_t>(index)];
+    uint64_t delta = entry.expiry - m_currentTick;
+
+    size_t level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    size_t slot = (entry.expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+
+    entry.level = static_cast<uint8_t>(level);
+    entry.slot = static_cast<uint8_t>(slot);
+    entry.prev = NIL;
+    entry.next = m_slots[level][slot];
+    if (entry.next != NIL) {
+        m_entries[static_cast<size_t>(entry.next)].prev = index;
+    }
+    m_slots[level][slot] = index;
+}
+
+void TimerWheel::unlink(int32_t index) {
+    Entry &entry = m_entries[static_cast<size_t>(index)];
+    if (entry.prev != NIL) {
+        m_entries[static_cast<size_t>(entry.prev)].next = entry.next;
+    } else {
+        m_slots[entry.level][entry.slot] = entry.next;
+    }
+    if (entry.next != NIL) {
+        m_entries[static_cast<size_t>(entry.next)].prev = entry.prev;
+    }
+    entry.prev = entry.next = NIL;
+}
+
+void TimerWheel::release(int32_t index) {
+    Entry &entry = m_entries[static_cast<size_t>(index)];
+    entry.callback = nullptr;
+    entry.owner = nullptr;
+    entry.state = EntryState::Free;
+    ++entry.generation; // invalidates outstanding handles
+    m_freeList.push_back(index);
+}
+
+void TimerWheel::arm(int32_t index, uint64_t expiry) {
+    Entry &entry = m_entries[static_cast<size_t>(index)];
+    entry.expiry = std::max(expiry, m_currentTick);
+    entry.state = EntryState::Armed;
+    link(index);
+}
+
+} // namespace doip
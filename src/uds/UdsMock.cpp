@@ -3,41 +3,79 @@
 
 namespace doip::uds {
 
+namespace {
+
+template <typename Buffer>
+void writeNegativeResponse(Buffer &buffer, size_t sidOffset, uint8_t sid, UdsResponseCode responseCode) {
+    buffer.resize(sidOffset);
+    buffer.emplace_back(0x7F);                               // Negative response indicator
+    buffer.emplace_back(sid);                                // Original service ID
+    buffer.emplace_back(static_cast<uint8_t>(responseCode)); // NRC
+}
+
+} // namespace
+
 ByteArray UdsMock::handleDiagnosticRequest(const ByteArray &request) const {
     if (request.empty())
         return {};
+    ByteArray response;
+    dispatch(request, response, 0);
+    return response;
+}
+
+DoIPMessage UdsMock::handleDiagnosticMessage(const DoIPAddress &sa, const DoIPAddress &ta, const ByteArray &request) const {
+    auto header = DoIPMessage::makeHeader(DoIPPayloadType::DiagnosticMessage, 0);
+    DoIPMessageBuffer frame;
+    frame.append(header.data(), header.size());
+    frame.writeU16BE(ta);
+    frame.writeU16BE(sa);
+    if (!request.empty()) {
+        dispatch(request, frame, frame.size());
+    }
+    return DoIPMessage::fromBuffer(std::move(frame));
+}
+
+template <typename Buffer>
+void UdsMock::dispatch(const ByteArray &request, Buffer &buffer, size_t sidOffset) const {
     uint8_t sid = request[0];
     UdsService service = static_cast<UdsService>(sid);
 
     const UdsServiceDescriptor *desc = findServiceDescriptor(service);
     if (!desc) {
-        return makeResponse(request, UdsResponseCode::ServiceNotSupported, {});
+        writeNegativeResponse(buffer, sidOffset, sid, UdsResponseCode::ServiceNotSupported);
+        return;
     }
 
     if (request.size() < desc->minReqLength || request.size() > desc->maxReqLength) {
         std::cerr << "UdsMock: Request length " << request.size()
                   << " out of bounds for service 0x" << std::hex << static_cast<int>(service) << std::dec
                   << " (expected " << desc->minReqLength << "-" << desc->maxReqLength << ")\n";
-        return makeResponse(request, UdsResponseCode::IncorrectMessageLengthOrInvalidFormat);
+        writeNegativeResponse(buffer, sidOffset, sid, UdsResponseCode::IncorrectMessageLengthOrInvalidFormat);
+        return;
     }
 
-    UdsResponse resp = {UdsResponseCode::ServiceNotSupported, {}};
-    auto it = m_handlers.find(sid);
-    if (it != m_handlers.end() && it->second) {
-        resp = it->second->handle(request);
-    } else {
-        return makeResponse(request, UdsResponseCode::ServiceNotSupported);
+    const UdsServiceWriterFunction &handler = m_handlers[sid];
+    if (!handler) {
+        writeNegativeResponse(buffer, sidOffset, sid, UdsResponseCode::ServiceNotSupported);
+        return;
     }
 
-    auto rspSize = resp.second.size() + 1; // +1 for the SID
+    buffer.emplace_back(static_cast<uint8_t>(sid + UDS_POSITIVE_RESPONSE_OFFSET)); // Positive response SID
+    UdsResponseWriter writer(buffer, sidOffset);
+    UdsResponseCode responseCode = handler(request, writer);
+
+    auto rspSize = writer.size() + 1; // +1 for the SID
     if (rspSize < desc->minRspLength || rspSize > desc->maxRspLength) {
-        std::cerr << "UdsMock: Response length " << resp.second.size()
+        std::cerr << "UdsMock: Response length " << writer.size()
                   << " out of bounds for service 0x" << std::hex << static_cast<int>(service) << std::dec
                   << " (expected " << desc->minRspLength << "-" << desc->maxRspLength << ")\n";
-        return makeResponse(request, UdsResponseCode::GeneralProgrammingFailure, {});
+        writeNegativeResponse(buffer, sidOffset, sid, UdsResponseCode::GeneralProgrammingFailure);
+        return;
     }
 
-    return makeResponse(request, resp.first, resp.second);
+    if (responseCode != UdsResponseCode::OK) {
+        writeNegativeResponse(buffer, sidOffset, sid, responseCode);
+    }
 }
 
 void UdsMock::registerDiagnosticSessionControlHandler(std::function<UdsResponse(uint8_t)> handler) {
@@ -61,6 +99,14 @@ void UdsMock::registerReadDataByIdentifierHandler(std::function<UdsResponse(uint
     });
 }
 
+void UdsMock::registerReadDataByIdentifierHandler(std::function<UdsResponseCode(uint16_t, UdsResponseWriter &)> handler) {
+    registerService(UdsService::ReadDataByIdentifier, [handler = std::move(handler)](const ByteArray &req, UdsResponseWriter &writer) {
+        uint16_t did = (static_cast<uint16_t>(req[1]) << 8) | req[2];
+        writer.writeU16BE(did);
+        return handler(did, writer);
+    });
+}
+
 void UdsMock::registerWriteDataByIdentifierHandler(std::function<UdsResponse(uint16_t, ByteArray)> handler) {
     registerService(UdsService::WriteDataByIdentifier, [handler = std::move(handler)](const ByteArray &req) -> UdsResponse {
         uint16_t did = (static_cast<uint16_t>(req[1]) << 8) | req[2];
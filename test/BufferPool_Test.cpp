@@ -0,0 +1,136 @@
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+
+#include "BufferPool.h"
+#include "ByteArray.h"
+
+using namespace doip;
+
+TEST_SUITE("BufferPool") {
+    TEST_CASE("Size classes") {
+        CHECK(BufferPool::sizeClass(0) == 0);
+        CHECK(BufferPool::sizeClass(1) == 0);
+        CHECK(BufferPool::sizeClass(64) == 0);
+        CHECK(BufferPool::sizeClass(65) == 1);
+        CHECK(BufferPool::sizeClass(4095) == 6);
+        CHECK(BufferPool::sizeClass(BufferPool::MAX_BLOCK_SIZE) == BufferPool::SIZE_CLASSES - 1);
+        CHECK(BufferPool::sizeClass(BufferPool::MAX_BLOCK_SIZE + 1) == BufferPool::SIZE_CLASSES);
+        CHECK(BufferPool::blockSize(BufferPool::sizeClass(100)) == 128);
+    }
+
+    TEST_CASE("Freed blocks are reused by the same thread") {
+        BufferPool &pool = BufferPool::instance();
+        void *first = pool.allocate(100);
+        REQUIRE(first != nullptr);
+        pool.deallocate(first, 100);
+
+        BufferPoolStats before = pool.stats();
+        // Same size class, so the cached block is returned
+        void *second = pool.allocate(120);
+        BufferPoolStats after = pool.stats();
+        CHECK(second == first);
+        CHECK(after.hits == before.hits + 1);
+        CHECK(after.misses == before.misses);
+        pool.deallocate(second, 120);
+    }
+
+    TEST_CASE("Oversized requests bypass the pool") {
+        BufferPool &pool = BufferPool::instance();
+        BufferPoolStats before = pool.stats();
+        void *p = pool.allocate(BufferPool::MAX_BLOCK_SIZE + 1);
+        REQUIRE(p != nullptr);
+        pool.deallocate(p, BufferPool::MAX_BLOCK_SIZE + 1);
+        BufferPoolStats after = pool.stats();
+        CHECK(after.oversized == before.oversized + 1);
+        CHECK(after.hits == before.hits);
+        CHECK(after.misses == before.misses);
+    }
+
+    TEST_CASE("Thread cache overflows into the global free lists") {
+        BufferPool &pool = BufferPool::instance();
+        const size_t blocks = 2 * BufferPool::THREAD_CACHE_BLOCKS;
+        std::vector<void *> allocated;
+        for (size_t i = 0; i < blocks; ++i) {
+            allocated.push_back(pool.allocate(2000));
+        }
+        BufferPoolStats before = pool.stats();
+        for (void *p : allocated) {
+            pool.deallocate(p, 2000);
+        }
+        CHECK(pool.stats().globalTransfers > before.globalTransfers);
+        CHECK(pool.globalFreeBlocks() >= BufferPool::THREAD_CACHE_BLOCKS / 2);
+
+        // Everything is served from the pool again
+        before = pool.stats();
+        for (auto &p : allocated) {
+            p = pool.allocate(2000);
+        }
+        CHECK(pool.stats().misses == before.misses);
+        for (void *p : allocated) {
+            pool.deallocate(p, 2000);
+        }
+    }
+
+    TEST_CASE("Blocks may be freed by another thread") {
+        BufferPool &pool = BufferPool::instance();
+        std::vector<void *> allocated;
+        for (int i = 0; i < 8; ++i) {
+            allocated.push_back(pool.allocate(256));
+        }
+
+        pool.trim();
+        std::thread([&pool, &allocated]() noexcept {
+            for (void *p : allocated) {
+                pool.deallocate(p, 256);
+            }
+        }).join();
+
+        // The exited thread returned its cache to the global free lists
+        CHECK(pool.globalFreeBlocks() == allocated.size());
+        BufferPoolStats before = pool.stats();
+        void *p = pool.allocate(256);
+        CHECK(pool.stats().misses == before.misses);
+        pool.deallocate(p, 256);
+    }
+
+    TEST_CASE("Counters of exited threads are kept") {
+        BufferPool &pool = BufferPool::instance();
+        BufferPoolStats before = pool.stats();
+        std::thread([&pool]() {
+            for (int i = 0; i < 10; ++i) {
+                pool.deallocate(pool.allocate(64), 64);
+            }
+        }).join();
+        BufferPoolStats after = pool.stats();
+        CHECK(after.hits + after.misses == before.hits + before.misses + 10);
+    }
+
+    TEST_CASE("PoolAllocator in standard containers") {
+        std::vector<uint32_t, PoolAllocator<uint32_t>> values;
+        for (uint32_t i = 0; i < 5000; ++i) {
+            values.push_back(i);
+        }
+        CHECK(values.size() == 5000);
+        CHECK(values[4999] == 4999);
+
+        std::vector<uint32_t, PoolAllocator<uint32_t>> other(values);
+        values.swap(other);
+        CHECK(values == other);
+        CHECK(PoolAllocator<uint8_t>() == PoolAllocator<uint32_t>());
+    }
+
+#if DOIP_USE_BUFFER_POOL
+    TEST_CASE("ByteArray buffers come from the pool") {
+        BufferPool &pool = BufferPool::instance();
+        { ByteArray warmUp{0x00}; }
+
+        BufferPoolStats before = pool.stats();
+        ByteArray data{0x01, 0x02};
+        data.writeU32BE(0xDEADBEEF);
+        BufferPoolStats after = pool.stats();
+        CHECK(after.hits + after.misses > before.hits + before.misses);
+        CHECK(data.readU32BE(2) == 0xDEADBEEF);
+    }
+#endif
+}
@@ -2,6 +2,8 @@
 #include "ByteArray.h"
 #include <sstream>
 #include <algorithm>
+#include <numeric>
+#include <vector>
 
 using namespace doip;
 
@@ -180,3 +182,20 @@ TEST_SUITE("ByteArray Stream Operator") {
         CHECK(oss.str() == "00.11.22.33.44.55");
     }
 }
+
+TEST_SUITE("ByteArray Conversion") {
+
+    TEST_CASE("Converts to and from std::vector<uint8_t>") {
+        std::vector<uint8_t> bytes{0x62, 0xF1, 0x90};
+        ByteArray arr(bytes);
+        CHECK(arr == ByteArray{0x62, 0xF1, 0x90});
+
+        std::vector<uint8_t> copy = arr;
+        CHECK(copy == bytes);
+
+        auto sum = [](const std::vector<uint8_t> &v) {
+            return std::accumulate(v.begin(), v.end(), 0);
+        };
+        CHECK(sum(arr) == 0x62 + 0xF1 + 0x90);
+    }
+}
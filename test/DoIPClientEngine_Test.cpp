@@ -0,0 +1,342 @@
+#include <doctest/doctest.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "DoIPClientEngine.h"
+#include "DoIPMessage.h"
+#include "doctest_aux.h"
+
+using namespace doip;
+using namespace doip::test;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr DoIPAddress ENTITY_ADDRESS = 0x1000;
+constexpr size_t LARGE_RESPONSE_LENGTH = 3 * DOIP_MAXIMUM_MTU;
+
+void sendMessage(int fd, const DoIPMessage &msg) {
+    ssize_t written = send(fd, msg.data(), msg.size(), MSG_NOSIGNAL);
+    (void)written;
+}
+
+/**
+ * @brief Minimal DoIP entity on an ephemeral loopback port, one thread per connection.
+ *
+ * Activates routing for any tester and answers by SID:
+ * 0x22 with "response pending" followed by 62 F1 90 <tester address low byte>,
+ * 0x10 with a TargetUnreachable NACK, 0x31 not at all, 0x19 only after 200 ms,
+ * 0x11 with a NACK from another address followed by 0x51, 0x23 with 63 followed by
+ * LARGE_RESPONSE_LENGTH bytes, all others with SID + 0x40.
+ */
+class FakeDoIPEntity {
+  public:
+    explicit FakeDoIPEntity(uint8_t routingActivationCode = 0x10) : m_routingActivationCode(routingActivationCode) {
+        m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(m_listenFd >= 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(bind(m_listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+        REQUIRE(listen(m_listenFd, 128) == 0);
+        socklen_t length = sizeof(address);
+        REQUIRE(getsockname(m_listenFd, reinterpret_cast<sockaddr *>(&address), &length) == 0);
+        m_port = ntohs(address.sin_port);
+        m_acceptThread = std::thread([this]() { acceptConnections(); });
+    }
+
+    ~FakeDoIPEntity() {
+        shutdown(m_listenFd, SHUT_RDWR);
+        m_acceptThread.join();
+        close(m_listenFd);
+        for (auto &thread : m_connections) {
+            thread.join();
+        }
+    }
+
+    uint16_t port() const { return m_port; }
+    size_t acceptedCount() const { return m_accepted.load(); }
+
+  private:
+    int m_listenFd{-1};
+    uint16_t m_port{0};
+    uint8_t m_routingActivationCode;
+    std::atomic<size_t> m_accepted{0};
+    std::thread m_acceptThread;
+    std::vector<std::thread> m_connections;
+
+    void acceptConnections() {
+        int fd;
+        while ((fd = accept(m_listenFd, nullptr, nullptr)) >= 0) {
+            ++m_accepted;
+            m_connections.emplace_back([this, fd]() { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        while (auto msg = readMessage(fd)) {
+            if (msg->getPayloadType() == DoIPPayloadType::RoutingActivationRequest) {
+                DoIPAddress tester = msg->getSourceAddress().value_or(ZERO_ADDRESS);
+                ByteArray payload{static_cast<uint8_t>(tester >> 8), static_cast<uint8_t>(tester & 0xFF),
+                                  static_cast<uint8_t>(ENTITY_ADDRESS >> 8), static_cast<uint8_t>(ENTITY_ADDRESS & 0xFF),
+                                  m_routingActivationCode, 0, 0, 0, 0};
+                sendMessage(fd, DoIPMessage(DoIPPayloadType::RoutingActivationResponse, payload));
+                continue;
+            }
+            if (msg->getPayloadType() != DoIPPayloadType::DiagnosticMessage) {
+                continue;
+            }
+
+            DoIPAddress tester = msg->getSourceAddress().value_or(ZERO_ADDRESS);
+            DoIPAddress target = msg->getTargetAddress().value_or(ZERO_ADDRESS);
+            auto [data, size] = msg->getDiagnosticMessagePayload();
+            ByteArray request(data, size);
+            uint8_t sid = request.empty() ? 0 : request[0];
+            if (sid == 0x10) {
+                ByteArray nack{static_cast<uint8_t>(target >> 8), static_cast<uint8_t>(target & 0xFF),
+                               static_cast<uint8_t>(tester >> 8), static_cast<uint8_t>(tester & 0xFF),
+                               static_cast<uint8_t>(DoIPNegativeDiagnosticAck::TargetUnreachable)};
+                sendMessage(fd, DoIPMessage(DoIPPayloadType::DiagnosticMessageNegativeAck, nack));
+                continue;
+            }
+            sendMessage(fd, message::makeDiagnosticPositiveResponse(target, tester, request));
+            if (sid == 0x31) {
+                continue;
+            }
+            if (sid == 0x19) {
+                std::this_thread::sleep_for(200ms);
+            }
+            if (sid == 0x23) {
+                ByteArray response{0x63};
+                for (size_t i = 1; i <= LARGE_RESPONSE_LENGTH; ++i) {
+                    response.push_back(static_cast<uint8_t>(i));
+                }
+                sendMessage(fd, message::makeDiagnosticMessage(target, tester, response));
+                continue;
+            }
+            if (sid == 0x11) {
+                DoIPAddress other = static_cast<DoIPAddress>(target + 1);
+                ByteArray nack{static_cast<uint8_t>(other >> 8), static_cast<uint8_t>(other & 0xFF),
+                               static_cast<uint8_t>(tester >> 8), static_cast<uint8_t>(tester & 0xFF),
+                               static_cast<uint8_t>(DoIPNegativeDiagnosticAck::TargetUnreachable)};
+                sendMessage(fd, DoIPMessage(DoIPPayloadType::DiagnosticMessageNegativeAck, nack));
+            }
+            if (sid == 0x22) {
+                sendMessage(fd, message::makeDiagnosticMessage(target, tester, ByteArray{0x7F, 0x22, 0x78}));
+                std::this_thread::sleep_for(5ms);
+                sendMessage(fd, message::makeDiagnosticMessage(target, tester, ByteArray{0x62, 0xF1, 0x90, static_cast<uint8_t>(tester & 0xFF)}));
+                continue;
+            }
+            sendMessage(fd, message::makeDiagnosticMessage(target, tester, ByteArray{static_cast<uint8_t>(sid + 0x40)}));
+        }
+        close(fd);
+    }
+};
+
+DoIPClientSessionConfig sessionConfig(const FakeDoIPEntity &entity, DoIPAddress sourceAddress) {
+    DoIPClientSessionConfig config;
+    config.port = entity.port();
+    config.sourceAddress = sourceAddress;
+    config.targetAddress = ENTITY_ADDRESS;
+    return config;
+}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+    for (int i = 0; i < 200 && !predicate(); ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    return predicate();
+}
+
+} // namespace
+
+TEST_SUITE("DoIPClientEngine") {
+    TEST_CASE("Many sessions are served by one engine") {
+        constexpr size_t SESSIONS = 64;
+        FakeDoIPEntity entity;
+        DoIPClientEngine engine;
+        REQUIRE(engine.start());
+
+        std::vector<DoIPSessionId> sessions;
+        std::vector<std::future<DoIPClientResponse>> responses;
+        for (size_t i = 0; i < SESSIONS; ++i) {
+            auto id = engine.openSession(sessionConfig(entity, static_cast<DoIPAddress>(0x0E00 + i)));
+            REQUIRE(id != DOIP_INVALID_SESSION);
+            sessions.push_back(id);
+            // Queued until the routing is active
+            responses.push_back(engine.sendDiagnosticMessage(id, ByteArray{0x22, 0xF1, 0x90}));
+            responses.push_back(engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}));
+        }
+        CHECK(engine.sessionCount() == SESSIONS);
+
+        for (size_t i = 0; i < SESSIONS; ++i) {
+            auto vin = responses[2 * i].get();
+            CHECK(vin.result == DoIPClientResult::Response);
+            CHECK(vin.data == ByteArray{0x62, 0xF1, 0x90, static_cast<uint8_t>(i)});
+            CHECK(vin.latency > 0ns);
+            auto testerPresent = responses[2 * i + 1].get();
+            CHECK(testerPresent.result == DoIPClientResult::Response);
+            CHECK(testerPresent.data == ByteArray{0x7E});
+            CHECK(engine.sessionState(sessions[i]) == DoIPSessionState::Active);
+        }
+        CHECK(entity.acceptedCount() == SESSIONS);
+
+        for (auto id : sessions) {
+            engine.closeSession(id);
+        }
+        CHECK(waitFor([&]() { return engine.sessionCount() == 0; }));
+        CHECK(engine.sessionState(sessions[0]) == DoIPSessionState::Closed);
+        CHECK_FALSE(engine.sendDiagnosticMessage(sessions[0], ByteArray{0x3E, 0x00}, [](const DoIPClientResponse &) noexcept {}));
+    }
+
+    TEST_CASE("Timeout, negative acknowledgement and callbacks") {
+        FakeDoIPEntity entity;
+        DoIPClientEngine engine;
+        REQUIRE(engine.start());
+
+        std::mutex mutex;
+        std::vector<DoIPSessionState> states;
+        auto config = sessionConfig(entity, 0x0E80);
+        config.responseTimeout = 100ms;
+        auto id = engine.openSession(config, [&](DoIPSessionId, DoIPSessionState state) {
+            std::lock_guard<std::mutex> lock(mutex);
+            states.push_back(state);
+        });
+
+        std::vector<DoIPClientResult> results;
+        auto record = [&](const DoIPClientResponse &response) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back(response.result);
+        };
+        REQUIRE(engine.sendDiagnosticMessage(id, ByteArray{0x31, 0x01, 0xFF, 0x00}, record));
+        REQUIRE(engine.sendDiagnosticMessage(id, ByteArray{0x10, 0x03}, record));
+        auto nack = engine.sendDiagnosticMessage(id, ByteArray{0x10, 0x01}).get();
+        CHECK(nack.result == DoIPClientResult::NegativeAck);
+        CHECK(nack.nackCode == DoIPNegativeDiagnosticAck::TargetUnreachable);
+
+        {
+            // Requests are answered in order, the first one only by the timeout
+            std::lock_guard<std::mutex> lock(mutex);
+            CHECK(results == std::vector<DoIPClientResult>{DoIPClientResult::Timeout, DoIPClientResult::NegativeAck});
+        }
+
+        // Requests still queued when the engine stops are completed
+        REQUIRE(engine.sendDiagnosticMessage(id, ByteArray{0x31, 0x01, 0xFF, 0x00}, record));
+        REQUIRE(engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}, record));
+        engine.stop();
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(results.size() == 4);
+        CHECK(results[3] == DoIPClientResult::SessionClosed);
+        CHECK(states == std::vector<DoIPSessionState>{DoIPSessionState::ActivatingRouting, DoIPSessionState::Active, DoIPSessionState::Closed});
+    }
+
+    TEST_CASE("Responses are matched to the request in flight") {
+        FakeDoIPEntity entity;
+        DoIPClientEngine engine;
+        REQUIRE(engine.start());
+        auto config = sessionConfig(entity, 0x0E80);
+        config.responseTimeout = 150ms;
+        auto id = engine.openSession(config);
+
+        // The response of the timed out request arrives while the next one is in flight
+        auto late = engine.sendDiagnosticMessage(id, ByteArray{0x19, 0x02, 0xFF}).get();
+        CHECK(late.result == DoIPClientResult::Timeout);
+        auto testerPresent = engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}).get();
+        CHECK(testerPresent.result == DoIPClientResult::Response);
+        CHECK(testerPresent.data == ByteArray{0x7E});
+
+        // A NACK from another address is not ours
+        auto reset = engine.sendDiagnosticMessage(id, ByteArray{0x11, 0x01}).get();
+        CHECK(reset.result == DoIPClientResult::Response);
+        CHECK(reset.data == ByteArray{0x51});
+    }
+
+    TEST_CASE("Responses larger than the MTU are reassembled") {
+        FakeDoIPEntity entity;
+        DoIPClientEngine engine;
+        REQUIRE(engine.start());
+        auto id = engine.openSession(sessionConfig(entity, 0x0E80));
+
+        auto response = engine.sendDiagnosticMessage(id, ByteArray{0x23, 0x14, 0x10, 0x00}).get();
+        REQUIRE(response.result == DoIPClientResult::Response);
+        REQUIRE(response.data.size() == LARGE_RESPONSE_LENGTH + 1);
+        CHECK(response.data[0] == 0x63);
+        CHECK(response.data[LARGE_RESPONSE_LENGTH] == static_cast<uint8_t>(LARGE_RESPONSE_LENGTH));
+
+        // The session is still usable
+        CHECK(engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}).get().data == ByteArray{0x7E});
+        CHECK(engine.sessionState(id) == DoIPSessionState::Active);
+
+        SUBCASE("Responses above the limit close the session") {
+            auto config = sessionConfig(entity, 0x0E81);
+            config.maxResponseLength = DOIP_MAXIMUM_MTU;
+            auto limited = engine.openSession(config);
+            CHECK(engine.sendDiagnosticMessage(limited, ByteArray{0x23, 0x14, 0x10, 0x00}).get().result == DoIPClientResult::SessionClosed);
+        }
+    }
+
+    TEST_CASE("A response handler may stop the engine") {
+        FakeDoIPEntity entity;
+        auto engine = std::make_unique<DoIPClientEngine>();
+        REQUIRE(engine->start());
+        auto id = engine->openSession(sessionConfig(entity, 0x0E80));
+
+        std::promise<DoIPClientResult> second;
+        REQUIRE(engine->sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}, [&](const DoIPClientResponse &) noexcept { engine->stop(); }));
+        REQUIRE(engine->sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}, [&](const DoIPClientResponse &response) noexcept {
+            second.set_value(response.result);
+        }));
+        CHECK(second.get_future().get() == DoIPClientResult::SessionClosed);
+        CHECK_FALSE(engine->isRunning());
+
+        // The stopped engine thread is joined by the next start()
+        REQUIRE(engine->start());
+        id = engine->openSession(sessionConfig(entity, 0x0E81));
+        CHECK(engine->sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}).get().result == DoIPClientResult::Response);
+        engine.reset();
+    }
+
+    TEST_CASE("Failed sessions are closed") {
+        DoIPClientEngine engine;
+        DoIPClientSessionConfig config;
+        CHECK(engine.openSession(config) == DOIP_INVALID_SESSION);
+        REQUIRE(engine.start());
+        config.serverAddress = "not an address";
+        CHECK(engine.openSession(config) == DOIP_INVALID_SESSION);
+
+        SUBCASE("Routing activation denied") {
+            FakeDoIPEntity entity(0x06);
+            auto id = engine.openSession(sessionConfig(entity, 0x0E80));
+            auto response = engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}).get();
+            CHECK(response.result == DoIPClientResult::SessionClosed);
+            CHECK(response.latency == 0ns);
+            CHECK(engine.sessionState(id) == DoIPSessionState::Closed);
+            engine.stop();
+        }
+
+        SUBCASE("Connection refused") {
+            uint16_t port;
+            {
+                // A port nobody listens on anymore
+                FakeDoIPEntity entity;
+                port = entity.port();
+            }
+            config = DoIPClientSessionConfig{};
+            config.port = port;
+            auto id = engine.openSession(config);
+            auto response = engine.sendDiagnosticMessage(id, ByteArray{0x3E, 0x00}).get();
+            CHECK(response.result == DoIPClientResult::SessionClosed);
+            CHECK(engine.sessionCount() == 0);
+        }
+    }
+}
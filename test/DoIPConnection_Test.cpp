@@ -0,0 +1,222 @@
+#include <doctest/doctest.h>
+
+#include <map>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "DoIPConnection.h"
+#include "DoIPMessage.h"
+#include "doctest_aux.h"
+
+using namespace doip;
+using namespace doip::test;
+
+namespace {
+
+/**
+ * @brief Server model recording the downstream requests instead of answering them.
+ */
+struct RecordingDownstreamModel : public DefaultDoIPServerModel {
+    std::map<DoIPAddress, ServerModelDownstreamResponseHandler> inFlight;
+    std::vector<ByteArray> forwarded;
+
+    RecordingDownstreamModel() {
+        onDownstreamRequest = [this](IConnectionContext &ctx, const DoIPMessageView &msg, ServerModelDownstreamResponseHandler callback) noexcept {
+            (void)ctx;
+            auto [data, size] = msg.getDiagnosticMessagePayload();
+            forwarded.emplace_back(data, size);
+            inFlight[msg.getTargetAddress().value()] = std::move(callback);
+            return DoIPDownstreamResult::Pending;
+        };
+    }
+};
+
+} // namespace
+
+TEST_SUITE("DoIPConnection") {
+    TEST_CASE("Fragments are sent as one DoIP message") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        DoIPConnection connection(fds[0], std::make_unique<DefaultDoIPServerModel>());
+
+        uint8_t addresses[] = {0x0E, 0x80, 0x12, 0x34};
+        ByteArray userData{0x62, 0xF1, 0x90, 0x01, 0x02};
+        ssize_t sent = connection.sendProtocolFragments(DoIPPayloadType::DiagnosticMessage,
+                                                        {ByteArrayRef{addresses, sizeof(addresses)},
+                                                         ByteArrayRef{userData.data(), userData.size()}});
+
+        auto expected = message::makeDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1234), userData);
+        REQUIRE(sent == static_cast<ssize_t>(expected.size()));
+
+        ByteArray received = readAll(fds[1], expected.size());
+        REQUIRE(received.size() == expected.size());
+        CHECK(std::equal(received.begin(), received.end(), expected.data()));
+
+        close(fds[1]);
+    }
+
+    TEST_CASE("Large downstream response is sent completely") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        DoIPConnection connection(fds[0], std::make_unique<DefaultDoIPServerModel>());
+
+        ByteArray response;
+        response.resize(3000);
+        for (size_t i = 0; i < response.size(); ++i) {
+            response[i] = static_cast<uint8_t>(i);
+        }
+        connection.setClientAddress(DoIPAddress(0x0E80));
+        connection.receiveDownstreamResponse(response, DoIPDownstreamResult::Handled);
+
+        ByteArray received = readAll(fds[1], DOIP_HEADER_SIZE + 4 + response.size());
+        REQUIRE(received.size() == DOIP_HEADER_SIZE + 4 + response.size());
+        auto message = DoIPMessage::tryParse(received.data(), received.size());
+        REQUIRE(message.has_value());
+        CHECK(message->getSourceAddress() == connection.getServerAddress());
+        CHECK(message->getTargetAddress() == DoIPAddress(0x0E80));
+        auto payload = message->getDiagnosticMessagePayload();
+        REQUIRE(payload.second == response.size());
+        CHECK(std::equal(response.begin(), response.end(), payload.first));
+
+        close(fds[1]);
+    }
+
+    TEST_CASE("Large diagnostic message is streamed to the model") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+        ByteArray received;
+        size_t chunks = 0;
+        std::vector<DoIPDiagnosticAck> notifications;
+        auto model = std::make_unique<DefaultDoIPServerModel>();
+        model->onDiagnosticNotification = [&](IConnectionContext &ctx, DoIPDiagnosticAck ack) noexcept {
+            (void)ctx;
+            notifications.push_back(ack);
+        };
+        model->onDiagnosticMessageChunk = [&](IConnectionContext &ctx, const DoIPDiagnosticChunk &chunk) noexcept -> DoIPDiagnosticAck {
+            (void)ctx;
+            CHECK(chunk.sourceAddress == DoIPAddress(0x0E80));
+            CHECK(chunk.offset == received.size());
+            received.insert(received.end(), chunk.data, chunk.data + chunk.length);
+            ++chunks;
+            return std::nullopt;
+        };
+        DoIPConnection connection(fds[0], std::move(model));
+
+        auto request = message::makeRoutingActivationRequest(DoIPAddress(0x0E80));
+        REQUIRE(write(fds[1], request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+        REQUIRE(connection.receiveTcpMessage() == 1);
+        REQUIRE(connection.isRoutingActivated());
+
+        ByteArray transferData{0x36, 0x01};
+        for (size_t i = 0; i < 3 * DOIP_MAXIMUM_MTU; ++i) {
+            transferData.push_back(static_cast<uint8_t>(i));
+        }
+        auto diag = message::makeDiagnosticMessage(DoIPAddress(0x0E80), connection.getServerAddress(), transferData);
+        std::thread writer([&]() noexcept {
+            CHECK(write(fds[1], diag.data(), diag.size()) == static_cast<ssize_t>(diag.size()));
+        });
+        while (received.size() < transferData.size() && connection.receiveTcpMessage() == 1) {
+        }
+        writer.join();
+
+        REQUIRE(received.size() == transferData.size());
+        CHECK(std::equal(transferData.begin(), transferData.end(), received.begin()));
+        CHECK(chunks > 1);
+        // Reported once, when the ACK after the last chunk is sent
+        CHECK(notifications == std::vector<DoIPDiagnosticAck>{std::nullopt});
+
+        auto activation = readMessage(fds[1]);
+        REQUIRE(activation.has_value());
+        CHECK(activation->getPayloadType() == DoIPPayloadType::RoutingActivationResponse);
+        auto ack = readMessage(fds[1]);
+        REQUIRE(ack.has_value());
+        CHECK(ack->getPayloadType() == DoIPPayloadType::DiagnosticMessageAck);
+
+        close(fds[1]);
+    }
+
+    TEST_CASE("Downstream requests to different targets are in flight concurrently") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        auto model = std::make_unique<RecordingDownstreamModel>();
+        RecordingDownstreamModel *recorder = model.get();
+        DoIPConnection connection(fds[0], std::move(model));
+        const DoIPAddress tester(0x0E80);
+
+        sendToConnection(fds[1], connection, message::makeRoutingActivationRequest(tester));
+        sendToConnection(fds[1], connection, message::makeDiagnosticMessage(tester, DoIPAddress(0x1001), ByteArray{0x22, 0xF1, 0x90}));
+        sendToConnection(fds[1], connection, message::makeDiagnosticMessage(tester, DoIPAddress(0x1002), ByteArray{0x22, 0xF1, 0x91}));
+        // Same target again, forwarded once the first request to 0x1001 is answered
+        sendToConnection(fds[1], connection, message::makeDiagnosticMessage(tester, DoIPAddress(0x1001), ByteArray{0x3E, 0x00}));
+
+        CHECK(connection.isRoutingActivated());
+        CHECK(recorder->forwarded.size() == 2);
+        CHECK(connection.getPendingDownstreamRequestCount() == 3);
+
+        REQUIRE(readMessage(fds[1])->getPayloadType() == DoIPPayloadType::RoutingActivationResponse);
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(readMessage(fds[1])->getPayloadType() == DoIPPayloadType::DiagnosticMessageAck);
+        }
+
+        // The second target answers first, its response is not held back
+        recorder->inFlight[DoIPAddress(0x1002)](ByteArray{0x62, 0xF1, 0x91}, DoIPDownstreamResult::Handled);
+        auto response = readMessage(fds[1]);
+        REQUIRE(response.has_value());
+        CHECK(response->getSourceAddress() == DoIPAddress(0x1002));
+        CHECK(response->getTargetAddress() == tester);
+
+        recorder->inFlight[DoIPAddress(0x1001)](ByteArray{0x62, 0xF1, 0x90}, DoIPDownstreamResult::Handled);
+        response = readMessage(fds[1]);
+        REQUIRE(response.has_value());
+        CHECK(response->getSourceAddress() == DoIPAddress(0x1001));
+
+        // The queued request was forwarded with its own handler
+        REQUIRE(recorder->forwarded.size() == 3);
+        CHECK(recorder->forwarded[2] == ByteArray{0x3E, 0x00});
+        CHECK(connection.getPendingDownstreamRequestCount() == 1);
+        recorder->inFlight[DoIPAddress(0x1001)](ByteArray{0x7E, 0x00}, DoIPDownstreamResult::Handled);
+        response = readMessage(fds[1]);
+        REQUIRE(response.has_value());
+        auto payload = response->getDiagnosticMessagePayload();
+        CHECK(ByteArray(payload.first, payload.second) == ByteArray{0x7E, 0x00});
+        CHECK(connection.getPendingDownstreamRequestCount() == 0);
+
+        close(fds[1]);
+    }
+
+    TEST_CASE("Downstream request times out independently") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        auto model = std::make_unique<RecordingDownstreamModel>();
+        RecordingDownstreamModel *recorder = model.get();
+        DoIPConnection connection(fds[0], std::move(model));
+        connection.setDownstreamResponseTimeout(std::chrono::milliseconds(50));
+        const DoIPAddress tester(0x0E80);
+
+        sendToConnection(fds[1], connection, message::makeRoutingActivationRequest(tester));
+        sendToConnection(fds[1], connection, message::makeDiagnosticMessage(tester, DoIPAddress(0x1001), ByteArray{0x10, 0x01}));
+        REQUIRE(readMessage(fds[1])->getPayloadType() == DoIPPayloadType::RoutingActivationResponse);
+        REQUIRE(readMessage(fds[1])->getPayloadType() == DoIPPayloadType::DiagnosticMessageAck);
+
+        // The timeout is reported on behalf of the target
+        auto nack = readMessage(fds[1]);
+        REQUIRE(nack.has_value());
+        CHECK(nack->getPayloadType() == DoIPPayloadType::DiagnosticMessageNegativeAck);
+        auto nackPayload = nack->getPayload();
+        REQUIRE(nackPayload.second >= 2);
+        CHECK(nackPayload.first[0] == 0x10);
+        CHECK(nackPayload.first[1] == 0x01);
+        CHECK(connection.getPendingDownstreamRequestCount() == 0);
+        CHECK(connection.isRoutingActivated());
+
+        // A late response is dropped
+        recorder->inFlight[DoIPAddress(0x1001)](ByteArray{0x50, 0x01}, DoIPDownstreamResult::Handled);
+        uint8_t buffer[64];
+        CHECK(recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT) < 0);
+
+        close(fds[1]);
+    }
+}
@@ -0,0 +1,172 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DoIPDefaultConnection.h"
+#include "DoIPDownstreamDispatcher.h"
+#include "DoIPMessage.h"
+
+using namespace doip;
+using namespace std::chrono_literals;
+
+namespace {
+
+/**
+ * @brief Collects the response passed to a ServerModelDownstreamResponseHandler.
+ */
+struct ResponseCollector {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int calls{0};
+    ByteArray response;
+    DoIPDownstreamResult result{DoIPDownstreamResult::Pending};
+
+    ServerModelDownstreamResponseHandler handler() {
+        return [this](const ByteArray &rsp, DoIPDownstreamResult res) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++calls;
+            response = rsp;
+            result = res;
+            cv.notify_all();
+        };
+    }
+
+    bool waitForCalls(int expected, std::chrono::milliseconds timeout = 1000ms) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, timeout, [&] { return calls >= expected; });
+    }
+};
+
+} // namespace
+
+TEST_SUITE("DoIPDownstreamDispatcher") {
+    TEST_CASE("Request is forwarded and completed without polling delay") {
+        DoIPDownstreamDispatcher dispatcher([](const DoIPDownstreamRequest &request, const ServerModelDownstreamResponseHandler &complete) {
+            ByteArray rsp{static_cast<uint8_t>(request.payload[0] + 0x40)};
+            complete(rsp, DoIPDownstreamResult::Handled);
+        });
+        dispatcher.start();
+        REQUIRE(dispatcher.isRunning());
+
+        ResponseCollector collector;
+        CHECK(dispatcher.submit(DoIPDownstreamRequest{0x0E80, 0x0E00, ByteArray{0x22, 0xF1, 0x90}}, collector.handler()) == DoIPDownstreamResult::Pending);
+        REQUIRE(collector.waitForCalls(1));
+        CHECK(collector.result == DoIPDownstreamResult::Handled);
+        CHECK(collector.response == ByteArray{0x62});
+    }
+
+    TEST_CASE("Requests are rejected while the dispatcher is stopped") {
+        std::atomic<int> forwarded{0};
+        DoIPDownstreamDispatcher dispatcher([&forwarded](const DoIPDownstreamRequest &, const ServerModelDownstreamResponseHandler &complete) {
+            ++forwarded;
+            complete(ByteArray{}, DoIPDownstreamResult::Handled);
+        });
+
+        ResponseCollector collector;
+        CHECK(dispatcher.submit(DoIPDownstreamRequest{}, collector.handler()) == DoIPDownstreamResult::Error);
+
+        dispatcher.start();
+        CHECK(dispatcher.submit(DoIPDownstreamRequest{}, collector.handler()) == DoIPDownstreamResult::Pending);
+        REQUIRE(collector.waitForCalls(1));
+
+        dispatcher.stop();
+        CHECK_FALSE(dispatcher.isRunning());
+        CHECK(dispatcher.submit(DoIPDownstreamRequest{}, collector.handler()) == DoIPDownstreamResult::Error);
+
+        // Restart after stop
+        dispatcher.start();
+        CHECK(dispatcher.submit(DoIPDownstreamRequest{}, collector.handler()) == DoIPDownstreamResult::Pending);
+        REQUIRE(collector.waitForCalls(2));
+        CHECK(forwarded == 2);
+    }
+
+    TEST_CASE("Handler copies the diagnostic message") {
+        DoIPDownstreamRequest received;
+        DoIPDownstreamDispatcher dispatcher([&received](const DoIPDownstreamRequest &request, const ServerModelDownstreamResponseHandler &complete) {
+            received = request;
+            complete(ByteArray{0x50, 0x01}, DoIPDownstreamResult::Handled);
+        });
+        dispatcher.start();
+
+        auto handler = dispatcher.makeHandler();
+        DoIPDefaultConnection connection(std::make_unique<DefaultDoIPServerModel>());
+        ResponseCollector collector;
+        {
+            DoIPMessage msg = message::makeDiagnosticMessage(0x0E80, 0x1234, ByteArray{0x10, 0x01});
+            // The view is gone once the handler returned
+            CHECK(handler(connection, msg, collector.handler()) == DoIPDownstreamResult::Pending);
+        }
+        REQUIRE(collector.waitForCalls(1));
+        CHECK(received.sourceAddress == 0x0E80);
+        CHECK(received.targetAddress == 0x1234);
+        CHECK(received.payload == ByteArray{0x10, 0x01});
+        CHECK(collector.response == ByteArray{0x50, 0x01});
+    }
+
+    TEST_CASE("Transport may complete asynchronously") {
+        std::mutex mutex;
+        std::vector<ServerModelDownstreamResponseHandler> inFlight;
+        DoIPDownstreamDispatcher dispatcher([&](const DoIPDownstreamRequest &, const ServerModelDownstreamResponseHandler &complete) {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight.push_back(complete);
+        });
+        dispatcher.start();
+
+        ResponseCollector first;
+        ResponseCollector second;
+        dispatcher.submit(DoIPDownstreamRequest{}, first.handler());
+        dispatcher.submit(DoIPDownstreamRequest{}, second.handler());
+
+        // Both requests reach the transport although neither was answered
+        for (int i = 0; i < 100; ++i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (inFlight.size() == 2) {
+                break;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(inFlight.size() == 2);
+
+        // The receive path answers the second one first
+        inFlight[1](ByteArray{0x02}, DoIPDownstreamResult::Handled);
+        inFlight[0](ByteArray{}, DoIPDownstreamResult::Error);
+        CHECK(second.response == ByteArray{0x02});
+        CHECK(first.result == DoIPDownstreamResult::Error);
+    }
+
+    TEST_CASE("Completion handler may stop the dispatcher") {
+        std::atomic<int> forwarded{0};
+        auto dispatcher = std::make_unique<DoIPDownstreamDispatcher>([&forwarded](const DoIPDownstreamRequest &, const ServerModelDownstreamResponseHandler &complete) {
+            ++forwarded;
+            complete(ByteArray{0x7E}, DoIPDownstreamResult::Handled);
+        });
+        dispatcher->start();
+
+        // Like a connection closing on the response, stop() runs on the worker
+        ResponseCollector collector;
+        DoIPDownstreamDispatcher *target = dispatcher.get();
+        auto stopping = [&collector, target](const ByteArray &rsp, DoIPDownstreamResult res) {
+            target->stop();
+            collector.handler()(rsp, res);
+        };
+        REQUIRE(dispatcher->submit(DoIPDownstreamRequest{}, stopping) == DoIPDownstreamResult::Pending);
+        REQUIRE(collector.waitForCalls(1));
+        CHECK_FALSE(dispatcher->isRunning());
+
+        // The stopped worker is joined before a new one starts
+        dispatcher->start();
+        REQUIRE(dispatcher->submit(DoIPDownstreamRequest{}, stopping) == DoIPDownstreamResult::Pending);
+        REQUIRE(collector.waitForCalls(2));
+        CHECK(forwarded == 2);
+
+        // Joins the worker, which may still be returning from the transport
+        dispatcher.reset();
+    }
+}
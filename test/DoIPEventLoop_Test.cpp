@@ -0,0 +1,66 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "DoIPEventLoop.h"
+#include "DoIPMessage.h"
+#include "doctest_aux.h"
+
+using namespace doip;
+using namespace doip::test;
+using namespace std::chrono_literals;
+
+TEST_SUITE("DoIPEventLoop") {
+    TEST_CASE("Start and stop") {
+        DoIPEventLoop loop(2);
+        REQUIRE(loop.start());
+        CHECK(loop.isRunning());
+        CHECK(loop.threadCount() == 2);
+        CHECK(loop.connectionCount() == 0);
+        loop.stop();
+        CHECK_FALSE(loop.isRunning());
+    }
+
+    TEST_CASE("Reactor dispatches routing activation and releases closed connection") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+        DoIPEventLoop loop(1);
+        REQUIRE(loop.start());
+        REQUIRE(loop.addConnection(std::make_unique<DoIPConnection>(fds[0], std::make_unique<DefaultDoIPServerModel>())));
+        CHECK(loop.connectionCount() == 1);
+
+        // Send the request in two parts to exercise partial frame handling
+        auto request = message::makeRoutingActivationRequest(DoIPAddress(0x0E80));
+        REQUIRE(write(fds[1], request.data(), 5) == 5);
+        std::this_thread::sleep_for(20ms);
+        REQUIRE(write(fds[1], request.data() + 5, request.size() - 5) == static_cast<ssize_t>(request.size() - 5));
+
+        auto response = readMessage(fds[1]);
+        REQUIRE(response.has_value());
+        CHECK(response->getPayloadType() == DoIPPayloadType::RoutingActivationResponse);
+
+        // Peer closes -> reactor releases the connection
+        close(fds[1]);
+        for (int i = 0; i < 100 && loop.connectionCount() > 0; ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        CHECK(loop.connectionCount() == 0);
+    }
+
+    TEST_CASE("Add connection to stopped loop fails") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+        DoIPEventLoop loop(1);
+        CHECK_FALSE(loop.addConnection(std::make_unique<DoIPConnection>(fds[0], std::make_unique<DefaultDoIPServerModel>())));
+
+        // The rejected connection is closed, so the peer is not left hanging
+        uint8_t buffer[8];
+        CHECK(recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT) == 0);
+        close(fds[1]);
+    }
+}
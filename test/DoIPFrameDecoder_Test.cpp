@@ -0,0 +1,174 @@
+#include <doctest/doctest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "DoIPFrameDecoder.h"
+#include "DoIPMessage.h"
+
+using namespace doip;
+
+TEST_SUITE("DoIPFrameDecoder") {
+    TEST_CASE("Pipelined frames are yielded one by one") {
+        DoIPFrameDecoder decoder;
+        auto alive = message::makeAliveCheckResponse(DoIPAddress(0x0E80));
+        auto diag = message::makeDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1234), ByteArray{0x3E, 0x00});
+
+        ByteArray stream;
+        stream.insert(stream.end(), alive.data(), alive.data() + alive.size());
+        stream.insert(stream.end(), diag.data(), diag.data() + diag.size());
+        REQUIRE(decoder.feed(stream.data(), stream.size()) == stream.size());
+
+        DoIPFrame frame;
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        CHECK(frame.payloadType == DoIPPayloadType::AliveCheckResponse);
+        CHECK(frame.payloadLength == alive.size() - DOIP_HEADER_SIZE);
+
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        CHECK(frame.payloadType == DoIPPayloadType::DiagnosticMessage);
+        REQUIRE(frame.payloadLength == 6);
+        CHECK(frame.payload[4] == 0x3E);
+        CHECK(frame.payload[5] == 0x00);
+
+        CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::NeedMoreData);
+        CHECK(decoder.bufferedBytes() == 0);
+    }
+
+    TEST_CASE("Partial frames are kept across reads") {
+        DoIPFrameDecoder decoder;
+        auto msg = message::makeRoutingActivationRequest(DoIPAddress(0x0E80));
+        DoIPFrame frame;
+
+        // Header split
+        decoder.feed(msg.data(), 3);
+        CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::NeedMoreData);
+        // Payload split
+        decoder.feed(msg.data() + 3, DOIP_HEADER_SIZE);
+        CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::NeedMoreData);
+        decoder.feed(msg.data() + 3 + DOIP_HEADER_SIZE, msg.size() - 3 - DOIP_HEADER_SIZE);
+
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        CHECK(frame.payloadType == DoIPPayloadType::RoutingActivationRequest);
+        CHECK(frame.payloadLength == msg.size() - DOIP_HEADER_SIZE);
+    }
+
+    TEST_CASE("Frames wrapping around the ring end are linearized") {
+        DoIPFrameDecoder decoder(40); // ring capacity 96 bytes
+        ByteArray payload;
+        for (uint8_t i = 0; i < 30; ++i) {
+            payload.push_back(i);
+        }
+        auto msg = message::makeDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1234), payload);
+        REQUIRE(msg.size() == DOIP_HEADER_SIZE + 34);
+
+        // Two frames plus the beginning of a third one, which will wrap
+        decoder.feed(msg.data(), msg.size());
+        decoder.feed(msg.data(), msg.size());
+        decoder.feed(msg.data(), 10);
+
+        DoIPFrame frame;
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::NeedMoreData);
+
+        CHECK(decoder.feed(msg.data() + 10, msg.size() - 10) == msg.size() - 10);
+        REQUIRE(decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady);
+        REQUIRE(frame.payloadLength == 34);
+        for (uint8_t i = 0; i < 30; ++i) {
+            CHECK(frame.payload[4 + i] == i);
+        }
+    }
+
+    TEST_CASE("Malformed headers are reported") {
+        DoIPFrameDecoder decoder;
+        DoIPFrame frame;
+
+        SUBCASE("Invalid protocol version") {
+            uint8_t header[] = {0x02, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00};
+            decoder.feed(header, sizeof(header));
+            CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::InvalidHeader);
+        }
+
+        SUBCASE("Payload too large") {
+            uint8_t header[] = {0x04, 0xFB, 0x80, 0x01, 0x00, 0x01, 0x00, 0x00};
+            decoder.feed(header, sizeof(header));
+            CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::PayloadTooLarge);
+        }
+    }
+
+    TEST_CASE("Oversized diagnostic messages are streamed in chunks") {
+        DoIPFrameDecoder decoder(40); // ring capacity 96 bytes
+        decoder.setStreamingEnabled(true);
+
+        ByteArray payload;
+        for (size_t i = 0; i < 300; ++i) {
+            payload.push_back(static_cast<uint8_t>(i));
+        }
+        auto big = message::makeDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1234), payload);
+        auto alive = message::makeAliveCheckResponse(DoIPAddress(0x0E80));
+
+        ByteArray stream;
+        stream.insert(stream.end(), big.data(), big.data() + big.size());
+        stream.insert(stream.end(), alive.data(), alive.data() + alive.size());
+
+        ByteArray received;
+        DoIPFrame frame;
+        size_t pos = 0;
+        while (true) {
+            DoIPDecodeStatus status = decoder.nextFrame(frame);
+            if (status == DoIPDecodeStatus::ChunkReady) {
+                CHECK(frame.payloadType == DoIPPayloadType::DiagnosticMessage);
+                CHECK(frame.offset == received.size());
+                CHECK(frame.totalLength == payload.size() + 4);
+                received.insert(received.end(), frame.payload, frame.payload + frame.payloadLength);
+            } else if (status == DoIPDecodeStatus::FrameReady) {
+                CHECK(frame.payloadType == DoIPPayloadType::AliveCheckResponse);
+                CHECK_FALSE(decoder.isStreaming());
+            } else {
+                REQUIRE(status == DoIPDecodeStatus::NeedMoreData);
+                if (pos == stream.size()) {
+                    break;
+                }
+                // Feed in odd portions so chunks do not align with the ring
+                pos += decoder.feed(stream.data() + pos, std::min<size_t>(37, stream.size() - pos));
+            }
+        }
+
+        REQUIRE(received.size() == payload.size() + 4);
+        CHECK(std::equal(payload.begin(), payload.end(), received.begin() + 4));
+    }
+
+    TEST_CASE("Oversized messages of other types are rejected with streaming enabled") {
+        DoIPFrameDecoder decoder(40);
+        decoder.setStreamingEnabled(true);
+        DoIPFrame frame;
+
+        uint8_t header[] = {0x04, 0xFB, 0x00, 0x05, 0x00, 0x00, 0x01, 0x00};
+        decoder.feed(header, sizeof(header));
+        CHECK(decoder.nextFrame(frame) == DoIPDecodeStatus::PayloadTooLarge);
+    }
+
+    TEST_CASE("One read picks up a burst of frames") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+        auto msg = message::makeAliveCheckResponse(DoIPAddress(0x0E80));
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(write(fds[1], msg.data(), msg.size()) == static_cast<ssize_t>(msg.size()));
+        }
+
+        DoIPFrameDecoder decoder;
+        CHECK(decoder.readFrom(fds[0]) == static_cast<ssize_t>(5 * msg.size()));
+
+        DoIPFrame frame;
+        int frames = 0;
+        while (decoder.nextFrame(frame) == DoIPDecodeStatus::FrameReady) {
+            ++frames;
+        }
+        CHECK(frames == 5);
+
+        close(fds[1]);
+        CHECK(decoder.readFrom(fds[0]) == 0);
+        close(fds[0]);
+    }
+}
@@ -233,4 +233,44 @@ TEST_SUITE("DoIPMessage") {
         CHECK(optPayload.first[DIAG_MSG_OFFSET + 1] == 0xFD);
         CHECK(optPayload.first[DIAG_MSG_OFFSET + 2] == 0x10);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("Message view borrows payload") {
+        const uint8_t payload[] = {MIN_SOURCE_ADDRESS >> 8, MIN_SOURCE_ADDRESS & 0xFF, 0xca, 0xfe, 0x22, 0xF1, 0x90};
+        DoIPMessageView view(DoIPPayloadType::DiagnosticMessage, payload, sizeof(payload));
+
+        CHECK(view.getPayloadType() == DoIPPayloadType::DiagnosticMessage);
+        CHECK(view.getPayloadSize() == sizeof(payload));
+        CHECK(view.getPayload().first == payload); // no copy
+        CHECK(view.getSourceAddress().value() == MIN_SOURCE_ADDRESS);
+        CHECK(view.getTargetAddress().value() == 0xcafe);
+
+        auto diagPayload = view.getDiagnosticMessagePayload();
+        REQUIRE(diagPayload.second == 3);
+        CHECK(diagPayload.first == payload + 4);
+
+        SUBCASE("Taking ownership") {
+            DoIPMessage msg(view);
+            CHECK(msg.getPayloadType() == DoIPPayloadType::DiagnosticMessage);
+            CHECK(msg.getPayloadSize() == sizeof(payload));
+            CHECK(msg.getPayload().first != payload);
+            CHECK(msg.getTargetAddress().value() == 0xcafe);
+            CHECK(msg.isValid());
+        }
+
+        SUBCASE("View of a message") {
+            auto msg = message::makeAliveCheckResponse(DoIPAddress(0x0E80));
+            DoIPMessageView msgView = msg;
+            CHECK(msgView.getPayloadType() == DoIPPayloadType::AliveCheckResponse);
+            CHECK(msgView.getPayload().first == msg.data() + DOIP_HEADER_SIZE);
+            CHECK(msgView.getSourceAddress().value() == 0x0E80);
+            CHECK_FALSE(msgView.getTargetAddress().has_value());
+        }
+
+        SUBCASE("Empty view") {
+            DoIPMessageView empty;
+            CHECK(empty.getPayload().first == nullptr);
+            CHECK_FALSE(empty.getSourceAddress().has_value());
+            CHECK(empty.getDiagnosticMessagePayload().second == 0);
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "DoIPConnection.h"
+#include "DoIPMessage.h"
+#include "DoIPMetrics.h"
+#include "doctest_aux.h"
+
+using namespace doip;
+using namespace doip::test;
+
+namespace {
+
+std::string metricsPath(const char *name) {
+    return std::string("/tmp/libdoip_") + name + "_" + std::to_string(getpid());
+}
+
+} // namespace
+
+TEST_SUITE("DoIPMetrics") {
+    TEST_CASE("Connection counts frames, NACKs and close reasons") {
+        auto registry = std::make_shared<DoIPMetricsRegistry>();
+        registry->serverMetrics().countAccepted();
+        const DoIPAddress tester(0x0E80);
+        auto routingActivation = message::makeRoutingActivationRequest(tester);
+        auto request = message::makeDiagnosticMessage(tester, DoIPAddress(0x1001), ByteArray{0x3E, 0x00});
+
+        {
+            int fds[2];
+            REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+            DoIPConnection connection(fds[0], std::make_unique<DefaultDoIPServerModel>());
+            connection.setMetricsRegistry(registry);
+
+            sendToConnection(fds[1], connection, routingActivation);
+            sendToConnection(fds[1], connection, request);
+            sendToConnection(fds[1], connection, message::makeDiagnosticMessage(DoIPAddress(0x0E81), DoIPAddress(0x1001), ByteArray{0x3E, 0x00}));
+
+            auto metrics = connection.metrics();
+            CHECK(metrics.framesReceivedOf(DoIPPayloadType::RoutingActivationRequest) == 1);
+            CHECK(metrics.bytesReceivedOf(DoIPPayloadType::RoutingActivationRequest) == routingActivation.size());
+            CHECK(metrics.framesReceivedOf(DoIPPayloadType::DiagnosticMessage) == 2);
+            CHECK(metrics.bytesReceivedOf(DoIPPayloadType::DiagnosticMessage) == 2 * request.size());
+            CHECK(metrics.framesSentOf(DoIPPayloadType::RoutingActivationResponse) == 1);
+            CHECK(metrics.framesSentOf(DoIPPayloadType::DiagnosticMessageAck) == 1);
+            CHECK(metrics.framesSentOf(DoIPPayloadType::DiagnosticMessageNegativeAck) == 1);
+            CHECK(metrics.nacksOf(DoIPNegativeDiagnosticAck::InvalidSourceAddress) == 1);
+            CHECK(metrics.diagnosticHandlerLatency.count == 1);
+
+            auto total = registry->snapshot();
+            CHECK(total.connectionsActive == 1);
+            CHECK(total.connectionsAccepted == 1);
+            CHECK(total.framesReceivedOf(DoIPPayloadType::DiagnosticMessage) == 2);
+
+            connection.triggerDisconnection();
+            CHECK(connection.metrics().closedBy(DoIPCloseReason::ApplicationRequest) == 1);
+            close(fds[1]);
+        }
+
+        // Counters of closed connections are kept
+        auto total = registry->snapshot();
+        CHECK(total.connectionsActive == 0);
+        CHECK(total.framesReceivedOf(DoIPPayloadType::DiagnosticMessage) == 2);
+        CHECK(total.closedBy(DoIPCloseReason::ApplicationRequest) == 1);
+    }
+
+    TEST_CASE("Timer expirations are counted") {
+        DoIPDefaultConnection connection(std::make_unique<DefaultDoIPServerModel>());
+        connection.setGeneralInactivityTimeout(20ms);
+        connection.setAliveCheckTimeout(20ms);
+        connection.setAliveCheckRetryCount(1);
+        connection.handleMessage2(message::makeRoutingActivationRequest(DoIPAddress(0x0E80)));
+
+        for (int i = 0; i < 200 && connection.isOpen(); ++i) {
+            std::this_thread::sleep_for(10ms);
+        }
+        REQUIRE_FALSE(connection.isOpen());
+
+        auto metrics = connection.metrics();
+        CHECK(metrics.expirationsOf(ConnectionTimers::GeneralInactivity) == 1);
+        CHECK(metrics.expirationsOf(ConnectionTimers::AliveCheck) == 1);
+        CHECK(metrics.closedBy(DoIPCloseReason::AliveCheckTimeout) == 1);
+        CHECK(metrics.framesSentOf(DoIPPayloadType::AliveCheckRequest) == 1);
+    }
+
+    TEST_CASE("Latency histogram and Prometheus text") {
+        DoIPMetrics metrics;
+        metrics.diagnosticHandlerLatency().observe(std::chrono::microseconds(5));
+        metrics.diagnosticHandlerLatency().observe(std::chrono::microseconds(10));
+        metrics.diagnosticHandlerLatency().observe(std::chrono::microseconds(300));
+        metrics.diagnosticHandlerLatency().observe(std::chrono::seconds(2));
+        metrics.countSent(DoIPPayloadType::DiagnosticMessage, 20);
+        metrics.countSent(static_cast<DoIPPayloadType>(0xF000), 8);
+        metrics.countNack(DoIPNegativeDiagnosticAck::TargetBusy);
+
+        auto snapshot = metrics.snapshot();
+        const auto &histogram = snapshot.diagnosticHandlerLatency;
+        CHECK(histogram.count == 4);
+        CHECK(histogram.buckets[0] == 2);
+        CHECK(histogram.buckets[5] == 1);
+        CHECK(histogram.buckets[METRICS_LATENCY_SLOTS - 1] == 1);
+        CHECK(histogram.sumNs == 2000315000);
+
+        std::ostringstream text;
+        writePrometheusText(text, snapshot);
+        std::string output = text.str();
+        CHECK(output.find("# TYPE doip_frames_sent_total counter\n") != std::string::npos);
+        CHECK(output.find("doip_frames_sent_total{payload_type=\"DiagnosticMessage\"} 1\n") != std::string::npos);
+        CHECK(output.find("doip_bytes_sent_total{payload_type=\"Other\"} 8\n") != std::string::npos);
+        CHECK(output.find("doip_diagnostic_nacks_total{code=\"TargetBusy\"} 1\n") != std::string::npos);
+        CHECK(output.find("doip_diagnostic_handler_duration_seconds_bucket{le=\"1e-05\"} 2\n") != std::string::npos);
+        CHECK(output.find("doip_diagnostic_handler_duration_seconds_bucket{le=\"0.0005\"} 3\n") != std::string::npos);
+        CHECK(output.find("doip_diagnostic_handler_duration_seconds_bucket{le=\"+Inf\"} 4\n") != std::string::npos);
+        CHECK(output.find("doip_diagnostic_handler_duration_seconds_count 4\n") != std::string::npos);
+    }
+
+    TEST_CASE("UDP rate limit counters") {
+        DoIPMetrics metrics;
+        metrics.countUdpDropped();
+        metrics.countUdpDropped();
+        metrics.countUdpNackSuppressed();
+
+        auto snapshot = metrics.snapshot();
+        CHECK(snapshot.udpDatagramsDropped == 2);
+        CHECK(snapshot.udpNacksSuppressed == 1);
+
+        DoIPMetricsSnapshot total;
+        total += snapshot;
+        total += snapshot;
+        CHECK(total.udpDatagramsDropped == 4);
+        CHECK(total.udpNacksSuppressed == 2);
+
+        std::ostringstream text;
+        writePrometheusText(text, snapshot);
+        std::string output = text.str();
+        CHECK(output.find("# TYPE doip_udp_datagrams_dropped_total counter\n") != std::string::npos);
+        CHECK(output.find("doip_udp_datagrams_dropped_total 2\n") != std::string::npos);
+        CHECK(output.find("doip_udp_nacks_suppressed_total 1\n") != std::string::npos);
+    }
+
+    TEST_CASE("Metrics are dumped to a file and to a local socket") {
+        DoIPMetrics metrics;
+        metrics.countAccepted();
+        auto snapshot = metrics.snapshot();
+
+        auto filePath = metricsPath("metrics") + ".prom";
+        REQUIRE(dumpPrometheusToFile(filePath, snapshot));
+        std::ifstream file(filePath);
+        std::stringstream content;
+        content << file.rdbuf();
+        CHECK(content.str().find("doip_connections_accepted_total 1\n") != std::string::npos);
+        std::remove(filePath.c_str());
+
+        auto socketPath = metricsPath("metrics") + ".sock";
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        REQUIRE(listener >= 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socketPath.c_str());
+        REQUIRE(bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+        REQUIRE(listen(listener, 1) == 0);
+
+        std::string received;
+        std::thread collector([&]() {
+            int client = accept(listener, nullptr, nullptr);
+            char buffer[4096];
+            ssize_t n;
+            while ((n = read(client, buffer, sizeof(buffer))) > 0) {
+                received.append(buffer, static_cast<size_t>(n));
+            }
+            close(client);
+        });
+        CHECK(dumpPrometheusToSocket(socketPath, snapshot));
+        collector.join();
+        close(listener);
+        unlink(socketPath.c_str());
+
+        CHECK(received == content.str());
+        CHECK_FALSE(dumpPrometheusToSocket(socketPath, snapshot));
+    }
+}
@@ -0,0 +1,215 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "DoIPOutboundQueue.h"
+
+using namespace doip;
+using namespace std::chrono_literals;
+
+namespace {
+
+ssize_t enqueueBytes(DoIPOutboundQueue &queue, const uint8_t *data, size_t length) {
+    iovec iov{const_cast<uint8_t *>(data), length};
+    return queue.enqueue(&iov, 1);
+}
+
+size_t drain(int fd) {
+    uint8_t buffer[4096];
+    size_t total = 0;
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+} // namespace
+
+TEST_SUITE("DoIPOutboundQueue") {
+    TEST_CASE("Uncorked messages are written immediately") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            DoIPOutboundQueue queue(fds[0]);
+            uint8_t data[] = {1, 2, 3, 4};
+            CHECK(enqueueBytes(queue, data, sizeof(data)) == 4);
+            CHECK(queue.pendingBytes() == 0);
+            CHECK(drain(fds[1]) == 4);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("Corked messages are coalesced") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            DoIPOutboundQueue queue(fds[0], 1000ms);
+            uint8_t ack[] = {0xAA, 0xAA};
+            uint8_t response[] = {0x62, 0xF1, 0x90};
+
+            queue.cork();
+            enqueueBytes(queue, ack, sizeof(ack));
+            enqueueBytes(queue, response, sizeof(response));
+            CHECK(queue.pendingBytes() == 5);
+            CHECK(drain(fds[1]) == 0);
+
+            queue.uncork();
+            CHECK(queue.pendingBytes() == 0);
+
+            uint8_t buffer[16];
+            CHECK(recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT) == 5);
+            CHECK(buffer[0] == 0xAA);
+            CHECK(buffer[2] == 0x62);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("Large corked messages are written with the held back data") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            DoIPOutboundQueue queue(fds[0], 1000ms);
+            uint8_t ack[] = {0xAA, 0xAA};
+            std::vector<uint8_t> response(2048, 0x62);
+
+            queue.cork();
+            enqueueBytes(queue, ack, sizeof(ack));
+            CHECK(queue.pendingBytes() == 2);
+            iovec iov[] = {{response.data(), 1024}, {response.data() + 1024, 1024}};
+            CHECK(queue.enqueue(iov, 2) == 2048);
+            CHECK(queue.pendingBytes() == 0);
+            queue.uncork();
+
+            std::vector<uint8_t> buffer(4096);
+            CHECK(recv(fds[1], buffer.data(), buffer.size(), MSG_DONTWAIT) == 2050);
+            CHECK(buffer[1] == 0xAA);
+            CHECK(buffer[2] == 0x62);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("Flush deadline bounds the coalescing delay") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            DoIPOutboundQueue queue(fds[0], 5ms);
+            uint8_t data[] = {1, 2, 3};
+
+            queue.cork();
+            enqueueBytes(queue, data, sizeof(data));
+
+            size_t received = 0;
+            for (int i = 0; i < 100 && received == 0; ++i) {
+                std::this_thread::sleep_for(5ms);
+                received = drain(fds[1]);
+            }
+            CHECK(received == 3);
+            CHECK(queue.pendingBytes() == 0);
+            queue.uncork();
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("Slow reader causes backpressure instead of blocking") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        int sendBuffer = 4096;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+        {
+            DoIPOutboundQueue queue(fds[0], 2ms, 16 * 1024);
+            std::atomic<int> congestedEvents{0};
+            std::atomic<int> drainedEvents{0};
+            queue.setCongestionHandler([&](bool congested) noexcept {
+                ++(congested ? congestedEvents : drainedEvents);
+            });
+
+            uint8_t chunk[1024] = {};
+            int chunks = 0;
+            while (!queue.isCongested() && chunks < 1000) {
+                REQUIRE(enqueueBytes(queue, chunk, sizeof(chunk)) == static_cast<ssize_t>(sizeof(chunk)));
+                ++chunks;
+            }
+            CHECK(queue.isCongested());
+            CHECK(congestedEvents == 1);
+
+            SUBCASE("Queue limit") {
+                ssize_t result = 0;
+                while (result >= 0) {
+                    result = enqueueBytes(queue, chunk, sizeof(chunk));
+                }
+                CHECK(errno == ENOBUFS);
+            }
+
+            // Once the peer reads, the queue is drained by the retry timer
+            for (int i = 0; i < 200 && queue.pendingBytes() > 0; ++i) {
+                drain(fds[1]);
+                std::this_thread::sleep_for(2ms);
+            }
+            CHECK(queue.pendingBytes() == 0);
+            CHECK_FALSE(queue.isCongested());
+            CHECK(drainedEvents == 1);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("A message larger than the queue limit is accepted by an empty queue") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        int sendBuffer = 4096;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+        {
+            constexpr size_t HIGH_WATERMARK = 4096;
+            DoIPOutboundQueue queue(fds[0], 2ms, HIGH_WATERMARK);
+            std::vector<uint8_t> message(8 * HIGH_WATERMARK, 0x36);
+            CHECK(enqueueBytes(queue, message.data(), message.size()) == static_cast<ssize_t>(message.size()));
+            CHECK(queue.pendingBytes() > 4 * HIGH_WATERMARK);
+
+            // Nothing more fits until the queue drained
+            uint8_t ack[] = {0xAA, 0xAA};
+            CHECK(enqueueBytes(queue, ack, sizeof(ack)) < 0);
+            CHECK(errno == ENOBUFS);
+
+            size_t received = 0;
+            for (int i = 0; i < 500 && received < message.size(); ++i) {
+                received += drain(fds[1]);
+                std::this_thread::sleep_for(1ms);
+            }
+            CHECK(received == message.size());
+            CHECK(queue.pendingBytes() == 0);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    TEST_CASE("Destroying a queue cancels a flush timer re-armed by its callback") {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        int sendBuffer = 4096;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+        // The peer never reads, so every flush timer callback arms the next timer
+        uint8_t chunk[1024] = {};
+        for (int round = 0; round < 20; ++round) {
+            DoIPOutboundQueue queue(fds[0], 1ms, 64 * 1024);
+            while (queue.pendingBytes() == 0) {
+                REQUIRE(enqueueBytes(queue, chunk, sizeof(chunk)) == static_cast<ssize_t>(sizeof(chunk)));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(round % 5));
+        }
+        CHECK(drain(fds[1]) > 0);
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
@@ -0,0 +1,71 @@
+#include <doctest/doctest.h>
+
+#include "DoIPRateLimiter.h"
+
+using namespace doip;
+using namespace std::chrono_literals;
+
+TEST_SUITE("DoIPRateLimiter") {
+    TEST_CASE("Burst, refill and separate buckets per source") {
+        DoIPRateLimiter limiter(16, DoIPRateLimit{10.0, 3.0}, DoIPRateLimit{1.0, 1.0});
+        auto now = DoIPRateLimiter::Clock::now();
+
+        CHECK(limiter.allowDatagram(1, now));
+        CHECK(limiter.allowDatagram(1, now));
+        CHECK(limiter.allowDatagram(1, now));
+        CHECK_FALSE(limiter.allowDatagram(1, now));
+
+        // Other sources and the NACK bucket are not affected
+        CHECK(limiter.allowDatagram(2, now));
+        CHECK(limiter.allowNack(1, now));
+        CHECK_FALSE(limiter.allowNack(1, now));
+
+        // 10 tokens per second: one token after 100 ms, never more than the burst
+        CHECK_FALSE(limiter.allowDatagram(1, now + 50ms));
+        CHECK(limiter.allowDatagram(1, now + 100ms));
+        CHECK_FALSE(limiter.allowDatagram(1, now + 100ms));
+        CHECK(limiter.allowNack(1, now + 1s));
+
+        auto later = now + 1h;
+        CHECK(limiter.allowDatagram(1, later));
+        CHECK(limiter.allowDatagram(1, later));
+        CHECK(limiter.allowDatagram(1, later));
+        CHECK_FALSE(limiter.allowDatagram(1, later));
+
+        CHECK(limiter.sourceCount() == 2);
+        CHECK(limiter.evictions() == 0);
+    }
+
+    TEST_CASE("A rate of 0 disables the limit") {
+        DoIPRateLimiter limiter(1, DoIPRateLimit{0.0, 1.0}, DoIPRateLimit{0.0, 1.0});
+        auto now = DoIPRateLimiter::Clock::now();
+        for (int i = 0; i < 100; ++i) {
+            CHECK(limiter.allowDatagram(1, now));
+            CHECK(limiter.allowNack(1, now));
+        }
+        CHECK(limiter.sourceCount() == 0);
+    }
+
+    TEST_CASE("The least recently seen source is evicted") {
+        DoIPRateLimiter limiter(3, DoIPRateLimit{1.0, 1.0}, DoIPRateLimit{});
+        REQUIRE(limiter.capacity() == 4);
+        auto now = DoIPRateLimiter::Clock::now();
+
+        // The table is smaller than the probe window, so all sources compete for it
+        for (uint32_t address = 1; address <= 4; ++address) {
+            CHECK(limiter.allowDatagram(address, now + std::chrono::milliseconds(address)));
+        }
+        CHECK(limiter.sourceCount() == 4);
+
+        // Source 1 is seen again, so source 2 is the least recently seen one
+        CHECK_FALSE(limiter.allowDatagram(1, now + 10ms));
+        CHECK(limiter.allowDatagram(5, now + 20ms));
+        CHECK(limiter.evictions() == 1);
+        CHECK(limiter.sourceCount() == 4);
+
+        // Source 1 is still limited, source 2 starts over with a full bucket
+        CHECK_FALSE(limiter.allowDatagram(1, now + 30ms));
+        CHECK(limiter.allowDatagram(2, now + 40ms));
+        CHECK(limiter.evictions() == 2);
+    }
+}
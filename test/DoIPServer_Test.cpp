@@ -1,9 +1,15 @@
 #include "DoIPServer.h"
 #include "DoIPMessage.h"
 #include "DoIPFurtherAction.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <memory>
 #include <doctest/doctest.h>
 #include <stdint.h>
 #include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
 
 #include "doctest_aux.h"
 
@@ -23,6 +29,70 @@ TEST_SUITE("DoIPServer Tests") {
         }
     };
 
+    /*
+     * A UDP server on the loopback discovery port and a tester socket sending to it.
+     * Adjust config before calling startServer().
+     */
+    struct DoIPUdpTesterFixture {
+        ServerConfig config;
+        std::unique_ptr<DoIPServer> udpServer;
+        sockaddr_in serverAddress{};
+        int tester;
+
+        DoIPUdpTesterFixture() {
+            config.loopback = true;
+            config.announceCount = 0;
+            serverAddress.sin_family = AF_INET;
+            serverAddress.sin_port = htons(DOIP_UDP_DISCOVERY_PORT);
+            serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            tester = openTester();
+        }
+
+        ~DoIPUdpTesterFixture() {
+            close(tester);
+            stopServer();
+        }
+
+        DoIPServer &startServer() {
+            udpServer = std::make_unique<DoIPServer>(config);
+            REQUIRE(udpServer->setupUdpSocket());
+            return *udpServer;
+        }
+
+        void stopServer() {
+            if (udpServer && udpServer->isRunning()) {
+                udpServer->closeUdpSocket();
+            }
+        }
+
+        static int openTester(timeval timeout = {0, 300000}) {
+            int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            REQUIRE(fd >= 0);
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            return fd;
+        }
+
+        void send(int fd, const uint8_t *data, size_t size) const {
+            REQUIRE(sendto(fd, data, size, 0, reinterpret_cast<const sockaddr *>(&serverAddress), sizeof(serverAddress)) > 0);
+        }
+
+        // Returns the reply, or an empty array if there is none
+        static ByteArray receive(int fd) {
+            uint8_t buffer[DOIP_MAXIMUM_MTU];
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            return received > 0 ? ByteArray(buffer, static_cast<size_t>(received)) : ByteArray{};
+        }
+
+        ByteArray exchange(const uint8_t *data, size_t size) {
+            send(tester, data, size);
+            return receive(tester);
+        }
+
+        ByteArray exchange(const DoIPMessage &msg) { return exchange(msg.data(), msg.size()); }
+
+        static ByteArray bytesOf(const DoIPMessage &msg) { return ByteArray(msg.data(), msg.size()); }
+    };
+
     /*
      * Test setting the VIN correctly
      */
@@ -61,4 +131,144 @@ TEST_SUITE("DoIPServer Tests") {
         auto zeros = std::count_if(payload.first + 17 + 2, payload.first + 17 + 2 + 6, [](uint8_t byte) { return byte == 0; });
         CHECK(zeros < 6); // At least one byte should not be zero
     }
-}
\ No newline at end of file
+
+    TEST_CASE_FIXTURE(DoIPServerFixture, "Vehicle identification response follows the identity") {
+        auto initial = server.getVehicleIdentificationResponse();
+        auto initialExpected = message::makeVehicleIdentificationResponse(DoIpVin::Zero, DefaultServerConfig.logicalAddress, DoIpEid::Zero, DoIpGid::Zero);
+        CHECK(initial->asByteArray() == initialExpected.asByteArray());
+
+        server.setVin("TESTVIN1234567890");
+        server.setEid(0x123456789ABC);
+        server.setGid(0xCBA987654321);
+        server.setLogicalGatewayAddress(DoIPAddress(0x0E00));
+        server.setFurtherActionRequired(DoIPFurtherAction::RoutingActivationForCentralSecurity);
+
+        auto expected = message::makeVehicleIdentificationResponse(DoIpVin("TESTVIN1234567890"), DoIPAddress(0x0E00), DoIpEid(0x123456789ABC),
+                                                                   DoIpGid(0xCBA987654321), DoIPFurtherAction::RoutingActivationForCentralSecurity);
+        CHECK(server.getVehicleIdentificationResponse()->asByteArray() == expected.asByteArray());
+
+        // Readers keep the response they got, the server released it
+        CHECK(initial.use_count() == 1);
+        CHECK(initial->asByteArray() == initialExpected.asByteArray());
+    }
+
+    TEST_CASE_FIXTURE(DoIPUdpTesterFixture, "UDP discovery replies go to each sender") {
+        config.udpBatchSize = 4;
+        config.vin = DoIpVin("TESTVIN1234567890");
+        DoIPServer &server = startServer();
+
+        auto request = message::makeVehicleIdentificationRequest();
+        const uint8_t garbage[] = {0x01, 0x02, 0x03};
+        int testers[] = {tester, openTester({2, 0}), openTester({2, 0})};
+        for (int i = 0; i < 2; ++i) {
+            send(testers[i], request.data(), request.size());
+        }
+        send(testers[2], garbage, sizeof(garbage));
+
+        auto expected = bytesOf(message::makeVehicleIdentificationResponse(config.vin, config.logicalAddress, config.eid, config.gid));
+        for (int i = 0; i < 2; ++i) {
+            CHECK(receive(testers[i]) == expected);
+        }
+        CHECK(receive(testers[2]) == bytesOf(message::makeNegativeAckMessage(DoIPNegativeAck::IncorrectPatternFormat)));
+
+        close(testers[1]);
+        close(testers[2]);
+        stopServer();
+
+        auto metrics = server.metrics();
+        CHECK(metrics.framesReceivedOf(DoIPPayloadType::VehicleIdentificationRequest) == 2);
+        CHECK(metrics.framesSentOf(DoIPPayloadType::VehicleIdentificationResponse) == 2);
+        CHECK(metrics.framesSentOf(DoIPPayloadType::NegativeAck) == 1);
+    }
+
+    TEST_CASE_FIXTURE(DoIPUdpTesterFixture, "UDP discovery protocol") {
+        config.vin = DoIpVin("TESTVIN1234567890");
+        config.eid = DoIpEid(0x123456789ABC);
+        config.maxConnections = 8;
+        DoIPServer &server = startServer();
+        server.setDiagnosticPowerMode(DoIPPowerMode::NotReady);
+
+        auto identification = bytesOf(*server.getVehicleIdentificationResponse());
+        CHECK(exchange(message::makeVehicleIdentificationRequestWithEid(config.eid)) == identification);
+        CHECK(exchange(message::makeVehicleIdentificationRequestWithVin(config.vin)) == identification);
+        CHECK(exchange(message::makeVehicleIdentificationRequestWithEid(DoIpEid(0x123456789ABD))).empty());
+        CHECK(exchange(message::makeVehicleIdentificationRequestWithVin(DoIpVin("TESTVIN1234567891"))).empty());
+
+        CHECK(exchange(message::makeEntityStatusRequest()) ==
+              bytesOf(message::makeEntityStatusResponse(DoIPNodeType::Gateway, 8, 0, DOIP_MAXIMUM_MTU)));
+        CHECK(exchange(message::makeDiagnosticPowerModeRequest()) ==
+              bytesOf(message::makeDiagnosticPowerModeResponse(DoIPPowerMode::NotReady)));
+
+        // Payload length does not match the payload type or the datagram
+        auto invalidLength = bytesOf(message::makeNegativeAckMessage(DoIPNegativeAck::InvalidPayloadLength));
+        CHECK(exchange(DoIPMessage(DoIPPayloadType::EntityStatusRequest, {0x00})) == invalidLength);
+        auto request = bytesOf(message::makeVehicleIdentificationRequestWithVin(config.vin));
+        CHECK(exchange(request.data(), request.size() - 1) == invalidLength);
+
+        // TCP only payload types
+        CHECK(exchange(message::makeAliveCheckRequest()) ==
+              bytesOf(message::makeNegativeAckMessage(DoIPNegativeAck::UnknownPayloadType)));
+    }
+
+    TEST_CASE_FIXTURE(DoIPUdpTesterFixture, "UDP requests are rate limited per source") {
+        config.udpDatagramLimit = DoIPRateLimit{0.01, 3.0};
+        config.udpNackLimit = DoIPRateLimit{0.01, 1.0};
+        DoIPServer &server = startServer();
+
+        // Two garbage datagrams, only the first one is answered
+        auto garbage = DoIPMessage(DoIPPayloadType::AliveCheckRequest, {});
+        CHECK_FALSE(exchange(garbage).empty());
+        CHECK(exchange(garbage).empty());
+
+        // The third datagram used up the burst
+        auto request = message::makeVehicleIdentificationRequest();
+        CHECK_FALSE(exchange(request).empty());
+        CHECK(exchange(request).empty());
+
+        auto metrics = server.metrics();
+        CHECK(metrics.udpDatagramsDropped == 1);
+        CHECK(metrics.udpNacksSuppressed == 1);
+        CHECK(metrics.framesReceivedOf(DoIPPayloadType::VehicleIdentificationRequest) == 1);
+    }
+
+    TEST_CASE("Connections above maxConnections are closed without delay") {
+        ServerConfig config;
+        config.loopback = true;
+        config.maxConnections = 0;
+        DoIPServer tcpServer(config);
+        REQUIRE(tcpServer.setupTcpSocket());
+        REQUIRE(tcpServer.startTcpListener());
+
+        sockaddr_in serverAddress{};
+        serverAddress.sin_family = AF_INET;
+        serverAddress.sin_port = htons(DOIP_SERVER_TCP_PORT);
+        serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        // The listener used to sleep 100 ms after each rejection
+        constexpr int CLIENTS = 5;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < CLIENTS; ++i) {
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            REQUIRE(client >= 0);
+            timeval timeout{2, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            // The listener thread calls listen() once it is running
+            int connected = -1;
+            for (int attempt = 0; attempt < 100 && connected != 0; ++attempt) {
+                connected = connect(client, reinterpret_cast<const sockaddr *>(&serverAddress), sizeof(serverAddress));
+                if (connected != 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            REQUIRE(connected == 0);
+            uint8_t buffer[8];
+            CHECK(recv(client, buffer, sizeof(buffer), 0) == 0);
+            close(client);
+        }
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100 * (CLIENTS - 1)));
+
+        auto metrics = tcpServer.metrics();
+        CHECK(metrics.connectionsRejected == CLIENTS);
+        CHECK(metrics.connectionsAccepted == 0);
+    }
+}
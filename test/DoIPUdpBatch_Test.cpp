@@ -0,0 +1,95 @@
+#include <doctest/doctest.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "DoIPUdpBatch.h"
+
+using namespace doip;
+
+namespace {
+
+// UDP socket bound to an ephemeral loopback port
+int openLoopbackSocket(sockaddr_in &address) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    REQUIRE(fd >= 0);
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+    socklen_t length = sizeof(address);
+    REQUIRE(getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) == 0);
+    return fd;
+}
+
+} // namespace
+
+TEST_SUITE("DoIPUdpBatch") {
+    TEST_CASE("Receives several datagrams at once and replies to each sender") {
+        sockaddr_in serverAddress;
+        int server = openLoopbackSocket(serverAddress);
+        constexpr size_t CLIENTS = 3;
+        int clients[CLIENTS];
+        sockaddr_in clientAddresses[CLIENTS];
+        for (size_t i = 0; i < CLIENTS; ++i) {
+            clients[i] = openLoopbackSocket(clientAddresses[i]);
+            uint8_t request[] = {0x02, 0xFD, 0x00, 0x01, 0, 0, 0, 0, static_cast<uint8_t>(i)};
+            REQUIRE(sendto(clients[i], request, sizeof(request), 0, reinterpret_cast<const sockaddr *>(&serverAddress), sizeof(serverAddress)) == sizeof(request));
+        }
+
+        DoIPUdpBatch batch(4);
+        REQUIRE(batch.receive(server) == CLIENTS);
+        REQUIRE(batch.size() == CLIENTS);
+        for (size_t i = 0; i < CLIENTS; ++i) {
+            auto [data, size] = batch.datagram(i);
+            REQUIRE(size == 9);
+            CHECK(data[8] == i);
+            CHECK(batch.sender(i).sin_port == clientAddresses[i].sin_port);
+
+            uint8_t reply[] = {0xA0, static_cast<uint8_t>(i)};
+            CHECK(batch.addReply(batch.sender(i), reply, sizeof(reply)));
+        }
+
+        uint8_t tooLarge[DOIP_UDP_REPLY_MAX_SIZE + 1] = {};
+        CHECK_FALSE(batch.addReply(batch.sender(0), tooLarge, sizeof(tooLarge)));
+        CHECK(batch.replyCount() == CLIENTS);
+
+        CHECK(batch.flush(server) == CLIENTS);
+        for (size_t i = 0; i < CLIENTS; ++i) {
+            CHECK(batch.isReplySent(i));
+            uint8_t buffer[16];
+            REQUIRE(recv(clients[i], buffer, sizeof(buffer), 0) == 2);
+            CHECK(buffer[0] == 0xA0);
+            CHECK(buffer[1] == i);
+            close(clients[i]);
+        }
+
+        // The capacity limits the number of replies
+        DoIPUdpBatch single(0);
+        CHECK(single.capacity() == 1);
+        uint8_t reply[] = {0xA0};
+        CHECK(single.addReply(clientAddresses[0], reply, sizeof(reply)));
+        CHECK_FALSE(single.addReply(clientAddresses[0], reply, sizeof(reply)));
+
+        close(server);
+    }
+
+    TEST_CASE("Receive times out without datagrams") {
+        sockaddr_in address;
+        int fd = openLoopbackSocket(address);
+        timeval timeout{0, 10000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        DoIPUdpBatch batch;
+        CHECK(batch.receive(fd) < 0);
+        CHECK((errno == EAGAIN || errno == EWOULDBLOCK));
+        CHECK(batch.size() == 0);
+        CHECK(batch.flush(fd) == 0);
+        close(fd);
+    }
+}
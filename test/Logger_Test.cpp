@@ -0,0 +1,38 @@
+#include <doctest/doctest.h>
+
+#include "Logger.h"
+
+using namespace doip;
+
+TEST_SUITE("Logger") {
+    TEST_CASE("Arguments are not evaluated for disabled levels") {
+        const auto previousLevel = Logger::get()->level();
+        Logger::setLevel(spdlog::level::warn);
+
+        int evaluations = 0;
+        auto evaluate = [&evaluations]() { return ++evaluations; };
+
+        LOG_DOIP_TRACE("value {}", evaluate());
+        LOG_DOIP_DEBUG("value {}", evaluate());
+        LOG_DOIP_INFO("value {}", evaluate());
+        LOG_DOIP_SUCCESS("value {}", evaluate());
+        CHECK(evaluations == 0);
+
+        LOG_DOIP_WARN("value {}", evaluate());
+        CHECK(evaluations == (DOIP_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN ? 1 : 0));
+
+        Logger::setLevel(previousLevel);
+    }
+
+    TEST_CASE("Cached handles refer to the registered loggers") {
+        CHECK(&Logger::doipLogger() == Logger::get().get());
+        CHECK(&Logger::udpLogger() == Logger::getUdp().get());
+        CHECK(&Logger::tcpLogger() == Logger::getTcp().get());
+
+        const auto previousLevel = Logger::get()->level();
+        Logger::setLevel(spdlog::level::err);
+        CHECK(Logger::doipLogger().level() == spdlog::level::err);
+        Logger::setLevel(previousLevel);
+        CHECK(Logger::doipLogger().level() == previousLevel);
+    }
+}
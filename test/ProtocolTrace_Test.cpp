@@ -0,0 +1,178 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "DoIPConnection.h"
+#include "DoIPMessage.h"
+#include "ProtocolTrace.h"
+
+using namespace doip;
+
+namespace {
+
+std::string tracePath(const char *name) {
+    return std::string("/tmp/libdoip_") + name + "_" + std::to_string(getpid()) + ".trace";
+}
+
+std::vector<TraceRecord> readTrace(const std::string &path) {
+    std::vector<TraceRecord> records;
+    ProtocolTraceReader reader(path);
+    REQUIRE(reader.isValid());
+    while (auto record = reader.next()) {
+        records.push_back(std::move(*record));
+    }
+    return records;
+}
+
+} // namespace
+
+TEST_SUITE("ProtocolTrace") {
+    TEST_CASE("Records are written and read back") {
+        auto path = tracePath("roundtrip");
+        auto &trace = ProtocolTrace::instance();
+
+        auto msg = message::makeAliveCheckResponse(0x0E80);
+        trace.record(TraceDirection::Rx, TraceTransport::Tcp, 1, msg.data(), msg.size());
+
+        REQUIRE(trace.start(path));
+        CHECK(trace.isEnabled());
+        CHECK_FALSE(trace.start(path));
+
+        trace.record(TraceDirection::Rx, TraceTransport::Tcp, 7, msg.data(), msg.size());
+        uint8_t part1[] = {0x01, 0x02};
+        uint8_t part2[] = {0x03};
+        iovec iov[] = {{part1, sizeof(part1)}, {part2, sizeof(part2)}};
+        trace.record(TraceDirection::Tx, TraceTransport::Udp, 0, iov, 2, true);
+        trace.stop();
+        CHECK_FALSE(trace.isEnabled());
+
+        // Not recorded while stopped
+        trace.record(TraceDirection::Rx, TraceTransport::Tcp, 1, msg.data(), msg.size());
+
+        auto records = readTrace(path);
+        REQUIRE(records.size() == 2);
+
+        CHECK(records[0].connectionId == 7);
+        CHECK(records[0].direction == TraceDirection::Rx);
+        CHECK(records[0].transport == TraceTransport::Tcp);
+        CHECK_FALSE(records[0].continuation);
+        CHECK(records[0].data == ByteArray(msg.data(), msg.size()));
+        CHECK(records[0].timestampNs > 0);
+
+        CHECK(records[1].connectionId == 0);
+        CHECK(records[1].direction == TraceDirection::Tx);
+        CHECK(records[1].transport == TraceTransport::Udp);
+        CHECK(records[1].continuation);
+        CHECK(records[1].data == ByteArray{0x01, 0x02, 0x03});
+        CHECK(records[1].timestampNs >= records[0].timestampNs);
+
+        std::remove(path.c_str());
+    }
+
+    TEST_CASE("Records of several threads are collected") {
+        auto path = tracePath("threads");
+        auto &trace = ProtocolTrace::instance();
+        REQUIRE(trace.start(path));
+
+        constexpr uint32_t kThreads = 4;
+        constexpr size_t kRecords = 200;
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&trace, t]() {
+                uint8_t data[16] = {};
+                for (size_t i = 0; i < kRecords; ++i) {
+                    data[0] = static_cast<uint8_t>(i);
+                    trace.record(TraceDirection::Tx, TraceTransport::Tcp, t, data, sizeof(data));
+                    if (i % 64 == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        trace.stop();
+
+        auto records = readTrace(path);
+        CHECK(records.size() + trace.droppedRecords() == kThreads * kRecords);
+
+        // Records of one thread keep their order
+        std::vector<size_t> expected(kThreads, 0);
+        for (const auto &record : records) {
+            REQUIRE(record.connectionId < kThreads);
+            CHECK(record.data.size() == 16);
+            CHECK(record.data[0] >= static_cast<uint8_t>(expected[record.connectionId]));
+            expected[record.connectionId] = record.data[0];
+        }
+
+        std::remove(path.c_str());
+    }
+
+    TEST_CASE("Concurrent start and stop") {
+        auto path = tracePath("lifecycle");
+        auto &trace = ProtocolTrace::instance();
+
+        // Threads racing start() against stop(), while new threads register their buffers
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&trace, &path, t]() {
+                for (int i = 0; i < 50; ++i) {
+                    if ((i + t) % 2 == 0) {
+                        trace.start(path);
+                    } else {
+                        trace.stop();
+                    }
+                    std::thread([&trace]() {
+                        uint8_t data[4] = {};
+                        trace.record(TraceDirection::Rx, TraceTransport::Tcp, 1, data, sizeof(data));
+                    }).join();
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        trace.stop();
+        CHECK_FALSE(trace.isEnabled());
+
+        REQUIRE(trace.start(path));
+        trace.stop();
+        CHECK(readTrace(path).empty());
+        std::remove(path.c_str());
+    }
+
+    TEST_CASE("Connection traces received and sent frames") {
+        auto path = tracePath("connection");
+        auto &trace = ProtocolTrace::instance();
+        REQUIRE(trace.start(path));
+
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            DoIPConnection connection(fds[0], std::make_unique<DefaultDoIPServerModel>());
+            auto request = message::makeRoutingActivationRequest(0x0E80);
+            REQUIRE(write(fds[1], request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+            REQUIRE(connection.receiveTcpMessage() == 1);
+            trace.stop();
+
+            auto records = readTrace(path);
+            REQUIRE(records.size() == 2);
+            CHECK(records[0].direction == TraceDirection::Rx);
+            CHECK(records[0].connectionId == static_cast<uint32_t>(fds[0]));
+            CHECK(records[0].data == ByteArray(request.data(), request.size()));
+            CHECK(records[1].direction == TraceDirection::Tx);
+            auto response = DoIPMessage::tryParse(records[1].data.data(), records[1].data.size());
+            REQUIRE(response.has_value());
+            CHECK(response->getPayloadType() == DoIPPayloadType::RoutingActivationResponse);
+        }
+        close(fds[1]);
+
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,257 @@
+#include <doctest/doctest.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <numeric>
+
+#include "RingQueue.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+template<typename Queue>
+void checkBasicContract() {
+    Queue queue(8);
+    CHECK(queue.capacity() == 8);
+    CHECK(queue.size() == 0);
+
+    CHECK(queue.push(1));
+    CHECK(queue.push(2));
+    CHECK(queue.size() == 2);
+
+    int item;
+    CHECK(queue.pop(item, 100ms));
+    CHECK(item == 1);
+    CHECK(queue.pop(item, 0ms));
+    CHECK(item == 2);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK_FALSE(queue.pop(item, 20ms));
+    CHECK(std::chrono::steady_clock::now() - start >= 15ms);
+}
+
+template<typename Queue>
+void checkStop() {
+    Queue queue(8);
+    queue.push(1);
+    queue.push(2);
+    queue.stop();
+
+    // Push after stop is ignored
+    CHECK_FALSE(queue.push(3));
+    CHECK(queue.size() == 2);
+
+    // Remaining items are still delivered
+    int item;
+    CHECK(queue.pop(item, 100ms));
+    CHECK(item == 1);
+    CHECK(queue.pop(item, 100ms));
+    CHECK(item == 2);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK_FALSE(queue.pop(item, 1000ms));
+    CHECK(std::chrono::steady_clock::now() - start < 50ms);
+}
+
+template<typename Queue>
+void checkBoundedCapacity() {
+    Queue queue(4);
+    for (int i = 0; i < 4; ++i) {
+        CHECK(queue.try_push(i));
+    }
+    CHECK_FALSE(queue.try_push(4));
+
+    // A blocked producer continues once the consumer makes room
+    std::atomic<bool> pushed{false};
+    std::thread producer([&queue, &pushed]() {
+        queue.push(4);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(20ms);
+    CHECK_FALSE(pushed);
+
+    int item;
+    CHECK(queue.pop(item, 100ms));
+    CHECK(item == 0);
+    producer.join();
+    CHECK(pushed);
+
+    for (int expected = 1; expected <= 4; ++expected) {
+        CHECK(queue.pop(item, 100ms));
+        CHECK(item == expected);
+    }
+}
+
+template<typename Queue>
+void checkBatchOperations() {
+    Queue queue(16);
+    std::vector<int> input(10);
+    std::iota(input.begin(), input.end(), 0);
+    CHECK(queue.push_n(input.data(), input.size()) == 10);
+    CHECK(queue.size() == 10);
+
+    int output[16];
+    CHECK(queue.pop_n(output, 4, 100ms) == 4);
+    CHECK(output[0] == 0);
+    CHECK(output[3] == 3);
+
+    // pop_n returns what is available without waiting for maxItems
+    CHECK(queue.pop_n(output, 16, 100ms) == 6);
+    CHECK(output[0] == 4);
+    CHECK(output[5] == 9);
+
+    CHECK(queue.pop_n(output, 16, 0ms) == 0);
+}
+
+template<typename Queue>
+void checkMoveOnly() {
+    Queue queue(4);
+    queue.push(std::make_unique<int>(42));
+    queue.push(std::make_unique<int>(24));
+
+    std::unique_ptr<int> item;
+    REQUIRE(queue.pop(item, 100ms));
+    REQUIRE(item != nullptr);
+    CHECK(*item == 42);
+
+    // The remaining element is destroyed with the queue
+}
+
+template<typename Queue>
+void checkTransfer(int producers, int consumers, int itemsPerProducer) {
+    Queue queue(64);
+    const int totalItems = producers * itemsPerProducer;
+    std::atomic<int> consumed{0};
+    std::atomic<long long> sum{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p, itemsPerProducer]() {
+            for (int i = 0; i < itemsPerProducer; ++i) {
+                queue.push(p * itemsPerProducer + i);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&queue, &consumed, &sum, totalItems]() {
+            int batch[8];
+            while (consumed < totalItems) {
+                size_t n = queue.pop_n(batch, 8, 10ms);
+                for (size_t i = 0; i < n; ++i) {
+                    sum += batch[i];
+                }
+                consumed += static_cast<int>(n);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    CHECK(consumed == totalItems);
+    CHECK(sum == static_cast<long long>(totalItems) * (totalItems - 1) / 2);
+    CHECK(queue.size() == 0);
+}
+
+} // namespace
+
+TEST_SUITE("SpscRingQueue") {
+    TEST_CASE("Basic push and pop operations") {
+        checkBasicContract<SpscRingQueue<int>>();
+    }
+
+    TEST_CASE("Stop functionality") {
+        checkStop<SpscRingQueue<int>>();
+    }
+
+    TEST_CASE("Bounded capacity") {
+        checkBoundedCapacity<SpscRingQueue<int>>();
+    }
+
+    TEST_CASE("Batch operations") {
+        checkBatchOperations<SpscRingQueue<int>>();
+    }
+
+    TEST_CASE("Move semantics") {
+        checkMoveOnly<SpscRingQueue<std::unique_ptr<int>>>();
+    }
+
+    TEST_CASE("Items keep FIFO order across threads") {
+        SpscRingQueue<int> queue(16);
+        constexpr int numItems = 100000;
+
+        std::thread producer([&queue]() {
+            std::vector<int> batch(5);
+            for (int i = 0; i < numItems; i += 5) {
+                std::iota(batch.begin(), batch.end(), i);
+                queue.push_n(batch.data(), batch.size());
+            }
+        });
+
+        int expected = 0;
+        bool ordered = true;
+        while (expected < numItems) {
+            int item;
+            if (queue.pop(item, 100ms)) {
+                ordered = ordered && item == expected;
+                ++expected;
+            }
+        }
+        producer.join();
+        CHECK(ordered);
+    }
+
+    TEST_CASE("Single producer single consumer transfer") {
+        checkTransfer<SpscRingQueue<int>>(1, 1, 50000);
+    }
+}
+
+TEST_SUITE("MpmcRingQueue") {
+    TEST_CASE("Basic push and pop operations") {
+        checkBasicContract<MpmcRingQueue<int>>();
+    }
+
+    TEST_CASE("Stop functionality") {
+        checkStop<MpmcRingQueue<int>>();
+    }
+
+    TEST_CASE("Bounded capacity") {
+        checkBoundedCapacity<MpmcRingQueue<int>>();
+    }
+
+    TEST_CASE("Batch operations") {
+        checkBatchOperations<MpmcRingQueue<int>>();
+    }
+
+    TEST_CASE("Move semantics") {
+        checkMoveOnly<MpmcRingQueue<std::unique_ptr<int>>>();
+    }
+
+    TEST_CASE("Stop wakes waiting consumers") {
+        MpmcRingQueue<int> queue;
+        std::atomic<bool> popResult{true};
+
+        std::thread consumer([&queue, &popResult]() {
+            int item;
+            popResult = queue.pop(item, 1000ms);
+        });
+
+        std::this_thread::sleep_for(20ms);
+        auto start = std::chrono::steady_clock::now();
+        queue.stop();
+        consumer.join();
+        CHECK_FALSE(popResult);
+        CHECK(std::chrono::steady_clock::now() - start < 500ms);
+    }
+
+    TEST_CASE("Multiple producers multiple consumers transfer") {
+        checkTransfer<MpmcRingQueue<int>>(4, 4, 20000);
+    }
+
+    TEST_CASE("Many producers single consumer transfer") {
+        checkTransfer<MpmcRingQueue<int>>(16, 1, 5000);
+    }
+}
@@ -0,0 +1,107 @@
+#include <doctest/doctest.h>
+#include <sstream>
+#include <utility>
+
+#include "DoIPMessage.h"
+#include "SmallByteArray.h"
+
+using namespace doip;
+
+TEST_SUITE("SmallByteArray") {
+    TEST_CASE("Short contents are stored inline") {
+        SmallByteArray<16> arr;
+        CHECK(arr.empty());
+        CHECK(arr.isInline());
+        CHECK(arr.capacity() == 16);
+
+        arr.writeU16BE(0x1234);
+        arr.writeU32BE(0xDEADBEEF);
+        arr.writeEnum(DoIPPayloadType::AliveCheckResponse);
+        CHECK(arr.size() == 8);
+        CHECK(arr.isInline());
+        CHECK(arr.readU16BE(0) == 0x1234);
+        CHECK(arr.readU32BE(2) == 0xDEADBEEF);
+        CHECK(arr.readEnum<DoIPPayloadType>(6) == DoIPPayloadType::AliveCheckResponse);
+        CHECK_THROWS(arr.readU32BE(6));
+    }
+
+    TEST_CASE("Large contents spill to the heap") {
+        SmallByteArray<8> arr{0x01, 0x02, 0x03};
+        for (uint8_t i = 0; i < 20; ++i) {
+            arr.push_back(i);
+        }
+        CHECK_FALSE(arr.isInline());
+        CHECK(arr.size() == 23);
+        CHECK(arr[0] == 0x01);
+        CHECK(arr[2] == 0x03);
+        CHECK(arr.back() == 19);
+
+        // The heap buffer is kept after clear()
+        arr.clear();
+        CHECK(arr.empty());
+        CHECK_FALSE(arr.isInline());
+    }
+
+    TEST_CASE("Insert and append") {
+        SmallByteArray<8> arr{0x01, 0x05};
+        const uint8_t middle[] = {0x02, 0x03, 0x04};
+        arr.insert(arr.begin() + 1, std::begin(middle), std::end(middle));
+        CHECK(arr == SmallByteArray<8>{0x01, 0x02, 0x03, 0x04, 0x05});
+
+        arr.insert(arr.end(), {0x06, 0x07, 0x08, 0x09});
+        arr.append(middle, sizeof(middle));
+        CHECK(arr.size() == 12);
+        CHECK(arr.at(8) == 0x09);
+        CHECK(arr.at(11) == 0x04);
+        CHECK_THROWS(arr.at(12));
+    }
+
+    TEST_CASE("Copy and move") {
+        SmallByteArray<8> small{0xAA, 0xBB};
+        SmallByteArray<8> large;
+        large.resize(32, 0xCC);
+
+        SmallByteArray<8> smallCopy(small);
+        SmallByteArray<8> largeCopy(large);
+        CHECK(smallCopy == small);
+        CHECK(largeCopy == large);
+
+        // Moving a heap buffer hands it over
+        const uint8_t *buffer = large.data();
+        SmallByteArray<8> moved(std::move(large));
+        CHECK(moved.data() == buffer);
+        CHECK(moved.size() == 32);
+
+        // Moving inline contents copies them
+        moved = std::move(smallCopy);
+        CHECK(moved.isInline());
+        CHECK(moved == small);
+
+        largeCopy = small;
+        CHECK(largeCopy == small);
+        CHECK(largeCopy.size() == 2);
+    }
+
+    TEST_CASE("Stream operator") {
+        SmallByteArray<8> arr{0x01, 0xAB};
+        std::ostringstream oss;
+        oss << arr;
+        CHECK(oss.str() == "01.AB");
+    }
+
+    TEST_CASE("Protocol control messages are stored inline") {
+        CHECK(message::makeAliveCheckRequest().buffer().isInline());
+        CHECK(message::makeAliveCheckResponse(0x0E80).buffer().isInline());
+        CHECK(message::makeDiagnosticPositiveResponse(0x0E80, 0x1234, ByteArray{0x22, 0xF1, 0x90}).buffer().isInline());
+
+        auto request = message::makeRoutingActivationRequest(0x0E80);
+        CHECK(request.buffer().isInline());
+        CHECK(message::makeRoutingActivationResponse(request, 0x1234).buffer().isInline());
+
+        ByteArray userData;
+        userData.resize(DOIP_MESSAGE_INLINE_SIZE);
+        auto diag = message::makeDiagnosticMessage(0x0E80, 0x1234, userData);
+        CHECK_FALSE(diag.buffer().isInline());
+        CHECK(diag.getDiagnosticMessagePayload().second == DOIP_MESSAGE_INLINE_SIZE);
+    }
+}
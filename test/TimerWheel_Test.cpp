@@ -0,0 +1,203 @@
+#include <atomic>
+#include <chrono>
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+
+#include "TimerWheel.h"
+
+using namespace std::chrono_literals;
+using namespace doip;
+
+TEST_SUITE("TimerWheel") {
+    TEST_CASE("One-shot timer expires not before its duration") {
+        TimerWheel wheel;
+        std::atomic<bool> fired{false};
+        auto started = std::chrono::steady_clock::now();
+        std::atomic<long long> elapsedMs{0};
+
+        auto handle = wheel.start(30ms, [&]() noexcept {
+            elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+            fired = true;
+        });
+        REQUIRE(handle != TimerWheel::INVALID_HANDLE);
+        CHECK(wheel.isActive(handle));
+        CHECK(wheel.timerCount() == 1);
+
+        std::this_thread::sleep_for(80ms);
+        CHECK(fired);
+        CHECK(elapsedMs >= 30);
+        CHECK_FALSE(wheel.isActive(handle));
+        CHECK(wheel.timerCount() == 0);
+    }
+
+    TEST_CASE("Null callback is rejected") {
+        TimerWheel wheel;
+        CHECK(wheel.start(10ms, nullptr) == TimerWheel::INVALID_HANDLE);
+    }
+
+    TEST_CASE("Cancelled timer does not fire and handle becomes stale") {
+        TimerWheel wheel;
+        std::atomic<bool> fired{false};
+
+        auto handle = wheel.start(30ms, [&]() noexcept { fired = true; });
+        CHECK(wheel.cancel(handle));
+        CHECK_FALSE(wheel.cancel(handle));
+        CHECK_FALSE(wheel.restart(handle));
+
+        std::this_thread::sleep_for(60ms);
+        CHECK_FALSE(fired);
+        CHECK(wheel.timerCount() == 0);
+    }
+
+    TEST_CASE("Restart postpones expiry") {
+        TimerWheel wheel;
+        std::atomic<bool> fired{false};
+
+        auto handle = wheel.start(60ms, [&]() noexcept { fired = true; });
+        for (int i = 0; i < 4; ++i) {
+            std::this_thread::sleep_for(30ms);
+            CHECK(wheel.restart(handle));
+        }
+        CHECK_FALSE(fired);
+
+        std::this_thread::sleep_for(100ms);
+        CHECK(fired);
+    }
+
+    TEST_CASE("Periodic timer") {
+        TimerWheel wheel;
+        std::atomic<int> count{0};
+
+        auto handle = wheel.start(20ms, [&]() noexcept { count++; }, true);
+        std::this_thread::sleep_for(110ms);
+        CHECK(count >= 3);
+        CHECK(wheel.isActive(handle));
+        CHECK(wheel.cancel(handle));
+    }
+
+    TEST_CASE("Timers beyond the first level cascade down and keep their order") {
+        TimerWheel wheel;
+        std::mutex mutex;
+        std::vector<int> order;
+
+        // 70ms and 150ms are beyond the 64 slots of level 0
+        auto h1 = wheel.start(150ms, [&]() noexcept { std::lock_guard<std::mutex> lock(mutex); order.push_back(3); });
+        auto h2 = wheel.start(70ms, [&]() noexcept { std::lock_guard<std::mutex> lock(mutex); order.push_back(2); });
+        auto h3 = wheel.start(10ms, [&]() noexcept { std::lock_guard<std::mutex> lock(mutex); order.push_back(1); });
+        (void)h1;
+        (void)h2;
+        (void)h3;
+
+        std::this_thread::sleep_for(250ms);
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(order == std::vector<int>{1, 2, 3});
+    }
+
+    TEST_CASE("Callback may cancel and restart timers") {
+        TimerWheel wheel;
+        std::atomic<int> count{0};
+        TimerWheel::TimerHandle handle = TimerWheel::INVALID_HANDLE;
+        std::atomic<bool> ready{false};
+
+        handle = wheel.start(10ms, [&]() noexcept {
+            while (!ready) {
+            }
+            if (++count < 3) {
+                wheel.restart(handle);
+            } else {
+                wheel.cancel(handle);
+            }
+        });
+        ready = true;
+
+        std::this_thread::sleep_for(100ms);
+        CHECK(count == 3);
+        CHECK(wheel.timerCount() == 0);
+    }
+
+    TEST_CASE("Many timers are served by one thread") {
+        TimerWheel wheel;
+        std::atomic<int> count{0};
+        std::vector<TimerWheel::TimerHandle> handles;
+
+        for (int i = 0; i < 1000; ++i) {
+            handles.push_back(wheel.start(std::chrono::milliseconds(10 + i % 50), [&]() noexcept { count++; }));
+        }
+        // Cancel every other timer
+        for (size_t i = 0; i < handles.size(); i += 2) {
+            CHECK(wheel.cancel(handles[i]));
+        }
+
+        std::this_thread::sleep_for(150ms);
+        CHECK(count == 500);
+        CHECK(wheel.timerCount() == 0);
+    }
+
+    TEST_CASE("WheelTimerManager") {
+        enum class TestTimer : uint8_t { One,
+                                         Two };
+        TimerWheel wheel;
+
+        SUBCASE("Add, restart and remove") {
+            WheelTimerManager<TestTimer> manager(wheel);
+            std::atomic<int> count{0};
+
+            auto id = manager.addTimer(TestTimer::One, 40ms, [&](TestTimer) noexcept { count++; });
+            REQUIRE(id.has_value());
+            CHECK(manager.hasTimer(TestTimer::One));
+            CHECK(manager.timerCount() == 1);
+
+            std::this_thread::sleep_for(25ms);
+            CHECK(manager.restartTimer(TestTimer::One));
+            std::this_thread::sleep_for(25ms);
+            CHECK(count == 0);
+
+            std::this_thread::sleep_for(50ms);
+            CHECK(count == 1);
+            CHECK_FALSE(manager.hasTimer(TestTimer::One)); // one-shot timer is removed
+            CHECK_FALSE(manager.restartTimer(TestTimer::One));
+
+            (void)manager.addTimer(TestTimer::Two, 10ms, [&](TestTimer) noexcept { count++; });
+            CHECK(manager.removeTimer(TestTimer::Two));
+            CHECK_FALSE(manager.removeTimer(TestTimer::Two));
+            std::this_thread::sleep_for(30ms);
+            CHECK(count == 1);
+        }
+
+        SUBCASE("Callback can stop all timers of its manager") {
+            WheelTimerManager<TestTimer> manager(wheel);
+            std::atomic<bool> fired{false};
+
+            (void)manager.addTimer(TestTimer::Two, 500ms, [&](TestTimer) noexcept { fired = true; });
+            (void)manager.addTimer(TestTimer::One, 10ms, [&](TestTimer) noexcept { manager.stopAll(); });
+
+            std::this_thread::sleep_for(50ms);
+            CHECK(manager.timerCount() == 0);
+            CHECK(wheel.timerCount() == 0);
+            CHECK_FALSE(fired);
+        }
+
+        SUBCASE("Destructor waits for running callback") {
+            std::atomic<bool> entered{false};
+            std::atomic<bool> finished{false};
+            {
+                WheelTimerManager<TestTimer> manager(wheel);
+                (void)manager.addTimer(TestTimer::One, 5ms, [&](TestTimer) noexcept {
+                    entered = true;
+                    std::this_thread::sleep_for(50ms);
+                    finished = true;
+                });
+                while (!entered) {
+                    std::this_thread::sleep_for(1ms);
+                }
+            }
+            CHECK(finished);
+        }
+
+        SUBCASE("Null callback is rejected") {
+            WheelTimerManager<TestTimer> manager(wheel);
+            CHECK_FALSE(manager.addTimer(TestTimer::One, 10ms, nullptr).has_value());
+        }
+    }
+}
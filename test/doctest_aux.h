@@ -2,9 +2,14 @@
 #define DOCTEST_AUX_H
 
 #include "ByteArray.h"
+#include "DoIPConnection.h"
+#include "DoIPMessage.h"
 #include <doctest/doctest.h>
 #include <iomanip>
+#include <optional>
 #include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace doip {
 namespace test {
@@ -52,6 +57,51 @@ inline bool compareByteArrays(const ByteArray &lhs_got, const ByteArray &rhs_exp
     return all_match;
 }
 
+/**
+ * @brief Read up to length bytes from a blocking socket
+ *
+ * @return the bytes read; shorter than length if the peer closed the socket
+ */
+inline ByteArray readAll(int fd, size_t length) {
+    ByteArray data;
+    data.resize(length);
+    size_t pos = 0;
+    while (pos < length) {
+        ssize_t n = recv(fd, data.data() + pos, length - pos, 0);
+        if (n <= 0) {
+            break;
+        }
+        pos += static_cast<size_t>(n);
+    }
+    data.resize(pos);
+    return data;
+}
+
+/**
+ * @brief Read one DoIP message from a blocking socket (test peer side)
+ *
+ * @param maxPayloadLength messages with a larger payload are rejected
+ * @return the message, or std::nullopt on an invalid header, an oversized payload or a closed socket
+ */
+inline std::optional<DoIPMessage> readMessage(int fd, size_t maxPayloadLength = DOIP_MAXIMUM_MTU) {
+    ByteArray message = readAll(fd, DOIP_HEADER_SIZE);
+    auto header = DoIPMessage::tryParseHeader(message.data(), message.size());
+    if (!header || header->second > maxPayloadLength) {
+        return std::nullopt;
+    }
+    ByteArray payload = readAll(fd, header->second);
+    message.insert(message.end(), payload.begin(), payload.end());
+    return DoIPMessage::tryParse(message.data(), message.size());
+}
+
+/**
+ * @brief Send a message to the connection and let it process it
+ */
+inline void sendToConnection(int fd, DoIPConnection &connection, const DoIPMessage &msg) {
+    REQUIRE(write(fd, msg.data(), msg.size()) == static_cast<ssize_t>(msg.size()));
+    REQUIRE(connection.receiveTcpMessage() == 1);
+}
+
 } // namespace test
 } // namespace doip
 
@@ -78,4 +78,64 @@ TEST_SUITE("UdsMock") {
         INFO(response);
         CHECK_BYTE_ARRAY_EQ(response, expectedResponse);
     }
+
+    TEST_CASE("UdsMock dispatches by SID and forgets unregistered services") {
+        static_assert(UDS_SERVICE_DESCRIPTOR_TABLE[0x22].service == UdsService::ReadDataByIdentifier);
+        static_assert(UDS_SERVICE_DESCRIPTOR_TABLE[0x22].minReqLength == 3);
+        static_assert(UDS_SERVICE_DESCRIPTOR_TABLE[0x12].maxReqLength == 0);
+        CHECK(findServiceDescriptor(static_cast<UdsService>(0x12)) == nullptr);
+
+        UdsMock udsMock;
+        udsMock.registerService(UdsService::TesterPresent,
+                                [](const ByteArray &request) {
+                                    return std::make_pair(uds::UdsResponseCode::OK, ByteArray{request[1]});
+                                });
+        udsMock.registerService(UdsService::ECUReset,
+                                [](const ByteArray &request) {
+                                    return std::make_pair(uds::UdsResponseCode::OK, ByteArray{request[1]});
+                                });
+
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x3E, 0x00}) == ByteArray{0x7E, 0x00});
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x11, 0x01}) == ByteArray{0x51, 0x01});
+        // Unknown SID
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x12, 0x01}) == ByteArray{0x7F, 0x12, 0x11});
+
+        udsMock.unregisterService(UdsService::TesterPresent);
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x3E, 0x00}) == ByteArray{0x7F, 0x3E, 0x11});
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x11, 0x01}) == ByteArray{0x51, 0x01});
+
+        udsMock.clear();
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x11, 0x01}) == ByteArray{0x7F, 0x11, 0x11});
+    }
+
+    TEST_CASE("UdsMock writes the response in place into a diagnostic message") {
+        UdsMock udsMock;
+        udsMock.registerReadDataByIdentifierHandler([](uint16_t did, UdsResponseWriter &writer) {
+            if (did != 0xF190) {
+                writer.writeU8(0xAA); // discarded
+                return UdsResponseCode::RequestOutOfRange;
+            }
+            writer.write(ByteArray{'V', 'I', 'N'});
+            return UdsResponseCode::OK;
+        });
+        udsMock.registerService(UdsService::TesterPresent,
+                                [](const ByteArray &request) {
+                                    return std::make_pair(uds::UdsResponseCode::OK, ByteArray{request[1]});
+                                });
+
+        DoIPMessage response = udsMock.handleDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1001), ByteArray{0x22, 0xF1, 0x90});
+        DoIPMessage expected = message::makeDiagnosticMessage(DoIPAddress(0x1001), DoIPAddress(0x0E80), ByteArray{0x62, 0xF1, 0x90, 'V', 'I', 'N'});
+        CHECK(response.asByteArray() == expected.asByteArray());
+
+        response = udsMock.handleDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1001), ByteArray{0x22, 0xF1, 0x91});
+        expected = message::makeDiagnosticMessage(DoIPAddress(0x1001), DoIPAddress(0x0E80), ByteArray{0x7F, 0x22, 0x31});
+        CHECK(response.asByteArray() == expected.asByteArray());
+
+        // Handlers returning their parameters are written into the message as well
+        response = udsMock.handleDiagnosticMessage(DoIPAddress(0x0E80), DoIPAddress(0x1001), ByteArray{0x3E, 0x00});
+        expected = message::makeDiagnosticMessage(DoIPAddress(0x1001), DoIPAddress(0x0E80), ByteArray{0x7E, 0x00});
+        CHECK(response.asByteArray() == expected.asByteArray());
+
+        CHECK(udsMock.handleDiagnosticRequest(ByteArray{0x22, 0xF1, 0x90}) == ByteArray{0x62, 0xF1, 0x90, 'V', 'I', 'N'});
+    }
 }
@@ -0,0 +1,232 @@
+/*
+ * Decodes a binary protocol trace written by doip::ProtocolTrace.
+ *
+ * Prints one line per record, or converts the trace to a pcap file that
+ * Wireshark decodes with its DoIP dissector. Since the trace holds no
+ * addresses, the pcap uses synthetic IPv4 addresses: the server is 10.0.0.1,
+ * a TCP connection with id N is the client 10.x.y.z (the low 24 bits of N),
+ * UDP peers are 10.255.255.254.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DoIPMessage.h"
+#include "DoIPServer.h"
+#include "ProtocolTrace.h"
+
+using namespace doip;
+using namespace std;
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC_NANOSECONDS = 0xA1B23C4D;
+constexpr uint32_t PCAP_LINKTYPE_RAW = 101;
+constexpr uint32_t PCAP_SNAPLEN = 65535;
+constexpr size_t IPV4_HEADER_SIZE = 20;
+constexpr size_t TCP_HEADER_SIZE = 20;
+constexpr size_t UDP_HEADER_SIZE = 8;
+constexpr size_t MAX_SEGMENT_SIZE = 65000;
+constexpr uint32_t SERVER_IP = 0x0A000001;
+constexpr uint32_t UDP_PEER_IP = 0x0AFFFFFE;
+constexpr uint16_t CLIENT_TCP_PORT = 50000;
+constexpr auto SERVER_TCP_PORT = static_cast<uint16_t>(DOIP_SERVER_TCP_PORT);
+constexpr auto SERVER_UDP_PORT = static_cast<uint16_t>(DOIP_UDP_DISCOVERY_PORT);
+constexpr auto CLIENT_UDP_PORT = static_cast<uint16_t>(DOIP_UDP_TEST_EQUIPMENT_REQUEST_PORT);
+
+void printUsage(const char *progName) {
+    cout << "Usage: " << progName << " <trace file> [OPTIONS]\n";
+    cout << "Options:\n";
+    cout << "  --pcap <file>  Write a pcap file instead of printing the records\n";
+    cout << "  --help         Show this help message\n";
+}
+
+void printRecord(const TraceRecord &record) {
+    time_t seconds = static_cast<time_t>(record.timestampNs / 1000000000ULL);
+    tm local{};
+    localtime_r(&seconds, &local);
+
+    cout << put_time(&local, "%Y-%m-%d %H:%M:%S") << '.' << setw(9) << setfill('0')
+         << record.timestampNs % 1000000000ULL << setfill(' ')
+         << (record.transport == TraceTransport::Udp ? " UDP " : " TCP ")
+         << setw(5) << record.connectionId
+         << (record.direction == TraceDirection::Rx ? " RX " : " TX ")
+         << setw(6) << record.data.size() << " bytes ";
+
+    if (record.continuation) {
+        cout << "(continued)";
+    } else if (auto header = DoIPMessage::tryParseHeader(record.data.data(), record.data.size()); header.has_value()) {
+        cout << header->first;
+    } else {
+        cout << "(invalid header)";
+    }
+    cout << ' ' << record.data << '\n';
+}
+
+void put16(vector<uint8_t> &out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void put32(vector<uint8_t> &out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value >> 16));
+    put16(out, static_cast<uint16_t>(value));
+}
+
+// pcap file and record headers are written in host byte order, as the magic number tells readers
+void writeHost32(FILE *file, uint32_t value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+void writeHost16(FILE *file, uint16_t value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+class PcapWriter {
+  public:
+    explicit PcapWriter(FILE *file) : m_file(file) {
+        writeHost32(m_file, PCAP_MAGIC_NANOSECONDS);
+        writeHost16(m_file, 2);
+        writeHost16(m_file, 4);
+        writeHost32(m_file, 0);
+        writeHost32(m_file, 0);
+        writeHost32(m_file, PCAP_SNAPLEN);
+        writeHost32(m_file, PCAP_LINKTYPE_RAW);
+    }
+
+    void write(const TraceRecord &record) {
+        // Large streamed messages do not fit into one IPv4 packet
+        size_t offset = 0;
+        do {
+            size_t length = min(MAX_SEGMENT_SIZE, record.data.size() - offset);
+            writePacket(record, record.data.data() + offset, length);
+            offset += length;
+        } while (offset < record.data.size());
+    }
+
+  private:
+    FILE *m_file;
+    // Next sequence number per connection and direction
+    map<pair<uint32_t, TraceDirection>, uint32_t> m_sequence;
+
+    void writePacket(const TraceRecord &record, const uint8_t *data, size_t length) {
+        bool rx = record.direction == TraceDirection::Rx;
+        bool udp = record.transport == TraceTransport::Udp;
+        uint32_t peerIp = udp ? UDP_PEER_IP : (0x0A000000 | (record.connectionId & 0xFFFFFF));
+        size_t transportHeaderSize = udp ? UDP_HEADER_SIZE : TCP_HEADER_SIZE;
+
+        vector<uint8_t> packet;
+        packet.reserve(IPV4_HEADER_SIZE + transportHeaderSize + length);
+
+        // IPv4 header, checksum left zero
+        packet.push_back(0x45);
+        packet.push_back(0);
+        put16(packet, static_cast<uint16_t>(IPV4_HEADER_SIZE + transportHeaderSize + length));
+        put32(packet, 0x00004000); // id 0, don't fragment
+        packet.push_back(64);
+        packet.push_back(udp ? 17 : 6);
+        put16(packet, 0);
+        put32(packet, rx ? peerIp : SERVER_IP);
+        put32(packet, rx ? SERVER_IP : peerIp);
+
+        if (udp) {
+            put16(packet, rx ? CLIENT_UDP_PORT : SERVER_UDP_PORT);
+            put16(packet, rx ? SERVER_UDP_PORT : CLIENT_UDP_PORT);
+            put16(packet, static_cast<uint16_t>(UDP_HEADER_SIZE + length));
+            put16(packet, 0);
+        } else {
+            TraceDirection reverse = rx ? TraceDirection::Tx : TraceDirection::Rx;
+            uint32_t &sequence = sequenceOf(record.connectionId, record.direction);
+            put16(packet, rx ? CLIENT_TCP_PORT : SERVER_TCP_PORT);
+            put16(packet, rx ? SERVER_TCP_PORT : CLIENT_TCP_PORT);
+            put32(packet, sequence);
+            put32(packet, sequenceOf(record.connectionId, reverse));
+            packet.push_back(0x50); // header length 5 words
+            packet.push_back(0x18); // PSH, ACK
+            put16(packet, 0xFFFF);
+            put16(packet, 0);
+            put16(packet, 0);
+            sequence += static_cast<uint32_t>(length);
+        }
+        packet.insert(packet.end(), data, data + length);
+
+        writeHost32(m_file, static_cast<uint32_t>(record.timestampNs / 1000000000ULL));
+        writeHost32(m_file, static_cast<uint32_t>(record.timestampNs % 1000000000ULL));
+        writeHost32(m_file, static_cast<uint32_t>(packet.size()));
+        writeHost32(m_file, static_cast<uint32_t>(packet.size()));
+        fwrite(packet.data(), 1, packet.size(), m_file);
+    }
+
+    uint32_t &sequenceOf(uint32_t connectionId, TraceDirection direction) {
+        return m_sequence.try_emplace({connectionId, direction}, 1).first->second;
+    }
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    string traceFile;
+    string pcapFile;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--pcap" && i + 1 < argc) {
+            pcapFile = argv[++i];
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (traceFile.empty() && arg.rfind("--", 0) != 0) {
+            traceFile = arg;
+        } else {
+            cout << "Unknown argument: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (traceFile.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ProtocolTraceReader reader(traceFile);
+    if (!reader.isValid()) {
+        cerr << "Not a protocol trace file: " << traceFile << endl;
+        return 1;
+    }
+
+    // Each recording thread has its own buffer, so the file is only ordered per thread
+    vector<TraceRecord> records;
+    while (auto record = reader.next()) {
+        records.push_back(std::move(*record));
+    }
+    stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b) {
+        return a.timestampNs < b.timestampNs;
+    });
+
+    if (pcapFile.empty()) {
+        for (const auto &record : records) {
+            printRecord(record);
+        }
+        return 0;
+    }
+
+    FILE *file = fopen(pcapFile.c_str(), "wb");
+    if (file == nullptr) {
+        cerr << "Could not open " << pcapFile << endl;
+        return 1;
+    }
+    PcapWriter writer(file);
+    for (const auto &record : records) {
+        writer.write(record);
+    }
+    fclose(file);
+    cout << "Wrote " << records.size() << " records to " << pcapFile << endl;
+    return 0;
+}